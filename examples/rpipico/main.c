@@ -4,6 +4,7 @@
 #include "hardware/watchdog.h"
 
 #include "libdaikin.h"
+#include "libdaikinsched.h"
 
 #include "port_common.h"
 #include "wizchip_conf.h"
@@ -44,7 +45,6 @@ void main(void)
 {
     // Wait for N seconds, before Daiking timeouts on DHCP and fails back to default IP.
     const unsigned char dhcp_timeout_delay = 35;
-    const unsigned char next_query_delay = 10;
 
     set_clock_khz();
     stdio_init_all();
@@ -73,6 +73,11 @@ void main(void)
 
     daikin_t daikin = { 0 };
     daikin_device_info_t info = { 0 };
+    daikin_sched_t sched;
+    uint32_t updated_mask;
+
+    // Fields are read as often as they change, within the default request budget
+    daikin_sched_init(&sched, NULL);
 
     // Try to connect.
     // If not successful -> reboot.
@@ -89,12 +94,18 @@ void main(void)
 
     while (1)
     {
-        if (daikin_get_device_info(&daikin, &info) == false)
+        if (daikin_sched_poll(&sched, &daikin, to_ms_since_boot(get_absolute_time()), &info, &updated_mask) == false)
         {
-            puts("daikin_get_device_info error!");
+            puts("daikin_sched_poll error!");
             goto daikin_close_reboot;
         }
 
+        if (updated_mask == 0)
+        {
+            sleep_ms(daikin_sched_next_delay(&sched, to_ms_since_boot(get_absolute_time())));
+            continue;
+        }
+
         printf("Outdoor Temperature:       %.1f\n", info.outdoor_temp);
         printf("Indoor Temperature:        %.1f\n", info.indoor_temp);
         printf("Leaving Water Temperature: %.1f\n", info.leaving_water_temp);
@@ -106,8 +117,6 @@ void main(void)
         printf("Error State:               %d\n", info.error_state);
         printf("Warning State:             %d\n", info.warning_state);
         puts("");
-
-        sleep_ms(next_query_delay * 1000);
     }
 
 daikin_close_reboot:
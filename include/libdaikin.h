@@ -10,6 +10,24 @@ extern "C" {
 
 #include "libdaikinhal.h"
 
+// Known resource paths for daikin_read_* / daikin_write_*
+// Other paths of the adapter can be used as well, they are just not validated.
+#define DAIKIN_PATH_INDOOR_TEMP         "MNAE/1/Sensor/IndoorTemperature"
+#define DAIKIN_PATH_OUTDOOR_TEMP        "MNAE/1/Sensor/OutdoorTemperature"
+#define DAIKIN_PATH_LEAVING_WATER_TEMP  "MNAE/1/Sensor/LeavingWaterTemperatureCurrent"
+#define DAIKIN_PATH_TEMP_TARGET         "MNAE/1/Operation/TargetTemperature"
+#define DAIKIN_PATH_TEMP_OFFSET         "MNAE/1/Operation/LeavingWaterTemperatureOffsetHeating"
+#define DAIKIN_PATH_POWER_STATE         "MNAE/1/Operation/Power"
+#define DAIKIN_PATH_OPERATION_MODE      "MNAE/1/Operation/OperationMode"
+#define DAIKIN_PATH_EMERGENCY_STATE     "MNAE/1/UnitStatus/EmergencyState"
+#define DAIKIN_PATH_ERROR_STATE         "MNAE/1/UnitStatus/ErrorState"
+#define DAIKIN_PATH_WARNING_STATE       "MNAE/1/UnitStatus/WarningState"
+#define DAIKIN_PATH_CONSUMPTION         "MNAE/1/Consumption"
+#define DAIKIN_PATH_TANK_TEMP           "MNAE/2/Sensor/TankTemperature"
+#define DAIKIN_PATH_TANK_TEMP_TARGET    "MNAE/2/Operation/TargetTemperature"
+#define DAIKIN_PATH_TANK_POWER_STATE    "MNAE/2/Operation/Power"
+#define DAIKIN_PATH_TANK_CONSUMPTION    "MNAE/2/Consumption"
+
 typedef enum
 {
     PS_UNKNOWN,
@@ -24,11 +42,6 @@ typedef enum
     TM_OFFSET
 } daikin_temperature_mode_t;
 
-typedef struct
-{
-    bool is_open;
-    daikin_hal_tcp_t tcp;
-} daikin_t;
 
 typedef struct
 {
@@ -45,13 +58,171 @@ typedef struct
     int8_t temp_offset;
 } daikin_device_info_t;
 
+// Identifies individual values of daikin_device_info_t
+typedef enum
+{
+    DF_INDOOR_TEMP,
+    DF_OUTDOOR_TEMP,
+    DF_LEAVING_WATER_TEMP,
+    DF_POWER_STATE,
+    DF_EMERGENCY_STATE,
+    DF_ERROR_STATE,
+    DF_WARNING_STATE,
+    DF_TEMP_MODE,
+    DF_TEMP_TARGET,
+    DF_TEMP_OFFSET,
+    DF_COUNT
+} daikin_field_t;
+
+// Fields read by daikin_get_device_info, others stay 0. Fewer fields => fewer round trips per poll,
+// e.g. -DDAIKIN_DEVICE_INFO_FIELDS="((1u << DF_INDOOR_TEMP) | (1u << DF_POWER_STATE))".
+// See libdaikinfields.h for a struct with only the wanted members.
+#ifndef DAIKIN_DEVICE_INFO_FIELDS
+#   define DAIKIN_DEVICE_INFO_FIELDS    (0xFFFFFFFFu)
+#endif
+
+// path is the resource path of the notification (without "/la").
+// field is DF_COUNT for paths which are not part of daikin_device_info_t.
+typedef void (*daikin_notify_cb)(void* ctx, const char* path, daikin_field_t field, const daikin_device_info_t* info);
+
+// Request pacing (see daikin_limiter_init)
+typedef struct
+{
+    float    rate_per_s;         // Token refill, 0 => unlimited rate
+    uint16_t burst;              // Token bucket capacity
+    uint8_t  max_in_flight;      // Requests in flight at once over all sessions sharing the limiter, 0 => 1
+    uint32_t latency_target_ms;  // Rate halves when a response is slower, 0 => fixed rate
+} daikin_limits_t;
+
+typedef struct
+{
+    uint8_t  in_flight;          // Acquired, response not received yet (> 1 with sessions sharing the limiter)
+    uint8_t  waiting;            // Callers waiting for a token or a free in-flight slot
+    uint8_t  queue_depth;        // in_flight + waiting
+    uint8_t  max_queue_depth;
+    float    rate_per_s;         // Current token refill (AIMD), limits.rate_per_s at most
+    uint32_t requests;
+    uint32_t throttled;          // Requests which had to wait for a token
+    uint32_t wait_ms;            // Total time spent waiting for tokens and slots
+    uint32_t window_full;        // Requests which found max_in_flight requests in flight
+    uint32_t decreases;          // Rate decreases (slow responses or failures)
+    uint32_t last_latency_ms;
+    uint32_t avg_latency_ms;     // Exponential moving average
+} daikin_limiter_stats_t;
+
+typedef struct
+{
+    daikin_limits_t limits;
+    float    tokens;
+    uint32_t last_refill_ms;
+    uint32_t last_decrease_ms;
+    uint8_t  lock;               // Spinlock, sessions of other threads can share the limiter (fleet, pool)
+    daikin_limiter_stats_t stats;
+} daikin_limiter_t;
+
+// Default bound of a buffered message (all fragments), larger messages fail
+#ifndef DAIKIN_WS_MAX_MESSAGE
+#   define DAIKIN_WS_MAX_MESSAGE    (16 * 1024)
+#endif
+
+// permessage-deflate (RFC 7692) needs a build with DAIKIN_WS_DEFLATE (zlib) and daikin_t.ws_deflate.
+// The window (9-15) is offered for both directions, memory ~ (5 << bits) + (1 << (mem level + 9)) bytes + 7 KiB.
+#ifndef DAIKIN_WS_DEFLATE_WINDOW_BITS
+#   define DAIKIN_WS_DEFLATE_WINDOW_BITS    (10)
+#endif
+#ifndef DAIKIN_WS_DEFLATE_MEM_LEVEL
+#   define DAIKIN_WS_DEFLATE_MEM_LEVEL      (4)
+#endif
+
+// Message payload in chunks of at most 256 bytes, last is set on the final one. false => abort
+typedef bool (*daikin_chunk_cb)(void* ctx, const char* data, uint32_t len, bool last);
+
+// Set in daikin_t.capabilities once the supported paths are known
+#define DAIKIN_CAPS_DISCOVERED      (1u << 31)
+
+typedef struct
+{
+    bool is_open;
+    daikin_hal_tcp_t tcp;
+    uint32_t capabilities; // Bit per known path, 0 => not discovered (all paths are tried)
+
+    daikin_device_info_t* notify_info; // Updated by notifications, can be NULL
+    daikin_notify_cb notify_cb;
+    void* notify_ctx;
+
+    daikin_limiter_t* limiter; // NULL => requests are not paced
+
+    uint32_t max_message_len; // 0 => DAIKIN_WS_MAX_MESSAGE
+
+    bool ws_deflate;        // Offer permessage-deflate when opening (DAIKIN_WS_DEFLATE builds)
+    void* ws_deflate_state; // Negotiated compression, owned by the library, NULL => uncompressed
+} daikin_t;
+
 bool daikin_open(daikin_t* const daikin);
 bool daikin_get_device_info(const daikin_t* const daikin, daikin_device_info_t* const info);
+bool daikin_get_field(const daikin_t* const daikin, daikin_field_t field, daikin_device_info_t* const info);
 bool daikin_set_temp_target(const daikin_t* const daikin, uint8_t temp_target);
 bool daikin_set_temp_offset(const daikin_t* const daikin, int8_t temp_offset);
 bool daikin_set_power_state(const daikin_t* const daikin, daikin_power_state_t power_state);
 void daikin_close(daikin_t* const daikin);
 
+// Absolute deadline (daikin_hal_time_ms) of the following requests, 0 => none, e.g. the end of
+// the control period: daikin_set_deadline(&daikin, daikin_hal_time_ms() + 200).
+// It bounds rate limiter waits, reads and writes. A request which missed it returns false
+// and may leave a frame half read: close and open the session before the next one.
+void daikin_set_deadline(daikin_t* const daikin, uint32_t deadline_ms);
+
+// Running and following requests fail (within DAIKIN_HAL_CANCEL_CHECK ms), safe from any thread.
+// Cleared by daikin_open.
+void daikin_cancel(daikin_t* const daikin);
+
+// daikin_get_device_info which keeps what it got: fields receives a bit (1u << DF_*) per value read,
+// also when it fails (e.g. at the deadline). Values without a bit are not valid.
+bool daikin_get_device_info_partial(const daikin_t* const daikin, daikin_device_info_t* const info, uint32_t* const fields);
+
+// Probes all known paths (DAIKIN_PATH_*) and fills daikin->capabilities.
+// Unsupported paths are skipped by later reads.
+bool daikin_discover(daikin_t* const daikin);
+bool daikin_is_supported(const daikin_t* const daikin, const char* const path); // Unknown paths => true
+
+// Capability cache (e.g. a file or a flash blob) to skip discovery on later opens.
+// Loading fails for a blob of another registry (paths added or changed), discovery is needed then.
+#define DAIKIN_CAPABILITIES_BLOB_LEN (18)
+
+uint16_t daikin_capabilities_save(const daikin_t* const daikin, uint8_t* const blob, uint16_t blob_len); // Returns length, 0 => error
+bool     daikin_capabilities_load(daikin_t* const daikin, const uint8_t* const blob, uint16_t blob_len);
+bool     daikin_capabilities_save_file(const daikin_t* const daikin, const char* const file_name);
+bool     daikin_capabilities_load_file(daikin_t* const daikin, const char* const file_name);
+
+// Subscriptions replace polling. Notifications update notify_info and call notify_cb.
+// They are processed by daikin_wait_notification (blocking) or while waiting for any response.
+void daikin_set_notify(daikin_t* const daikin, daikin_device_info_t* const info, daikin_notify_cb cb, void* ctx);
+bool daikin_subscribe(const daikin_t* const daikin, daikin_field_t field);
+bool daikin_unsubscribe(const daikin_t* const daikin, daikin_field_t field);
+bool daikin_wait_notification(const daikin_t* const daikin);
+
+// Request pacing: token bucket with a latency driven rate (AIMD) and a concurrency cap.
+// Assign the limiter to daikin_t.limiter, limits can be NULL => defaults. Sessions sharing it
+// (also from other threads) share the rate and the in-flight slots, e.g. all sessions of one adapter.
+// A request waits for a token and a slot at most until its deadline.
+void daikin_limiter_init(daikin_limiter_t* const limiter, const daikin_limits_t* const limits);
+void daikin_limiter_get_stats(daikin_limiter_t* const limiter, daikin_limiter_stats_t* const stats); // Takes the lock
+
+// Generic access to any resource path (without the trailing "/la").
+// Known paths (DAIKIN_PATH_*) are checked for type and valid range.
+// Strings are returned without quotes, JSON objects are returned as raw text.
+bool daikin_read_float(const daikin_t* const daikin, const char* const path, float* const v);
+bool daikin_read_int(const daikin_t* const daikin, const char* const path, int32_t* const v);
+bool daikin_read_string(const daikin_t* const daikin, const char* const path, char* const v, uint16_t v_len);
+bool daikin_write_float(const daikin_t* const daikin, const char* const path, float v);
+bool daikin_write_int(const daikin_t* const daikin, const char* const path, int32_t v);
+bool daikin_write_string(const daikin_t* const daikin, const char* const path, const char* const v);
+
+// Reads the path and streams the raw response JSON (m2m:rsp) to cb without buffering it,
+// for responses larger than max_message_len. The head (rsc, rqi, to, fr) is checked before
+// the first chunk, error responses fail without calling cb. The caller parses con.
+bool daikin_read_stream(const daikin_t* const daikin, const char* const path, daikin_chunk_cb cb, void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,80 @@
+#ifndef __LIB_DAIKIN_CMDQ_H__
+#define __LIB_DAIKIN_CMDQ_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Command queue in front of daikin_set_temp_target, daikin_set_temp_offset
+// and daikin_set_power_state.
+//
+// Only the last requested value per set point matters: a queued write is replaced
+// (superseded) by a newer one and a write equal to the last known value is skipped.
+// Queued writes are sent by daikin_cmdq_flush from the main loop, at most one write
+// per set point every min_interval_ms, so the adapter write load stays bounded
+// no matter how often the controller changes its mind.
+
+#define DAIKIN_CMDQ_MIN_INTERVAL    (2000) // Default ms between writes of the same set point
+#define DAIKIN_CMDQ_SLOTS           (3)    // Target temperature, offset, power state
+
+typedef enum
+{
+    CR_WRITTEN,     // Adapter accepted the value
+    CR_SKIPPED,     // Equal to the last known value, nothing was sent
+    CR_SUPERSEDED,  // Replaced by a newer value before it was sent
+    CR_FAILED       // Write failed, value is unknown now
+} daikin_cmd_result_t;
+
+// field is DF_TEMP_TARGET, DF_TEMP_OFFSET or DF_POWER_STATE
+typedef void (*daikin_cmd_done_cb)(void* ctx, daikin_field_t field, int32_t value, daikin_cmd_result_t result);
+
+typedef struct
+{
+    bool     pending;
+    int32_t  value;
+    daikin_cmd_done_cb cb;
+    void*    ctx;
+
+    bool     known;      // last_value is what the adapter has
+    int32_t  last_value;
+    bool     written;    // last_write_ms is valid
+    uint32_t last_write_ms;
+} daikin_cmdq_slot_t;
+
+typedef struct
+{
+    uint32_t min_interval_ms;
+    daikin_cmdq_slot_t slots[DAIKIN_CMDQ_SLOTS];
+
+    uint32_t writes;     // Statistics
+    uint32_t skipped;
+    uint32_t superseded;
+    uint32_t failed;
+} daikin_cmdq_t;
+
+void daikin_cmdq_init(daikin_cmdq_t* const cmdq, uint32_t min_interval_ms); // 0 => DAIKIN_CMDQ_MIN_INTERVAL
+
+// Queue a write, range is validated immediately. cb can be NULL.
+bool daikin_cmdq_set_temp_target(daikin_cmdq_t* const cmdq, uint8_t temp_target, daikin_cmd_done_cb cb, void* ctx);
+bool daikin_cmdq_set_temp_offset(daikin_cmdq_t* const cmdq, int8_t temp_offset, daikin_cmd_done_cb cb, void* ctx);
+bool daikin_cmdq_set_power_state(daikin_cmdq_t* const cmdq, daikin_power_state_t power_state, daikin_cmd_done_cb cb, void* ctx);
+
+// Last known values from polls or notifications (fields outside the current temperature mode are ignored)
+void daikin_cmdq_observe(daikin_cmdq_t* const cmdq, const daikin_device_info_t* const info);
+
+// Sends queued writes which are due. false => at least one write failed (its callback got CR_FAILED).
+bool daikin_cmdq_flush(daikin_cmdq_t* const cmdq, const daikin_t* const daikin, uint32_t now_ms);
+
+// Milliseconds until the next queued write is due, UINT32_MAX => nothing queued
+uint32_t daikin_cmdq_next_delay(const daikin_cmdq_t* const cmdq, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __LIB_DAIKIN_DELTA_H__
+#define __LIB_DAIKIN_DELTA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Change detection over polled daikin_device_info_t snapshots.
+//
+// Keeps the last reported value of every field (one daikin_delta_t per device)
+// and emits an event only when a field moved by at least its deadband.
+// A change back in the opposite direction must additionally exceed
+// the hysteresis, which suppresses flapping around a threshold.
+
+typedef struct
+{
+    float deadband;   // Minimum change to report (0 => any change)
+    float hysteresis; // Extra margin for a change in the opposite direction
+} daikin_delta_config_t;
+
+typedef struct
+{
+    daikin_field_t field;
+    bool           initial; // First value of the field, old_value == new_value
+    double         old_value; // Last reported value
+    double         new_value;
+} daikin_delta_event_t;
+
+typedef struct
+{
+    uint32_t reported_mask; // Fields with a reported value
+    double   reported[DF_COUNT];
+    int8_t   direction[DF_COUNT]; // Direction of the last reported change
+    daikin_delta_config_t config[DF_COUNT];
+} daikin_delta_t;
+
+// config can be NULL => 0.5 deadband for temperatures, any change for states
+void    daikin_delta_init(daikin_delta_t* const delta, const daikin_delta_config_t config[DF_COUNT]);
+
+// Returns number of events written. First value of every field is reported as initial.
+uint8_t daikin_delta_update(daikin_delta_t* const delta, const daikin_device_info_t* const info,
+    daikin_delta_event_t* const events, uint8_t max_events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __LIB_DAIKIN_EXPORT_H__
+#define __LIB_DAIKIN_EXPORT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+#include "libdaikindelta.h"
+#include "libdaikinwire.h"
+
+// Streaming CSV / NDJSON export of device info and change events for analytics.
+//
+// Lines are collected in a buffer of DAIKIN_EXPORT_BUFFER bytes and handed to the output
+// callback when it is full (and by daikin_export_flush), so a file or socket sees few large
+// writes. Numbers are formatted without printf: integers as is, other values rounded to
+// 3 decimals.
+//
+// CSV has a header line and one column per field, values not read are empty. A CSV export
+// takes records of one kind only. NDJSON writes one object per line with the fields read:
+//   {"device":3,"t":1700000000,"indoor_temp":21.5,"power_state":1}
+//   {"device":3,"t":1700000060,"field":"indoor_temp","initial":false,"old":21.5,"new":22}
+
+#ifndef DAIKIN_EXPORT_BUFFER
+#   define DAIKIN_EXPORT_BUFFER     (4096)
+#endif
+
+typedef enum
+{
+    EF_CSV,
+    EF_NDJSON,
+} daikin_export_format_t;
+
+// false => abort, the export call fails
+typedef bool (*daikin_export_cb)(void* ctx, const char* data, uint32_t len);
+
+typedef struct
+{
+    daikin_export_format_t format;
+    daikin_export_cb cb;
+    void* ctx;
+    uint8_t kind;       // Of the CSV header written, 0 => none yet
+    uint32_t used;
+    uint32_t lines;     // Statistics
+    uint64_t bytes;
+    char buffer[DAIKIN_EXPORT_BUFFER];
+} daikin_export_t;
+
+void daikin_export_init(daikin_export_t* const e, daikin_export_format_t format, daikin_export_cb cb, void* ctx);
+
+// fields has a bit (1u << DF_*) per value to export
+bool daikin_export_info(daikin_export_t* const e, uint16_t device, uint32_t t,
+    const daikin_device_info_t* const info, uint16_t fields);
+bool daikin_export_change(daikin_export_t* const e, uint16_t device, uint32_t t,
+    const daikin_delta_event_t* const event);
+
+// Every record of a batch, read in place
+bool daikin_export_batch(daikin_export_t* const e, const daikin_wire_reader_t* const reader);
+
+// Hands the buffered lines to the callback
+bool daikin_export_flush(daikin_export_t* const e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
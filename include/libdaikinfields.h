@@ -0,0 +1,82 @@
+#ifndef __LIB_DAIKIN_FIELDS_H__
+#define __LIB_DAIKIN_FIELDS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libdaikin.h"
+
+// Build time field set (X-macro) for builds which need only a few values.
+//
+// List the wanted fields before including this header:
+//
+//   #define DAIKIN_FIELD_SET(X) DAIKIN_FIELD_INDOOR_TEMP(X) DAIKIN_FIELD_POWER_STATE(X)
+//   #include "libdaikinfields.h"
+//
+// This generates daikin_field_set_t with only those members,
+// DAIKIN_FIELD_SET_MASK and daikin_get_field_set, which reads only those fields.
+// One field set per translation unit.
+
+// X(field, member, type)
+#define DAIKIN_FIELD_INDOOR_TEMP(X)         X(DF_INDOOR_TEMP, indoor_temp, float)
+#define DAIKIN_FIELD_OUTDOOR_TEMP(X)        X(DF_OUTDOOR_TEMP, outdoor_temp, float)
+#define DAIKIN_FIELD_LEAVING_WATER_TEMP(X)  X(DF_LEAVING_WATER_TEMP, leaving_water_temp, float)
+#define DAIKIN_FIELD_POWER_STATE(X)         X(DF_POWER_STATE, power_state, daikin_power_state_t)
+#define DAIKIN_FIELD_EMERGENCY_STATE(X)     X(DF_EMERGENCY_STATE, emergency_state, int32_t)
+#define DAIKIN_FIELD_ERROR_STATE(X)         X(DF_ERROR_STATE, error_state, int32_t)
+#define DAIKIN_FIELD_WARNING_STATE(X)       X(DF_WARNING_STATE, warning_state, int32_t)
+#define DAIKIN_FIELD_TEMP_MODE(X)           X(DF_TEMP_MODE, temp_mode, daikin_temperature_mode_t) // Reads both set points
+#define DAIKIN_FIELD_TEMP_TARGET(X)         X(DF_TEMP_TARGET, temp_target, uint8_t)
+#define DAIKIN_FIELD_TEMP_OFFSET(X)         X(DF_TEMP_OFFSET, temp_offset, int8_t)
+
+#ifndef DAIKIN_FIELD_SET
+#   error "Define DAIKIN_FIELD_SET(X) before including libdaikinfields.h"
+#endif
+
+#define DAIKIN_FIELD_SET_MEMBER_(field, member, type) type member;
+#define DAIKIN_FIELD_SET_BIT_(field, member, type) | (1u << (field))
+
+typedef struct
+{
+    DAIKIN_FIELD_SET(DAIKIN_FIELD_SET_MEMBER_)
+} daikin_field_set_t;
+
+#define DAIKIN_FIELD_SET_MASK (0u DAIKIN_FIELD_SET(DAIKIN_FIELD_SET_BIT_))
+
+// Temperature mode read fills the set points as well
+#define DAIKIN_FIELD_SET_FETCHED_(field) \
+    ((field) == DF_TEMP_MODE ? ((1u << DF_TEMP_MODE) | (1u << DF_TEMP_TARGET) | (1u << DF_TEMP_OFFSET)) : (1u << (field)))
+
+#define DAIKIN_FIELD_SET_FETCH_(field, member, type) \
+    if ((fetched & (1u << (field))) == 0) \
+    { \
+        if (daikin_get_field(daikin, (field), &info) == false) \
+            return false; \
+        fetched |= DAIKIN_FIELD_SET_FETCHED_(field); \
+    } \
+    set->member = info.member;
+
+// One round trip per field (two for the temperature mode)
+static inline bool daikin_get_field_set(const daikin_t* const daikin, daikin_field_set_t* const set)
+{
+    daikin_device_info_t info;
+    uint32_t fetched = 0;
+
+    memset(&info, 0, sizeof(info));
+
+    DAIKIN_FIELD_SET(DAIKIN_FIELD_SET_FETCH_)
+
+    (void)fetched;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
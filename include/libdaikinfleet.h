@@ -0,0 +1,89 @@
+#ifndef __LIB_DAIKIN_FLEET_H__
+#define __LIB_DAIKIN_FLEET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+#include "libdaikinreconnect.h"
+#include "libdaikinhealth.h"
+
+// Multi-threaded poller for large fleets (DAIKIN_FLEET builds, needs threads).
+//
+// Devices are sharded round robin over worker threads, one per core by default.
+// Every worker runs its own loop over the devices it owns: open the session when needed,
+// poll, reschedule. A worker without a due device steals half of the overdue devices
+// of the most loaded worker, so uneven shards or a handshake storm on one worker
+// don't leave the other cores idle. A device moves with its open session and is polled
+// by one worker at a time, its callback runs on the worker which polled it (no hand-off
+// to another thread). Device state is kept per cache line, workers share no hot data.
+// Stolen sessions are used on another thread, the HAL must allow that (the socket HAL does,
+// the io_uring HAL doesn't).
+// Failed devices retry after a jittered exponential backoff (daikin_reconnect_backoff) and
+// at most max_handshakes opens run at once over all workers, so a mass reconnect
+// doesn't hit the adapters and the CPU at the same moment.
+// Every device has a circuit breaker (libdaikinhealth.h): a device which keeps failing is
+// left alone for the open period and then probed with a single read, reads of sessions
+// without a timeout of their own give up after the health timeout_ms.
+
+#ifndef DAIKIN_FLEET_MAX_WORKERS
+#   define DAIKIN_FLEET_MAX_WORKERS     (64)
+#endif
+
+#define DAIKIN_FLEET_RETRY_INTERVAL     (5000) // Default ms of the first backoff window of a failed device
+
+// Runs on the worker thread, info and health are valid during the call. ok == false => open or poll failed.
+typedef void (*daikin_fleet_cb)(void* ctx, uint16_t worker, uint32_t device, bool ok,
+    const daikin_device_info_t* const info, const daikin_health_t* const health);
+
+typedef struct
+{
+    uint16_t workers;       // 0 => one per core (at most DAIKIN_FLEET_MAX_WORKERS)
+    bool     pin;           // Pin worker n to core n
+    uint32_t interval_ms;   // Between polls of a device, 0 => back to back
+    uint32_t retry_ms;      // First backoff window, 0 => DAIKIN_FLEET_RETRY_INTERVAL
+    uint32_t max_retry_ms;  // Largest backoff window, 0 => DAIKIN_RECONNECT_MAX_DELAY
+    uint16_t max_handshakes; // Opens at once over all workers, 0 => DAIKIN_RECONNECT_IN_PROGRESS
+    uint32_t fields;        // Bit (1 << field) per polled field, 0 => daikin_get_device_info
+    const daikin_health_config_t* health; // Circuit breaker of every device, NULL => defaults
+    daikin_fleet_cb cb;     // Can be NULL
+    void*    ctx;
+} daikin_fleet_config_t;
+
+typedef struct
+{
+    uint64_t polls;
+    uint64_t failures;
+    uint64_t opens;
+    uint64_t steals;        // Devices taken from other workers
+    uint64_t deferred;      // Opens which waited for a handshake slot
+    uint32_t devices;       // Owned right now
+    uint32_t open_circuits; // Devices not polled because their circuit isn't closed (fleet wide)
+} daikin_fleet_stats_t;
+
+typedef struct
+{
+    void* impl;
+} daikin_fleet_t;
+
+// devices are copied (address, limiter, ...), they must not be open. Workers start polling at once.
+bool daikin_fleet_start(daikin_fleet_t* const fleet, const daikin_fleet_config_t* const config,
+    const daikin_t* const devices, uint32_t device_count);
+
+uint16_t daikin_fleet_workers(const daikin_fleet_t* const fleet);
+
+// Counters of one worker (can be read while running), worker >= daikin_fleet_workers => sum of all
+void daikin_fleet_stats(const daikin_fleet_t* const fleet, uint16_t worker, daikin_fleet_stats_t* const stats);
+
+// Stops the workers after their current poll and closes all sessions
+void daikin_fleet_stop(daikin_fleet_t* const fleet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -39,11 +39,46 @@ extern "C" {
 #   define DAIKIN_REMOTE_PORT   (80)
 #endif
 
+// Longest wait of one read or write in ms, 0 => none (notifications can take any time).
+// Supported by the Linux, io_uring and Windows HAL, the Linux and io_uring HAL bound the
+// connect of daikin_hal_tcp_open with it as well.
+//
+// deadline_ms bounds a whole request instead: connects, reads and writes fail once daikin_hal_time_ms
+// passed it, a blocked call included. cancel makes them fail as well and can be set from any
+// thread. The Linux, io_uring and Windows HAL notice both within DAIKIN_HAL_CANCEL_CHECK ms,
+// the others only check before blocking.
+#ifndef DAIKIN_HAL_TIMEOUT
+#   define DAIKIN_HAL_TIMEOUT   (0)
+#endif
+
+#ifndef DAIKIN_HAL_CANCEL_CHECK
+#   define DAIKIN_HAL_CANCEL_CHECK  (50)
+#endif
+
 typedef struct
 {
     void* handle;
+    const char* remote_ip; // NULL => DAIKIN_REMOTE_IP
+    uint16_t remote_port; // 0 => DAIKIN_REMOTE_PORT
+    uint32_t timeout_ms; // 0 => DAIKIN_HAL_TIMEOUT
+    uint32_t deadline_ms; // Absolute daikin_hal_time_ms, 0 => none
+    bool cancel; // Written from other threads, access with DAIKIN_HAL_CANCELLED / DAIKIN_HAL_SET_CANCEL
 } daikin_hal_tcp_t;
 
+#if defined(__GNUC__) || defined(__clang__)
+#   define DAIKIN_HAL_CANCELLED(tcp)        __atomic_load_n(&(tcp)->cancel, __ATOMIC_ACQUIRE)
+#   define DAIKIN_HAL_SET_CANCEL(tcp, v)    __atomic_store_n(&(tcp)->cancel, (v), __ATOMIC_RELEASE)
+#else
+    // MSVC volatile accesses have acquire / release semantics
+#   define DAIKIN_HAL_CANCELLED(tcp)        (*(const volatile bool*)&(tcp)->cancel)
+#   define DAIKIN_HAL_SET_CANCEL(tcp, v)    (*(volatile bool*)&(tcp)->cancel = (v))
+#endif
+
+// Remote address of the connection, compile time defaults when not set at runtime
+#define DAIKIN_HAL_REMOTE_IP(tcp)   ((tcp)->remote_ip != NULL ? (tcp)->remote_ip : DAIKIN_REMOTE_IP)
+#define DAIKIN_HAL_REMOTE_PORT(tcp) ((uint16_t)((tcp)->remote_port != 0 ? (tcp)->remote_port : DAIKIN_REMOTE_PORT))
+#define DAIKIN_HAL_TIMEOUT_MS(tcp)  ((uint32_t)((tcp)->timeout_ms != 0 ? (tcp)->timeout_ms : DAIKIN_HAL_TIMEOUT))
+
 bool     daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp); // true => success
 int32_t  daikin_hal_tcp_read(const daikin_hal_tcp_t* const tcp, char* const data, uint16_t len); // Returns > 0 => success
 int32_t  daikin_hal_tcp_write(const daikin_hal_tcp_t* const tcp, const char* const data, uint16_t len); // Returns > 0 => success
@@ -51,6 +86,12 @@ void     daikin_hal_tcp_close(daikin_hal_tcp_t* const tcp);
 
 uint32_t daikin_hal_tcp_IPv4(const char* const ipv4); // Returns > 0 => success
 
+// Milliseconds a read or write may still wait, UINT32_MAX => no deadline, 0 => deadline passed or cancelled
+uint32_t daikin_hal_tcp_remaining_ms(const daikin_hal_tcp_t* const tcp);
+
+uint32_t daikin_hal_time_ms(void); // Monotonic, wraps
+void     daikin_hal_sleep_ms(uint32_t ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,82 @@
+#ifndef __LIB_DAIKIN_HEALTH_H__
+#define __LIB_DAIKIN_HEALTH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Health model and circuit breaker per adapter.
+//
+// Every poll is recorded with its result and latency: success rate and latency are
+// exponentially weighted moving averages, a failed call which took timeout_ms or longer
+// counts as timeout. failure_threshold failures in a row open the circuit, no polls
+// are made for open_ms. Then the circuit is half open: one probe (a single lightweight
+// read) is allowed, success closes the circuit and full polls resume, failure opens
+// it again for twice as long (up to max_open_ms). So a hung adapter costs one timeout
+// per open period instead of one per poll, and the devices behind it don't wait.
+
+#define DAIKIN_HEALTH_FAILURE_THRESHOLD (3)
+#define DAIKIN_HEALTH_OPEN_INTERVAL     (10000)  // Default ms the circuit stays open
+#define DAIKIN_HEALTH_MAX_OPEN_INTERVAL (300000)
+#define DAIKIN_HEALTH_TIMEOUT           (5000)   // Default latency ms which counts as timeout
+#define DAIKIN_HEALTH_SLOW              (500)    // Default latency ms above which the score drops
+#define DAIKIN_HEALTH_ALPHA             (0.2f)   // Default EWMA weight of the newest poll
+
+typedef enum
+{
+    HS_CLOSED,      // Healthy, polls run
+    HS_OPEN,        // Tripped, no polls until open_until_ms
+    HS_HALF_OPEN    // One probe decides
+} daikin_health_state_t;
+
+typedef struct
+{
+    uint8_t  failure_threshold; // 0 => DAIKIN_HEALTH_FAILURE_THRESHOLD
+    uint32_t open_ms;           // 0 => DAIKIN_HEALTH_OPEN_INTERVAL
+    uint32_t max_open_ms;       // 0 => DAIKIN_HEALTH_MAX_OPEN_INTERVAL
+    uint32_t timeout_ms;        // 0 => DAIKIN_HEALTH_TIMEOUT
+    uint32_t slow_ms;           // 0 => DAIKIN_HEALTH_SLOW
+    float    alpha;             // 0 => DAIKIN_HEALTH_ALPHA
+} daikin_health_config_t;
+
+typedef struct
+{
+    daikin_health_config_t config;
+    daikin_health_state_t state;
+    float    success_rate;      // EWMA, 0..1
+    float    latency_ms;        // EWMA of successful polls
+    uint8_t  failures_in_row;
+    bool     probing;           // Probe handed out, waiting for its result
+    uint32_t open_interval_ms;  // Of the current or next open period
+    uint32_t open_until_ms;
+
+    uint32_t successes;         // Statistics
+    uint32_t failures;
+    uint32_t timeouts;
+    uint32_t trips;             // Circuit opened
+} daikin_health_t;
+
+void daikin_health_init(daikin_health_t* const health, const daikin_health_config_t* const config); // config can be NULL
+
+// May the device be polled now? probe receives true when only a single lightweight read is allowed.
+bool daikin_health_allow(daikin_health_t* const health, uint32_t now_ms, bool* const probe);
+
+// Result of a poll or probe allowed by daikin_health_allow
+void daikin_health_record(daikin_health_t* const health, bool ok, uint32_t latency_ms, uint32_t now_ms);
+
+// Milliseconds until daikin_health_allow can return true, 0 => now
+uint32_t daikin_health_next_delay(const daikin_health_t* const health, uint32_t now_ms);
+
+// 0 (down) .. 100 (every poll succeeds within slow_ms), drops with failures and with latency above slow_ms
+uint8_t daikin_health_score(const daikin_health_t* const health);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
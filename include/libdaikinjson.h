@@ -0,0 +1,74 @@
+#ifndef __LIB_DAIKIN_JSON_H__
+#define __LIB_DAIKIN_JSON_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Incremental (SAX style) JSON parser without allocations.
+//
+// Input can be fed in pieces of any size (e.g. WebSocket frames or chunks of
+// daikin_read_stream), events are reported as soon as a token is complete.
+// Strings are unescaped, tokens longer than DAIKIN_JSON_TOKEN_LEN are truncated
+// (daikin_json_t.truncated is set while the event is reported).
+
+#ifndef DAIKIN_JSON_TOKEN_LEN
+#   define DAIKIN_JSON_TOKEN_LEN    (128) // Longest key, string or number reported in one piece
+#endif
+
+#define DAIKIN_JSON_MAX_DEPTH       (32)
+
+typedef enum
+{
+    JE_OBJECT_START,
+    JE_OBJECT_END,
+    JE_ARRAY_START,
+    JE_ARRAY_END,
+    JE_KEY,         // text is the key, the value follows
+    JE_STRING,
+    JE_NUMBER,      // text is the number as written
+    JE_TRUE,
+    JE_FALSE,
+    JE_NULL,
+} daikin_json_event_t;
+
+struct daikin_json_s;
+
+// text is NUL terminated (len without the NUL), NULL for events without text.
+// Return false to stop parsing (daikin_json_feed fails).
+typedef bool (*daikin_json_cb)(struct daikin_json_s* json, daikin_json_event_t event,
+    const char* text, uint16_t len);
+
+typedef struct daikin_json_s
+{
+    daikin_json_cb cb;
+    void* ctx;
+
+    uint8_t  state;
+    uint8_t  depth;             // Open objects and arrays
+    uint32_t containers;        // Bit per depth, 1 => object
+    bool     done;              // Top level value is complete
+    bool     error;
+
+    char     token[DAIKIN_JSON_TOKEN_LEN + 1];
+    uint16_t token_len;
+    bool     truncated;
+    uint8_t  escape;            // 1 => after '\', 2..5 => \u digits
+    uint16_t code_point;
+
+    uint32_t offset;            // Bytes consumed, for error messages
+} daikin_json_t;
+
+void daikin_json_init(daikin_json_t* const json, daikin_json_cb cb, void* ctx);
+bool daikin_json_feed(daikin_json_t* const json, const char* const data, uint32_t len);
+// End of input, completes a top level number and checks the document is complete
+bool daikin_json_finish(daikin_json_t* const json);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
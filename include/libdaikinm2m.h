@@ -0,0 +1,95 @@
+#ifndef __LIB_DAIKIN_M2M_H__
+#define __LIB_DAIKIN_M2M_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikinjson.h"
+
+// One pass decoder of adapter messages (oneM2M JSON) into a fixed struct.
+//
+// Responses ({"m2m:rsp":...}) and requests from the adapter ({"m2m:rqp":...},
+// e.g. subscription notifications) are decoded in any key order, fed at once
+// (daikin_m2m_decode) or in pieces (daikin_m2m_feed, daikin_m2m_chunk).
+
+#ifndef DAIKIN_M2M_PATH_LEN
+#   define DAIKIN_M2M_PATH_LEN      (96)
+#endif
+
+#ifndef DAIKIN_M2M_CON_LEN
+#   define DAIKIN_M2M_CON_LEN       (512)
+#endif
+
+typedef enum
+{
+    MK_UNKNOWN,
+    MK_RESPONSE,    // m2m:rsp
+    MK_REQUEST,     // m2m:rqp, sent by the adapter for notifications
+} daikin_m2m_kind_t;
+
+typedef enum
+{
+    CT_NONE,        // No con
+    CT_NUMBER,
+    CT_STRING,
+    CT_BOOL,
+    CT_NULL,
+    CT_OBJECT,
+    CT_ARRAY,
+} daikin_m2m_con_type_t;
+
+typedef struct
+{
+    daikin_m2m_kind_t kind;
+    int32_t rsc;                        // Response status code, 0 => missing
+    int32_t op;                         // Operation of a request, 0 => missing
+    int32_t ty;                         // Resource type of a request, 0 => missing
+    char    rqi[24];
+    char    to[DAIKIN_M2M_PATH_LEN];
+    char    fr[DAIKIN_M2M_PATH_LEN];
+
+    // Content instance, pc.m2m:cin of a response or pc.m2m:sgn.nev.rep.m2m:cin of a notification
+    bool    has_cin;
+    daikin_m2m_con_type_t con_type;
+    char    con[DAIKIN_M2M_CON_LEN + 1]; // Strings without quotes, objects and arrays as compact JSON
+    uint16_t con_len;
+    double  con_number;                 // CT_NUMBER and CT_BOOL
+    char    cnf[32];
+    char    ct[20];                     // Creation time, 20240101T120000Z
+    char    lt[20];                     // Last modification time
+
+    // Notification, pc.m2m:sgn
+    char    sur[DAIKIN_M2M_PATH_LEN];   // Subscription resource
+    int32_t net;                        // Notification event type, 0 => missing
+
+    bool    truncated;                  // A value didn't fit its field
+} daikin_m2m_t;
+
+typedef struct
+{
+    daikin_json_t json;
+    daikin_m2m_t* msg;
+    uint8_t keys[DAIKIN_JSON_MAX_DEPTH]; // Known key of the current value per depth
+    uint8_t con_depth;                  // Depth of a con object or array being copied, 0 => none
+    bool    con_comma;                  // Next element of the copied con needs ','
+} daikin_m2m_decoder_t;
+
+void daikin_m2m_init(daikin_m2m_decoder_t* const decoder, daikin_m2m_t* const msg);
+bool daikin_m2m_feed(daikin_m2m_decoder_t* const decoder, const char* const data, uint32_t len);
+bool daikin_m2m_finish(daikin_m2m_decoder_t* const decoder);
+
+// daikin_chunk_cb for daikin_read_stream, ctx is an initialized decoder
+bool daikin_m2m_chunk(void* ctx, const char* data, uint32_t len, bool last);
+
+// Whole message at once
+bool daikin_m2m_decode(const char* const data, uint32_t len, daikin_m2m_t* const msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef __LIB_DAIKIN_METRICS_H__
+#define __LIB_DAIKIN_METRICS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Derived metrics over polled daikin_device_info_t snapshots, one daikin_metrics_t per device.
+//
+// Every sample updates the signals in constant time and memory, nothing is kept per sample:
+// - delta T: leaving water minus indoor temperature
+// - heating degree-hours: (base - outdoor) integrated over time while outdoor is below base
+// - defrost cycles: leaving water dips below its slow moving baseline while powered on,
+//   the cycle ends when it recovers
+// - COP: heat over electrical energy, from meter readings passed to daikin_metrics_energy
+//   (the adapter doesn't report energy as a number)
+//
+// Rolling values cover the last DAIKIN_METRICS_BUCKETS buckets of window_s / DAIKIN_METRICS_BUCKETS
+// seconds, the newest one partly. Completed buckets are summed once when a bucket starts.
+
+#define DAIKIN_METRICS_BUCKETS          (12)
+
+#define DAIKIN_METRICS_WINDOW_S         (3600)
+#define DAIKIN_METRICS_HDH_BASE         (15.5f)  // Celsius
+#define DAIKIN_METRICS_MAX_GAP_S        (600)    // Longer gaps between samples are not integrated
+#define DAIKIN_METRICS_DEFROST_DROP     (3.0f)   // Below baseline to start a defrost
+#define DAIKIN_METRICS_DEFROST_RECOVER  (1.0f)   // Below baseline to end it
+#define DAIKIN_METRICS_DEFROST_MAX_S    (900)    // Longer dips are a new level, not a defrost
+#define DAIKIN_METRICS_BASELINE_S       (600)    // Time constant of the leaving water baseline
+
+typedef struct
+{
+    uint32_t window_s;          // At least DAIKIN_METRICS_BUCKETS
+    float    hdh_base;
+    uint32_t max_gap_s;
+    float    defrost_drop;
+    float    defrost_recover;
+    uint32_t defrost_max_s;
+    uint32_t baseline_s;
+} daikin_metrics_config_t;
+
+typedef struct
+{
+    uint32_t t_start;           // Of the bucket
+    uint32_t samples;           // With delta T
+    float    delta_t_sum;
+    float    delta_t_min;
+    float    delta_t_max;
+    float    degree_hours;
+    uint32_t defrost_s;
+    uint16_t defrosts;          // Started in the bucket
+    float    electric_kwh;
+    float    heat_kwh;
+} daikin_metrics_bucket_t;
+
+typedef struct
+{
+    daikin_metrics_config_t config;
+
+    daikin_metrics_bucket_t buckets[DAIKIN_METRICS_BUCKETS]; // Ring, current is the newest
+    uint8_t  current;
+    daikin_metrics_bucket_t completed; // Sum of the other buckets of the window
+
+    uint32_t t_last;            // Of the last sample, 0 => none
+    float    hdh_last;          // max(0, base - outdoor) of the last sample, < 0 => none
+    float    delta_t;           // Of the last sample
+    double   degree_hours;      // Since init
+
+    float    baseline;          // Leaving water, NAN => none
+    uint32_t defrost_start;     // 0 => no defrost
+    uint32_t defrost_last_s;
+    uint32_t defrosts;          // Since init
+
+    double   electric_meter;    // Last readings, < 0 => none
+    double   heat_meter;
+} daikin_metrics_t;
+
+typedef struct
+{
+    float    delta_t;           // Last sample
+    float    delta_t_avg;       // Window
+    float    delta_t_min;
+    float    delta_t_max;
+    uint32_t samples;           // Window, with delta T
+    float    degree_hours;      // Window
+    double   degree_hours_total;
+    uint16_t defrosts;          // Window
+    uint32_t defrosts_total;
+    uint32_t defrost_s;         // Window
+    uint32_t defrost_last_s;    // Duration of the last completed defrost
+    bool     defrosting;
+    float    cop;               // Window, NAN => no electrical energy
+} daikin_metrics_values_t;
+
+// config can be NULL, members which are 0 get the DAIKIN_METRICS_* defaults
+void daikin_metrics_init(daikin_metrics_t* const metrics, const daikin_metrics_config_t* const config);
+
+// Adds one poll. t in seconds must not go backwards. fields has a bit (1u << DF_*) per valid value,
+// see daikin_get_device_info_partial (DAIKIN_DEVICE_INFO_FIELDS for daikin_get_device_info).
+bool daikin_metrics_update(daikin_metrics_t* const metrics, uint32_t t,
+    const daikin_device_info_t* const info, uint32_t fields);
+
+// Adds cumulative meter readings in kWh (e.g. of an external meter), heat_kwh < 0 => none.
+// A reading below the previous one restarts the meter. t may be a little older than the last
+// sample of daikin_metrics_update (e.g. a meter polled in between), it is added to the current bucket.
+bool daikin_metrics_energy(daikin_metrics_t* const metrics, uint32_t t, double electric_kwh, double heat_kwh);
+
+// Current values, without going over any history
+void daikin_metrics_get(const daikin_metrics_t* const metrics, daikin_metrics_values_t* const values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
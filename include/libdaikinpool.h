@@ -0,0 +1,88 @@
+#ifndef __LIB_DAIKIN_POOL_H__
+#define __LIB_DAIKIN_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Pool of open sessions to one adapter.
+//
+// daikin_pool_maintain (main loop or idle time) keeps size sessions open, opening at most
+// one and pinging at most one idle session per call, so TCP connect, HTTP upgrade and
+// the accept hash are off the critical path. daikin_pool_acquire hands out an open session,
+// a failed one is closed on release (or daikin_pool_swap) and the next standby takes over.
+// Only when no standby is left the caller waits on a handshake.
+// The adapter accepts only a few WebSocket sessions, keep size small (2 => one standby).
+
+#ifndef DAIKIN_POOL_MAX
+#   define DAIKIN_POOL_MAX          (4)
+#endif
+
+#define DAIKIN_POOL_CHECK_INTERVAL  (30000) // Default ms an idle session is trusted without a ping
+#define DAIKIN_POOL_RETRY_INTERVAL  (5000)  // Default ms between opens after a failed one
+
+typedef enum
+{
+    PLS_CLOSED,
+    PLS_IDLE,        // Open, ready to be handed out
+    PLS_IN_USE,
+} daikin_pool_state_t;
+
+typedef struct
+{
+    daikin_t daikin;
+    daikin_pool_state_t state;
+    uint32_t checked_ms; // Last open, release or ping
+} daikin_pool_slot_t;
+
+typedef struct
+{
+    daikin_t proto;                 // Settings of every session (address, limiter, ...)
+    daikin_pool_slot_t slots[DAIKIN_POOL_MAX];
+    uint8_t size;                   // Sessions kept open
+    uint32_t check_interval_ms;
+    uint32_t retry_interval_ms;
+    bool retry_wait;                // Last open failed, next one at retry_ms
+    uint32_t retry_ms;
+
+    uint32_t opens;                 // Statistics
+    uint32_t open_failures;
+    uint32_t checks;
+    uint32_t check_failures;
+    uint32_t swaps;                 // Failed sessions replaced by a standby
+    uint32_t waits;                 // Acquires which had to open a session
+} daikin_pool_t;
+
+// proto is copied, it must not be open. 0 => DAIKIN_POOL_CHECK_INTERVAL / DAIKIN_POOL_RETRY_INTERVAL
+bool daikin_pool_init(daikin_pool_t* const pool, const daikin_t* const proto, uint8_t size,
+    uint32_t check_interval_ms, uint32_t retry_interval_ms);
+
+// Opens a missing session or pings an idle one when due. false => the open or the ping failed.
+bool daikin_pool_maintain(daikin_pool_t* const pool, uint32_t now_ms);
+
+// Milliseconds until daikin_pool_maintain has work, UINT32_MAX => nothing to do
+uint32_t daikin_pool_next_delay(const daikin_pool_t* const pool, uint32_t now_ms);
+
+// Open session, NULL => none could be opened
+daikin_t* daikin_pool_acquire(daikin_pool_t* const pool, uint32_t now_ms);
+
+// ok == false => a request on the session failed, it is closed and reopened by daikin_pool_maintain
+void daikin_pool_release(daikin_pool_t* const pool, daikin_t* const daikin, bool ok, uint32_t now_ms);
+
+// Releases a failed session and acquires another one
+daikin_t* daikin_pool_swap(daikin_pool_t* const pool, daikin_t* const daikin, uint32_t now_ms);
+
+uint8_t daikin_pool_idle(const daikin_pool_t* const pool); // Standby sessions
+
+void daikin_pool_close(daikin_pool_t* const pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef __LIB_DAIKIN_RECONNECT_H__
+#define __LIB_DAIKIN_RECONNECT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Reconnect scheduler for many sessions, e.g. a gateway whose adapters all drop
+// when a switch reboots.
+//
+// A lost device waits a random delay within its backoff window before the next open
+// (full jitter): base_delay_ms for the first attempt, doubled after every failed one up to
+// max_delay_ms. So the opens of a mass reconnect are spread instead of arriving together.
+// daikin_reconnect_next hands out at most max_in_progress devices at once (SHA-1, base64
+// and the adapter's accept queue), devices with pending writes first, then the most overdue.
+// A fleet of n devices is back within max_delay_ms + n / max_in_progress handshakes
+// as long as the adapters answer.
+//
+// The scheduler works over a caller provided entry array, one entry per device.
+
+#define DAIKIN_RECONNECT_BASE_DELAY     (1000)  // Default ms of the first backoff window
+#define DAIKIN_RECONNECT_MAX_DELAY      (60000) // Default ms of the largest backoff window
+#define DAIKIN_RECONNECT_IN_PROGRESS    (4)     // Default handshakes at once
+
+typedef enum
+{
+    RS_CONNECTED,
+    RS_WAITING,     // Lost, next open at due_ms
+    RS_CONNECTING   // Handed out by daikin_reconnect_next
+} daikin_reconnect_state_t;
+
+typedef struct
+{
+    daikin_reconnect_state_t state;
+    bool     pending_writes; // Reconnected first, without a backoff window for the first attempt
+    uint8_t  failures;       // Failed opens since the session was lost
+    uint32_t due_ms;
+} daikin_reconnect_entry_t;
+
+typedef struct
+{
+    daikin_reconnect_entry_t* entries;
+    uint16_t count;
+    uint16_t max_in_progress;
+    uint16_t in_progress;
+    uint32_t base_delay_ms;
+    uint32_t max_delay_ms;
+    uint32_t random;         // Jitter generator state
+
+    uint32_t attempts;       // Statistics
+    uint32_t failures;
+    uint32_t deferred;       // Due devices held back by max_in_progress
+} daikin_reconnect_t;
+
+// All devices start connected. 0 => DAIKIN_RECONNECT_IN_PROGRESS / _BASE_DELAY / _MAX_DELAY.
+// seed decorrelates gateways which restart together (e.g. a MAC address), 0 => time.
+bool daikin_reconnect_init(daikin_reconnect_t* const rc, daikin_reconnect_entry_t* const entries, uint16_t count,
+    uint16_t max_in_progress, uint32_t base_delay_ms, uint32_t max_delay_ms, uint32_t seed);
+
+// Session of the device was lost (or never opened), schedules its first attempt
+void daikin_reconnect_lost(daikin_reconnect_t* const rc, uint16_t device, uint32_t now_ms);
+
+// Writes queued for the device (e.g. daikin_cmdq_next_delay != UINT32_MAX)
+void daikin_reconnect_set_pending_writes(daikin_reconnect_t* const rc, uint16_t device, bool pending);
+
+// Device to open now, -1 => none is due or max_in_progress handshakes run.
+// Report the result with daikin_reconnect_done.
+int32_t daikin_reconnect_next(daikin_reconnect_t* const rc, uint32_t now_ms);
+
+// ok => connected, otherwise the backoff window doubles
+void daikin_reconnect_done(daikin_reconnect_t* const rc, uint16_t device, bool ok, uint32_t now_ms);
+
+// Milliseconds until daikin_reconnect_next has a device, UINT32_MAX => nothing to do
+uint32_t daikin_reconnect_next_delay(const daikin_reconnect_t* const rc, uint32_t now_ms);
+
+uint16_t daikin_reconnect_waiting(const daikin_reconnect_t* const rc); // Lost and not connecting yet
+
+// Random delay in [0, window), window = base_ms << failures capped at max_ms. random is the generator state.
+uint32_t daikin_reconnect_backoff(uint32_t* const random, uint8_t failures, uint32_t base_ms, uint32_t max_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __LIB_DAIKIN_SCHED_H__
+#define __LIB_DAIKIN_SCHED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Adaptive polling scheduler.
+//
+// Every field has its own read interval between min_interval_ms and max_interval_ms.
+// When a read shows a change of at least change_threshold the interval is halved,
+// otherwise it grows by a quarter. Reads are paced by a token bucket so the total
+// request rate stays under budget_per_min. When the budget is exhausted
+// the most overdue field is read first.
+
+typedef struct
+{
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms; // 0 => field is not polled
+    float    change_threshold;
+} daikin_sched_field_config_t;
+
+typedef struct
+{
+    uint16_t budget_per_min; // Max adapter requests per minute
+    daikin_sched_field_config_t fields[DF_COUNT];
+} daikin_sched_config_t;
+
+typedef struct
+{
+    uint32_t interval_ms;
+    uint32_t next_due_ms;
+    double   last_value;
+    bool     valid;
+} daikin_sched_field_t;
+
+typedef struct
+{
+    daikin_sched_config_t config;
+    daikin_sched_field_t  fields[DF_COUNT];
+    float    tokens;
+    uint32_t last_refill_ms;
+    bool     started;
+} daikin_sched_t;
+
+void daikin_sched_default_config(daikin_sched_config_t* const config);
+void daikin_sched_init(daikin_sched_t* const sched, const daikin_sched_config_t* const config); // config can be NULL
+
+// Reads all fields which are due and fit into the budget.
+// updated_mask receives bit (1 << field) for every field read.
+bool daikin_sched_poll(daikin_sched_t* const sched, const daikin_t* const daikin, uint32_t now_ms,
+    daikin_device_info_t* const info, uint32_t* const updated_mask);
+
+// Milliseconds until the next read is possible (0 => poll now).
+uint32_t daikin_sched_next_delay(const daikin_sched_t* const sched, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __LIB_DAIKIN_SHM_H__
+#define __LIB_DAIKIN_SHM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Latest device state shared with other processes (or cores).
+//
+// One publisher (the poller) writes a snapshot per device into a memory region,
+// any number of readers copy it out without locks or system calls.
+// Every slot keeps two copies guarded by a sequence counter (seqlock latch):
+// the counter tells readers which copy is stable while the publisher writes the other,
+// readers retry only when the counter changed during their copy.
+//
+// The region can be POSIX shared memory (see daikin_shm_map) or any memory
+// visible to both sides. Layout uses native endianness.
+
+#define DAIKIN_SHM_READ_RETRIES     (1000) // Reader gives up when the publisher keeps interrupting
+
+// Quality flags of daikin_shm_snapshot_t.flags, set by the publisher
+#define DAIKIN_SHM_F_CONNECTED      (1u << 0) // Adapter session is open
+#define DAIKIN_SHM_F_POLL_ERROR     (1u << 1) // Last poll failed, values are from earlier polls
+#define DAIKIN_SHM_F_PARTIAL        (1u << 2) // Not all fields were read yet
+
+typedef struct
+{
+    daikin_device_info_t info;
+    uint32_t flags;
+    uint32_t generation;        // Number of publishes
+    uint64_t published_ms;      // Time of the last publish (publisher clock, e.g. Unix ms)
+    uint64_t field_ms[DF_COUNT]; // Time of the last update per field, 0 => never
+} daikin_shm_snapshot_t;
+
+typedef struct
+{
+    uint8_t* mem;
+    uint32_t mem_len;
+    uint16_t device_count;
+    bool     publisher;
+} daikin_shm_t;
+
+// Region size needed for device_count devices
+uint32_t daikin_shm_size(uint16_t device_count);
+
+// Publisher side, formats the region (all slots empty)
+bool daikin_shm_init(daikin_shm_t* const shm, uint8_t* const mem, uint32_t mem_len, uint16_t device_count);
+
+// Copies info into the slot of the device. Fields in updated_mask get now_ms as update time.
+bool daikin_shm_publish(daikin_shm_t* const shm, uint16_t device, const daikin_device_info_t* const info,
+    uint32_t updated_mask, uint32_t flags, uint64_t now_ms);
+
+// Reader side, region must be formatted by the publisher
+bool daikin_shm_attach(daikin_shm_t* const shm, const uint8_t* const mem, uint32_t mem_len);
+
+// Consistent copy of the device slot. false => not published yet or too many retries.
+bool daikin_shm_read(const daikin_shm_t* const shm, uint16_t device, daikin_shm_snapshot_t* const snapshot);
+
+// POSIX shared memory helpers (shm_open, name like "/daikin").
+// Publisher creates/extends the object to len bytes, reader maps it read only (len 0 => whole object).
+bool daikin_shm_map(const char* const name, bool publisher, uint32_t* const len, uint8_t** const mem);
+void daikin_shm_unmap(uint8_t* const mem, uint32_t len);
+bool daikin_shm_unlink(const char* const name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef __LIB_DAIKIN_STATE_H__
+#define __LIB_DAIKIN_STATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+#include "libdaikinhealth.h"
+
+// Persistent per-device state for a warm start after a restart or reset.
+//
+// Keeps the last snapshot (temperature mode included), the capability map and the health
+// stats of every device in a caller provided region: a memory-mapped file on Linux (see
+// daikin_state_map_file), or RAM which survives a reset on MCUs (e.g. a no-init section
+// kept over a watchdog reboot). After the restart, daikin_state_open takes over the
+// records, so the gateway publishes the last values and skips discovery at once.
+//
+// Every slot has two copies with a sequence number and a CRC-32, a save writes the older
+// one. A save cut short by a reset or crash leaves the other copy valid.
+// The layout uses native endianness, a region of another layout or build is formatted.
+
+typedef struct
+{
+    daikin_device_info_t info;
+    uint32_t fields;        // Bit (1u << DF_*) per valid value of info, 0 => no snapshot
+    uint32_t info_time;     // Of the snapshot, caller clock (e.g. Unix seconds)
+    uint8_t  capabilities[DAIKIN_CAPABILITIES_BLOB_LEN]; // daikin_capabilities_save blob, all 0 => not discovered
+    daikin_health_t health;
+} daikin_state_record_t;
+
+typedef struct
+{
+    uint8_t* mem;
+    uint32_t mem_len;
+    uint16_t device_count;
+} daikin_state_t;
+
+// Region size needed for device_count devices
+uint32_t daikin_state_size(uint16_t device_count);
+
+// Takes over a region of the same layout (records of devices beyond device_count are dropped)
+// or formats it. restored receives the number of devices with a valid record, can be NULL.
+bool daikin_state_open(daikin_state_t* const state, uint8_t* const mem, uint32_t mem_len,
+    uint16_t device_count, uint16_t* const restored);
+
+bool daikin_state_save(daikin_state_t* const state, uint16_t device, const daikin_state_record_t* const record);
+
+// false => no valid record of the device
+bool daikin_state_load(const daikin_state_t* const state, uint16_t device, daikin_state_record_t* const record);
+
+// Fills capabilities and health of record from daikin and health (can be NULL), before a save
+void daikin_state_capture(daikin_state_record_t* const record, const daikin_t* const daikin,
+    const daikin_health_t* const health);
+
+// Fills daikin->capabilities and the health state and stats (config is kept) from a loaded
+// record, health can be NULL. Capabilities of another registry build are dropped (0 => discovery).
+// Times of health are of the clock before the restart: an open circuit becomes half open,
+// so one probe decides.
+void daikin_state_apply(const daikin_state_record_t* const record, daikin_t* const daikin,
+    daikin_health_t* const health);
+
+// Memory-mapped file helpers (POSIX only). File is created/extended to len bytes.
+bool daikin_state_map_file(const char* const path, uint32_t len, uint8_t** const mem);
+void daikin_state_unmap_file(uint8_t* const mem, uint32_t len);
+
+// Writes a mapped file region to disk (msync, POSIX only), not needed for other regions
+bool daikin_state_sync(const daikin_state_t* const state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
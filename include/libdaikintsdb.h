@@ -0,0 +1,85 @@
+#ifndef __LIB_DAIKIN_TSDB_H__
+#define __LIB_DAIKIN_TSDB_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+
+// Telemetry store for polled daikin_device_info_t history.
+//
+// Each poll is appended into per-field columns (plus one timestamp column).
+// Timestamps and integer values use delta-of-delta encoding,
+// floats use XOR compression (Gorilla).
+// Mostly constant signals cost about one bit per sample.
+//
+// The store works over a caller provided memory region which is split into
+// fixed size segments used as a ring (oldest segment is reused when full).
+// The region can be a memory-mapped file (see daikin_tsdb_map_file),
+// RAM or a flash region. Layout uses native endianness.
+// daikin_tsdb_open drops an append cut short by a crash, the samples before it are kept.
+
+#define DAIKIN_TSDB_COLUMNS         (1 + DF_COUNT) // Timestamp + fields
+#define DAIKIN_TSDB_SEGMENT_SIZE    (1024) // Default segment size in bytes
+
+typedef struct
+{
+    uint32_t prev;
+    int32_t  prev_delta;
+    uint8_t  leading;
+    uint8_t  trailing;
+} daikin_tsdb_column_t;
+
+typedef struct
+{
+    uint8_t* mem;
+    uint32_t mem_len;
+    uint16_t segment_size;
+    uint32_t segment_count;
+    uint32_t active; // Index of the segment being appended
+    daikin_tsdb_column_t columns[DAIKIN_TSDB_COLUMNS]; // Encoder state of the active segment
+} daikin_tsdb_t;
+
+typedef struct
+{
+    uint32_t t_start;
+    uint32_t count;
+    float    min;
+    float    max;
+    float    avg;
+} daikin_tsdb_bucket_t;
+
+// Return false to stop the iteration
+typedef bool (*daikin_tsdb_sample_cb)(void* ctx, uint32_t t, double value);
+
+// Opens existing store in the region or formats a new one.
+// segment_size must be a multiple of 4 (0 => DAIKIN_TSDB_SEGMENT_SIZE).
+bool daikin_tsdb_open(daikin_tsdb_t* const tsdb, uint8_t* const mem, uint32_t mem_len, uint16_t segment_size);
+
+// Appends one poll. Timestamp t (seconds) must not go backwards.
+bool daikin_tsdb_append(daikin_tsdb_t* const tsdb, uint32_t t, const daikin_device_info_t* const info);
+
+// Calls cb for every sample of the field with t_from <= t <= t_to (oldest first).
+bool daikin_tsdb_query(const daikin_tsdb_t* const tsdb, daikin_field_t field,
+    uint32_t t_from, uint32_t t_to, daikin_tsdb_sample_cb cb, void* ctx);
+
+// Aggregates samples into buckets of bucket_len seconds starting at t_from.
+// Returns number of buckets written to out (empty buckets have count == 0).
+uint32_t daikin_tsdb_downsample(const daikin_tsdb_t* const tsdb, daikin_field_t field,
+    uint32_t t_from, uint32_t t_to, uint32_t bucket_len,
+    daikin_tsdb_bucket_t* const out, uint32_t max_buckets);
+
+// Memory-mapped file helpers (POSIX only). File is created/extended to len bytes.
+bool daikin_tsdb_map_file(const char* const path, uint32_t len, uint8_t** const mem);
+bool daikin_tsdb_sync(const daikin_tsdb_t* const tsdb);
+void daikin_tsdb_unmap_file(uint8_t* const mem, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __LIB_DAIKIN_WIRE_H__
+#define __LIB_DAIKIN_WIRE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libdaikin.h"
+#include "libdaikindelta.h"
+
+// Compact binary encoding of device info and change events, e.g. for gateways shipping
+// snapshots of many devices to a backend.
+//
+// A batch is a header followed by fixed size records of one kind, little endian regardless
+// of the host:
+//   header  "DKWB" u8 version u8 kind u16 count u16 record_len u16 reserved
+//   info    u16 device u16 fields u32 t f32 indoor_temp f32 outdoor_temp f32 leaving_water_temp
+//           i32 emergency_state i32 error_state i32 warning_state
+//           u8 power_state u8 temp_mode u8 temp_target i8 temp_offset
+//   change  u16 device u8 field u8 flags (1 => initial) u32 t f64 old_value f64 new_value
+// fields has a bit (1u << DF_*) per valid value, t is defined by the caller (e.g. seconds).
+// Newer versions only append to records, readers step by record_len. No checksum, the
+// transport has one.
+//
+// Records are read in place (zero copy): daikin_wire_record returns a pointer into the
+// batch for the accessors below.
+
+#define DAIKIN_WIRE_VERSION         (1)
+#define DAIKIN_WIRE_HEADER_LEN      (12)
+#define DAIKIN_WIRE_INFO_LEN        (36)
+#define DAIKIN_WIRE_CHANGE_LEN      (24)
+
+// Buffer length of a batch with count records of record_len bytes
+#define DAIKIN_WIRE_BATCH_LEN(count, record_len) (DAIKIN_WIRE_HEADER_LEN + (uint32_t)(count) * (record_len))
+
+typedef enum
+{
+    WK_INFO = 1,    // daikin_device_info_t snapshots
+    WK_CHANGE = 2,  // daikin_delta_event_t
+} daikin_wire_kind_t;
+
+typedef struct
+{
+    uint8_t* buf;
+    uint32_t len;
+    uint32_t used;
+    uint16_t count;
+    daikin_wire_kind_t kind;
+} daikin_wire_writer_t;
+
+typedef struct
+{
+    const uint8_t* data;
+    uint16_t count;
+    uint16_t record_len;
+    daikin_wire_kind_t kind;
+} daikin_wire_reader_t;
+
+// Starts a batch of kind records in buf
+bool daikin_wire_begin(daikin_wire_writer_t* const writer, uint8_t* const buf, uint32_t len, daikin_wire_kind_t kind);
+
+// false => batch is full (or of the other kind), end it and start the next one
+bool daikin_wire_add_info(daikin_wire_writer_t* const writer, uint16_t device, uint32_t t,
+    const daikin_device_info_t* const info, uint16_t fields);
+bool daikin_wire_add_change(daikin_wire_writer_t* const writer, uint16_t device, uint32_t t,
+    const daikin_delta_event_t* const event);
+
+// Completes the header, returns the batch length in bytes
+uint32_t daikin_wire_end(daikin_wire_writer_t* const writer);
+
+// Checks the header and the length, data must stay valid while the reader is used
+bool daikin_wire_read(daikin_wire_reader_t* const reader, const uint8_t* const data, uint32_t len);
+
+// Record index of the batch, NULL => out of range
+const uint8_t* daikin_wire_record(const daikin_wire_reader_t* const reader, uint16_t index);
+
+// Accessors of a record, both kinds
+uint16_t daikin_wire_device(const uint8_t* const record);
+uint32_t daikin_wire_time(const uint8_t* const record);
+
+// Accessors of an info record
+uint16_t daikin_wire_info_fields(const uint8_t* const record);
+bool     daikin_wire_info_value(const uint8_t* const record, daikin_field_t field, double* const v); // false => not valid
+void     daikin_wire_info_decode(const uint8_t* const record, daikin_device_info_t* const info);
+
+// Accessor of a change record, false => field out of range
+bool     daikin_wire_change_decode(const uint8_t* const record, daikin_delta_event_t* const event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __BYTE_ORDER_H__
+#define __BYTE_ORDER_H__
+
+#include <stdint.h>
+
+// Little endian regardless of the host. Inline, wire batches call them per value and
+// compilers turn them into plain loads and stores.
+
+static inline void daikin_put_le16(uint8_t* const p, uint16_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void daikin_put_le32(uint8_t* const p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void daikin_put_le64(uint8_t* const p, uint64_t v)
+{
+    daikin_put_le32(p, (uint32_t)v);
+    daikin_put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint16_t daikin_get_le16(const uint8_t* const p)
+{
+    return (uint16_t)(((uint16_t)p[0]) | ((uint16_t)p[1] << 8));
+}
+
+static inline uint32_t daikin_get_le32(const uint8_t* const p)
+{
+    return
+        ((uint32_t)p[0]) |
+        ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) |
+        ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t daikin_get_le64(const uint8_t* const p)
+{
+    return (uint64_t)daikin_get_le32(p) | ((uint64_t)daikin_get_le32(p + 4) << 32);
+}
+
+#endif
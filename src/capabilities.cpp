@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/libdaikin.h"
+
+#include "registry.h"
+#include "byte_order.h"
+#include "checksum.h"
+#include "trace.h"
+
+static const uint8_t BLOB_MAGIC[] = { 'D', 'K', 'C', 'P' };
+static const uint8_t BLOB_VERSION = 1;
+static const uint16_t BLOB_LEN = DAIKIN_CAPABILITIES_BLOB_LEN; // magic, version, count, hash, caps, crc
+
+bool daikin_is_supported(
+    const daikin_t* const daikin,
+    const char* const path)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT((path != NULL) && (strlen(path) > 0));
+
+    if (daikin == NULL || path == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or path.\n");
+        return false;
+    }
+
+    if ((daikin->capabilities & DAIKIN_CAPS_DISCOVERED) == 0)
+        return true; // Not discovered, everything is tried
+
+    const registry_entry_t* const entry = registry_find(path, strlen(path));
+    if (entry == NULL)
+        return true; // Unknown paths are not discovered
+
+    return ((daikin->capabilities | REGISTRY_MODE_DEPENDENT) & (1u << registry_index_of(entry))) != 0;
+}
+
+uint16_t daikin_capabilities_save(
+    const daikin_t* const daikin,
+    uint8_t* const blob,
+    uint16_t blob_len)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(blob != NULL);
+
+    if (daikin == NULL || blob == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or blob.\n");
+        return 0;
+    }
+
+    if ((daikin->capabilities & DAIKIN_CAPS_DISCOVERED) == 0)
+    {
+        LIBDAIKIN_ERROR("Capabilities are not discovered.\n");
+        return 0;
+    }
+
+    if (blob_len < BLOB_LEN)
+    {
+        LIBDAIKIN_ERROR("Blob too small: %u. Required: %u.\n", blob_len, BLOB_LEN);
+        return 0;
+    }
+
+    memcpy(blob, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+    blob[4] = BLOB_VERSION;
+    blob[5] = (uint8_t)RE_COUNT;
+    daikin_put_le32(&blob[6], registry_hash());
+    daikin_put_le32(&blob[10], daikin->capabilities);
+    daikin_put_le32(&blob[14], daikin_crc32(blob, 14));
+
+    return BLOB_LEN;
+}
+
+bool daikin_capabilities_load(
+    daikin_t* const daikin,
+    const uint8_t* const blob,
+    uint16_t blob_len)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(blob != NULL);
+
+    if (daikin == NULL || blob == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or blob.\n");
+        return false;
+    }
+
+    if (
+        blob_len < BLOB_LEN ||
+        memcmp(blob, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0 ||
+        blob[4] != BLOB_VERSION ||
+        daikin_get_le32(&blob[14]) != daikin_crc32(blob, 14))
+    {
+        LIBDAIKIN_ERROR("Capabilities blob is not valid.\n");
+        return false;
+    }
+
+    if (blob[5] != (uint8_t)RE_COUNT || daikin_get_le32(&blob[6]) != registry_hash())
+    {
+        LIBDAIKIN_INFO("Capabilities blob is outdated. Discovery is needed.\n");
+        return false;
+    }
+
+    const uint32_t caps = daikin_get_le32(&blob[10]);
+    if ((caps & DAIKIN_CAPS_DISCOVERED) == 0)
+    {
+        LIBDAIKIN_ERROR("Capabilities blob is not valid.\n");
+        return false;
+    }
+
+    daikin->capabilities = caps;
+    return true;
+}
+
+bool daikin_capabilities_save_file(
+    const daikin_t* const daikin,
+    const char* const file_name)
+{
+    LIBDAIKIN_ASSERT((file_name != NULL) && (strlen(file_name) > 0));
+
+    if (file_name == NULL || strlen(file_name) == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument file_name.\n");
+        return false;
+    }
+
+    uint8_t blob[BLOB_LEN];
+    const uint16_t len = daikin_capabilities_save(daikin, blob, sizeof(blob));
+    if (len == 0)
+        return false; // No extra error info needed
+
+    FILE* f = fopen(file_name, "wb");
+    if (f == NULL)
+    {
+        LIBDAIKIN_ERROR("Unable to open '%s' for writing.\n", file_name);
+        return false;
+    }
+
+    const bool ok = fwrite(blob, 1, len, f) == len;
+    if (fclose(f) != 0 || ok == false)
+    {
+        LIBDAIKIN_ERROR("Unable to write '%s'.\n", file_name);
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_capabilities_load_file(
+    daikin_t* const daikin,
+    const char* const file_name)
+{
+    LIBDAIKIN_ASSERT((file_name != NULL) && (strlen(file_name) > 0));
+
+    if (file_name == NULL || strlen(file_name) == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument file_name.\n");
+        return false;
+    }
+
+    FILE* f = fopen(file_name, "rb");
+    if (f == NULL)
+    {
+        LIBDAIKIN_TRACE("Capabilities file '%s' not found.\n", file_name);
+        return false;
+    }
+
+    uint8_t blob[BLOB_LEN];
+    const size_t len = fread(blob, 1, sizeof(blob), f);
+    fclose(f);
+
+    return daikin_capabilities_load(daikin, blob, (uint16_t)len);
+}
@@ -0,0 +1,20 @@
+#include "checksum.h"
+#include "trace.h"
+
+uint32_t daikin_crc32(const void* const data, size_t len)
+{
+    LIBDAIKIN_ASSERT(data != NULL || len == 0);
+
+    // Bitwise version, no table to keep flash usage low
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,17 @@
+#ifndef __CHECKSUM_H__
+#define __CHECKSUM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t daikin_crc32(const void* const data, size_t len); // CRC-32 (IEEE 802.3)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,224 @@
+#include <string.h>
+
+#include "../include/libdaikincmdq.h"
+
+#include "registry.h"
+#include "trace.h"
+
+static const daikin_field_t SLOT_FIELDS[DAIKIN_CMDQ_SLOTS] =
+{
+    daikin_field_t::DF_TEMP_TARGET,
+    daikin_field_t::DF_TEMP_OFFSET,
+    daikin_field_t::DF_POWER_STATE
+};
+
+static void complete(daikin_cmdq_t* const cmdq, uint8_t slot, int32_t value,
+    daikin_cmd_done_cb cb, void* ctx, daikin_cmd_result_t result)
+{
+    switch (result)
+    {
+    case daikin_cmd_result_t::CR_WRITTEN:    cmdq->writes++; break;
+    case daikin_cmd_result_t::CR_SKIPPED:    cmdq->skipped++; break;
+    case daikin_cmd_result_t::CR_SUPERSEDED: cmdq->superseded++; break;
+    case daikin_cmd_result_t::CR_FAILED:     cmdq->failed++; break;
+    }
+
+    if (cb != NULL)
+        cb(ctx, SLOT_FIELDS[slot], value, result);
+}
+
+static bool is_due(const daikin_cmdq_t* const cmdq, const daikin_cmdq_slot_t* const s, uint32_t now_ms)
+{
+    return s->written == false || (now_ms - s->last_write_ms) >= cmdq->min_interval_ms;
+}
+
+static bool enqueue(
+    daikin_cmdq_t* const cmdq,
+    uint8_t slot,
+    int32_t value,
+    daikin_cmd_done_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(cmdq != NULL);
+    LIBDAIKIN_ASSERT(slot < DAIKIN_CMDQ_SLOTS);
+
+    if (cmdq == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument cmdq.\n");
+        return false;
+    }
+
+    daikin_cmdq_slot_t* const s = &cmdq->slots[slot];
+
+    if (s->pending)
+    {
+        s->pending = false;
+        complete(cmdq, slot, s->value, s->cb, s->ctx, daikin_cmd_result_t::CR_SUPERSEDED);
+    }
+
+    if (s->known && s->last_value == value)
+    {
+        complete(cmdq, slot, value, cb, ctx, daikin_cmd_result_t::CR_SKIPPED);
+        return true;
+    }
+
+    s->pending = true;
+    s->value = value;
+    s->cb = cb;
+    s->ctx = ctx;
+    return true;
+}
+
+static bool is_in_range(registry_index_t index, int32_t v)
+{
+    const registry_entry_t* const entry = registry_get(index);
+    if (v < entry->min || v > entry->max)
+    {
+        LIBDAIKIN_ERROR("Invalid value %d for '%.*s'. Value must be between %g and %g.\n",
+            v, entry->path_len, entry->read_path, entry->min, entry->max);
+        return false;
+    }
+
+    return true;
+}
+
+void daikin_cmdq_init(daikin_cmdq_t* const cmdq, uint32_t min_interval_ms)
+{
+    LIBDAIKIN_ASSERT(cmdq != NULL);
+
+    if (cmdq == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument cmdq.\n");
+        return;
+    }
+
+    memset(cmdq, 0, sizeof(daikin_cmdq_t));
+    cmdq->min_interval_ms = min_interval_ms > 0 ? min_interval_ms : DAIKIN_CMDQ_MIN_INTERVAL;
+}
+
+bool daikin_cmdq_set_temp_target(daikin_cmdq_t* const cmdq, uint8_t temp_target, daikin_cmd_done_cb cb, void* ctx)
+{
+    if (is_in_range(registry_index_t::RE_TEMP_TARGET, temp_target) == false)
+        return false; // No extra error info needed
+
+    return enqueue(cmdq, 0, temp_target, cb, ctx);
+}
+
+bool daikin_cmdq_set_temp_offset(daikin_cmdq_t* const cmdq, int8_t temp_offset, daikin_cmd_done_cb cb, void* ctx)
+{
+    if (is_in_range(registry_index_t::RE_TEMP_OFFSET, temp_offset) == false)
+        return false; // No extra error info needed
+
+    return enqueue(cmdq, 1, temp_offset, cb, ctx);
+}
+
+bool daikin_cmdq_set_power_state(daikin_cmdq_t* const cmdq, daikin_power_state_t power_state, daikin_cmd_done_cb cb, void* ctx)
+{
+    if (!(power_state == daikin_power_state_t::PS_ON || power_state == daikin_power_state_t::PS_STANDBY))
+    {
+        LIBDAIKIN_ERROR("Invalid input argument power_state: %d\n", power_state);
+        return false;
+    }
+
+    return enqueue(cmdq, 2, power_state, cb, ctx);
+}
+
+void daikin_cmdq_observe(daikin_cmdq_t* const cmdq, const daikin_device_info_t* const info)
+{
+    LIBDAIKIN_ASSERT(cmdq != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (cmdq == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument cmdq or info.\n");
+        return;
+    }
+
+    const bool known[DAIKIN_CMDQ_SLOTS] =
+    {
+        info->temp_mode == daikin_temperature_mode_t::TM_TARGET,
+        info->temp_mode == daikin_temperature_mode_t::TM_OFFSET,
+        info->power_state != daikin_power_state_t::PS_UNKNOWN
+    };
+    const int32_t values[DAIKIN_CMDQ_SLOTS] = { info->temp_target, info->temp_offset, info->power_state };
+
+    for (uint8_t i = 0; i < DAIKIN_CMDQ_SLOTS; i++)
+    {
+        cmdq->slots[i].known = known[i];
+        cmdq->slots[i].last_value = values[i];
+    }
+}
+
+bool daikin_cmdq_flush(daikin_cmdq_t* const cmdq, const daikin_t* const daikin, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(cmdq != NULL);
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (cmdq == NULL || daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument cmdq or daikin.\n");
+        return false;
+    }
+
+    bool ok = true;
+
+    for (uint8_t i = 0; i < DAIKIN_CMDQ_SLOTS; i++)
+    {
+        daikin_cmdq_slot_t* const s = &cmdq->slots[i];
+        if (s->pending == false || is_due(cmdq, s, now_ms) == false)
+            continue;
+
+        // Slot is free before the callback, it can queue the next value
+        const int32_t value = s->value;
+        const daikin_cmd_done_cb cb = s->cb;
+        void* const ctx = s->ctx;
+        s->pending = false;
+
+        // Observed meanwhile
+        if (s->known && s->last_value == value)
+        {
+            complete(cmdq, i, value, cb, ctx, daikin_cmd_result_t::CR_SKIPPED);
+            continue;
+        }
+
+        bool written;
+        if (i == 0)
+            written = daikin_set_temp_target(daikin, (uint8_t)value);
+        else if (i == 1)
+            written = daikin_set_temp_offset(daikin, (int8_t)value);
+        else
+            written = daikin_set_power_state(daikin, (daikin_power_state_t)value);
+
+        s->written = true;
+        s->last_write_ms = now_ms;
+        s->known = written;
+        s->last_value = value;
+
+        complete(cmdq, i, value, cb, ctx, written ? daikin_cmd_result_t::CR_WRITTEN : daikin_cmd_result_t::CR_FAILED);
+        ok = ok && written;
+    }
+
+    return ok;
+}
+
+uint32_t daikin_cmdq_next_delay(const daikin_cmdq_t* const cmdq, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(cmdq != NULL);
+
+    if (cmdq == NULL)
+        return UINT32_MAX;
+
+    uint32_t delay = UINT32_MAX;
+    for (uint8_t i = 0; i < DAIKIN_CMDQ_SLOTS; i++)
+    {
+        const daikin_cmdq_slot_t* const s = &cmdq->slots[i];
+        if (s->pending == false)
+            continue;
+
+        const uint32_t d = is_due(cmdq, s, now_ms) ? 0 : cmdq->min_interval_ms - (now_ms - s->last_write_ms);
+        if (d < delay)
+            delay = d;
+    }
+
+    return delay;
+}
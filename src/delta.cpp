@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include "../include/libdaikindelta.h"
+
+#include "fields.h"
+#include "trace.h"
+
+static const float DEFAULT_TEMP_DEADBAND = 0.5f;
+static const float DEFAULT_TEMP_HYSTERESIS = 0.1f;
+
+// Temperatures are floats with 0.1 resolution, 20.8 -> 21.3 must pass 0.5 deadband
+static const double DEADBAND_EPSILON = 0.001;
+
+void daikin_delta_init(
+    daikin_delta_t* const delta,
+    const daikin_delta_config_t config[DF_COUNT])
+{
+    LIBDAIKIN_ASSERT(delta != NULL);
+
+    if (delta == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument delta.\n");
+        return;
+    }
+
+    memset(delta, 0, sizeof(daikin_delta_t));
+
+    if (config != NULL)
+    {
+        memcpy(delta->config, config, sizeof(delta->config));
+        return;
+    }
+
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        if (daikin_field_is_float((daikin_field_t)f))
+        {
+            delta->config[f].deadband = DEFAULT_TEMP_DEADBAND;
+            delta->config[f].hysteresis = DEFAULT_TEMP_HYSTERESIS;
+        }
+    }
+}
+
+uint8_t daikin_delta_update(
+    daikin_delta_t* const delta,
+    const daikin_device_info_t* const info,
+    daikin_delta_event_t* const events,
+    uint8_t max_events)
+{
+    LIBDAIKIN_ASSERT(delta != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(events != NULL);
+
+    if (delta == NULL || info == NULL || events == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument delta, info or events.\n");
+        return 0;
+    }
+
+    uint8_t count = 0;
+
+    for (uint8_t f = 0; f < DF_COUNT && count < max_events; f++)
+    {
+        const daikin_field_t field = (daikin_field_t)f;
+        const double v = daikin_field_get_double(info, field);
+        daikin_delta_event_t* const e = &events[count];
+
+        if ((delta->reported_mask & (1u << f)) == 0)
+        {
+            e->field = field;
+            e->initial = true;
+            e->old_value = v;
+            e->new_value = v;
+            delta->reported[f] = v;
+            delta->reported_mask |= (1u << f);
+            count++;
+            continue;
+        }
+
+        const double diff = v - delta->reported[f];
+        if (diff == 0)
+            continue;
+
+        const int8_t direction = diff > 0 ? 1 : -1;
+        const daikin_delta_config_t* const c = &delta->config[f];
+
+        double threshold = c->deadband;
+        if (delta->direction[f] != 0 && delta->direction[f] != direction)
+            threshold += c->hysteresis;
+
+        if ((diff > 0 ? diff : -diff) < threshold - DEADBAND_EPSILON)
+            continue;
+
+        e->field = field;
+        e->initial = false;
+        e->old_value = delta->reported[f];
+        e->new_value = v;
+        delta->reported[f] = v;
+        delta->direction[f] = direction;
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,341 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/libdaikinexport.h"
+
+#include "fields.h"
+#include "trace.h"
+
+static const uint16_t MAX_LINE = 512; // Longest line written, with room to spare
+
+static_assert(DAIKIN_EXPORT_BUFFER >= MAX_LINE, "DAIKIN_EXPORT_BUFFER must hold a line");
+
+// Members of daikin_device_info_t
+static const char* const FIELD_NAMES[DF_COUNT] =
+{
+    "indoor_temp",
+    "outdoor_temp",
+    "leaving_water_temp",
+    "power_state",
+    "emergency_state",
+    "error_state",
+    "warning_state",
+    "temp_mode",
+    "temp_target",
+    "temp_offset",
+};
+
+static const double INTEGER_LIMIT = 1e15; // Below it doubles hold integers exactly
+static const uint32_t DECIMALS_SCALE = 1000;
+
+static char* put_str(char* p, const char* s)
+{
+    while (*s)
+        *p++ = *s++;
+    return p;
+}
+
+static char* put_uint(char* p, uint64_t v)
+{
+    char digits[20];
+    uint8_t n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    while (n > 0)
+        *p++ = digits[--n];
+    return p;
+}
+
+// Integers as is, others rounded to 3 decimals without trailing zeros
+static char* put_number(char* p, double v, bool json)
+{
+    if (isfinite(v) == false)
+        return json ? put_str(p, "null") : p;
+
+    const double a = v < 0 ? -v : v;
+    if (a >= INTEGER_LIMIT)
+        return p + snprintf(p, 32, "%.17g", v); // Rare, exact
+
+    const uint64_t scaled = (uint64_t)(a * DECIMALS_SCALE + 0.5);
+    uint32_t frac = (uint32_t)(scaled % DECIMALS_SCALE);
+
+    if (v < 0 && scaled > 0)
+        *p++ = '-';
+    p = put_uint(p, scaled / DECIMALS_SCALE);
+
+    if (frac > 0)
+    {
+        *p++ = '.';
+        for (uint32_t d = DECIMALS_SCALE / 10; d > 0 && frac > 0; d /= 10)
+        {
+            *p++ = (char)('0' + frac / d);
+            frac %= d;
+        }
+    }
+
+    return p;
+}
+
+static bool ensure_line(daikin_export_t* const e)
+{
+    if (DAIKIN_EXPORT_BUFFER - e->used >= MAX_LINE)
+        return true;
+
+    return daikin_export_flush(e);
+}
+
+static bool is_valid_export(const daikin_export_t* const e)
+{
+    if (e == NULL || e->cb == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument e, not initialized.\n");
+        return false;
+    }
+
+    return true;
+}
+
+// CSV takes one record kind, written with its header
+static bool csv_header(daikin_export_t* const e, daikin_wire_kind_t kind)
+{
+    if (e->kind == (uint8_t)kind)
+        return true;
+
+    if (e->kind != 0)
+    {
+        LIBDAIKIN_ERROR("CSV export of kind %u can't take kind %d.\n", e->kind, kind);
+        return false;
+    }
+
+    if (ensure_line(e) == false)
+        return false; // No extra error info needed
+
+    char* p = e->buffer + e->used;
+    p = put_str(p, "device,t");
+    if (kind == daikin_wire_kind_t::WK_INFO)
+    {
+        for (uint8_t f = 0; f < DF_COUNT; f++)
+        {
+            *p++ = ',';
+            p = put_str(p, FIELD_NAMES[f]);
+        }
+    }
+    else
+        p = put_str(p, ",field,initial,old,new");
+
+    *p++ = '\n';
+    e->used = (uint32_t)(p - e->buffer);
+    e->kind = (uint8_t)kind;
+    return true;
+}
+
+// values has an entry per field, only the ones in fields are used
+static bool info_line(daikin_export_t* const e, uint16_t device, uint32_t t, const double values[DF_COUNT], uint16_t fields)
+{
+    if (e->format == daikin_export_format_t::EF_CSV && csv_header(e, daikin_wire_kind_t::WK_INFO) == false)
+        return false; // No extra error info needed
+
+    if (ensure_line(e) == false)
+        return false; // No extra error info needed
+
+    char* p = e->buffer + e->used;
+    if (e->format == daikin_export_format_t::EF_CSV)
+    {
+        p = put_uint(p, device);
+        *p++ = ',';
+        p = put_uint(p, t);
+        for (uint8_t f = 0; f < DF_COUNT; f++)
+        {
+            *p++ = ',';
+            if (fields & (1u << f))
+                p = put_number(p, values[f], false);
+        }
+    }
+    else
+    {
+        p = put_str(p, "{\"device\":");
+        p = put_uint(p, device);
+        p = put_str(p, ",\"t\":");
+        p = put_uint(p, t);
+        for (uint8_t f = 0; f < DF_COUNT; f++)
+        {
+            if ((fields & (1u << f)) == 0)
+                continue;
+
+            p = put_str(p, ",\"");
+            p = put_str(p, FIELD_NAMES[f]);
+            p = put_str(p, "\":");
+            p = put_number(p, values[f], true);
+        }
+        *p++ = '}';
+    }
+
+    *p++ = '\n';
+    e->used = (uint32_t)(p - e->buffer);
+    e->lines++;
+    return true;
+}
+
+static bool change_line(daikin_export_t* const e, uint16_t device, uint32_t t, const daikin_delta_event_t* const event)
+{
+    if (event->field >= daikin_field_t::DF_COUNT)
+    {
+        LIBDAIKIN_ERROR("Invalid change of field %d.\n", event->field);
+        return false;
+    }
+
+    if (e->format == daikin_export_format_t::EF_CSV && csv_header(e, daikin_wire_kind_t::WK_CHANGE) == false)
+        return false; // No extra error info needed
+
+    if (ensure_line(e) == false)
+        return false; // No extra error info needed
+
+    const bool json = e->format == daikin_export_format_t::EF_NDJSON;
+    char* p = e->buffer + e->used;
+
+    p = put_str(p, json ? "{\"device\":" : "");
+    p = put_uint(p, device);
+    p = put_str(p, json ? ",\"t\":" : ",");
+    p = put_uint(p, t);
+    p = put_str(p, json ? ",\"field\":\"" : ",");
+    p = put_str(p, FIELD_NAMES[event->field]);
+    p = put_str(p, json ? "\",\"initial\":" : ",");
+    p = put_str(p, event->initial ? "true" : "false");
+    p = put_str(p, json ? ",\"old\":" : ",");
+    p = put_number(p, event->old_value, json);
+    p = put_str(p, json ? ",\"new\":" : ",");
+    p = put_number(p, event->new_value, json);
+    p = put_str(p, json ? "}\n" : "\n");
+
+    e->used = (uint32_t)(p - e->buffer);
+    e->lines++;
+    return true;
+}
+
+void daikin_export_init(
+    daikin_export_t* const e,
+    daikin_export_format_t format,
+    daikin_export_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(e != NULL);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    if (e == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument e.\n");
+        return;
+    }
+
+    e->format = format;
+    e->cb = cb;
+    e->ctx = ctx;
+    e->kind = 0;
+    e->used = 0;
+    e->lines = 0;
+    e->bytes = 0;
+}
+
+bool daikin_export_info(
+    daikin_export_t* const e,
+    uint16_t device,
+    uint32_t t,
+    const daikin_device_info_t* const info,
+    uint16_t fields)
+{
+    LIBDAIKIN_ASSERT(e != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (is_valid_export(e) == false || info == NULL)
+        return false; // No extra error info needed
+
+    double values[DF_COUNT];
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+        values[f] = daikin_field_get_double(info, (daikin_field_t)f);
+
+    return info_line(e, device, t, values, fields);
+}
+
+bool daikin_export_change(
+    daikin_export_t* const e,
+    uint16_t device,
+    uint32_t t,
+    const daikin_delta_event_t* const event)
+{
+    LIBDAIKIN_ASSERT(e != NULL);
+    LIBDAIKIN_ASSERT(event != NULL);
+
+    if (is_valid_export(e) == false || event == NULL)
+        return false; // No extra error info needed
+
+    return change_line(e, device, t, event);
+}
+
+bool daikin_export_batch(
+    daikin_export_t* const e,
+    const daikin_wire_reader_t* const reader)
+{
+    LIBDAIKIN_ASSERT(e != NULL);
+    LIBDAIKIN_ASSERT(reader != NULL);
+
+    if (is_valid_export(e) == false || reader == NULL)
+        return false; // No extra error info needed
+
+    for (uint16_t i = 0; i < reader->count; i++)
+    {
+        const uint8_t* const record = daikin_wire_record(reader, i);
+        bool ok;
+
+        if (reader->kind == daikin_wire_kind_t::WK_INFO)
+        {
+            double values[DF_COUNT];
+            const uint16_t fields = daikin_wire_info_fields(record);
+            for (uint8_t f = 0; f < DF_COUNT; f++)
+            {
+                if (daikin_wire_info_value(record, (daikin_field_t)f, &values[f]) == false)
+                    values[f] = 0;
+            }
+
+            ok = info_line(e, daikin_wire_device(record), daikin_wire_time(record), values, fields);
+        }
+        else
+        {
+            daikin_delta_event_t event;
+            ok = daikin_wire_change_decode(record, &event) &&
+                change_line(e, daikin_wire_device(record), daikin_wire_time(record), &event);
+        }
+
+        if (ok == false)
+            return false; // No extra error info needed
+    }
+
+    return true;
+}
+
+bool daikin_export_flush(daikin_export_t* const e)
+{
+    LIBDAIKIN_ASSERT(e != NULL);
+
+    if (is_valid_export(e) == false)
+        return false; // No extra error info needed
+
+    if (e->used == 0)
+        return true;
+
+    const uint32_t used = e->used;
+    e->used = 0;
+    e->bytes += used;
+
+    if (e->cb(e->ctx, e->buffer, used) == false)
+    {
+        LIBDAIKIN_ERROR("Export output failed.\n");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,87 @@
+#include <stddef.h>
+
+#include "fields.h"
+#include "trace.h"
+
+bool daikin_field_is_float(daikin_field_t field)
+{
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    return
+        field == daikin_field_t::DF_INDOOR_TEMP ||
+        field == daikin_field_t::DF_OUTDOOR_TEMP ||
+        field == daikin_field_t::DF_LEAVING_WATER_TEMP;
+}
+
+float daikin_field_get_float(
+    const daikin_device_info_t* const info,
+    daikin_field_t field)
+{
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(daikin_field_is_float(field));
+
+    switch (field)
+    {
+    case daikin_field_t::DF_INDOOR_TEMP:        return info->indoor_temp;
+    case daikin_field_t::DF_OUTDOOR_TEMP:       return info->outdoor_temp;
+    case daikin_field_t::DF_LEAVING_WATER_TEMP: return info->leaving_water_temp;
+    default:                                    return (float)daikin_field_get_int32(info, field);
+    }
+}
+
+int32_t daikin_field_get_int32(
+    const daikin_device_info_t* const info,
+    daikin_field_t field)
+{
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    switch (field)
+    {
+    case daikin_field_t::DF_POWER_STATE:        return (int32_t)info->power_state;
+    case daikin_field_t::DF_EMERGENCY_STATE:    return info->emergency_state;
+    case daikin_field_t::DF_ERROR_STATE:        return info->error_state;
+    case daikin_field_t::DF_WARNING_STATE:      return info->warning_state;
+    case daikin_field_t::DF_TEMP_MODE:          return (int32_t)info->temp_mode;
+    case daikin_field_t::DF_TEMP_TARGET:        return (int32_t)info->temp_target;
+    case daikin_field_t::DF_TEMP_OFFSET:        return (int32_t)info->temp_offset;
+    default:                                    return (int32_t)daikin_field_get_float(info, field);
+    }
+}
+
+double daikin_field_get_double(
+    const daikin_device_info_t* const info,
+    daikin_field_t field)
+{
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    if (daikin_field_is_float(field))
+        return (double)daikin_field_get_float(info, field);
+
+    return (double)daikin_field_get_int32(info, field);
+}
+
+void daikin_field_set_double(
+    daikin_device_info_t* const info,
+    daikin_field_t field,
+    double v)
+{
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    switch (field)
+    {
+    case daikin_field_t::DF_INDOOR_TEMP:        info->indoor_temp = (float)v; break;
+    case daikin_field_t::DF_OUTDOOR_TEMP:       info->outdoor_temp = (float)v; break;
+    case daikin_field_t::DF_LEAVING_WATER_TEMP: info->leaving_water_temp = (float)v; break;
+    case daikin_field_t::DF_POWER_STATE:        info->power_state = (daikin_power_state_t)(int32_t)v; break;
+    case daikin_field_t::DF_EMERGENCY_STATE:    info->emergency_state = (int32_t)v; break;
+    case daikin_field_t::DF_ERROR_STATE:        info->error_state = (int32_t)v; break;
+    case daikin_field_t::DF_WARNING_STATE:      info->warning_state = (int32_t)v; break;
+    case daikin_field_t::DF_TEMP_MODE:          info->temp_mode = (daikin_temperature_mode_t)(int32_t)v; break;
+    case daikin_field_t::DF_TEMP_TARGET:        info->temp_target = (uint8_t)(int32_t)v; break;
+    case daikin_field_t::DF_TEMP_OFFSET:        info->temp_offset = (int8_t)(int32_t)v; break;
+    default:                                    break;
+    }
+}
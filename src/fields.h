@@ -0,0 +1,23 @@
+#ifndef __FIELDS_H__
+#define __FIELDS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/libdaikin.h"
+
+bool    daikin_field_is_float(daikin_field_t field);
+float   daikin_field_get_float(const daikin_device_info_t* const info, daikin_field_t field);
+int32_t daikin_field_get_int32(const daikin_device_info_t* const info, daikin_field_t field);
+double  daikin_field_get_double(const daikin_device_info_t* const info, daikin_field_t field);
+void    daikin_field_set_double(daikin_device_info_t* const info, daikin_field_t field, double v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
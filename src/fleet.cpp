@@ -0,0 +1,531 @@
+#include <string.h>
+
+#include "../include/libdaikinfleet.h"
+
+#include "time_util.h"
+#include "trace.h"
+
+#ifdef DAIKIN_FLEET
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const uint32_t IDLE_CHECK_MS = 2;  // Idle worker looks for overdue devices of others this often
+static const uint32_t STEAL_LAG_MS = 5;   // Devices this late show a worker which falls behind
+static const uint32_t HANDSHAKE_WAIT_MS = 1; // Open deferred by max_handshakes is tried again
+static const uint32_t PROBE_WAIT_MS = 5;     // Probe deferred by the probe cap is tried again
+static const uint16_t WORKERS_PER_PROBE = 4; // Probes block on sick adapters, most workers stay for the healthy ones
+static const size_t CACHE_LINE = 64;
+
+typedef struct
+{
+    uint32_t due_ms;
+    uint32_t device;
+} fleet_due_t;
+
+struct alignas(CACHE_LINE) fleet_device_t
+{
+    daikin_t daikin;
+    daikin_device_info_t info;
+    uint8_t failures;       // Failed polls in a row, widens the backoff window
+    daikin_health_t health;
+};
+
+struct fleet_impl_t;
+
+// Everything the owner writes per poll sits on its own lines
+struct alignas(CACHE_LINE) fleet_worker_t
+{
+    fleet_impl_t* fleet;
+    uint16_t id;
+    std::thread thread;
+
+    std::mutex mutex;                   // Queue, taken by thieves as well
+    std::vector<fleet_due_t> queue;     // Min heap by due time
+    std::atomic<uint32_t> size;         // Queue length, read by thieves without the lock
+
+    std::mutex wait_mutex;
+    std::condition_variable wake;
+    uint32_t random;                    // Backoff jitter
+
+    std::atomic<uint64_t> polls;
+    std::atomic<uint64_t> failures;
+    std::atomic<uint64_t> opens;
+    std::atomic<uint64_t> steals;
+    std::atomic<uint64_t> deferred;
+    std::atomic<uint32_t> devices;      // Owned, queued or in the current poll
+};
+
+struct fleet_impl_t
+{
+    daikin_fleet_config_t config;
+    std::vector<fleet_device_t> devices;
+    std::vector<fleet_worker_t*> workers;
+    std::atomic<bool> stop;
+    alignas(CACHE_LINE) std::atomic<uint16_t> handshakes; // Opens running over all workers
+    std::atomic<uint32_t> open_circuits; // Changes only when a circuit trips or closes
+    std::atomic<uint16_t> probes;        // Probes running over all workers
+    uint16_t max_probes;
+};
+
+// Heap order of std::push_heap / std::pop_heap, earliest due on top
+static bool later(const fleet_due_t& a, const fleet_due_t& b)
+{
+    return (int32_t)(a.due_ms - b.due_ms) > 0;
+}
+
+static void enqueue(fleet_worker_t* const w, const fleet_due_t* const items, size_t count)
+{
+    std::lock_guard<std::mutex> lock(w->mutex);
+    for (size_t i = 0; i < count; i++)
+    {
+        w->queue.push_back(items[i]);
+        std::push_heap(w->queue.begin(), w->queue.end(), later);
+    }
+
+    w->size.store((uint32_t)w->queue.size(), std::memory_order_relaxed);
+}
+
+// Next due device of the worker, false => none is due (next_ms gets the earliest due time)
+static bool dequeue(fleet_worker_t* const w, uint32_t now_ms, uint32_t* const device, uint32_t* const next_ms)
+{
+    std::lock_guard<std::mutex> lock(w->mutex);
+    if (w->queue.empty())
+    {
+        *next_ms = now_ms + IDLE_CHECK_MS;
+        return false;
+    }
+
+    if (daikin_time_is_due(now_ms, w->queue.front().due_ms) == false)
+    {
+        *next_ms = w->queue.front().due_ms;
+        return false;
+    }
+
+    std::pop_heap(w->queue.begin(), w->queue.end(), later);
+    *device = w->queue.back().device;
+    w->queue.pop_back();
+    w->size.store((uint32_t)w->queue.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// Takes up to half of the late devices of the most loaded worker.
+// Devices just due stay, their owner gets to them anyway and moving costs its caches.
+static bool steal(fleet_worker_t* const thief, uint32_t now_ms)
+{
+    fleet_impl_t* const fleet = thief->fleet;
+
+    fleet_worker_t* victim = NULL;
+    uint32_t victim_size = 1; // A single device isn't worth moving
+    for (size_t i = 0; i < fleet->workers.size(); i++)
+    {
+        fleet_worker_t* const w = fleet->workers[i];
+        const uint32_t size = w->size.load(std::memory_order_relaxed);
+        if (w != thief && size > victim_size)
+        {
+            victim = w;
+            victim_size = size;
+        }
+    }
+
+    // Busy victim isn't waited for, its owner holds the lock only briefly anyway
+    if (victim == NULL || victim->mutex.try_lock() == false)
+        return false;
+
+    std::vector<fleet_due_t> taken;
+    const size_t max_taken = victim->queue.size() / 2;
+    while (taken.size() < max_taken && daikin_time_is_due(now_ms - STEAL_LAG_MS, victim->queue.front().due_ms))
+    {
+        std::pop_heap(victim->queue.begin(), victim->queue.end(), later);
+        taken.push_back(victim->queue.back());
+        victim->queue.pop_back();
+    }
+
+    victim->size.store((uint32_t)victim->queue.size(), std::memory_order_relaxed);
+    victim->devices.fetch_sub((uint32_t)taken.size(), std::memory_order_relaxed);
+    victim->mutex.unlock();
+
+    if (taken.empty())
+        return false;
+
+    LIBDAIKIN_TRACE("Worker %u took %u devices of worker %u.\n", thief->id, (uint32_t)taken.size(), victim->id);
+    thief->devices.fetch_add((uint32_t)taken.size(), std::memory_order_relaxed);
+    thief->steals.fetch_add(taken.size(), std::memory_order_relaxed);
+    enqueue(thief, &taken[0], taken.size());
+    return true;
+}
+
+static bool acquire(std::atomic<uint16_t>* const running, uint16_t max)
+{
+    if (running->fetch_add(1, std::memory_order_acquire) < max)
+        return true;
+
+    running->fetch_sub(1, std::memory_order_release);
+    return false;
+}
+
+// Caller took a handshake slot when the session is closed.
+// probe => one field only, enough to tell whether the adapter is back.
+static bool poll_device(fleet_worker_t* const w, fleet_device_t* const d, bool probe)
+{
+    fleet_impl_t* const fleet = w->fleet;
+    const daikin_fleet_config_t* const config = &fleet->config;
+
+    if (d->daikin.is_open == false)
+    {
+        w->opens.fetch_add(1, std::memory_order_relaxed);
+        const bool opened = daikin_open(&d->daikin);
+        fleet->handshakes.fetch_sub(1, std::memory_order_release);
+        if (opened == false)
+            return false; // No extra error info needed
+    }
+
+    if (config->fields == 0 && probe == false)
+        return daikin_get_device_info(&d->daikin, &d->info);
+
+    const uint32_t fields = config->fields != 0 ? config->fields : (1u << DF_INDOOR_TEMP);
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        if ((fields & (1u << f)) == 0)
+            continue;
+
+        if (daikin_get_field(&d->daikin, (daikin_field_t)f, &d->info) == false)
+            return false; // No extra error info needed
+        if (probe)
+            break;
+    }
+
+    return true;
+}
+
+static void worker_run(fleet_worker_t* const w)
+{
+    fleet_impl_t* const fleet = w->fleet;
+    const daikin_fleet_config_t* const config = &fleet->config;
+
+    while (fleet->stop.load(std::memory_order_relaxed) == false)
+    {
+        uint32_t now_ms = daikin_hal_time_ms();
+        uint32_t device = 0;
+        uint32_t next_ms = 0;
+
+        if (dequeue(w, now_ms, &device, &next_ms) == false)
+        {
+            if (steal(w, now_ms))
+                continue;
+
+            // Own work is not due yet, look for others' work meanwhile
+            uint32_t wait_ms = next_ms - now_ms;
+            wait_ms = (int32_t)wait_ms < 0 ? 0 : wait_ms;
+            wait_ms = wait_ms > IDLE_CHECK_MS ? IDLE_CHECK_MS : wait_ms;
+
+            std::unique_lock<std::mutex> lock(w->wait_mutex);
+            w->wake.wait_for(lock, std::chrono::milliseconds(wait_ms),
+                [fleet]() { return fleet->stop.load(std::memory_order_relaxed); });
+            continue;
+        }
+
+        fleet_device_t* const d = &fleet->devices[device];
+        const uint32_t open_wait_ms = daikin_health_next_delay(&d->health, now_ms);
+        if (open_wait_ms > 0)
+        {
+            const fleet_due_t later_due = { now_ms + open_wait_ms, device };
+            enqueue(w, &later_due, 1);
+            continue;
+        }
+
+        // Circuit not closed => the poll is a probe, likely to block until the timeout
+        const bool probe = d->health.state != daikin_health_state_t::HS_CLOSED;
+        if (probe && acquire(&fleet->probes, fleet->max_probes) == false)
+        {
+            const fleet_due_t later_due = { now_ms + PROBE_WAIT_MS, device };
+            enqueue(w, &later_due, 1);
+            continue;
+        }
+
+        if (d->daikin.is_open == false && acquire(&fleet->handshakes, config->max_handshakes) == false)
+        {
+            if (probe)
+                fleet->probes.fetch_sub(1, std::memory_order_release);
+
+            w->deferred.fetch_add(1, std::memory_order_relaxed);
+            const fleet_due_t later_due = { now_ms + HANDSHAKE_WAIT_MS, device };
+            enqueue(w, &later_due, 1);
+            continue;
+        }
+
+        bool allowed_probe = false;
+        daikin_health_allow(&d->health, now_ms, &allowed_probe); // Not open, one poll at a time => allowed
+        LIBDAIKIN_ASSERT(allowed_probe == probe);
+
+        const uint32_t start_ms = daikin_hal_time_ms();
+        const bool ok = poll_device(w, d, probe);
+        now_ms = daikin_hal_time_ms();
+        daikin_health_record(&d->health, ok, now_ms - start_ms, now_ms);
+
+        if (probe)
+            fleet->probes.fetch_sub(1, std::memory_order_release);
+
+        uint32_t delay_ms = config->interval_ms;
+        if (ok == false)
+        {
+            daikin_close(&d->daikin); // Reopened by the next poll
+            w->failures.fetch_add(1, std::memory_order_relaxed);
+
+            // Devices which failed together come back spread over the window
+            delay_ms = daikin_reconnect_backoff(&w->random, d->failures, config->retry_ms, config->max_retry_ms);
+            d->failures = d->failures < UINT8_MAX ? d->failures + 1 : d->failures;
+
+            // Devices which tripped together are probed spread over a quarter of the open period
+            const uint32_t open_ms = daikin_health_next_delay(&d->health, now_ms);
+            delay_ms = open_ms > 0 ? open_ms + daikin_reconnect_backoff(&w->random, 0, open_ms / 4, open_ms / 4) : delay_ms;
+        }
+        else
+            d->failures = 0;
+
+        const bool is_closed = d->health.state == daikin_health_state_t::HS_CLOSED;
+        if (probe == is_closed)
+        {
+            if (is_closed)
+                fleet->open_circuits.fetch_sub(1, std::memory_order_relaxed);
+            else
+                fleet->open_circuits.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        w->polls.fetch_add(1, std::memory_order_relaxed);
+
+        if (config->cb != NULL)
+            config->cb(config->ctx, w->id, device, ok, &d->info, &d->health);
+
+        now_ms = daikin_hal_time_ms();
+        const fleet_due_t next = { now_ms + delay_ms, device };
+        enqueue(w, &next, 1);
+    }
+}
+
+static fleet_impl_t* impl_of(const daikin_fleet_t* const fleet)
+{
+    return (fleet_impl_t*)fleet->impl;
+}
+
+static void pin_to_core(fleet_worker_t* const w, uint16_t cores)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->id % cores, &set);
+    if (pthread_setaffinity_np(w->thread.native_handle(), sizeof(set), &set) != 0)
+        LIBDAIKIN_ERROR("Unable to pin worker %u to a core.\n", w->id);
+}
+
+bool daikin_fleet_start(
+    daikin_fleet_t* const fleet,
+    const daikin_fleet_config_t* const config,
+    const daikin_t* const devices,
+    uint32_t device_count)
+{
+    LIBDAIKIN_ASSERT(fleet != NULL);
+    LIBDAIKIN_ASSERT(config != NULL);
+    LIBDAIKIN_ASSERT(devices != NULL && device_count > 0);
+
+    if (fleet == NULL || config == NULL || devices == NULL || device_count == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument fleet, config or devices.\n");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        if (devices[i].is_open)
+        {
+            LIBDAIKIN_ERROR("Invalid input argument devices, device %u is open.\n", i);
+            return false;
+        }
+    }
+
+    const uint16_t cores = (uint16_t)std::max(1u, std::thread::hardware_concurrency());
+    uint16_t workers = config->workers > 0 ? config->workers : cores;
+    workers = workers > DAIKIN_FLEET_MAX_WORKERS ? DAIKIN_FLEET_MAX_WORKERS : workers;
+
+    fleet_impl_t* const impl = new fleet_impl_t();
+    impl->config = *config;
+    impl->config.retry_ms = config->retry_ms > 0 ? config->retry_ms : DAIKIN_FLEET_RETRY_INTERVAL;
+    impl->config.max_retry_ms = config->max_retry_ms > 0 ? config->max_retry_ms : DAIKIN_RECONNECT_MAX_DELAY;
+    impl->config.max_handshakes = config->max_handshakes > 0 ? config->max_handshakes : DAIKIN_RECONNECT_IN_PROGRESS;
+    impl->stop.store(false);
+    impl->handshakes.store(0);
+    impl->open_circuits.store(0);
+    impl->probes.store(0);
+    impl->max_probes = workers / WORKERS_PER_PROBE > 0 ? workers / WORKERS_PER_PROBE : 1;
+
+    // Fresh copies, nothing of the caller's sessions is shared
+    impl->devices.resize(device_count);
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        fleet_device_t* const d = &impl->devices[i];
+        d->daikin = devices[i];
+        d->daikin.tcp.handle = NULL;
+        d->daikin.ws_deflate_state = NULL;
+        memset(&d->info, 0, sizeof(daikin_device_info_t));
+        d->failures = 0;
+        daikin_health_init(&d->health, config->health);
+
+        // A hung adapter must not hold its worker longer than the health model's timeout
+        if (DAIKIN_HAL_TIMEOUT_MS(&d->daikin.tcp) == 0)
+            d->daikin.tcp.timeout_ms = d->health.config.timeout_ms;
+    }
+
+    const uint32_t now_ms = daikin_hal_time_ms();
+    for (uint16_t i = 0; i < workers; i++)
+    {
+        fleet_worker_t* const w = new fleet_worker_t();
+        w->fleet = impl;
+        w->id = i;
+        w->size.store(0);
+        w->polls.store(0);
+        w->failures.store(0);
+        w->opens.store(0);
+        w->steals.store(0);
+        w->deferred.store(0);
+        w->random = (now_ms ^ (0x9E3779B9u * (i + 1))) | 1;
+        w->devices.store(0);
+
+        // Round robin shards, every device is due at once
+        std::vector<fleet_due_t> shard;
+        for (uint32_t d = i; d < device_count; d += workers)
+            shard.push_back({ now_ms, d });
+
+        w->devices.store((uint32_t)shard.size());
+        if (shard.empty() == false)
+            enqueue(w, &shard[0], shard.size());
+
+        impl->workers.push_back(w);
+    }
+
+    for (uint16_t i = 0; i < workers; i++)
+    {
+        fleet_worker_t* const w = impl->workers[i];
+        w->thread = std::thread(worker_run, w);
+        if (config->pin)
+            pin_to_core(w, cores);
+    }
+
+    fleet->impl = impl;
+    return true;
+}
+
+uint16_t daikin_fleet_workers(const daikin_fleet_t* const fleet)
+{
+    LIBDAIKIN_ASSERT(fleet != NULL);
+
+    return fleet != NULL && fleet->impl != NULL ? (uint16_t)impl_of(fleet)->workers.size() : 0;
+}
+
+void daikin_fleet_stats(const daikin_fleet_t* const fleet, uint16_t worker, daikin_fleet_stats_t* const stats)
+{
+    LIBDAIKIN_ASSERT(fleet != NULL);
+    LIBDAIKIN_ASSERT(stats != NULL);
+
+    if (stats == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument stats.\n");
+        return;
+    }
+
+    memset(stats, 0, sizeof(daikin_fleet_stats_t));
+    if (fleet == NULL || fleet->impl == NULL)
+        return;
+
+    const fleet_impl_t* const impl = impl_of(fleet);
+    for (size_t i = 0; i < impl->workers.size(); i++)
+    {
+        if (worker < impl->workers.size() && i != worker)
+            continue;
+
+        const fleet_worker_t* const w = impl->workers[i];
+        stats->polls += w->polls.load(std::memory_order_relaxed);
+        stats->failures += w->failures.load(std::memory_order_relaxed);
+        stats->opens += w->opens.load(std::memory_order_relaxed);
+        stats->steals += w->steals.load(std::memory_order_relaxed);
+        stats->deferred += w->deferred.load(std::memory_order_relaxed);
+        stats->devices += w->devices.load(std::memory_order_relaxed);
+    }
+
+    stats->open_circuits = impl->open_circuits.load(std::memory_order_relaxed);
+}
+
+void daikin_fleet_stop(daikin_fleet_t* const fleet)
+{
+    LIBDAIKIN_ASSERT(fleet != NULL);
+
+    if (fleet == NULL || fleet->impl == NULL)
+        return;
+
+    fleet_impl_t* const impl = impl_of(fleet);
+    impl->stop.store(true);
+    for (size_t i = 0; i < impl->workers.size(); i++)
+    {
+        fleet_worker_t* const w = impl->workers[i];
+        {
+            std::lock_guard<std::mutex> lock(w->wait_mutex);
+            w->wake.notify_all();
+        }
+
+        w->thread.join();
+    }
+
+    for (size_t i = 0; i < impl->devices.size(); i++)
+    {
+        if (impl->devices[i].daikin.is_open)
+            daikin_close(&impl->devices[i].daikin);
+    }
+
+    for (size_t i = 0; i < impl->workers.size(); i++)
+        delete impl->workers[i];
+
+    delete impl;
+    fleet->impl = NULL;
+}
+
+#else
+
+bool daikin_fleet_start(
+    daikin_fleet_t* const fleet,
+    const daikin_fleet_config_t* const config,
+    const daikin_t* const devices,
+    uint32_t device_count)
+{
+    (void)fleet;
+    (void)config;
+    (void)devices;
+    (void)device_count;
+    LIBDAIKIN_ERROR("Fleet runtime is not built in (DAIKIN_FLEET).\n");
+    return false;
+}
+
+uint16_t daikin_fleet_workers(const daikin_fleet_t* const fleet)
+{
+    (void)fleet;
+    return 0;
+}
+
+void daikin_fleet_stats(const daikin_fleet_t* const fleet, uint16_t worker, daikin_fleet_stats_t* const stats)
+{
+    (void)fleet;
+    (void)worker;
+    if (stats != NULL)
+        memset(stats, 0, sizeof(daikin_fleet_stats_t));
+}
+
+void daikin_fleet_stop(daikin_fleet_t* const fleet)
+{
+    (void)fleet;
+}
+
+#endif
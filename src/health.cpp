@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "../include/libdaikinhealth.h"
+
+#include "time_util.h"
+#include "trace.h"
+
+static void trip(daikin_health_t* const health, uint32_t now_ms)
+{
+    health->state = daikin_health_state_t::HS_OPEN;
+    health->open_until_ms = now_ms + health->open_interval_ms;
+    health->trips++;
+    LIBDAIKIN_INFO("Circuit opened for %u ms.\n", health->open_interval_ms);
+}
+
+void daikin_health_init(daikin_health_t* const health, const daikin_health_config_t* const config)
+{
+    LIBDAIKIN_ASSERT(health != NULL);
+
+    if (health == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument health.\n");
+        return;
+    }
+
+    memset(health, 0, sizeof(daikin_health_t));
+    if (config != NULL)
+        health->config = *config;
+
+    daikin_health_config_t* const c = &health->config;
+    c->failure_threshold = c->failure_threshold > 0 ? c->failure_threshold : DAIKIN_HEALTH_FAILURE_THRESHOLD;
+    c->open_ms = c->open_ms > 0 ? c->open_ms : DAIKIN_HEALTH_OPEN_INTERVAL;
+    c->max_open_ms = c->max_open_ms > 0 ? c->max_open_ms : DAIKIN_HEALTH_MAX_OPEN_INTERVAL;
+    c->max_open_ms = c->max_open_ms < c->open_ms ? c->open_ms : c->max_open_ms;
+    c->timeout_ms = c->timeout_ms > 0 ? c->timeout_ms : DAIKIN_HEALTH_TIMEOUT;
+    c->slow_ms = c->slow_ms > 0 ? c->slow_ms : DAIKIN_HEALTH_SLOW;
+    c->alpha = c->alpha > 0.0f && c->alpha <= 1.0f ? c->alpha : DAIKIN_HEALTH_ALPHA;
+
+    health->state = daikin_health_state_t::HS_CLOSED;
+    health->success_rate = 1.0f; // Innocent until proven otherwise
+    health->open_interval_ms = c->open_ms;
+}
+
+bool daikin_health_allow(daikin_health_t* const health, uint32_t now_ms, bool* const probe)
+{
+    LIBDAIKIN_ASSERT(health != NULL);
+    LIBDAIKIN_ASSERT(probe != NULL);
+
+    if (health == NULL || probe == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument health or probe.\n");
+        return false;
+    }
+
+    *probe = false;
+
+    if (health->state == daikin_health_state_t::HS_OPEN)
+    {
+        if (daikin_time_is_due(now_ms, health->open_until_ms) == false)
+            return false;
+
+        health->state = daikin_health_state_t::HS_HALF_OPEN;
+        health->probing = false;
+    }
+
+    if (health->state == daikin_health_state_t::HS_HALF_OPEN)
+    {
+        if (health->probing)
+            return false; // One probe at a time
+
+        health->probing = true;
+        *probe = true;
+    }
+
+    return true;
+}
+
+void daikin_health_record(daikin_health_t* const health, bool ok, uint32_t latency_ms, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(health != NULL);
+
+    if (health == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument health.\n");
+        return;
+    }
+
+    const float alpha = health->config.alpha;
+    health->success_rate += alpha * ((ok ? 1.0f : 0.0f) - health->success_rate);
+
+    if (ok)
+    {
+        // Failures say nothing about the latency of a working adapter
+        health->latency_ms = health->successes == 0 ? (float)latency_ms :
+            health->latency_ms + alpha * ((float)latency_ms - health->latency_ms);
+        health->successes++;
+        health->failures_in_row = 0;
+
+        if (health->state != daikin_health_state_t::HS_CLOSED)
+            LIBDAIKIN_INFO("Circuit closed, probe succeeded.\n");
+
+        health->state = daikin_health_state_t::HS_CLOSED;
+        health->probing = false;
+        health->open_interval_ms = health->config.open_ms;
+        return;
+    }
+
+    health->failures++;
+    if (latency_ms >= health->config.timeout_ms)
+        health->timeouts++;
+    if (health->failures_in_row < UINT8_MAX)
+        health->failures_in_row++;
+
+    if (health->state == daikin_health_state_t::HS_HALF_OPEN)
+    {
+        // Still sick, wait longer next time
+        health->probing = false;
+        health->open_interval_ms = health->open_interval_ms > health->config.max_open_ms / 2 ?
+            health->config.max_open_ms : health->open_interval_ms * 2;
+        trip(health, now_ms);
+    }
+    else if (health->state == daikin_health_state_t::HS_CLOSED && health->failures_in_row >= health->config.failure_threshold)
+        trip(health, now_ms);
+}
+
+uint32_t daikin_health_next_delay(const daikin_health_t* const health, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(health != NULL);
+
+    if (health == NULL || health->state != daikin_health_state_t::HS_OPEN)
+        return 0;
+
+    return daikin_time_is_due(now_ms, health->open_until_ms) ? 0 : health->open_until_ms - now_ms;
+}
+
+uint8_t daikin_health_score(const daikin_health_t* const health)
+{
+    LIBDAIKIN_ASSERT(health != NULL);
+
+    if (health == NULL || health->state == daikin_health_state_t::HS_OPEN)
+        return 0;
+
+    float score = 100.0f * health->success_rate;
+    if (health->latency_ms > (float)health->config.slow_ms)
+        score *= (float)health->config.slow_ms / health->latency_ms;
+
+    return (uint8_t)(score + 0.5f);
+}
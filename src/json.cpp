@@ -0,0 +1,383 @@
+#include <string.h>
+
+#include "../include/libdaikinjson.h"
+
+#include "trace.h"
+
+typedef enum
+{
+    JS_VALUE,           // Value expected
+    JS_VALUE_OR_END,    // After '['
+    JS_KEY_OR_END,      // After '{'
+    JS_KEY,             // After ',' in an object
+    JS_COLON,
+    JS_AFTER_VALUE,     // ',' or the end of the container expected
+    JS_STRING,
+    JS_KEY_STRING,
+    JS_NUMBER,
+    JS_LITERAL,
+    JS_DONE,
+} json_state_t;
+
+static bool is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static void token_append(daikin_json_t* const json, char c)
+{
+    if (json->token_len < DAIKIN_JSON_TOKEN_LEN)
+        json->token[json->token_len++] = c;
+    else
+        json->truncated = true;
+}
+
+static bool fail(daikin_json_t* const json, const char* const what)
+{
+    LIBDAIKIN_ERROR("JSON %s at offset %u.\n", what, json->offset);
+    json->error = true;
+    return false;
+}
+
+static bool emit(daikin_json_t* const json, daikin_json_event_t event, bool with_token)
+{
+    bool ok;
+    if (with_token)
+    {
+        json->token[json->token_len] = 0;
+        ok = json->cb(json, event, json->token, json->token_len);
+    }
+    else
+        ok = json->cb(json, event, NULL, 0);
+
+    json->token_len = 0;
+    json->truncated = false;
+
+    if (ok == false)
+    {
+        json->error = true;
+        return false; // Stopped by the consumer, no error message needed
+    }
+
+    return true;
+}
+
+static void value_end(daikin_json_t* const json)
+{
+    if (json->depth == 0)
+    {
+        json->done = true;
+        json->state = JS_DONE;
+    }
+    else
+        json->state = JS_AFTER_VALUE;
+}
+
+static bool is_in_object(const daikin_json_t* const json)
+{
+    return json->depth > 0 && (json->containers & (1u << (json->depth - 1))) != 0;
+}
+
+static bool open_container(daikin_json_t* const json, bool object)
+{
+    if (json->depth >= DAIKIN_JSON_MAX_DEPTH)
+        return fail(json, "nesting too deep");
+
+    if (object)
+        json->containers |= (1u << json->depth);
+    else
+        json->containers &= ~(1u << json->depth);
+    json->depth++;
+
+    json->state = object ? JS_KEY_OR_END : JS_VALUE_OR_END;
+    return emit(json, object ? JE_OBJECT_START : JE_ARRAY_START, false);
+}
+
+static bool close_container(daikin_json_t* const json, bool object)
+{
+    if (json->depth == 0 || is_in_object(json) != object)
+        return fail(json, "unexpected end of container");
+
+    json->depth--;
+    if (emit(json, object ? JE_OBJECT_END : JE_ARRAY_END, false) == false)
+        return false; // No extra error info needed
+
+    value_end(json);
+    return true;
+}
+
+static bool start_value(daikin_json_t* const json, char c)
+{
+    switch (c)
+    {
+    case '{':
+        return open_container(json, true);
+    case '[':
+        return open_container(json, false);
+    case '"':
+        json->state = JS_STRING;
+        return true;
+    case 't':
+    case 'f':
+    case 'n':
+        token_append(json, c);
+        json->state = JS_LITERAL;
+        return true;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            token_append(json, c);
+            json->state = JS_NUMBER;
+            return true;
+        }
+        return fail(json, "unexpected character");
+    }
+}
+
+static void append_code_point(daikin_json_t* const json, uint16_t cp)
+{
+    // UTF-8, surrogate pairs are not combined
+    if (cp < 0x80)
+        token_append(json, (char)cp);
+    else if (cp < 0x800)
+    {
+        token_append(json, (char)(0xC0 | (cp >> 6)));
+        token_append(json, (char)(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        token_append(json, (char)(0xE0 | (cp >> 12)));
+        token_append(json, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        token_append(json, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static bool string_char(daikin_json_t* const json, char c)
+{
+    if (json->escape == 1)
+    {
+        json->escape = 0;
+        switch (c)
+        {
+        case '"':  token_append(json, '"'); return true;
+        case '\\': token_append(json, '\\'); return true;
+        case '/':  token_append(json, '/'); return true;
+        case 'b':  token_append(json, '\b'); return true;
+        case 'f':  token_append(json, '\f'); return true;
+        case 'n':  token_append(json, '\n'); return true;
+        case 'r':  token_append(json, '\r'); return true;
+        case 't':  token_append(json, '\t'); return true;
+        case 'u':
+            json->escape = 2;
+            json->code_point = 0;
+            return true;
+        default:
+            return fail(json, "invalid escape");
+        }
+    }
+
+    if (json->escape >= 2)
+    {
+        uint8_t digit;
+        if (c >= '0' && c <= '9')
+            digit = (uint8_t)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            digit = (uint8_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            digit = (uint8_t)(c - 'A' + 10);
+        else
+            return fail(json, "invalid unicode escape");
+
+        json->code_point = (uint16_t)((json->code_point << 4) | digit);
+        if (++json->escape == 6)
+        {
+            json->escape = 0;
+            append_code_point(json, json->code_point);
+        }
+        return true;
+    }
+
+    if (c == '\\')
+    {
+        json->escape = 1;
+        return true;
+    }
+
+    if (c == '"')
+    {
+        if (json->state == JS_KEY_STRING)
+        {
+            json->state = JS_COLON;
+            return emit(json, JE_KEY, true);
+        }
+
+        if (emit(json, JE_STRING, true) == false)
+            return false; // No extra error info needed
+        value_end(json);
+        return true;
+    }
+
+    if ((uint8_t)c < 0x20)
+        return fail(json, "control character in string");
+
+    token_append(json, c);
+    return true;
+}
+
+static bool literal_char(daikin_json_t* const json, char c)
+{
+    static const char* const LITERALS[] = { "true", "false", "null" };
+    static const daikin_json_event_t EVENTS[] = { JE_TRUE, JE_FALSE, JE_NULL };
+
+    token_append(json, c);
+
+    for (uint8_t i = 0; i < sizeof(LITERALS) / sizeof(LITERALS[0]); i++)
+    {
+        const size_t len = strlen(LITERALS[i]);
+        if (json->token_len > len || strncmp(json->token, LITERALS[i], json->token_len) != 0)
+            continue;
+
+        if (json->token_len == len)
+        {
+            if (emit(json, EVENTS[i], true) == false)
+                return false; // No extra error info needed
+            value_end(json);
+        }
+        return true;
+    }
+
+    return fail(json, "invalid literal");
+}
+
+static bool end_number(daikin_json_t* const json)
+{
+    if (emit(json, JE_NUMBER, true) == false)
+        return false; // No extra error info needed
+
+    value_end(json);
+    return true;
+}
+
+static bool process_char(daikin_json_t* const json, char c)
+{
+    switch ((json_state_t)json->state)
+    {
+    case JS_STRING:
+    case JS_KEY_STRING:
+        return string_char(json, c);
+
+    case JS_LITERAL:
+        return literal_char(json, c);
+
+    case JS_NUMBER:
+        if (is_number_char(c))
+        {
+            token_append(json, c);
+            return true;
+        }
+
+        // Number ends at the first other character, which is processed again
+        return end_number(json) && process_char(json, c);
+
+    default:
+        break;
+    }
+
+    if (is_whitespace(c))
+        return true;
+
+    switch ((json_state_t)json->state)
+    {
+    case JS_VALUE_OR_END:
+        if (c == ']')
+            return close_container(json, false);
+        return start_value(json, c);
+
+    case JS_VALUE:
+        return start_value(json, c);
+
+    case JS_KEY_OR_END:
+        if (c == '}')
+            return close_container(json, true);
+        // fall through
+    case JS_KEY:
+        if (c != '"')
+            return fail(json, "key expected");
+        json->state = JS_KEY_STRING;
+        return true;
+
+    case JS_COLON:
+        if (c != ':')
+            return fail(json, "':' expected");
+        json->state = JS_VALUE;
+        return true;
+
+    case JS_AFTER_VALUE:
+        if (c == ',')
+        {
+            json->state = is_in_object(json) ? JS_KEY : JS_VALUE;
+            return true;
+        }
+        if (c == '}' || c == ']')
+            return close_container(json, c == '}');
+        return fail(json, "',' expected");
+
+    default:
+        return fail(json, "trailing data");
+    }
+}
+
+void daikin_json_init(daikin_json_t* const json, daikin_json_cb cb, void* ctx)
+{
+    LIBDAIKIN_ASSERT(json != NULL);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    memset(json, 0, sizeof(daikin_json_t));
+    json->cb = cb;
+    json->ctx = ctx;
+    json->state = JS_VALUE;
+}
+
+bool daikin_json_feed(daikin_json_t* const json, const char* const data, uint32_t len)
+{
+    LIBDAIKIN_ASSERT(json != NULL && json->cb != NULL);
+    LIBDAIKIN_ASSERT(data != NULL || len == 0);
+
+    if (json == NULL || json->cb == NULL || (data == NULL && len > 0))
+    {
+        LIBDAIKIN_ERROR("Invalid input argument json or data.\n");
+        return false;
+    }
+
+    if (json->error)
+        return false; // Reported already
+
+    for (uint32_t i = 0; i < len; i++, json->offset++)
+    {
+        if (process_char(json, data[i]) == false)
+            return false; // No extra error info needed
+    }
+
+    return true;
+}
+
+bool daikin_json_finish(daikin_json_t* const json)
+{
+    LIBDAIKIN_ASSERT(json != NULL);
+
+    if (json == NULL || json->error)
+        return false;
+
+    if (json->state == JS_NUMBER && end_number(json) == false)
+        return false; // No extra error info needed
+
+    if (json->done == false)
+        return fail(json, "document incomplete");
+
+    return true;
+}
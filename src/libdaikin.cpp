@@ -1,236 +1,197 @@
 #include <time.h>
 #include <string.h>
-#include <errno.h>
 #include <string>
 
 #include "../include/libdaikin.h"
+#include "../include/libdaikinm2m.h"
 
 #include "websockets.h"
+#include "websockets_frame.h"
+#include "registry.h"
+#include "fields.h"
 #include "trace.h"
 
 static const char agent[] =
 "libdaikin";
 
-static const uint8_t OP_W = 1;
-static const uint8_t OP_R = 2;
+static const uint8_t OP_W = 1; // Create
+static const uint8_t OP_R = 2; // Retrieve
+static const uint8_t OP_D = 4; // Delete
+static const uint8_t TY_CIN = 4; // Content instance
+static const uint8_t TY_SUB = 23; // Subscription
 static const uint8_t INDEX = 0;
 static const int32_t RSC_OK = 2000;
 static const int32_t RSC_OK_ACT = 2001;
+static const int32_t RSC_DELETED = 2002;
+static const int32_t RSC_NOT_FOUND = 4004;
+static const int32_t RSC_CONFLICT = 4105;
 
-static bool str_to_int32(const char** s, int32_t* const v)
+static bool is_rsc_ok(int32_t rsc)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(*s) > 0));
-    LIBDAIKIN_ASSERT(v != NULL);
-
-    errno = 0;
-    char* end;
-    long l = strtol(*s, &end, 10);
+    return (rsc == RSC_OK || rsc == RSC_OK_ACT);
+}
 
-    if (errno != 0)
-    {
-        LIBDAIKIN_TRACE("str_to_int32 failed. errno: %ld.\n", errno);
-        return false;
-    }
+static bool is_entry_supported(const daikin_t* const daikin, registry_index_t index)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(index < RE_COUNT);
 
-    if (*s == end)
-    {
-        LIBDAIKIN_TRACE("str_to_int32 failed. No number characters?\n");
-        return false;
-    }
+    if ((daikin->capabilities & DAIKIN_CAPS_DISCOVERED) == 0)
+        return true; // Not discovered, everything is tried
 
-    *v = (int32_t)l;
-    *s = end;
-    return true;
+    return ((daikin->capabilities | REGISTRY_MODE_DEPENDENT) & (1u << index)) != 0;
 }
 
-static bool str_to_double(const char** s, double* const v)
+static bool get_con_number(const daikin_m2m_t* const msg, double* const v)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(*s) > 0));
+    LIBDAIKIN_ASSERT(msg != NULL);
     LIBDAIKIN_ASSERT(v != NULL);
 
-    errno = 0;
-    char* end;
-    double d = strtod(*s, &end);
-
-    if (errno != 0)
-    {
-        LIBDAIKIN_TRACE("str_to_double failed. errno: %ld.\n", errno);
-        return false;
-    }
-
-    if (*s == end)
+    if (msg->has_cin == false || msg->con_type != daikin_m2m_con_type_t::CT_NUMBER)
     {
-        LIBDAIKIN_TRACE("str_to_double failed. No number characters?\n");
+        LIBDAIKIN_ERROR("Number not found in the con: '%s'.\n", msg->con);
         return false;
     }
 
-    *v = d;
-    *s = end;
+    *v = msg->con_number;
     return true;
 }
 
-static bool str_find_skip_token(const char** s, const char* const token, bool strict)
+static bool get_con_int32(const daikin_m2m_t* const msg, int32_t* const v)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(*s) > 0));
-    LIBDAIKIN_ASSERT((token != NULL) && (strlen(token) > 0));
-
-    const char* p = *s;
-    const char* e = strstr(p, token);
+    LIBDAIKIN_ASSERT(v != NULL);
 
-    if (e == NULL)
-    {
-        LIBDAIKIN_ERROR("Token '%s' not found.\n", token);
-        return false;
-    }
+    double temp;
+    if (get_con_number(msg, &temp) == false)
+        return false; // No extra error info needed
 
-    // strict means find exactly at the start
-    if (strict && (p != e))
+    // Don't truncate fractions or wrap large values silently
+    if ((temp >= INT32_MIN && temp <= INT32_MAX) == false || temp != (double)(int32_t)temp)
     {
-        LIBDAIKIN_ERROR("Token '%s' is not matching the begining of the string '%s'.\n", token, *s);
+        LIBDAIKIN_ERROR("Integer not found in the con: '%s'.\n", msg->con);
         return false;
     }
 
-    *s = e + strlen(token);
+    *v = (int32_t)temp;
     return true;
 }
 
-static std::string string_between_tokens(
-    const char* s,
-    const char* const start_token,
-    const char* const end_token)
-{
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(s) > 0));
-    LIBDAIKIN_ASSERT((start_token != NULL) && (strlen(start_token) > 0));
-    LIBDAIKIN_ASSERT((end_token != NULL) && (strlen(end_token) > 0));
-
-    // Find token somewhere in the string (strict == false)
-    if (str_find_skip_token(&s, start_token, false) == false)
-        return ""; // No extra error info needed
-
-    const char* const start = s;
-
-    // Find token somewhere in the string (strict == false)
-    if (str_find_skip_token(&s, end_token, false) == false)
-        return ""; // No extra error info needed
-
-    const char* const end = s;
-
-    return std::string(start, end - start - 1);
-}
-
-static bool is_rsc_ok(int32_t rsc)
-{
-    return (rsc == RSC_OK || rsc == RSC_OK_ACT);
-}
-
-static bool get_con_int32(const char* s, int32_t* const v)
+static bool get_con_float(const daikin_m2m_t* const msg, float* const v)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(s) > 0));
     LIBDAIKIN_ASSERT(v != NULL);
 
-    // Search for "con":
-    const char token01[] = "\"con\":";
-    // Search for }
-    const char token02[] = "}";
-
-    std::string str = string_between_tokens(s, token01, token02);
-    if (str.length() == 0)
+    double temp;
+    if (get_con_number(msg, &temp) == false)
         return false; // No extra error info needed
 
-    int32_t temp;
-    const char* p = str.c_str();
-
-    if (str_to_int32(&p, &temp) == false)
-    {
-        LIBDAIKIN_ERROR("Number not found in the string: '%s'.\n", str.c_str());
-        return false;
-    }
-
-    *v = temp;
+    *v = (float)temp;
     return true;
 }
 
-static bool get_con_float(const char* s, float* const v)
+static bool get_con_power_state(const daikin_m2m_t* const msg, daikin_power_state_t* const v)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(s) > 0));
+    LIBDAIKIN_ASSERT(msg != NULL);
     LIBDAIKIN_ASSERT(v != NULL);
 
-    // Search for "con":
-    const char token01[] = "\"con\":";
-    // Search for }
-    const char token02[] = "}";
-
-    std::string str = string_between_tokens(s, token01, token02);
-    if (str.length() == 0)
-        return false; // No extra error info needed
-
-    double temp;
-    const char* p = str.c_str();
-
-    if (str_to_double(&p, &temp) == false)
+    if (msg->has_cin == false || msg->con_type != daikin_m2m_con_type_t::CT_STRING)
     {
-        LIBDAIKIN_ERROR("Number not found in the string: '%s'.\n", str.c_str());
+        LIBDAIKIN_ERROR("String not found in the con: '%s'.\n", msg->con);
         return false;
     }
 
-    *v = (float)temp;
+    if (strcmp(msg->con, "on") == 0)
+        *v = daikin_power_state_t::PS_ON;
+    else if (strcmp(msg->con, "standby") == 0)
+        *v = daikin_power_state_t::PS_STANDBY;
+    else
+    {
+        *v = daikin_power_state_t::PS_UNKNOWN;
+        LIBDAIKIN_TRACE("Unknown power state: '%s'.\n", msg->con);
+    }
+
     return true;
 }
 
-static bool get_con_power_state(const char* s, daikin_power_state_t* const v)
+static bool get_con_raw(const daikin_m2m_t* const msg, std::string& v)
 {
-    LIBDAIKIN_ASSERT((s != NULL) && (strlen(s) > 0));
-    LIBDAIKIN_ASSERT(v != NULL);
-
-    // Search for "con":"
-    const char token01[] = "\"con\":\"";
-    // Search for "
-    const char token02[] = "\"";
+    LIBDAIKIN_ASSERT(msg != NULL);
 
-    std::string str = string_between_tokens(s, token01, token02);
-    if (str.length() == 0)
-        return false; // No extra error info needed
+    if (msg->has_cin == false || msg->con_type == daikin_m2m_con_type_t::CT_NONE)
+    {
+        LIBDAIKIN_ERROR("Empty con value.\n");
+        return false;
+    }
 
-    if (str == "on")
-        *v = daikin_power_state_t::PS_ON;
-    else if (str == "standby")
-        *v = daikin_power_state_t::PS_STANDBY;
-    else
+    if (msg->truncated)
     {
-        *v = daikin_power_state_t::PS_UNKNOWN;
-        LIBDAIKIN_TRACE("Unknown power state: '%s'.\n", str.c_str());
+        LIBDAIKIN_ERROR("Value longer than %u bytes, use daikin_read_stream.\n", DAIKIN_M2M_CON_LEN);
+        return false;
     }
 
+    // Strings without quotes, anything else as JSON text
+    v.assign(msg->con, msg->con_len);
     return true;
 }
 
 static std::string create_request_id()
 {
-    srand((unsigned)clock());
-
     char buf[5];
     const uint8_t len = (uint8_t)sizeof(buf);
+    ws_random_fill(buf, len);
     for (uint8_t i = 0; i < len; i++)
-        buf[i] = (char)((rand() % 9) + 49); // Just numbers 1-9
+        buf[i] = (char)(((uint8_t)buf[i] % 9) + 49); // Just numbers 1-9
 
     return std::string(buf, len);
 }
 
+// Appends text as the content of a JSON string (without the quotes)
+static void append_json_escaped(std::string& out, const char* const text)
+{
+    for (const char* p = text; *p != 0; p++)
+    {
+        const char c = *p;
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)c);
+            out += escaped;
+        }
+        else
+            out += c;
+    }
+}
+
 static std::string create_request_json(
     uint8_t op,
     uint8_t index,
     const char* const field_path,
+    uint8_t field_path_len,
     std::string& req_id,
+    uint8_t ty,
     const char* const con_val)
 {
-    LIBDAIKIN_ASSERT(op == OP_W || op == OP_R);
+    LIBDAIKIN_ASSERT(op == OP_W || op == OP_R || op == OP_D);
     LIBDAIKIN_ASSERT(index == INDEX);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
+    LIBDAIKIN_ASSERT(op != OP_W || ty == TY_CIN || ty == TY_SUB);
     //LIBDAIKIN_ASSERT(con_val != NULL); con_val Can be NULL
 
+    // Upper bounds of the fixed parts of the request below
+    const size_t REQ_FIXED_LEN = 64;
+    const size_t REQ_WRITE_LEN = 64;
+
     req_id = create_request_id();
 
-    std::string req = std::string("{\"m2m:rqp\":{\"fr\":\"");
+    std::string req;
+    req.reserve(REQ_FIXED_LEN + sizeof(agent) + field_path_len +
+        (op == OP_W ? REQ_WRITE_LEN + (con_val != NULL ? strlen(con_val) : 0) : 0));
+
+    req += "{\"m2m:rqp\":{\"fr\":\"";
     req += agent;
     req += "\",\"rqi\":\"";
     req += req_id;
@@ -239,12 +200,21 @@ static std::string create_request_json(
     req += ",\"to\":\"/[";
     req += (char)(48 + index); // number to string
     req += "]/";
-    req += field_path;
+    req.append(field_path, field_path_len);
 
-    if (op == OP_R)
+    if (op == OP_R || op == OP_D)
     {
         req += "\"";
     }
+    else if (op == OP_W && ty == TY_SUB)
+    {
+        // Notify us about new content instances (net 3) of the container
+        req += "\",\"ty\":23,\"pc\":{\"m2m:sub\":{\"rn\":\"";
+        req += agent;
+        req += "\",\"enc\":{\"net\":[3]},\"nu\":[\"";
+        req += agent;
+        req += "\"],\"nct\":1}}";
+    }
     else if (op == OP_W)
     {
         // ,"ty":4,"pc":{"m2m:cin":{"con":
@@ -258,78 +228,170 @@ static std::string create_request_json(
     return req;
 }
 
-static bool parse_query_response(
-    const std::string& response,
+static bool check_query_response(
+    const daikin_m2m_t* const msg,
     const char* const field_path,
-    int32_t* const rsc,
-    int32_t* const rqi,
-    int32_t* const idx,
-    const char** reminder)
-{
-    LIBDAIKIN_ASSERT(response.size() > 0);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
-    LIBDAIKIN_ASSERT(rsc != NULL);
-    LIBDAIKIN_ASSERT(rqi != NULL);
-    LIBDAIKIN_ASSERT(idx != NULL);
-    LIBDAIKIN_ASSERT(reminder != NULL);
-
-    const char* s = response.c_str();
-
-    // Search for {"m2m:rsp":{"rsc":
-    const char token01[] = "{\"m2m:rsp\":{\"rsc\":";
-    if (str_find_skip_token(&s, token01, true) == false)
-        return false; // No extra error info needed
+    uint8_t field_path_len,
+    const std::string& req_id)
+{
+    LIBDAIKIN_ASSERT(msg != NULL);
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
 
-    // Search for DDDD - rsc (2000,4004,????)
-    if (str_to_int32(&s, rsc) == false)
+    if (msg->kind != daikin_m2m_kind_t::MK_RESPONSE)
     {
-        LIBDAIKIN_ERROR("Not valid rsc code.\n");
+        LIBDAIKIN_ERROR("Not a response.\n");
         return false;
     }
 
-    // Search for ,"rqi":"
-    const char token02[] = ",\"rqi\":\"";
-    if (str_find_skip_token(&s, token02, true) == false)
-        return false; // No extra error info needed
+    if (strcmp(msg->to, agent) != 0)
+    {
+        LIBDAIKIN_ERROR("Response is for '%s'.\n", msg->to);
+        return false;
+    }
 
-    // Search for DDDDD - rqi
-    if (str_to_int32(&s, rqi) == false)
+    if (req_id != msg->rqi)
     {
-        LIBDAIKIN_ERROR("Not valid rqi code.\n");
+        LIBDAIKIN_ERROR("rqi code %s doesn't match with the expected code: %s.\n", msg->rqi, req_id.c_str());
         return false;
     }
 
-    // Search for ","to":"
-    const char token03[] = "\",\"to\":\"";
-    if (str_find_skip_token(&s, token03, true) == false)
-        return false; // No extra error info needed
+    // fr is /[INDEX]/<field path>
+    const char prefix[] = { '/', '[', (char)(48 + INDEX), ']', '/' };
+    if (strncmp(msg->fr, prefix, sizeof(prefix)) != 0 ||
+        strncmp(msg->fr + sizeof(prefix), field_path, field_path_len) != 0)
+    {
+        LIBDAIKIN_ERROR("Response is from '%s' instead of '/[%u]/%.*s'.\n",
+            msg->fr, INDEX, field_path_len, field_path);
+        return false;
+    }
 
-    // Search for libdaikin
-    if (str_find_skip_token(&s, agent, true) == false)
-        return false; // No extra error info needed
+    return true;
+}
 
-    // Search for ","fr":"/[
-    const char token04[] = "\",\"fr\":\"/[";
-    if (str_find_skip_token(&s, token04, true) == false)
-        return false; // No extra error info needed
+static void store_field(
+    daikin_device_info_t* const info,
+    daikin_field_t field,
+    double value,
+    bool available)
+{
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    // Only one of the set points is available, depending on the temperature mode
+    const bool is_set_point =
+        field == daikin_field_t::DF_TEMP_TARGET ||
+        field == daikin_field_t::DF_TEMP_OFFSET;
+
+    if (is_set_point)
+    {
+        daikin_field_set_double(info, field, 0);
+        if (available == false)
+            return;
+
+        LIBDAIKIN_TRACE("%s mode\n", field == daikin_field_t::DF_TEMP_TARGET ?
+            "Target Temperature" : "Leaving Water Temperature Offset Heating");
+        info->temp_mode = field == daikin_field_t::DF_TEMP_TARGET ?
+            daikin_temperature_mode_t::TM_TARGET : daikin_temperature_mode_t::TM_OFFSET;
+    }
+
+    if (available)
+        daikin_field_set_double(info, field, value);
+}
+
+static bool is_notification(const std::string& frame)
+{
+    // Requests from the adapter, responses start with {"m2m:rsp"
+    const char token01[] = "{\"m2m:rqp\":";
+    return frame.compare(0, sizeof(token01) - 1, token01) == 0;
+}
+
+static bool handle_notification(
+    const daikin_t* const daikin,
+    const daikin_m2m_t* const msg)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(msg != NULL);
 
-    // Search for D - INDEX
-    if (str_to_int32(&s, idx) == false)
+    if (msg->rqi[0] == 0 || msg->sur[0] == 0)
     {
-        LIBDAIKIN_ERROR("Not valid idx code.\n");
+        LIBDAIKIN_ERROR("Not valid notification from '%s'.\n", msg->fr);
         return false;
     }
 
-    // Search for ]/
-    const char token05[] = "]/";
-    if (str_find_skip_token(&s, token05, true) == false)
-        return false; // No extra error info needed
+    // Acknowledge, otherwise the adapter may remove the subscription
+    std::string rsp = "{\"m2m:rsp\":{\"rsc\":2000,\"rqi\":\"";
+    append_json_escaped(rsp, msg->rqi);
+    rsp += "\",\"to\":\"";
+    append_json_escaped(rsp, msg->fr);
+    rsp += "\",\"fr\":\"";
+    rsp += agent;
+    rsp += "\"}}";
 
-    // Search for FIELD PATH
-    if (str_find_skip_token(&s, field_path, true) == false)
-        return false; // No extra error info needed
+    if (daikin_ws_send(daikin, rsp) == false)
+    {
+        LIBDAIKIN_ERROR("Sending notification response failed.\n");
+        return false;
+    }
+
+    // Subscription resource is /[0]/<container path>/<agent>
+    const std::string sur = msg->sur;
+    const char prefix[] = "/[0]/";
+    const size_t suffix_len = sizeof(agent); // "/" + agent
+    if (sur.compare(0, sizeof(prefix) - 1, prefix) != 0 || sur.length() <= sizeof(prefix) - 1 + suffix_len)
+    {
+        LIBDAIKIN_ERROR("Unknown subscription resource '%s'.\n", sur.c_str());
+        return false;
+    }
+
+    const std::string path = sur.substr(sizeof(prefix) - 1, sur.length() - (sizeof(prefix) - 1) - suffix_len);
+
+    // Content instance is the representation of the event
+    if (msg->has_cin == false)
+        return true; // Other events (e.g. deleted subscription) are not reported
+
+    const registry_entry_t* const entry = registry_find(path.c_str(), path.length());
+    const daikin_field_t field = entry != NULL ?
+        registry_entry_field(registry_index_of(entry)) : daikin_field_t::DF_COUNT;
+
+    if (field < daikin_field_t::DF_COUNT && daikin->notify_info != NULL)
+    {
+        double value;
+        bool ok;
+
+        if (entry->type == registry_type_t::RT_FLOAT || entry->type == registry_type_t::RT_INT)
+            ok = get_con_number(msg, &value);
+        else
+        {
+            daikin_power_state_t temp;
+            ok = get_con_power_state(msg, &temp);
+            value = temp;
+        }
+
+        if (ok == false)
+        {
+            LIBDAIKIN_ERROR("Parsing notification value for '%s' failed.\n", path.c_str());
+            return false;
+        }
+
+        store_field(daikin->notify_info, field, value, true);
+    }
+
+    if (daikin->notify_cb != NULL)
+        daikin->notify_cb(daikin->notify_ctx, path.c_str(), field, daikin->notify_info);
+
+    return true;
+}
+
+static bool decode_frame(const std::string& frame, daikin_m2m_t* const msg)
+{
+    LIBDAIKIN_TRACE("FRAME: %s\n", frame.c_str());
+
+    if (daikin_m2m_decode(frame.data(), (uint32_t)frame.length(), msg) == false)
+    {
+        LIBDAIKIN_ERROR("Parsing frame '%s' failed.\n", frame.c_str());
+        return false;
+    }
 
-    *reminder = s;
     return true;
 }
 
@@ -337,53 +399,56 @@ static bool send_query(
     const daikin_t* const daikin,
     uint8_t op,
     const char* const field_path,
+    uint8_t field_path_len,
     std::string& response,
     int32_t* const rsc,
-    const char** reminder,
+    daikin_m2m_t* const msg,
+    uint8_t ty,
     const char* const con_val)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT(op == OP_W || op == OP_R);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
+    LIBDAIKIN_ASSERT(op == OP_W || op == OP_R || op == OP_D);
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
     // LIBDAIKIN_ASSERT(rsc != NULL); // rsc Can be NULL
-    LIBDAIKIN_ASSERT(reminder != NULL);
+    LIBDAIKIN_ASSERT(msg != NULL);
     //LIBDAIKIN_ASSERT(con_val != NULL); con_val Can be NULL
 
     std::string req_id;
-    if (daikin_ws_request(daikin, create_request_json(op, INDEX, field_path, req_id, con_val), response) == false)
-    {
-        LIBDAIKIN_ERROR("Query '%s' failed.\n", field_path);
-        return false;
-    }
-
-    int32_t rsc_temp, rqi, idx;
-    if (parse_query_response(response, field_path, &rsc_temp, &rqi, &idx, reminder) == false)
+    if (daikin_ws_request(daikin, create_request_json(op, INDEX, field_path, field_path_len, req_id, ty, con_val), response) == false ||
+        decode_frame(response, msg) == false)
     {
-        LIBDAIKIN_ERROR("Parsing response '%s' failed.\n", response.c_str());
+        LIBDAIKIN_ERROR("Query '%.*s' failed.\n", field_path_len, field_path);
         return false;
     }
 
-    if (rsc != NULL)
-        *rsc = rsc_temp; // Caller will handle
-    else // Otherwise handle rsc here
+    // Notifications can arrive before the response
+    while (msg->kind == daikin_m2m_kind_t::MK_REQUEST)
     {
-        if (is_rsc_ok(rsc_temp) == false)
+        if (handle_notification(daikin, msg) == false ||
+            daikin_ws_receive(daikin, response) == false ||
+            decode_frame(response, msg) == false)
         {
-            LIBDAIKIN_ERROR("Error rsc code: %d indicates error for the query '%s'.\n", rsc_temp, field_path);
+            LIBDAIKIN_ERROR("Query '%.*s' failed.\n", field_path_len, field_path);
             return false;
         }
     }
 
-    if (req_id != std::to_string(rqi))
+    if (check_query_response(msg, field_path, field_path_len, req_id) == false)
     {
-        LIBDAIKIN_ERROR("rqi code %d doesn't match with the expected code: %s.\n", rqi, req_id.c_str());
+        LIBDAIKIN_ERROR("Unexpected response '%s'.\n", response.c_str());
         return false;
     }
 
-    if (idx != ((int32_t)INDEX))
+    if (rsc != NULL)
+        *rsc = msg->rsc; // Caller will handle
+    else // Otherwise handle rsc here
     {
-        LIBDAIKIN_ERROR("Index code %d doesn't match with the expected code: %u.\n", idx, INDEX);
-        return false;
+        if (is_rsc_ok(msg->rsc) == false)
+        {
+            LIBDAIKIN_ERROR("Error rsc code: %d indicates error for the query '%.*s'.\n",
+                msg->rsc, field_path_len, field_path);
+            return false;
+        }
     }
 
     return true;
@@ -392,24 +457,25 @@ static bool send_query(
 static bool send_query_con_float(
     const daikin_t* const daikin,
     const char* const field_path,
+    uint8_t field_path_len,
     std::string& response,
     int32_t* const rsc,
     float* const v)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
     // LIBDAIKIN_ASSERT(rsc != NULL); // rsc Can be NULL
     LIBDAIKIN_ASSERT(v != NULL);
 
-    const char* reminder;
-    if (send_query(daikin, OP_R, field_path, response, rsc, &reminder, NULL) == false)
+    daikin_m2m_t msg;
+    if (send_query(daikin, OP_R, field_path, field_path_len, response, rsc, &msg, 0, NULL) == false)
         return false; // No extra error info needed
 
     if (rsc == NULL || (rsc != NULL && is_rsc_ok(*rsc)))
     {
-        if (get_con_float(reminder, v) == false)
+        if (get_con_float(&msg, v) == false)
         {
-            LIBDAIKIN_ERROR("Parsing value for the field '%s' failed.\n", field_path);
+            LIBDAIKIN_ERROR("Parsing value for the field '%.*s' failed.\n", field_path_len, field_path);
             return false;
         }
     }
@@ -420,19 +486,20 @@ static bool send_query_con_float(
 static bool send_query_con_int32(
     const daikin_t* const daikin,
     const char* const field_path,
+    uint8_t field_path_len,
     std::string& response,
     int32_t* const v)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
     LIBDAIKIN_ASSERT(v != NULL);
 
-    const char* reminder;
-    if (send_query(daikin, OP_R, field_path, response, NULL, &reminder, NULL) == false)
+    daikin_m2m_t msg;
+    if (send_query(daikin, OP_R, field_path, field_path_len, response, NULL, &msg, 0, NULL) == false)
         return false; // No extra error info needed
-    if (get_con_int32(reminder, v) == false)
+    if (get_con_int32(&msg, v) == false)
     {
-        LIBDAIKIN_ERROR("Parsing value for the field '%s' failed.\n", field_path);
+        LIBDAIKIN_ERROR("Parsing value for the field '%.*s' failed.\n", field_path_len, field_path);
         return false;
     }
 
@@ -442,131 +509,153 @@ static bool send_query_con_int32(
 static bool send_query_con_power_state(
     const daikin_t* const daikin,
     const char* const field_path,
+    uint8_t field_path_len,
     std::string& response,
     daikin_power_state_t* const v)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT((field_path != NULL) && (strlen(field_path) > 0));
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
     LIBDAIKIN_ASSERT(v != NULL);
 
-    const char* reminder;
-    if (send_query(daikin, OP_R, field_path, response, NULL, &reminder, NULL) == false)
+    daikin_m2m_t msg;
+    if (send_query(daikin, OP_R, field_path, field_path_len, response, NULL, &msg, 0, NULL) == false)
         return false; // No extra error info needed
-    if (get_con_power_state(reminder, v) == false)
+    if (get_con_power_state(&msg, v) == false)
     {
-        LIBDAIKIN_ERROR("Parsing value for the field '%s' failed.\n", field_path);
+        LIBDAIKIN_ERROR("Parsing value for the field '%.*s' failed.\n", field_path_len, field_path);
         return false;
     }
 
     return true;
 }
 
-bool daikin_open(daikin_t* const daikin)
+static bool send_query_con_raw(
+    const daikin_t* const daikin,
+    const char* const field_path,
+    uint8_t field_path_len,
+    std::string& response,
+    std::string& v)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
 
-    if (daikin == NULL)
+    daikin_m2m_t msg;
+    if (send_query(daikin, OP_R, field_path, field_path_len, response, NULL, &msg, 0, NULL) == false)
+        return false; // No extra error info needed
+    if (get_con_raw(&msg, v) == false)
     {
-        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        LIBDAIKIN_ERROR("Parsing value for the field '%.*s' failed.\n", field_path_len, field_path);
         return false;
     }
 
-    return daikin_ws_open(daikin);
+    return true;
 }
 
-void daikin_close(daikin_t* const daikin)
+static bool write_con(
+    const daikin_t* const daikin,
+    const char* const field_path,
+    uint8_t field_path_len,
+    const char* const con_val)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT((field_path != NULL) && (field_path_len > 0));
+    LIBDAIKIN_ASSERT(con_val != NULL);
 
-    if (daikin == NULL)
-    {
-        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
-        return;
-    }
+    std::string response;
+    daikin_m2m_t msg;
 
-    daikin_ws_close(daikin);
+    return send_query(daikin, OP_W, field_path, field_path_len, response,
+        NULL, &msg, TY_CIN, con_val);
 }
 
-bool daikin_get_device_info(
-    const daikin_t* const daikin,
-    daikin_device_info_t* const info)
+static bool is_in_range(const registry_entry_t* const entry, double v)
 {
-    LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(entry != NULL);
 
-    if (daikin == NULL)
-    {
-        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
-        return false;
-    }
+    if (entry->min == entry->max)
+        return true; // No range
 
-    if (info == NULL)
+    if (v < entry->min || v > entry->max)
     {
-        LIBDAIKIN_ERROR("Invalid input argument info.\n");
+        LIBDAIKIN_ERROR("Invalid value %g for '%.*s'. Value must be between %g and %g.\n",
+            v, entry->path_len, entry->read_path, entry->min, entry->max);
         return false;
     }
 
-    float temp;
-    int32_t rsc;
-    std::string response;
-
-    const char INDOOR_TEMP[] = "MNAE/1/Sensor/IndoorTemperature/la";
-    if (send_query_con_float(daikin, INDOOR_TEMP, response, NULL, &info->indoor_temp) == false)
-        return false; // No extra error info needed
+    return true;
+}
 
-    const char OUTDOOR_TEMP[] = "MNAE/1/Sensor/OutdoorTemperature/la";
-    if (send_query_con_float(daikin, OUTDOOR_TEMP, response, NULL, &info->outdoor_temp) == false)
-        return false; // No extra error info needed
+static bool resolve_path(
+    const daikin_t* const daikin,
+    const char* const path,
+    bool write,
+    registry_type_t type,
+    std::string& read_path,
+    const char** field_path,
+    uint8_t* field_path_len,
+    const registry_entry_t** entry)
+{
+    LIBDAIKIN_ASSERT(field_path != NULL);
+    LIBDAIKIN_ASSERT(field_path_len != NULL);
+    LIBDAIKIN_ASSERT(entry != NULL);
 
-    const char LW_TEMP[] = "MNAE/1/Sensor/LeavingWaterTemperatureCurrent/la";
-    if (send_query_con_float(daikin, LW_TEMP, response, NULL, &info->leaving_water_temp) == false)
-        return false; // No extra error info needed
+    const size_t MAX_PATH_LEN = 0xFF - READ_SUFFIX_LEN;
+    const size_t len = path != NULL ? strlen(path) : 0;
 
-    info->temp_target = 0;
-    const char TARGET_TEMP[] = "MNAE/1/Operation/TargetTemperature/la";
-    if (send_query_con_float(daikin, TARGET_TEMP, response, &rsc, &temp) == false)
-        return false; // No extra error info needed
-    if (is_rsc_ok(rsc))
+    if (len == 0 || len > MAX_PATH_LEN)
     {
-        LIBDAIKIN_TRACE("Target Temperature mode\n");
-        info->temp_mode = daikin_temperature_mode_t::TM_TARGET;
-        info->temp_target = (uint8_t)temp;
+        LIBDAIKIN_ERROR("Invalid input argument path.\n");
+        return false;
     }
 
-    info->temp_offset = 0;
-    const char LW_TEMP_OFFSET[] = "MNAE/1/Operation/LeavingWaterTemperatureOffsetHeating/la";
-    if (send_query_con_float(daikin, LW_TEMP_OFFSET, response, &rsc, &temp) == false)
-        return false; // No extra error info needed
-    if (is_rsc_ok(rsc))
+    *entry = registry_find(path, len);
+    if (*entry != NULL)
     {
-        LIBDAIKIN_TRACE("Leaving Water Temperature Offset Heating mode\n");
-        info->temp_mode = daikin_temperature_mode_t::TM_OFFSET;
-        info->temp_offset = (uint8_t)temp;
-    }
+        // Integer reads of fractional values would lose the fraction
+        if (((*entry)->type == registry_type_t::RT_STRING) != (type == registry_type_t::RT_STRING) ||
+            (write == false && type == registry_type_t::RT_INT && (*entry)->type == registry_type_t::RT_FLOAT))
+        {
+            LIBDAIKIN_ERROR("Type mismatch for the path '%s'.\n", path);
+            return false;
+        }
 
-    const char PWR_STATE[] = "MNAE/1/Operation/Power/la";
-    if (send_query_con_power_state(daikin, PWR_STATE, response, &info->power_state) == false)
-        return false; // No extra error info needed
+        if (write && (*entry)->writable == false)
+        {
+            LIBDAIKIN_ERROR("Path '%s' is read only.\n", path);
+            return false;
+        }
 
-    const char EM_STATE[] = "MNAE/1/UnitStatus/EmergencyState/la";
-    if (send_query_con_int32(daikin, EM_STATE, response, &info->emergency_state) == false)
-        return false; // No extra error info needed
+        if (is_entry_supported(daikin, registry_index_of(*entry)) == false)
+        {
+            LIBDAIKIN_ERROR("Path '%s' is not supported by the adapter.\n", path);
+            return false;
+        }
 
-    const char ER_STATE[] = "MNAE/1/UnitStatus/ErrorState/la";
-    if (send_query_con_int32(daikin, ER_STATE, response, &info->error_state) == false)
-        return false; // No extra error info needed
+        // Known path, no need to build it
+        *field_path = (*entry)->read_path;
+        *field_path_len = (uint8_t)((*entry)->path_len + (write ? 0 : READ_SUFFIX_LEN));
+        return true;
+    }
 
-    const char WR_STATE[] = "MNAE/1/UnitStatus/WarningState/la";
-    if (send_query_con_int32(daikin, WR_STATE, response, &info->warning_state) == false)
-        return false; // No extra error info needed
+    if (write)
+    {
+        *field_path = path;
+        *field_path_len = (uint8_t)len;
+        return true;
+    }
 
+    read_path.reserve(len + READ_SUFFIX_LEN);
+    read_path.assign(path, len);
+    read_path += "/la";
+
+    *field_path = read_path.c_str();
+    *field_path_len = (uint8_t)read_path.length();
     return true;
 }
 
-bool daikin_set_temp_offset(const daikin_t* const daikin, int8_t temp_offset)
+bool daikin_open(daikin_t* const daikin)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT(temp_offset >= -10 && temp_offset <= 10);
 
     if (daikin == NULL)
     {
@@ -574,53 +663,52 @@ bool daikin_set_temp_offset(const daikin_t* const daikin, int8_t temp_offset)
         return false;
     }
 
-    if (temp_offset < -10 || temp_offset > 10)
+    DAIKIN_HAL_SET_CANCEL(&daikin->tcp, false);
+    return daikin_ws_open(daikin);
+}
+
+void daikin_close(daikin_t* const daikin)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
     {
-        LIBDAIKIN_ERROR(
-            "Invalid input argument temp_offset: %d. Value must be between -10 and 10.\n",
-            temp_offset);
-        return false;
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return;
     }
 
-    std::string response;
-    const char* reminder;
-    const char TEMP_OFFSET_OP[] = "MNAE/1/Operation/LeavingWaterTemperatureOffsetHeating";
-
-    return send_query(daikin, OP_W, TEMP_OFFSET_OP, response,
-        NULL, &reminder, std::to_string(temp_offset).c_str());
+    daikin_ws_close(daikin);
 }
 
-bool daikin_set_temp_target(const daikin_t* const daikin, uint8_t temp_target)
+void daikin_set_deadline(daikin_t* const daikin, uint32_t deadline_ms)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT(temp_target >= 16 && temp_target <= 30);
 
     if (daikin == NULL)
     {
         LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
-        return false;
+        return;
     }
 
-    if (temp_target < 16 || temp_target > 30)
+    daikin->tcp.deadline_ms = deadline_ms;
+}
+
+void daikin_cancel(daikin_t* const daikin)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
     {
-        LIBDAIKIN_ERROR(
-            "Invalid input argument temp_target: %u. Value must be between 16 and 30.\n",
-            temp_target);
-        return false;
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return;
     }
 
-    std::string response;
-    const char* reminder;
-    const char TEMP_TARGET_OP[] = "MNAE/1/Operation/TargetTemperature";
-
-    return send_query(daikin, OP_W, TEMP_TARGET_OP, response,
-        NULL, &reminder, std::to_string(temp_target).c_str());
+    DAIKIN_HAL_SET_CANCEL(&daikin->tcp, true);
 }
 
-bool daikin_set_power_state(const daikin_t* const daikin, daikin_power_state_t power_state)
+bool daikin_discover(daikin_t* const daikin)
 {
     LIBDAIKIN_ASSERT(daikin != NULL);
-    LIBDAIKIN_ASSERT(power_state == daikin_power_state_t::PS_ON || power_state == daikin_power_state_t::PS_STANDBY);
 
     if (daikin == NULL)
     {
@@ -628,16 +716,733 @@ bool daikin_set_power_state(const daikin_t* const daikin, daikin_power_state_t p
         return false;
     }
 
-    if (!(power_state == daikin_power_state_t::PS_ON || power_state == daikin_power_state_t::PS_STANDBY))
+    uint32_t capabilities = DAIKIN_CAPS_DISCOVERED | REGISTRY_MODE_DEPENDENT;
+    std::string response;
+
+    for (uint8_t i = 0; i < RE_COUNT; i++)
+    {
+        if ((REGISTRY_MODE_DEPENDENT & (1u << i)) != 0)
+            continue; // Error rsc code of the inactive set point doesn't mean it's missing
+
+        const registry_entry_t* const entry = registry_get((registry_index_t)i);
+        daikin_m2m_t msg;
+        int32_t rsc;
+
+        if (send_query(daikin, OP_R, entry->read_path, (uint8_t)(entry->path_len + READ_SUFFIX_LEN),
+            response, &rsc, &msg, 0, NULL) == false)
+            return false; // No extra error info needed
+
+        if (is_rsc_ok(rsc))
+            capabilities |= (1u << i);
+        else if (rsc != RSC_NOT_FOUND)
+            LIBDAIKIN_INFO("Path '%.*s' returned rsc code: %d. Treated as not supported.\n",
+                entry->path_len, entry->read_path, rsc);
+    }
+
+    LIBDAIKIN_TRACE("Capabilities: 0x%08x\n", capabilities);
+    daikin->capabilities = capabilities;
+    return true;
+}
+
+typedef enum
+{
+    GF_READ,
+    GF_SKIPPED, // Not supported by the unit, the value is left as is
+    GF_FAILED
+} get_field_result_t;
+
+static get_field_result_t get_field(
+    const daikin_t* const daikin,
+    daikin_field_t field,
+    daikin_device_info_t* const info,
+    std::string& response)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (field == daikin_field_t::DF_TEMP_MODE)
+    {
+        // Mode is detected by the set point which is available
+        const get_field_result_t target = get_field(daikin, daikin_field_t::DF_TEMP_TARGET, info, response);
+        if (target == get_field_result_t::GF_FAILED)
+            return get_field_result_t::GF_FAILED;
+
+        const get_field_result_t offset = get_field(daikin, daikin_field_t::DF_TEMP_OFFSET, info, response);
+        if (offset == get_field_result_t::GF_FAILED)
+            return get_field_result_t::GF_FAILED;
+
+        return target == get_field_result_t::GF_READ || offset == get_field_result_t::GF_READ ?
+            get_field_result_t::GF_READ : get_field_result_t::GF_SKIPPED;
+    }
+
+    const registry_index_t index = registry_field_entry(field);
+    const registry_entry_t* const entry = registry_get(index);
+    const uint8_t len = (uint8_t)(entry->path_len + READ_SUFFIX_LEN);
+
+    // Set points return error rsc code when not used by the current temperature mode
+    const bool is_set_point =
+        field == daikin_field_t::DF_TEMP_TARGET ||
+        field == daikin_field_t::DF_TEMP_OFFSET;
+
+    if (is_entry_supported(daikin, index) == false)
+        return get_field_result_t::GF_SKIPPED; // Known to be missing on this unit, don't waste a round trip
+
+    int32_t rsc = RSC_OK;
+    double value;
+
+    switch (entry->type)
+    {
+    case registry_type_t::RT_FLOAT:
+    {
+        float temp;
+        if (send_query_con_float(daikin, entry->read_path, len, response, is_set_point ? &rsc : NULL, &temp) == false)
+            return get_field_result_t::GF_FAILED; // No extra error info needed
+        value = temp;
+        break;
+    }
+    case registry_type_t::RT_INT:
+    {
+        int32_t temp;
+        if (send_query_con_int32(daikin, entry->read_path, len, response, &temp) == false)
+            return get_field_result_t::GF_FAILED; // No extra error info needed
+        value = temp;
+        break;
+    }
+    default:
+    {
+        LIBDAIKIN_ASSERT(field == daikin_field_t::DF_POWER_STATE); // The only string field
+        daikin_power_state_t temp;
+        if (send_query_con_power_state(daikin, entry->read_path, len, response, &temp) == false)
+            return get_field_result_t::GF_FAILED; // No extra error info needed
+        value = temp;
+        break;
+    }
+    }
+
+    store_field(info, field, value, is_rsc_ok(rsc));
+    return get_field_result_t::GF_READ;
+}
+
+bool daikin_get_device_info(
+    const daikin_t* const daikin,
+    daikin_device_info_t* const info)
+{
+    uint32_t fields;
+    return daikin_get_device_info_partial(daikin, info, &fields);
+}
+
+bool daikin_get_device_info_partial(
+    const daikin_t* const daikin,
+    daikin_device_info_t* const info,
+    uint32_t* const fields)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(fields != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    if (info == NULL || fields == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument info or fields.\n");
+        return false;
+    }
+
+    *fields = 0;
+
+    static const daikin_field_t FIELDS[] =
+    {
+        daikin_field_t::DF_INDOOR_TEMP,
+        daikin_field_t::DF_OUTDOOR_TEMP,
+        daikin_field_t::DF_LEAVING_WATER_TEMP,
+        daikin_field_t::DF_TEMP_MODE, // Target temperature and offset
+        daikin_field_t::DF_POWER_STATE,
+        daikin_field_t::DF_EMERGENCY_STATE,
+        daikin_field_t::DF_ERROR_STATE,
+        daikin_field_t::DF_WARNING_STATE,
+    };
+
+    // Temperature mode is read together with the set points
+    const uint32_t TEMP_MODE_MASK =
+        (1u << daikin_field_t::DF_TEMP_MODE) |
+        (1u << daikin_field_t::DF_TEMP_TARGET) |
+        (1u << daikin_field_t::DF_TEMP_OFFSET);
+
+    std::string response;
+
+    for (size_t i = 0; i < sizeof(FIELDS) / sizeof(FIELDS[0]); i++)
+    {
+        const uint32_t mask = FIELDS[i] == daikin_field_t::DF_TEMP_MODE ? TEMP_MODE_MASK : (1u << FIELDS[i]);
+        if ((DAIKIN_DEVICE_INFO_FIELDS & mask) == 0)
+            continue; // Not built in
+
+        const get_field_result_t result = get_field(daikin, FIELDS[i], info, response);
+        if (result == get_field_result_t::GF_FAILED)
+            return false; // No extra error info needed
+
+        if (result == get_field_result_t::GF_READ)
+            *fields |= mask;
+    }
+
+    return true;
+}
+
+bool daikin_get_field(
+    const daikin_t* const daikin,
+    daikin_field_t field,
+    daikin_device_info_t* const info)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    if (field >= daikin_field_t::DF_COUNT)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument field: %d.\n", field);
+        return false;
+    }
+
+    if (info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument info.\n");
+        return false;
+    }
+
+    std::string response;
+    return get_field(daikin, field, info, response) != get_field_result_t::GF_FAILED;
+}
+
+bool daikin_set_temp_offset(const daikin_t* const daikin, int8_t temp_offset)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    const registry_entry_t* const entry = registry_get(registry_index_t::RE_TEMP_OFFSET);
+    if (is_in_range(entry, temp_offset) == false)
+        return false; // No extra error info needed
+
+    return write_con(daikin, entry->read_path, entry->path_len, std::to_string(temp_offset).c_str());
+}
+
+bool daikin_set_temp_target(const daikin_t* const daikin, uint8_t temp_target)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    const registry_entry_t* const entry = registry_get(registry_index_t::RE_TEMP_TARGET);
+    if (is_in_range(entry, temp_target) == false)
+        return false; // No extra error info needed
+
+    return write_con(daikin, entry->read_path, entry->path_len, std::to_string(temp_target).c_str());
+}
+
+bool daikin_set_power_state(const daikin_t* const daikin, daikin_power_state_t power_state)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(power_state == daikin_power_state_t::PS_ON || power_state == daikin_power_state_t::PS_STANDBY);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    if (!(power_state == daikin_power_state_t::PS_ON || power_state == daikin_power_state_t::PS_STANDBY))
     {
         LIBDAIKIN_ERROR("Invalid input argument power_state: %d\n", power_state);
         return false;
     }
 
+    const registry_entry_t* const entry = registry_get(registry_index_t::RE_POWER_STATE);
+    return write_con(daikin, entry->read_path, entry->path_len,
+        power_state == daikin_power_state_t::PS_ON ? "\"on\"" : "\"standby\"");
+}
+
+bool daikin_read_float(
+    const daikin_t* const daikin,
+    const char* const path,
+    float* const v)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(v != NULL);
+
+    if (daikin == NULL || v == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or v.\n");
+        return false;
+    }
+
+    std::string read_path, response;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, false, registry_type_t::RT_FLOAT, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    return send_query_con_float(daikin, field_path, field_path_len, response, NULL, v);
+}
+
+bool daikin_read_int(
+    const daikin_t* const daikin,
+    const char* const path,
+    int32_t* const v)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(v != NULL);
+
+    if (daikin == NULL || v == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or v.\n");
+        return false;
+    }
+
+    std::string read_path, response;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, false, registry_type_t::RT_INT, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    return send_query_con_int32(daikin, field_path, field_path_len, response, v);
+}
+
+bool daikin_read_string(
+    const daikin_t* const daikin,
+    const char* const path,
+    char* const v,
+    uint16_t v_len)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(v != NULL && v_len > 0);
+
+    if (daikin == NULL || v == NULL || v_len == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin, v or v_len.\n");
+        return false;
+    }
+
+    std::string read_path, response, value;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, false, registry_type_t::RT_STRING, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    if (send_query_con_raw(daikin, field_path, field_path_len, response, value) == false)
+        return false; // No extra error info needed
+
+    if (value.length() + 1 > v_len)
+    {
+        LIBDAIKIN_ERROR("Buffer too small for the value of '%s'. Required: %u.\n",
+            path, (uint32_t)(value.length() + 1));
+        return false;
+    }
+
+    memcpy(v, value.c_str(), value.length() + 1);
+    return true;
+}
+
+typedef struct
+{
+    const daikin_t* daikin;
+    daikin_chunk_cb cb;
+    void* ctx;
+    const char* field_path;
+    uint8_t field_path_len;
+    const std::string* req_id;
+    std::string head; // Start of the message until it is known to be a notification or a valid response
+    daikin_m2m_decoder_t decoder; // Head of the response
+    daikin_m2m_t msg;
+    bool decided;
+    bool notification;
+    bool checked;
+    bool failed; // Rest of the message is drained, the connection stays usable
+} read_stream_t;
+
+static bool is_stream_head_complete(const daikin_m2m_t* const msg)
+{
+    // The adapter sends rsc, rqi, to and fr before pc
+    return msg->rsc != 0 && msg->rqi[0] != 0 && msg->to[0] != 0 && msg->fr[0] != 0;
+}
+
+static bool read_stream_chunk(void* ctx, const char* data, uint32_t len, bool last)
+{
+    read_stream_t* const rs = (read_stream_t*)ctx;
+    const size_t PREFIX_LEN = sizeof("{\"m2m:rqp\":") - 1;
+
+    if (rs->checked)
+        return rs->cb(rs->ctx, data, len, last);
+
+    if (rs->failed)
+        return true;
+
+    // Notifications are small, they are buffered and handled as usual.
+    // Responses are buffered until the head is checked.
+    const uint32_t max_len = rs->daikin->max_message_len > 0 ? rs->daikin->max_message_len : DAIKIN_WS_MAX_MESSAGE;
+    rs->head.append(data, len);
+    if (rs->head.size() > max_len)
+    {
+        LIBDAIKIN_ERROR("Stream head exceeds the limit of %u bytes.\n", max_len);
+        rs->failed = true;
+        return true;
+    }
+
+    if (rs->decided == false)
+    {
+        if (rs->head.size() < PREFIX_LEN && last == false)
+            return true;
+
+        rs->decided = true;
+        rs->notification = is_notification(rs->head);
+        if (rs->notification == false)
+        {
+            // Everything buffered so far is new to the decoder
+            daikin_m2m_init(&rs->decoder, &rs->msg);
+            data = rs->head.data();
+            len = (uint32_t)rs->head.size();
+        }
+    }
+
+    if (rs->notification)
+    {
+        if (last == false)
+            return true;
+
+        daikin_m2m_t msg;
+        return decode_frame(rs->head, &msg) && handle_notification(rs->daikin, &msg);
+    }
+
+    if (daikin_m2m_feed(&rs->decoder, data, len) == false)
+    {
+        LIBDAIKIN_ERROR("Parsing stream head '%s' failed.\n", rs->head.c_str());
+        rs->failed = true;
+        return true;
+    }
+
+    if (last == false && is_stream_head_complete(&rs->msg) == false)
+        return true;
+
+    if (last && daikin_m2m_finish(&rs->decoder) == false)
+    {
+        LIBDAIKIN_ERROR("Parsing stream '%s' failed.\n", rs->head.c_str());
+        return false;
+    }
+
+    if (check_query_response(&rs->msg, rs->field_path, rs->field_path_len, *rs->req_id) == false)
+    {
+        rs->failed = true;
+        return true; // No extra error info needed
+    }
+
+    if (is_rsc_ok(rs->msg.rsc) == false)
+    {
+        LIBDAIKIN_ERROR("Error rsc code: %d indicates error for the query '%.*s'.\n",
+            rs->msg.rsc, rs->field_path_len, rs->field_path);
+        rs->failed = true;
+        return true;
+    }
+
+    rs->checked = true;
+    return rs->cb(rs->ctx, rs->head.data(), (uint32_t)rs->head.size(), last);
+}
+
+bool daikin_read_stream(
+    const daikin_t* const daikin,
+    const char* const path,
+    daikin_chunk_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    if (daikin == NULL || cb == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or cb.\n");
+        return false;
+    }
+
+    std::string read_path, req_id;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    // Any type, the raw response is streamed
+    const registry_entry_t* const known = path != NULL ? registry_find(path, strlen(path)) : NULL;
+    const registry_type_t type = known != NULL ? known->type : registry_type_t::RT_STRING;
+
+    if (resolve_path(daikin, path, false, type, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    read_stream_t rs;
+    rs.daikin = daikin;
+    rs.cb = cb;
+    rs.ctx = ctx;
+    rs.field_path = field_path;
+    rs.field_path_len = field_path_len;
+    rs.req_id = &req_id;
+    rs.decided = false;
+    rs.notification = false;
+    rs.checked = false;
+    rs.failed = false;
+
+    const std::string req = create_request_json(OP_R, INDEX, field_path, field_path_len, req_id, 0, NULL);
+    bool ok = daikin_ws_request_stream(daikin, req, read_stream_chunk, &rs);
+
+    // Notifications can arrive before the response
+    while (ok && rs.notification && rs.failed == false)
+    {
+        rs.head.clear();
+        rs.decided = false;
+        rs.notification = false;
+        ok = daikin_ws_receive_stream(daikin, read_stream_chunk, &rs);
+    }
+
+    if (ok == false || rs.failed)
+    {
+        LIBDAIKIN_ERROR("Query '%.*s' failed.\n", field_path_len, field_path);
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_write_float(
+    const daikin_t* const daikin,
+    const char* const path,
+    float v)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    std::string read_path;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, true, registry_type_t::RT_FLOAT, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    if (entry != NULL && is_in_range(entry, v) == false)
+        return false; // No extra error info needed
+
+    char con_val[32];
+    snprintf(con_val, sizeof(con_val), "%g", v);
+    return write_con(daikin, field_path, field_path_len, con_val);
+}
+
+bool daikin_write_int(
+    const daikin_t* const daikin,
+    const char* const path,
+    int32_t v)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    std::string read_path;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, true, registry_type_t::RT_INT, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    if (entry != NULL && is_in_range(entry, v) == false)
+        return false; // No extra error info needed
+
+    return write_con(daikin, field_path, field_path_len, std::to_string(v).c_str());
+}
+
+bool daikin_write_string(
+    const daikin_t* const daikin,
+    const char* const path,
+    const char* const v)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(v != NULL);
+
+    if (daikin == NULL || v == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin or v.\n");
+        return false;
+    }
+
+    if (strpbrk(v, "\"\\") != NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument v. Quotes and backslashes are not supported.\n");
+        return false;
+    }
+
+    std::string read_path;
+    const char* field_path;
+    uint8_t field_path_len;
+    const registry_entry_t* entry;
+
+    if (resolve_path(daikin, path, true, registry_type_t::RT_STRING, read_path, &field_path, &field_path_len, &entry) == false)
+        return false; // No extra error info needed
+
+    std::string con_val;
+    con_val.reserve(strlen(v) + 2);
+    con_val += "\"";
+    con_val += v;
+    con_val += "\"";
+
+    return write_con(daikin, field_path, field_path_len, con_val.c_str());
+}
+
+void daikin_set_notify(
+    daikin_t* const daikin,
+    daikin_device_info_t* const info,
+    daikin_notify_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return;
+    }
+
+    daikin->notify_info = info;
+    daikin->notify_cb = cb;
+    daikin->notify_ctx = ctx;
+}
+
+static bool subscription(
+    const daikin_t* const daikin,
+    daikin_field_t field,
+    bool subscribe)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    if (field >= daikin_field_t::DF_COUNT)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument field: %d.\n", field);
+        return false;
+    }
+
+    if (field == daikin_field_t::DF_TEMP_MODE)
+    {
+        return
+            subscription(daikin, daikin_field_t::DF_TEMP_TARGET, subscribe) &&
+            subscription(daikin, daikin_field_t::DF_TEMP_OFFSET, subscribe);
+    }
+
+    const registry_index_t index = registry_field_entry(field);
+    const registry_entry_t* const entry = registry_get(index);
+
+    if (is_entry_supported(daikin, index) == false)
+        return true; // Nothing to subscribe to
+
     std::string response;
-    const char* reminder;
-    const char POWER_OP[] = "MNAE/1/Operation/Power";
+    daikin_m2m_t msg;
+    int32_t rsc;
 
-    return send_query(daikin, OP_W, POWER_OP, response,
-        NULL, &reminder, power_state == daikin_power_state_t::PS_ON ? "\"on\"" : "\"standby\"");
+    if (subscribe)
+    {
+        // Subscriptions are created on the container, not on the latest (la) instance
+        if (send_query(daikin, OP_W, entry->read_path, entry->path_len, response,
+            &rsc, &msg, TY_SUB, NULL) == false)
+            return false; // No extra error info needed
+
+        if (is_rsc_ok(rsc) || rsc == RSC_CONFLICT) // Conflict => already subscribed
+            return true;
+    }
+    else
+    {
+        std::string sub_path(entry->read_path, entry->path_len);
+        sub_path += "/";
+        sub_path += agent;
+
+        if (send_query(daikin, OP_D, sub_path.c_str(), (uint8_t)sub_path.length(), response,
+            &rsc, &msg, 0, NULL) == false)
+            return false; // No extra error info needed
+
+        if (is_rsc_ok(rsc) || rsc == RSC_DELETED || rsc == RSC_NOT_FOUND)
+            return true;
+    }
+
+    LIBDAIKIN_ERROR("Error rsc code: %d indicates error for the %s of '%.*s'.\n",
+        rsc, subscribe ? "subscription" : "unsubscription", entry->path_len, entry->read_path);
+    return false;
+}
+
+bool daikin_subscribe(const daikin_t* const daikin, daikin_field_t field)
+{
+    return subscription(daikin, field, true);
+}
+
+bool daikin_unsubscribe(const daikin_t* const daikin, daikin_field_t field)
+{
+    return subscription(daikin, field, false);
+}
+
+bool daikin_wait_notification(const daikin_t* const daikin)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin.\n");
+        return false;
+    }
+
+    std::string frame;
+    daikin_m2m_t msg;
+    while (true)
+    {
+        if (daikin_ws_receive(daikin, frame) == false)
+        {
+            LIBDAIKIN_ERROR("daikin_ws_receive failed.\n");
+            return false;
+        }
+
+        if (decode_frame(frame, &msg) == false)
+            return false; // No extra error info needed
+
+        if (msg.kind == daikin_m2m_kind_t::MK_REQUEST)
+            return handle_notification(daikin, &msg);
+
+        LIBDAIKIN_INFO("Unexpected frame ignored: '%s'.\n", frame.c_str());
+    }
 }
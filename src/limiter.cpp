@@ -0,0 +1,292 @@
+#include <string.h>
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+#include "limiter.h"
+#include "trace.h"
+
+#include "../include/libdaikinhal.h"
+
+static const float DEFAULT_RATE_PER_S = 5.0f;
+static const uint16_t DEFAULT_BURST = 10;
+static const uint8_t DEFAULT_MAX_IN_FLIGHT = 4;
+static const uint32_t DEFAULT_LATENCY_TARGET_MS = 500;
+static const float MIN_RATE_FRACTION = 0.125f; // Decreases stop at this part of limits.rate_per_s
+static const uint8_t LATENCY_EWMA_SHIFT = 3; // New sample weight 1/8
+static const uint8_t LOCK_SPINS = 64; // Then the holder was preempted, sleep instead of spinning
+static const uint32_t SLOT_POLL_MS = 1; // Free slots are not signalled, waiters poll
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define LIMITER_TRY_LOCK(l)      (__atomic_test_and_set(&(l)->lock, __ATOMIC_ACQUIRE) == false)
+#   define LIMITER_UNLOCK(l)        __atomic_clear(&(l)->lock, __ATOMIC_RELEASE)
+#   if defined(__i386__) || defined(__x86_64__)
+#       define LIMITER_PAUSE()      __builtin_ia32_pause()
+#   elif defined(__arm__) || defined(__aarch64__)
+#       define LIMITER_PAUSE()      __asm__ __volatile__("yield")
+#   else
+#       define LIMITER_PAUSE()      __asm__ __volatile__("" ::: "memory")
+#   endif
+#elif defined(_MSC_VER)
+#   define LIMITER_TRY_LOCK(l)      (_InterlockedExchange8((volatile char*)&(l)->lock, 1) == 0)
+#   define LIMITER_UNLOCK(l)        _InterlockedExchange8((volatile char*)&(l)->lock, 0)
+#   if defined(_M_IX86) || defined(_M_X64)
+#       define LIMITER_PAUSE()      _mm_pause()
+#   else
+#       define LIMITER_PAUSE()      __yield()
+#   endif
+#else
+#   error "No atomic test-and-set for the limiter lock on this compiler"
+#endif
+
+static void lock(daikin_limiter_t* const limiter)
+{
+    // Held for a few instructions only, never while sleeping or doing I/O
+    uint8_t spins = 0;
+    while (LIMITER_TRY_LOCK(limiter) == false)
+    {
+        if (++spins < LOCK_SPINS)
+            LIMITER_PAUSE();
+        else
+        {
+            spins = 0;
+            daikin_hal_sleep_ms(1);
+        }
+    }
+}
+
+static void unlock(daikin_limiter_t* const limiter)
+{
+    LIMITER_UNLOCK(limiter);
+}
+
+static void refill(daikin_limiter_t* const limiter, uint32_t now_ms)
+{
+    const uint32_t elapsed = now_ms - limiter->last_refill_ms;
+    limiter->last_refill_ms = now_ms;
+
+    limiter->tokens += (float)elapsed * limiter->stats.rate_per_s / 1000.0f;
+    if (limiter->tokens > limiter->limits.burst)
+        limiter->tokens = limiter->limits.burst;
+}
+
+static void update_depth(daikin_limiter_t* const limiter)
+{
+    daikin_limiter_stats_t* const s = &limiter->stats;
+    s->queue_depth = (uint8_t)(s->in_flight + s->waiting);
+    if (s->queue_depth > s->max_queue_depth)
+        s->max_queue_depth = s->queue_depth;
+}
+
+static void decrease(daikin_limiter_t* const limiter, uint32_t now_ms)
+{
+    // At most once per latency target, one slow adapter slows all requests sent meanwhile
+    if ((now_ms - limiter->last_decrease_ms) < limiter->limits.latency_target_ms)
+        return;
+
+    daikin_limiter_stats_t* const s = &limiter->stats;
+    const float min_rate = limiter->limits.rate_per_s * MIN_RATE_FRACTION;
+
+    limiter->last_decrease_ms = now_ms;
+    s->rate_per_s = s->rate_per_s / 2 < min_rate ? min_rate : s->rate_per_s / 2;
+    s->decreases++;
+}
+
+void daikin_limiter_init(daikin_limiter_t* const limiter, const daikin_limits_t* const limits)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+
+    if (limiter == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument limiter.\n");
+        return;
+    }
+
+    memset(limiter, 0, sizeof(daikin_limiter_t));
+
+    if (limits != NULL)
+        limiter->limits = *limits;
+    else
+    {
+        limiter->limits.rate_per_s = DEFAULT_RATE_PER_S;
+        limiter->limits.burst = DEFAULT_BURST;
+        limiter->limits.max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+        limiter->limits.latency_target_ms = DEFAULT_LATENCY_TARGET_MS;
+    }
+
+    if (limiter->limits.burst == 0)
+        limiter->limits.burst = 1;
+
+    if (limiter->limits.max_in_flight == 0)
+        limiter->limits.max_in_flight = 1;
+
+    // Starts at the full rate, slow responses bring it down
+    limiter->tokens = limiter->limits.burst;
+    limiter->last_refill_ms = daikin_hal_time_ms();
+    limiter->last_decrease_ms = limiter->last_refill_ms - limiter->limits.latency_target_ms;
+    limiter->stats.rate_per_s = limiter->limits.rate_per_s;
+}
+
+void daikin_limiter_get_stats(daikin_limiter_t* const limiter, daikin_limiter_stats_t* const stats)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+    LIBDAIKIN_ASSERT(stats != NULL);
+
+    if (limiter == NULL || stats == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument limiter or stats.\n");
+        return;
+    }
+
+    lock(limiter);
+    *stats = limiter->stats;
+    unlock(limiter);
+}
+
+static bool has_token(const daikin_limiter_t* const limiter)
+{
+    return limiter->limits.rate_per_s <= 0 || limiter->tokens >= 1.0f; // Unlimited rate or a token
+}
+
+static bool has_slot(const daikin_limiter_t* const limiter)
+{
+    return limiter->stats.in_flight < limiter->limits.max_in_flight;
+}
+
+bool limiter_acquire(daikin_limiter_t* const limiter, const daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    daikin_limiter_stats_t* const s = &limiter->stats;
+    const bool rated = limiter->limits.rate_per_s > 0;
+
+    lock(limiter);
+    uint32_t now = daikin_hal_time_ms();
+    if (rated)
+        refill(limiter, now);
+
+    if (has_token(limiter) == false)
+        s->throttled++;
+    if (has_slot(limiter) == false)
+        s->window_full++;
+
+    const uint32_t start = now;
+    bool waited = false;
+    bool expired = false;
+    while (has_token(limiter) == false || has_slot(limiter) == false)
+    {
+        if (waited == false)
+        {
+            waited = true;
+            s->waiting++;
+            update_depth(limiter);
+        }
+
+        // A token or slot later than the deadline is of no use, fail now instead of at the deadline
+        const uint32_t remaining_ms = daikin_hal_tcp_remaining_ms(tcp);
+        const uint32_t sleep_ms = has_token(limiter) ? SLOT_POLL_MS :
+            (uint32_t)((1.0f - limiter->tokens) * 1000.0f / s->rate_per_s) + 1;
+        expired = remaining_ms == 0 || (remaining_ms != UINT32_MAX && sleep_ms > remaining_ms);
+        if (expired)
+            break;
+
+        unlock(limiter);
+        daikin_hal_sleep_ms(sleep_ms < DAIKIN_HAL_CANCEL_CHECK ? sleep_ms : DAIKIN_HAL_CANCEL_CHECK);
+        lock(limiter);
+
+        now = daikin_hal_time_ms();
+        if (rated)
+            refill(limiter, now);
+    }
+
+    if (waited)
+    {
+        s->wait_ms += now - start;
+        s->waiting--;
+    }
+
+    const bool token = has_token(limiter); // What was missing at the deadline
+    if (expired == false)
+    {
+        if (rated)
+            limiter->tokens -= 1.0f;
+        s->in_flight++; // Slot is taken until limiter_completed or limiter_release
+    }
+
+    update_depth(limiter);
+    unlock(limiter);
+
+    if (expired)
+    {
+        LIBDAIKIN_ERROR("Waiting for a %s %s.\n", token ? "free in-flight slot" : "token",
+            DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "would miss the deadline");
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t limiter_sent(daikin_limiter_t* const limiter)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+
+    daikin_limiter_stats_t* const s = &limiter->stats;
+
+    lock(limiter);
+    s->requests++;
+    unlock(limiter);
+
+    return daikin_hal_time_ms();
+}
+
+void limiter_release(daikin_limiter_t* const limiter)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+
+    daikin_limiter_stats_t* const s = &limiter->stats;
+
+    lock(limiter);
+    LIBDAIKIN_ASSERT(s->in_flight > 0);
+    if (s->in_flight > 0)
+        s->in_flight--;
+    update_depth(limiter);
+    unlock(limiter);
+}
+
+void limiter_completed(daikin_limiter_t* const limiter, uint32_t sent_ms, bool success)
+{
+    LIBDAIKIN_ASSERT(limiter != NULL);
+
+    daikin_limiter_stats_t* const s = &limiter->stats;
+
+    lock(limiter);
+    const uint32_t now = daikin_hal_time_ms();
+    const uint32_t latency = now - sent_ms;
+
+    LIBDAIKIN_ASSERT(s->in_flight > 0);
+    if (s->in_flight > 0)
+        s->in_flight--;
+    update_depth(limiter);
+
+    s->last_latency_ms = latency;
+    s->avg_latency_ms = s->avg_latency_ms == 0 ? latency :
+        s->avg_latency_ms - (s->avg_latency_ms >> LATENCY_EWMA_SHIFT) + (latency >> LATENCY_EWMA_SHIFT);
+
+    // Fixed or unlimited rate
+    if (limiter->limits.latency_target_ms > 0 && limiter->limits.rate_per_s > 0)
+    {
+        if (success == false || latency > limiter->limits.latency_target_ms)
+            decrease(limiter, now);
+        else
+        {
+            // Additive increase, about one request per second for every second of fast responses
+            s->rate_per_s += 1.0f / s->rate_per_s;
+            if (s->rate_per_s > limiter->limits.rate_per_s)
+                s->rate_per_s = limiter->limits.rate_per_s;
+        }
+    }
+
+    unlock(limiter);
+}
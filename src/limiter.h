@@ -0,0 +1,26 @@
+#ifndef __LIMITER_H__
+#define __LIMITER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/libdaikin.h"
+#include "../include/libdaikinhal.h"
+
+// Waits for a token and an in-flight slot, at most until the deadline of tcp.
+// false => deadline passed or cancelled. true => the slot is taken, give it back with
+// limiter_completed once the response arrived (or failed) or limiter_release when nothing was sent.
+bool     limiter_acquire(daikin_limiter_t* const limiter, const daikin_hal_tcp_t* const tcp);
+uint32_t limiter_sent(daikin_limiter_t* const limiter); // Returns the send time for limiter_completed
+void     limiter_completed(daikin_limiter_t* const limiter, uint32_t sent_ms, bool success);
+void     limiter_release(daikin_limiter_t* const limiter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/libdaikinm2m.h"
+
+#include "trace.h"
+
+// Keys the decoder looks at, anything else is K_OTHER
+typedef enum
+{
+    K_OTHER,
+    K_RSP,
+    K_RQP,
+    K_RSC,
+    K_RQI,
+    K_TO,
+    K_FR,
+    K_OP,
+    K_TY,
+    K_PC,
+    K_CIN,
+    K_CON,
+    K_CNF,
+    K_CT,
+    K_LT,
+    K_SGN,
+    K_NEV,
+    K_REP,
+    K_NET,
+    K_SUR,
+    K_COUNT,
+} m2m_key_t;
+
+static const char* const KEYS[K_COUNT] =
+{
+    "", "m2m:rsp", "m2m:rqp", "rsc", "rqi", "to", "fr", "op", "ty", "pc",
+    "m2m:cin", "con", "cnf", "ct", "lt", "m2m:sgn", "nev", "rep", "net", "sur",
+};
+
+// Key paths from the top level object to the parent of the value
+static const uint8_t PATH_RSP_CIN[] = { K_RSP, K_PC, K_CIN };
+static const uint8_t PATH_SGN_CIN[] = { K_RQP, K_PC, K_SGN, K_NEV, K_REP, K_CIN };
+static const uint8_t PATH_SGN[] = { K_RQP, K_PC, K_SGN };
+static const uint8_t PATH_NEV[] = { K_RQP, K_PC, K_SGN, K_NEV };
+
+static uint8_t key_of(const char* const text)
+{
+    for (uint8_t i = 1; i < K_COUNT; i++)
+    {
+        if (strcmp(text, KEYS[i]) == 0)
+            return i;
+    }
+
+    return K_OTHER;
+}
+
+// Value at depth (open containers) has the parent path and the key
+static bool is_at(const daikin_m2m_decoder_t* const dec, uint8_t depth,
+    const uint8_t* const path, uint8_t path_len, uint8_t key)
+{
+    if (depth != path_len + 1)
+        return false;
+
+    return memcmp(dec->keys, path, path_len) == 0 && dec->keys[path_len] == key;
+}
+
+static bool is_cin_field(const daikin_m2m_decoder_t* const dec, uint8_t depth, uint8_t key)
+{
+    return
+        is_at(dec, depth, PATH_RSP_CIN, sizeof(PATH_RSP_CIN), key) ||
+        is_at(dec, depth, PATH_SGN_CIN, sizeof(PATH_SGN_CIN), key);
+}
+
+static void copy_text(daikin_m2m_t* const msg, char* const dst, size_t dst_size,
+    const char* const text, uint16_t len, bool truncated)
+{
+    const size_t n = len < dst_size - 1 ? len : dst_size - 1;
+    memcpy(dst, text, n);
+    dst[n] = 0;
+
+    if (truncated || n < len)
+        msg->truncated = true;
+}
+
+static void con_append(daikin_m2m_t* const msg, const char* const text, size_t len)
+{
+    if (msg->con_len + len > DAIKIN_M2M_CON_LEN)
+    {
+        msg->truncated = true;
+        len = DAIKIN_M2M_CON_LEN - msg->con_len;
+    }
+
+    memcpy(msg->con + msg->con_len, text, len);
+    msg->con_len = (uint16_t)(msg->con_len + len);
+    msg->con[msg->con_len] = 0;
+}
+
+static void con_append_string(daikin_m2m_t* const msg, const char* const text, uint16_t len)
+{
+    con_append(msg, "\"", 1);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        const char c = text[i];
+        if (c == '"' || c == '\\')
+        {
+            const char escaped[2] = { '\\', c };
+            con_append(msg, escaped, 2);
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)c);
+            con_append(msg, escaped, 6);
+        }
+        else
+            con_append(msg, &c, 1);
+    }
+    con_append(msg, "\"", 1);
+}
+
+// Events inside a con object or array are written back as compact JSON
+static void con_copy_event(daikin_m2m_decoder_t* const dec, daikin_json_event_t event,
+    const char* const text, uint16_t len)
+{
+    daikin_m2m_t* const msg = dec->msg;
+    const bool is_end = event == JE_OBJECT_END || event == JE_ARRAY_END;
+
+    if (dec->con_comma && is_end == false)
+        con_append(msg, ",", 1);
+
+    switch (event)
+    {
+    case JE_OBJECT_START: con_append(msg, "{", 1); break;
+    case JE_OBJECT_END:   con_append(msg, "}", 1); break;
+    case JE_ARRAY_START:  con_append(msg, "[", 1); break;
+    case JE_ARRAY_END:    con_append(msg, "]", 1); break;
+    case JE_KEY:
+        con_append_string(msg, text, len);
+        con_append(msg, ":", 1);
+        break;
+    case JE_STRING:
+        con_append_string(msg, text, len);
+        break;
+    default:
+        con_append(msg, text, len);
+        break;
+    }
+
+    // No ',' after a key or at the start of a container
+    dec->con_comma = event != JE_KEY && event != JE_OBJECT_START && event != JE_ARRAY_START;
+}
+
+static void store_con(daikin_m2m_t* const msg, daikin_json_event_t event,
+    const char* const text, uint16_t len, bool truncated)
+{
+    switch (event)
+    {
+    case JE_NUMBER:
+        msg->con_type = daikin_m2m_con_type_t::CT_NUMBER;
+        msg->con_number = strtod(text, NULL);
+        break;
+    case JE_STRING:
+        msg->con_type = daikin_m2m_con_type_t::CT_STRING;
+        break;
+    case JE_TRUE:
+    case JE_FALSE:
+        msg->con_type = daikin_m2m_con_type_t::CT_BOOL;
+        msg->con_number = event == JE_TRUE ? 1 : 0;
+        break;
+    default:
+        msg->con_type = daikin_m2m_con_type_t::CT_NULL;
+        break;
+    }
+
+    msg->con_len = 0;
+    if (truncated)
+        msg->truncated = true;
+    con_append(msg, text, len);
+}
+
+static void store_scalar(daikin_m2m_decoder_t* const dec, uint8_t depth, daikin_json_event_t event,
+    const char* const text, uint16_t len, bool truncated)
+{
+    daikin_m2m_t* const msg = dec->msg;
+    const uint8_t key = dec->keys[depth - 1];
+    const bool is_number = event == JE_NUMBER;
+
+    if (depth == 2 && (dec->keys[0] == K_RSP || dec->keys[0] == K_RQP))
+    {
+        if (key == K_RSC && is_number)
+            msg->rsc = (int32_t)strtol(text, NULL, 10);
+        else if (key == K_OP && is_number)
+            msg->op = (int32_t)strtol(text, NULL, 10);
+        else if (key == K_TY && is_number)
+            msg->ty = (int32_t)strtol(text, NULL, 10);
+        else if (key == K_RQI)
+            copy_text(msg, msg->rqi, sizeof(msg->rqi), text, len, truncated);
+        else if (key == K_TO)
+            copy_text(msg, msg->to, sizeof(msg->to), text, len, truncated);
+        else if (key == K_FR)
+            copy_text(msg, msg->fr, sizeof(msg->fr), text, len, truncated);
+        return;
+    }
+
+    if (is_cin_field(dec, depth, K_CON))
+        store_con(msg, event, text, len, truncated);
+    else if (is_cin_field(dec, depth, K_CNF))
+        copy_text(msg, msg->cnf, sizeof(msg->cnf), text, len, truncated);
+    else if (is_cin_field(dec, depth, K_CT))
+        copy_text(msg, msg->ct, sizeof(msg->ct), text, len, truncated);
+    else if (is_cin_field(dec, depth, K_LT))
+        copy_text(msg, msg->lt, sizeof(msg->lt), text, len, truncated);
+    else if (is_at(dec, depth, PATH_SGN, sizeof(PATH_SGN), K_SUR))
+        copy_text(msg, msg->sur, sizeof(msg->sur), text, len, truncated);
+    else if (is_at(dec, depth, PATH_NEV, sizeof(PATH_NEV), K_NET) && is_number)
+        msg->net = (int32_t)strtol(text, NULL, 10);
+}
+
+static bool on_json_event(daikin_json_t* json, daikin_json_event_t event, const char* text, uint16_t len)
+{
+    daikin_m2m_decoder_t* const dec = (daikin_m2m_decoder_t*)json->ctx;
+    daikin_m2m_t* const msg = dec->msg;
+    const uint8_t depth = json->depth; // Already updated for container events
+
+    if (dec->con_depth > 0)
+    {
+        if (json->truncated)
+            msg->truncated = true;
+
+        con_copy_event(dec, event, text, len);
+        if ((event == JE_OBJECT_END || event == JE_ARRAY_END) && depth < dec->con_depth)
+            dec->con_depth = 0; // con is complete
+        return true;
+    }
+
+    switch (event)
+    {
+    case JE_KEY:
+        dec->keys[depth - 1] = key_of(text);
+        return true;
+
+    case JE_OBJECT_START:
+    case JE_ARRAY_START:
+        if (depth == 1)
+        {
+            if (event != JE_OBJECT_START)
+            {
+                LIBDAIKIN_ERROR("Message is not a JSON object.\n");
+                return false;
+            }
+            return true;
+        }
+
+        if (depth == 2 && event == JE_OBJECT_START)
+        {
+            if (dec->keys[0] == K_RSP)
+                msg->kind = daikin_m2m_kind_t::MK_RESPONSE;
+            else if (dec->keys[0] == K_RQP)
+                msg->kind = daikin_m2m_kind_t::MK_REQUEST;
+        }
+        else if (event == JE_OBJECT_START &&
+            (is_at(dec, depth - 1, PATH_RSP_CIN, sizeof(PATH_RSP_CIN) - 1, K_CIN) ||
+            is_at(dec, depth - 1, PATH_SGN_CIN, sizeof(PATH_SGN_CIN) - 1, K_CIN)))
+        {
+            msg->has_cin = true;
+        }
+        else if (is_cin_field(dec, depth - 1, K_CON))
+        {
+            // Objects and arrays are kept as JSON text
+            msg->con_type = event == JE_OBJECT_START ?
+                daikin_m2m_con_type_t::CT_OBJECT : daikin_m2m_con_type_t::CT_ARRAY;
+            msg->con_len = 0;
+            dec->con_depth = depth;
+            dec->con_comma = false;
+            con_copy_event(dec, event, text, len);
+            return true;
+        }
+
+        dec->keys[depth - 1] = K_OTHER; // Keys of the new container follow
+        return true;
+
+    case JE_OBJECT_END:
+    case JE_ARRAY_END:
+        return true;
+
+    default:
+        if (depth == 0)
+        {
+            LIBDAIKIN_ERROR("Message is not a JSON object.\n");
+            return false;
+        }
+
+        // Values of arrays have no key
+        if ((json->containers & (1u << (depth - 1))) != 0)
+            store_scalar(dec, depth, event, text, len, json->truncated);
+        return true;
+    }
+}
+
+void daikin_m2m_init(daikin_m2m_decoder_t* const decoder, daikin_m2m_t* const msg)
+{
+    LIBDAIKIN_ASSERT(decoder != NULL);
+    LIBDAIKIN_ASSERT(msg != NULL);
+
+    memset(decoder, 0, sizeof(daikin_m2m_decoder_t));
+    memset(msg, 0, sizeof(daikin_m2m_t));
+
+    decoder->msg = msg;
+    daikin_json_init(&decoder->json, on_json_event, decoder);
+}
+
+bool daikin_m2m_feed(daikin_m2m_decoder_t* const decoder, const char* const data, uint32_t len)
+{
+    LIBDAIKIN_ASSERT(decoder != NULL && decoder->msg != NULL);
+
+    if (decoder == NULL || decoder->msg == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument decoder.\n");
+        return false;
+    }
+
+    return daikin_json_feed(&decoder->json, data, len);
+}
+
+bool daikin_m2m_finish(daikin_m2m_decoder_t* const decoder)
+{
+    LIBDAIKIN_ASSERT(decoder != NULL && decoder->msg != NULL);
+
+    if (decoder == NULL || decoder->msg == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument decoder.\n");
+        return false;
+    }
+
+    if (daikin_json_finish(&decoder->json) == false)
+        return false; // No extra error info needed
+
+    if (decoder->msg->kind == daikin_m2m_kind_t::MK_UNKNOWN)
+    {
+        LIBDAIKIN_ERROR("Neither m2m:rsp nor m2m:rqp message.\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_m2m_chunk(void* ctx, const char* data, uint32_t len, bool last)
+{
+    daikin_m2m_decoder_t* const decoder = (daikin_m2m_decoder_t*)ctx;
+
+    if (daikin_m2m_feed(decoder, data, len) == false)
+        return false; // No extra error info needed
+
+    return last == false || daikin_m2m_finish(decoder);
+}
+
+bool daikin_m2m_decode(const char* const data, uint32_t len, daikin_m2m_t* const msg)
+{
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(msg != NULL);
+
+    if (data == NULL || msg == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument data or msg.\n");
+        return false;
+    }
+
+    daikin_m2m_decoder_t decoder;
+    daikin_m2m_init(&decoder, msg);
+
+    return daikin_m2m_feed(&decoder, data, len) && daikin_m2m_finish(&decoder);
+}
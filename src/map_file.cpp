@@ -0,0 +1,77 @@
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   define MAP_FILE_HAS_MMAP 1
+#endif
+
+#include "map_file.h"
+#include "trace.h"
+
+#ifdef MAP_FILE_HAS_MMAP
+
+bool daikin_map_file(
+    const char* const path,
+    uint32_t len,
+    uint8_t** const mem)
+{
+    LIBDAIKIN_ASSERT((path != NULL) && (strlen(path) > 0));
+    LIBDAIKIN_ASSERT(len > 0);
+    LIBDAIKIN_ASSERT(mem != NULL);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        LIBDAIKIN_ERROR("Unable to open '%s'.\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < (off_t)len && ftruncate(fd, (off_t)len) != 0))
+    {
+        LIBDAIKIN_ERROR("Unable to size '%s' to %u bytes.\n", path, len);
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+    {
+        LIBDAIKIN_ERROR("Unable to map '%s'.\n", path);
+        return false;
+    }
+
+    *mem = (uint8_t*)p;
+    return true;
+}
+
+void daikin_unmap_file(uint8_t* const mem, uint32_t len)
+{
+    LIBDAIKIN_ASSERT(mem != NULL);
+
+    munmap(mem, len);
+}
+
+#else
+
+bool daikin_map_file(const char* const path, uint32_t len, uint8_t** const mem)
+{
+    (void)path;
+    (void)len;
+    (void)mem;
+    LIBDAIKIN_ERROR("Memory-mapped files are not supported on this platform.\n");
+    return false;
+}
+
+void daikin_unmap_file(uint8_t* const mem, uint32_t len)
+{
+    (void)mem;
+    (void)len;
+}
+
+#endif
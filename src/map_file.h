@@ -0,0 +1,19 @@
+#ifndef __MAP_FILE_H__
+#define __MAP_FILE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Shared read/write mapping of a file, created/extended to len bytes (POSIX only)
+bool daikin_map_file(const char* const path, uint32_t len, uint8_t** const mem);
+void daikin_unmap_file(uint8_t* const mem, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,261 @@
+#include <math.h>
+#include <string.h>
+
+#include "../include/libdaikinmetrics.h"
+
+#include "trace.h"
+
+static const float SECONDS_PER_HOUR = 3600.0f;
+
+static bool has(uint32_t fields, daikin_field_t field)
+{
+    return (fields & (1u << field)) != 0;
+}
+
+static void clear_bucket(daikin_metrics_bucket_t* const b, uint32_t t_start)
+{
+    memset(b, 0, sizeof(daikin_metrics_bucket_t));
+    b->t_start = t_start;
+}
+
+static void add_bucket(daikin_metrics_bucket_t* const sum, const daikin_metrics_bucket_t* const b)
+{
+    if (b->samples > 0)
+    {
+        sum->delta_t_min = sum->samples == 0 || b->delta_t_min < sum->delta_t_min ? b->delta_t_min : sum->delta_t_min;
+        sum->delta_t_max = sum->samples == 0 || b->delta_t_max > sum->delta_t_max ? b->delta_t_max : sum->delta_t_max;
+    }
+
+    sum->samples += b->samples;
+    sum->delta_t_sum += b->delta_t_sum;
+    sum->degree_hours += b->degree_hours;
+    sum->defrost_s += b->defrost_s;
+    sum->defrosts += b->defrosts;
+    sum->electric_kwh += b->electric_kwh;
+    sum->heat_kwh += b->heat_kwh;
+}
+
+// Moves the ring to the bucket of t, sums the completed ones when a bucket starts
+static daikin_metrics_bucket_t* advance(daikin_metrics_t* const metrics, uint32_t t)
+{
+    const uint32_t len = metrics->config.window_s / DAIKIN_METRICS_BUCKETS;
+    const uint32_t t_start = t - t % len;
+    daikin_metrics_bucket_t* const cur = &metrics->buckets[metrics->current];
+
+    if (t_start <= cur->t_start)
+        return cur; // Energy readings may be a little older than the last sample
+
+    const uint32_t steps = (t_start - cur->t_start) / len;
+    for (uint32_t i = steps < DAIKIN_METRICS_BUCKETS ? steps : DAIKIN_METRICS_BUCKETS; i > 0; i--)
+    {
+        metrics->current = (uint8_t)((metrics->current + 1) % DAIKIN_METRICS_BUCKETS);
+        clear_bucket(&metrics->buckets[metrics->current], t_start - (i - 1) * len);
+    }
+
+    clear_bucket(&metrics->completed, 0);
+    for (uint8_t i = 0; i < DAIKIN_METRICS_BUCKETS; i++)
+    {
+        if (i != metrics->current)
+            add_bucket(&metrics->completed, &metrics->buckets[i]);
+    }
+
+    return &metrics->buckets[metrics->current];
+}
+
+static bool is_valid_time(const daikin_metrics_t* const metrics, uint32_t t)
+{
+    if (t < metrics->t_last)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument t, %u is before the last sample %u.\n", t, metrics->t_last);
+        return false;
+    }
+
+    return true;
+}
+
+static void update_defrost(daikin_metrics_t* const metrics, daikin_metrics_bucket_t* const b, uint32_t t, uint32_t dt,
+    float lwt, bool powered)
+{
+    const daikin_metrics_config_t* const c = &metrics->config;
+
+    if (metrics->defrost_start != 0)
+    {
+        b->defrost_s += dt;
+
+        const uint32_t duration = t - metrics->defrost_start;
+        if (powered && lwt < metrics->baseline - c->defrost_recover && duration <= c->defrost_max_s)
+            return;
+
+        metrics->defrost_start = 0;
+        metrics->defrost_last_s = duration;
+        if (duration > c->defrost_max_s)
+            metrics->baseline = lwt; // Stayed down, new level
+        LIBDAIKIN_INFO("Defrost ended after %u s.\n", duration);
+        return;
+    }
+
+    if (powered == false)
+    {
+        metrics->baseline = NAN; // Starts again from the water temperature at power on
+        return;
+    }
+
+    if (isnan(metrics->baseline) || dt == 0)
+    {
+        metrics->baseline = lwt;
+        return;
+    }
+
+    if (lwt <= metrics->baseline - c->defrost_drop)
+    {
+        metrics->defrost_start = t;
+        metrics->defrosts++;
+        b->defrosts++;
+        return;
+    }
+
+    // Exponential moving average with time constant baseline_s, for any poll interval
+    metrics->baseline += (lwt - metrics->baseline) * (float)dt / (float)(c->baseline_s + dt);
+}
+
+void daikin_metrics_init(daikin_metrics_t* const metrics, const daikin_metrics_config_t* const config)
+{
+    LIBDAIKIN_ASSERT(metrics != NULL);
+
+    if (metrics == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument metrics.\n");
+        return;
+    }
+
+    memset(metrics, 0, sizeof(daikin_metrics_t));
+    if (config != NULL)
+        metrics->config = *config;
+
+    daikin_metrics_config_t* const c = &metrics->config;
+    c->window_s = c->window_s > 0 ? c->window_s : DAIKIN_METRICS_WINDOW_S;
+    c->window_s = c->window_s < DAIKIN_METRICS_BUCKETS ? DAIKIN_METRICS_BUCKETS : c->window_s;
+    c->hdh_base = c->hdh_base != 0.0f ? c->hdh_base : DAIKIN_METRICS_HDH_BASE;
+    c->max_gap_s = c->max_gap_s > 0 ? c->max_gap_s : DAIKIN_METRICS_MAX_GAP_S;
+    c->defrost_drop = c->defrost_drop > 0.0f ? c->defrost_drop : DAIKIN_METRICS_DEFROST_DROP;
+    c->defrost_recover = c->defrost_recover > 0.0f ? c->defrost_recover : DAIKIN_METRICS_DEFROST_RECOVER;
+    c->defrost_recover = c->defrost_recover > c->defrost_drop ? c->defrost_drop : c->defrost_recover;
+    c->defrost_max_s = c->defrost_max_s > 0 ? c->defrost_max_s : DAIKIN_METRICS_DEFROST_MAX_S;
+    c->baseline_s = c->baseline_s > 0 ? c->baseline_s : DAIKIN_METRICS_BASELINE_S;
+
+    metrics->hdh_last = -1.0f;
+    metrics->delta_t = NAN;
+    metrics->baseline = NAN;
+    metrics->electric_meter = -1.0;
+    metrics->heat_meter = -1.0;
+}
+
+bool daikin_metrics_update(
+    daikin_metrics_t* const metrics,
+    uint32_t t,
+    const daikin_device_info_t* const info,
+    uint32_t fields)
+{
+    LIBDAIKIN_ASSERT(metrics != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (metrics == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument metrics or info.\n");
+        return false;
+    }
+
+    if (is_valid_time(metrics, t) == false)
+        return false; // No extra error info needed
+
+    daikin_metrics_bucket_t* const b = advance(metrics, t);
+
+    // Nothing is integrated over the first sample and over gaps
+    const uint32_t dt = metrics->t_last != 0 && t - metrics->t_last <= metrics->config.max_gap_s ? t - metrics->t_last : 0;
+    metrics->t_last = t;
+
+    if (has(fields, daikin_field_t::DF_INDOOR_TEMP) && has(fields, daikin_field_t::DF_LEAVING_WATER_TEMP))
+    {
+        const float delta_t = info->leaving_water_temp - info->indoor_temp;
+        b->delta_t_min = b->samples == 0 || delta_t < b->delta_t_min ? delta_t : b->delta_t_min;
+        b->delta_t_max = b->samples == 0 || delta_t > b->delta_t_max ? delta_t : b->delta_t_max;
+        b->delta_t_sum += delta_t;
+        b->samples++;
+        metrics->delta_t = delta_t;
+    }
+
+    if (has(fields, daikin_field_t::DF_OUTDOOR_TEMP))
+    {
+        const float below = metrics->config.hdh_base - info->outdoor_temp;
+        const float h = below > 0.0f ? below : 0.0f;
+
+        if (dt > 0 && metrics->hdh_last >= 0.0f)
+        {
+            const float degree_hours = (metrics->hdh_last + h) * 0.5f * (float)dt / SECONDS_PER_HOUR; // Trapezoid
+            b->degree_hours += degree_hours;
+            metrics->degree_hours += degree_hours;
+        }
+
+        metrics->hdh_last = h;
+    }
+    else
+        metrics->hdh_last = -1.0f;
+
+    if (has(fields, daikin_field_t::DF_LEAVING_WATER_TEMP) && has(fields, daikin_field_t::DF_POWER_STATE))
+        update_defrost(metrics, b, t, dt, info->leaving_water_temp, info->power_state == daikin_power_state_t::PS_ON);
+
+    return true;
+}
+
+bool daikin_metrics_energy(daikin_metrics_t* const metrics, uint32_t t, double electric_kwh, double heat_kwh)
+{
+    LIBDAIKIN_ASSERT(metrics != NULL);
+
+    if (metrics == NULL || electric_kwh < 0.0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument metrics or electric_kwh.\n");
+        return false;
+    }
+
+    // Not checked against t_last, readings a little older than the last sample go to the current bucket
+    daikin_metrics_bucket_t* const b = advance(metrics, t);
+
+    if (metrics->electric_meter >= 0.0 && electric_kwh >= metrics->electric_meter)
+        b->electric_kwh += (float)(electric_kwh - metrics->electric_meter);
+    metrics->electric_meter = electric_kwh;
+
+    if (heat_kwh >= 0.0 && metrics->heat_meter >= 0.0 && heat_kwh >= metrics->heat_meter)
+        b->heat_kwh += (float)(heat_kwh - metrics->heat_meter);
+    metrics->heat_meter = heat_kwh >= 0.0 ? heat_kwh : -1.0;
+
+    return true;
+}
+
+void daikin_metrics_get(const daikin_metrics_t* const metrics, daikin_metrics_values_t* const values)
+{
+    LIBDAIKIN_ASSERT(metrics != NULL);
+    LIBDAIKIN_ASSERT(values != NULL);
+
+    if (metrics == NULL || values == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument metrics or values.\n");
+        return;
+    }
+
+    daikin_metrics_bucket_t w = metrics->completed;
+    add_bucket(&w, &metrics->buckets[metrics->current]);
+
+    values->delta_t = metrics->delta_t;
+    values->delta_t_avg = w.samples > 0 ? w.delta_t_sum / (float)w.samples : NAN;
+    values->delta_t_min = w.samples > 0 ? w.delta_t_min : NAN;
+    values->delta_t_max = w.samples > 0 ? w.delta_t_max : NAN;
+    values->samples = w.samples;
+    values->degree_hours = w.degree_hours;
+    values->degree_hours_total = metrics->degree_hours;
+    values->defrosts = w.defrosts;
+    values->defrosts_total = metrics->defrosts;
+    values->defrost_s = w.defrost_s;
+    values->defrost_last_s = metrics->defrost_last_s;
+    values->defrosting = metrics->defrost_start != 0;
+    values->cop = w.electric_kwh > 0.0f && metrics->heat_meter >= 0.0 ? w.heat_kwh / w.electric_kwh : NAN;
+}
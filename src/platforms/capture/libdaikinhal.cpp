@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "libdaikinhal.h"
+#include "../../../src/trace.h"
+#include "../../../src/websockets.h"
+
+#ifndef DAIKIN_HAL_CAPTURE_PLATFORM
+#   define DAIKIN_HAL_CAPTURE_PLATFORM "../linux/libdaikinhal.cpp"
+#endif
+
+// Wrapped platform HAL, its TCP functions are renamed
+#define daikin_hal_tcp_open     platform_tcp_open
+#define daikin_hal_tcp_read     platform_tcp_read
+#define daikin_hal_tcp_write    platform_tcp_write
+#define daikin_hal_tcp_close    platform_tcp_close
+#define daikin_hal_linux_fd     platform_linux_fd // Descriptor of the wrapped handle only
+#include DAIKIN_HAL_CAPTURE_PLATFORM
+#undef daikin_hal_tcp_open
+#undef daikin_hal_tcp_read
+#undef daikin_hal_tcp_write
+#undef daikin_hal_tcp_close
+#undef daikin_hal_linux_fd
+
+typedef std::chrono::steady_clock capture_clock_t;
+
+static const char CAPTURE_MAGIC[] = { 'D', 'K', 'C', 'A', 'P' };
+static const uint8_t CAPTURE_VERSION = 1;
+static const size_t CAPTURE_HEADER_LEN = sizeof(CAPTURE_MAGIC) + 3;
+
+static const size_t MAX_MESSAGE_TEXT = 4096;    // Request text searched for the rqi
+static const size_t MAX_SUBSTITUTIONS = 16;     // Recent ids mapped in replayed reads
+
+typedef enum
+{
+    CM_PASS,
+    CM_RECORD,
+    CM_REPLAY,
+} capture_mode_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint32_t conn;
+    uint64_t time_us;   // Since the start of the capture
+    size_t offset;      // Data in g_capture
+    uint32_t len;
+} replay_record_t;
+
+// Bytes written by a client (handshake, masked frames), reports the ids to map
+typedef struct
+{
+    bool upgraded;
+    std::string text;   // Handshake or payload of the current message
+    uint8_t hdr[14];
+    uint8_t hdr_len;
+    uint64_t remaining; // Payload bytes of the current frame
+    uint64_t offset;
+    std::deque<std::string> ids;
+} client_stream_t;
+
+typedef struct
+{
+    daikin_hal_tcp_t platform;
+    capture_mode_t mode;
+    uint32_t id;
+
+    // Replay
+    size_t cursor;
+    std::string pending; // Rest of the current read record
+    size_t pending_pos;
+    client_stream_t recorded;
+    client_stream_t live;
+    std::vector<std::pair<std::string, std::string>> substitutions;
+} capture_conn_t;
+
+static std::mutex g_lock;
+static capture_mode_t g_mode = CM_PASS;
+static uint32_t g_connections = 0;
+
+// Record
+static FILE* g_file = NULL;
+static capture_clock_t::time_point g_last;
+
+// Replay
+static std::string g_capture;
+static std::vector<replay_record_t> g_records;
+static float g_speed = 1.0f;
+static capture_clock_t::time_point g_anchor_time; // Replay time of the last consumed record
+static uint64_t g_anchor_us = 0;                   // Capture time of the last consumed record
+
+static capture_conn_t* conn_of(const daikin_hal_tcp_t* const tcp)
+{
+    return (capture_conn_t*)tcp->handle;
+}
+
+static void put_varint(std::string& out, uint64_t v)
+{
+    do
+    {
+        const uint8_t b = (uint8_t)(v & 0x7F);
+        v >>= 7;
+        out += (char)(v != 0 ? (b | 0x80) : b);
+    } while (v != 0);
+}
+
+static bool get_varint(const std::string& in, size_t& pos, uint64_t* const v)
+{
+    *v = 0;
+    for (uint8_t shift = 0; pos < in.length() && shift < 64; shift += 7)
+    {
+        const uint8_t b = (uint8_t)in[pos++];
+        *v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static void record(daikin_capture_record_t type, uint32_t conn, const char* const data, uint32_t len)
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+    if (g_file == NULL)
+        return; // Stopped meanwhile
+
+    const capture_clock_t::time_point now = capture_clock_t::now();
+    const uint64_t delta_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - g_last).count();
+    g_last = now;
+
+    std::string rec;
+    rec += (char)type;
+    put_varint(rec, conn);
+    put_varint(rec, delta_us);
+    put_varint(rec, len);
+    if (len > 0)
+        rec.append(data, len);
+
+    if (fwrite(rec.data(), 1, rec.length(), g_file) != rec.length())
+        LIBDAIKIN_ERROR("Capture write failed, record %d of connection %u lost.\n", (int)type, conn);
+}
+
+static void client_message_end(client_stream_t* const s)
+{
+    static const char RQI[] = "\"rqi\":\"";
+
+    const size_t b = s->text.find(RQI);
+    if (b != std::string::npos)
+    {
+        const size_t e = s->text.find('"', b + sizeof(RQI) - 1);
+        if (e != std::string::npos)
+            s->ids.push_back(s->text.substr(b + sizeof(RQI) - 2, e - b - sizeof(RQI) + 3)); // With quotes
+    }
+
+    s->text.clear();
+}
+
+static void client_handshake_end(client_stream_t* const s)
+{
+    static const char KEY[] = "Sec-WebSocket-Key:";
+
+    size_t b = s->text.find(KEY);
+    if (b != std::string::npos)
+    {
+        b += sizeof(KEY) - 1;
+        while (b < s->text.length() && s->text[b] == ' ')
+            b++;
+        const size_t e = s->text.find("\r\n", b);
+        s->ids.push_back(ws_create_accept_hash(s->text.substr(b, e - b)));
+    }
+
+    s->upgraded = true;
+    s->text.clear();
+}
+
+static void client_feed(client_stream_t* const s, const char* const data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        const char c = data[i];
+        if (s->upgraded == false)
+        {
+            s->text += c;
+            if (s->text.length() >= 4 && s->text.compare(s->text.length() - 4, 4, "\r\n\r\n") == 0)
+                client_handshake_end(s);
+            continue;
+        }
+
+        if (s->remaining == 0)
+        {
+            // Header, client frames are always masked
+            s->hdr[s->hdr_len++] = (uint8_t)c;
+            const uint8_t len7 = s->hdr_len > 1 ? (s->hdr[1] & 0x7F) : 0;
+            const uint8_t ext_len = len7 == 126 ? 2 : (len7 == 127 ? 8 : 0);
+            if (s->hdr_len < 2 || s->hdr_len < 2 + ext_len + 4)
+                continue;
+
+            uint64_t payload_len = len7;
+            if (ext_len > 0)
+            {
+                payload_len = 0;
+                for (uint8_t b = 0; b < ext_len; b++)
+                    payload_len = (payload_len << 8) | s->hdr[2 + b];
+            }
+
+            s->remaining = payload_len;
+            s->offset = 0;
+            if (payload_len == 0 && (s->hdr[0] & 0x80) != 0 && (s->hdr[0] & 0x08) == 0)
+                client_message_end(s);
+            s->hdr_len = payload_len == 0 ? 0 : s->hdr_len;
+            continue;
+        }
+
+        // Control frames may arrive between fragments, only data frames are collected
+        const uint8_t* const mask = &s->hdr[s->hdr_len - 4];
+        if ((s->hdr[0] & 0x08) == 0 && s->text.length() < MAX_MESSAGE_TEXT)
+            s->text += (char)(c ^ mask[s->offset % 4]);
+        s->offset++;
+
+        if (--s->remaining == 0)
+        {
+            if ((s->hdr[0] & 0x80) != 0 && (s->hdr[0] & 0x08) == 0)
+                client_message_end(s);
+            s->hdr_len = 0;
+        }
+    }
+}
+
+// Recorded and live ids reported in the same order are the same thing
+static void map_ids(capture_conn_t* const c)
+{
+    while (c->recorded.ids.size() > 0 && c->live.ids.size() > 0)
+    {
+        if (c->recorded.ids.front() != c->live.ids.front())
+            c->substitutions.push_back(std::make_pair(c->recorded.ids.front(), c->live.ids.front()));
+        c->recorded.ids.pop_front();
+        c->live.ids.pop_front();
+    }
+
+    if (c->substitutions.size() > MAX_SUBSTITUTIONS)
+        c->substitutions.erase(c->substitutions.begin(), c->substitutions.end() - MAX_SUBSTITUTIONS);
+}
+
+static std::string substitute(const capture_conn_t* const c, std::string data)
+{
+    for (const auto& s : c->substitutions)
+    {
+        for (size_t p = data.find(s.first); p != std::string::npos; p = data.find(s.first, p + s.second.length()))
+            data.replace(p, s.first.length(), s.second);
+    }
+
+    return data;
+}
+
+static const replay_record_t* next_record(const capture_conn_t* const c)
+{
+    for (size_t i = c->cursor; i < g_records.size(); i++)
+    {
+        if (g_records[i].conn == c->id)
+            return &g_records[i];
+    }
+
+    return NULL;
+}
+
+// Delay of the record after the previous one, scaled by the speed
+static void replay_wait(const replay_record_t* const r, std::unique_lock<std::mutex>& lock)
+{
+    if (g_speed > 0.0f && r->time_us > g_anchor_us)
+    {
+        const capture_clock_t::time_point target = g_anchor_time +
+            std::chrono::microseconds((uint64_t)((double)(r->time_us - g_anchor_us) / g_speed));
+
+        lock.unlock(); // Other connections go on meanwhile
+        std::this_thread::sleep_until(target);
+        lock.lock();
+    }
+
+    g_anchor_time = capture_clock_t::now();
+    g_anchor_us = r->time_us;
+}
+
+static bool replay_open(capture_conn_t* const c, std::unique_lock<std::mutex>& lock)
+{
+    c->id = ++g_connections;
+    c->cursor = 0;
+
+    const replay_record_t* const r = next_record(c);
+    if (r == NULL || (r->type != CR_OPEN && r->type != CR_OPEN_FAILED))
+    {
+        LIBDAIKIN_ERROR("Capture has no connection %u.\n", c->id);
+        return false;
+    }
+
+    c->cursor = (size_t)(r - &g_records[0]) + 1;
+    replay_wait(r, lock);
+    return r->type == CR_OPEN;
+}
+
+static int32_t replay_read(capture_conn_t* const c, char* const data, uint16_t len)
+{
+    std::unique_lock<std::mutex> lock(g_lock);
+
+    while (c->pending_pos >= c->pending.length())
+    {
+        const replay_record_t* const r = next_record(c);
+        if (r == NULL || r->type == CR_CLOSE)
+        {
+            LIBDAIKIN_ERROR("Capture of connection %u has no more reads.\n", c->id);
+            return -1;
+        }
+
+        c->cursor = (size_t)(r - &g_records[0]) + 1;
+
+        // Written by the recorded client without a live write
+        if (r->type == CR_WRITE)
+        {
+            client_feed(&c->recorded, &g_capture[r->offset], r->len);
+            map_ids(c);
+            continue;
+        }
+
+        if (r->type != CR_READ && r->type != CR_READ_FAILED)
+            continue;
+
+        replay_wait(r, lock);
+        if (r->type == CR_READ_FAILED)
+            return -1;
+        if (r->len == 0)
+            return 0; // Closed by the peer
+
+        c->pending = substitute(c, g_capture.substr(r->offset, r->len));
+        c->pending_pos = 0;
+    }
+
+    const size_t n = c->pending.length() - c->pending_pos < len ? c->pending.length() - c->pending_pos : len;
+    memcpy(data, &c->pending[c->pending_pos], n);
+    c->pending_pos += n;
+    return (int32_t)n;
+}
+
+static int32_t replay_write(capture_conn_t* const c, const char* const data, uint16_t len)
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+
+    bool failed = false;
+    const replay_record_t* const r = next_record(c);
+    if (r != NULL && (r->type == CR_WRITE || r->type == CR_WRITE_FAILED))
+    {
+        c->cursor = (size_t)(r - &g_records[0]) + 1;
+        g_anchor_time = capture_clock_t::now();
+        g_anchor_us = r->time_us;
+
+        if (r->type == CR_WRITE)
+            client_feed(&c->recorded, &g_capture[r->offset], r->len);
+        failed = r->type == CR_WRITE_FAILED;
+    }
+
+    client_feed(&c->live, data, len);
+    map_ids(c);
+    return failed ? -1 : (int32_t)len;
+}
+
+static void capture_stop()
+{
+    if (g_file != NULL)
+        fclose(g_file);
+    g_file = NULL;
+
+    g_capture.clear();
+    g_records.clear();
+    g_mode = CM_PASS;
+}
+
+static bool load_capture(const char* const path)
+{
+    FILE* const f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        LIBDAIKIN_ERROR("Unable to open capture '%s'.\n", path);
+        return false;
+    }
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        g_capture.append(buf, n);
+    fclose(f);
+
+    if (g_capture.length() < CAPTURE_HEADER_LEN ||
+        memcmp(g_capture.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        (uint8_t)g_capture[sizeof(CAPTURE_MAGIC)] != CAPTURE_VERSION)
+    {
+        LIBDAIKIN_ERROR("'%s' is not a capture of version %u.\n", path, CAPTURE_VERSION);
+        return false;
+    }
+
+    uint64_t time_us = 0;
+    size_t pos = CAPTURE_HEADER_LEN;
+    while (pos < g_capture.length())
+    {
+        replay_record_t r;
+        uint64_t conn, delta_us, len;
+        r.type = (uint8_t)g_capture[pos++];
+        if (get_varint(g_capture, pos, &conn) == false || get_varint(g_capture, pos, &delta_us) == false ||
+            get_varint(g_capture, pos, &len) == false || len > g_capture.length() - pos ||
+            r.type < CR_OPEN || r.type > CR_CLOSE)
+        {
+            LIBDAIKIN_ERROR("Capture '%s' is corrupted at offset %u.\n", path, (uint32_t)pos);
+            return false;
+        }
+
+        time_us += delta_us;
+        r.conn = (uint32_t)conn;
+        r.time_us = time_us;
+        r.offset = pos;
+        r.len = (uint32_t)len;
+        g_records.push_back(r);
+        pos += (size_t)len;
+    }
+
+    return true;
+}
+
+bool daikin_hal_capture_record(const char* const path)
+{
+    LIBDAIKIN_ASSERT(path != NULL);
+
+    if (path == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument path.\n");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_lock);
+    capture_stop();
+
+    g_file = fopen(path, "wb");
+    if (g_file == NULL)
+    {
+        LIBDAIKIN_ERROR("Unable to create capture '%s'.\n", path);
+        return false;
+    }
+
+    char header[CAPTURE_HEADER_LEN] = { 0 };
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header[sizeof(CAPTURE_MAGIC)] = (char)CAPTURE_VERSION;
+    if (fwrite(header, 1, sizeof(header), g_file) != sizeof(header))
+    {
+        LIBDAIKIN_ERROR("Unable to write capture '%s'.\n", path);
+        capture_stop();
+        return false;
+    }
+
+    g_mode = CM_RECORD;
+    g_connections = 0;
+    g_last = capture_clock_t::now();
+    return true;
+}
+
+bool daikin_hal_capture_replay(const char* const path, float speed)
+{
+    LIBDAIKIN_ASSERT(path != NULL);
+    LIBDAIKIN_ASSERT(speed >= 0.0f);
+
+    if (path == NULL || speed < 0.0f)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument path or speed.\n");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_lock);
+    capture_stop();
+
+    if (load_capture(path) == false)
+    {
+        capture_stop();
+        return false; // No extra error info needed
+    }
+
+    g_mode = CM_REPLAY;
+    g_connections = 0;
+    g_speed = speed;
+    g_anchor_time = capture_clock_t::now();
+    g_anchor_us = 0;
+    return true;
+}
+
+void daikin_hal_capture_stop(void)
+{
+    std::lock_guard<std::mutex> lock(g_lock);
+    capture_stop();
+}
+
+bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    daikin_hal_tcp_close(tcp); // Reopen without a close
+
+    capture_conn_t* const c = new capture_conn_t();
+    c->platform.remote_ip = tcp->remote_ip;
+    c->platform.remote_port = tcp->remote_port;
+    c->platform.timeout_ms = tcp->timeout_ms;
+    tcp->handle = c;
+
+    std::unique_lock<std::mutex> lock(g_lock);
+    c->mode = g_mode;
+    if (c->mode == CM_REPLAY)
+        return replay_open(c, lock);
+    if (c->mode == CM_RECORD)
+        c->id = ++g_connections;
+    lock.unlock();
+
+    const bool ok = platform_tcp_open(&c->platform);
+    if (c->mode == CM_RECORD)
+    {
+        const std::string address = std::string(DAIKIN_HAL_REMOTE_IP(tcp)) + ":" +
+            std::to_string(DAIKIN_HAL_REMOTE_PORT(tcp));
+        record(ok ? CR_OPEN : CR_OPEN_FAILED, c->id, address.data(), (uint32_t)address.length());
+    }
+
+    return ok;
+}
+
+int32_t daikin_hal_tcp_read(
+    const daikin_hal_tcp_t* const tcp,
+    char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    capture_conn_t* const c = conn_of(tcp);
+    if (c == NULL)
+    {
+        LIBDAIKIN_ERROR("Connection is not open.\n");
+        return -1;
+    }
+
+    if (c->mode == CM_REPLAY)
+        return replay_read(c, data, len);
+
+    // Copied per call, a cancel during a blocked call is noticed at the deadline only
+    c->platform.deadline_ms = tcp->deadline_ms;
+    DAIKIN_HAL_SET_CANCEL(&c->platform, DAIKIN_HAL_CANCELLED(tcp));
+    const int32_t ret = platform_tcp_read(&c->platform, data, len);
+    if (c->mode == CM_RECORD)
+        record(ret < 0 ? CR_READ_FAILED : CR_READ, c->id, data, ret < 0 ? 0 : (uint32_t)ret);
+
+    return ret;
+}
+
+int32_t daikin_hal_tcp_write(
+    const daikin_hal_tcp_t* const tcp,
+    const char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    capture_conn_t* const c = conn_of(tcp);
+    if (c == NULL)
+    {
+        LIBDAIKIN_ERROR("Connection is not open.\n");
+        return -1;
+    }
+
+    if (c->mode == CM_REPLAY)
+        return replay_write(c, data, len);
+
+    c->platform.deadline_ms = tcp->deadline_ms;
+    DAIKIN_HAL_SET_CANCEL(&c->platform, DAIKIN_HAL_CANCELLED(tcp));
+    const int32_t ret = platform_tcp_write(&c->platform, data, len);
+    if (c->mode == CM_RECORD)
+        record(ret < 0 ? CR_WRITE_FAILED : CR_WRITE, c->id, data, ret < 0 ? 0 : (uint32_t)ret);
+
+    return ret;
+}
+
+void daikin_hal_tcp_close(
+    daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    capture_conn_t* const c = conn_of(tcp);
+    if (c == NULL)
+        return;
+
+    if (c->mode != CM_REPLAY)
+        platform_tcp_close(&c->platform);
+    if (c->mode == CM_RECORD)
+    {
+        record(CR_CLOSE, c->id, NULL, 0);
+
+        std::lock_guard<std::mutex> lock(g_lock);
+        if (g_file != NULL)
+            fflush(g_file); // Capture is complete up to here
+    }
+
+    delete c;
+    tcp->handle = NULL;
+}
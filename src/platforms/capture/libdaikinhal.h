@@ -0,0 +1,57 @@
+#ifndef __LIB_DAIKIN_HAL_CAPTURE_H__
+#define __LIB_DAIKIN_HAL_CAPTURE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../../include/libdaikinhal.h"
+
+// Record/replay decorator of a platform HAL (host builds).
+//
+// Compiled instead of the platform HAL, the wrapped one is included from
+// DAIKIN_HAL_CAPTURE_PLATFORM (default: the Linux HAL). Without a capture it
+// passes everything through. Time and sleep functions are never captured.
+//
+// Capture file, integers little endian, varint = unsigned LEB128:
+//   header  "DKCAP" u8 version u16 reserved
+//   record  u8 type, varint connection, varint us since the previous record, varint len, len bytes
+// Connections are numbered from 1 in the order they are opened.
+//
+// Replay hands the recorded reads back, writes are consumed without checking
+// the data. Handshake key and request ids are random per run, the recorded
+// ones are mapped to the live ones in replayed reads.
+//
+// Request ids are found in the plain text of frames, so the mapping doesn't work
+// for sessions with permessage-deflate (daikin_t.ws_deflate): their compressed
+// requests and responses keep the recorded ids and replayed requests fail the rqi check.
+// Record with ws_deflate off for replays.
+
+typedef enum
+{
+    CR_OPEN = 1,        // Data is "ip:port"
+    CR_OPEN_FAILED,
+    CR_WRITE,           // Bytes accepted by the platform
+    CR_WRITE_FAILED,
+    CR_READ,            // Bytes returned by the platform, 0 => closed by the peer
+    CR_READ_FAILED,
+    CR_CLOSE,
+} daikin_capture_record_t;
+
+// Following connections are recorded to path (truncated)
+bool daikin_hal_capture_record(const char* const path);
+
+// Following connections replay path, speed 1 => recorded delays, 10 => ten times faster, 0 => no delays
+bool daikin_hal_capture_replay(const char* const path, float speed);
+
+// Back to pass through, closes the capture
+void daikin_hal_capture_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
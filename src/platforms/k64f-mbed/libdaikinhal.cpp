@@ -15,7 +15,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
     LIBDAIKIN_ASSERT(tcp != NULL);
 
     tcp->handle = INVALID_SOCKET;
-    const uint16_t remote_port = DAIKIN_REMOTE_PORT;
+    const uint16_t remote_port = DAIKIN_HAL_REMOTE_PORT(tcp);
 
     nsapi_error_t ret = socket.open(net);
     if (ret != NSAPI_ERROR_OK)
@@ -34,7 +34,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
         return false;
     }
 
-    SocketAddress remote_ip(DAIKIN_REMOTE_IP);
+    SocketAddress remote_ip(DAIKIN_HAL_REMOTE_IP(tcp));
     remote_ip.set_port(remote_port);
 
     LIBDAIKIN_TRACE("CONNECTING %s:%u.\n", remote_ip.get_ip_address(), remote_ip.get_port());
@@ -60,6 +60,13 @@ int32_t daikin_hal_tcp_read(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    // Checked before the call only, a blocked one can't be interrupted
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("recv %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
     nsapi_size_or_error_t ret = socket.recv((void*)data, (nsapi_size_t)len);
     if (ret > 0)
         return (int32_t)ret;
@@ -77,6 +84,12 @@ int32_t daikin_hal_tcp_write(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("send %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
     nsapi_size_or_error_t ret = socket.send((const void*)data, (nsapi_size_t)len);
     if (ret > 0)
         return (int32_t)ret;
@@ -106,3 +119,13 @@ void daikin_hal_tcp_close(
         tcp->handle = INVALID_SOCKET;
     }
 }
+
+uint32_t daikin_hal_time_ms(void)
+{
+    return (uint32_t)Kernel::get_ms_count();
+}
+
+void daikin_hal_sleep_ms(uint32_t ms)
+{
+    thread_sleep_for(ms);
+}
@@ -0,0 +1,781 @@
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "libdaikinhal.h"
+#include "../../../src/trace.h"
+
+static_assert((DAIKIN_URING_BUFFERS & (DAIKIN_URING_BUFFERS - 1)) == 0, "DAIKIN_URING_BUFFERS must be a power of 2");
+
+#define INVALID_SOCKET (-1)
+
+static const uint16_t BUFFER_GROUP = 0;
+static const size_t PAGE_LEN = 4096;
+
+// user_data: connection slot << 8 | operation
+static const uint8_t UD_RECV = 1;
+static const uint8_t UD_SEND = 2;
+static const uint8_t UD_CANCEL = 3;
+static const uint8_t UD_BUFFERS = 4;
+
+struct uring_s;
+
+typedef struct
+{
+    struct uring_s* ring;
+    uint16_t slot;
+    bool used;
+    int fd;
+
+    bool recv_armed;        // Multishot receive can still complete
+    bool closing;
+    bool eof;
+    int32_t error;          // First failure (-errno), reported by the next call
+
+    std::string rx;         // Received, not yet read
+    size_t rx_pos;
+
+    uint32_t tx_used;       // Buffered bytes in the registered write area
+    uint32_t tx_sent;       // Bytes completed or in flight
+    uint32_t tx_inflight;   // Length of the send in flight, 0 => none
+    bool dirty;             // In the list of connections with bytes to send
+} uring_conn_t;
+
+typedef struct uring_s
+{
+    int fd;
+
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_array;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sq_local_tail; // Prepared, published on enter
+    uint32_t sq_pending;
+    struct io_uring_sqe* sqes;
+
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* ring_ptr;
+    size_t ring_len;
+    void* sqes_ptr;
+    size_t sqes_len;
+
+    char* buffers;          // Provided to the kernel, DAIKIN_URING_BUFFER_LEN each
+    char* tx;               // Registered, DAIKIN_URING_TX_LEN per connection
+    bool tx_fixed;          // Sends use the registration, cleared when the kernel refuses it
+
+    uring_conn_t conns[DAIKIN_URING_MAX_CONNECTIONS];
+    std::vector<uint16_t> dirty;
+
+    daikin_hal_uring_stats_t stats;
+} uring_t;
+
+static void ring_destroy(uring_t* const r);
+
+// Ring of the thread, released with the thread
+struct uring_holder_t
+{
+    uring_t* ring = NULL;
+    bool failed = false;
+    ~uring_holder_t() { ring_destroy(ring); }
+};
+
+static thread_local uring_holder_t t_ring;
+
+static uint64_t user_data(uint16_t slot, uint8_t op)
+{
+    return ((uint64_t)slot << 8) | op;
+}
+
+static void ring_destroy(uring_t* const r)
+{
+    if (r == NULL)
+        return;
+
+    if (r->fd >= 0)
+        close(r->fd); // Unregisters the buffers
+    if (r->ring_ptr != NULL && r->ring_ptr != MAP_FAILED)
+        munmap(r->ring_ptr, r->ring_len);
+    if (r->sqes_ptr != NULL && r->sqes_ptr != MAP_FAILED)
+        munmap(r->sqes_ptr, r->sqes_len);
+    free(r->buffers);
+    free(r->tx);
+    delete r;
+}
+
+static bool ring_setup(uring_t* const r)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+
+    const uint32_t entries = 2 * DAIKIN_URING_MAX_CONNECTIONS;
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0 && errno == EINVAL)
+    {
+        // Older kernel without the flags
+        memset(&p, 0, sizeof(p));
+        r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    }
+
+    if (r->fd < 0)
+    {
+        LIBDAIKIN_ERROR("io_uring_setup error: %d.\n", errno);
+        return false;
+    }
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        LIBDAIKIN_ERROR("io_uring of this kernel is too old.\n");
+        return false;
+    }
+
+    const size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    const size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->ring_len = sq_len > cq_len ? sq_len : cq_len;
+    r->ring_ptr = mmap(NULL, r->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes_ptr = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->ring_ptr == MAP_FAILED || r->sqes_ptr == MAP_FAILED)
+    {
+        LIBDAIKIN_ERROR("io_uring mmap error: %d.\n", errno);
+        return false;
+    }
+
+    char* const ring = (char*)r->ring_ptr;
+    r->sq_head = (uint32_t*)(ring + p.sq_off.head);
+    r->sq_tail = (uint32_t*)(ring + p.sq_off.tail);
+    r->sq_array = (uint32_t*)(ring + p.sq_off.array);
+    r->sq_mask = *(uint32_t*)(ring + p.sq_off.ring_mask);
+    r->sq_entries = p.sq_entries;
+    r->sq_local_tail = *r->sq_tail;
+    r->sqes = (struct io_uring_sqe*)r->sqes_ptr;
+    r->cq_head = (uint32_t*)(ring + p.cq_off.head);
+    r->cq_tail = (uint32_t*)(ring + p.cq_off.tail);
+    r->cq_mask = *(uint32_t*)(ring + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(ring + p.cq_off.cqes);
+
+    // Receive buffers are shared by the connections, memory doesn't grow with them
+    r->buffers = (char*)aligned_alloc(PAGE_LEN, (size_t)DAIKIN_URING_BUFFERS * DAIKIN_URING_BUFFER_LEN);
+    r->tx = (char*)aligned_alloc(PAGE_LEN, (size_t)DAIKIN_URING_MAX_CONNECTIONS * DAIKIN_URING_TX_LEN);
+    if (r->buffers == NULL || r->tx == NULL)
+    {
+        LIBDAIKIN_ERROR("Out of memory for io_uring buffers.\n");
+        return false;
+    }
+
+    struct iovec tx = { r->tx, (size_t)DAIKIN_URING_MAX_CONNECTIONS * DAIKIN_URING_TX_LEN };
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, &tx, 1) != 0)
+    {
+        LIBDAIKIN_ERROR("io_uring register buffers error: %d.\n", errno);
+        return false;
+    }
+
+    r->tx_fixed = true;
+    for (uint16_t i = 0; i < DAIKIN_URING_MAX_CONNECTIONS; i++)
+    {
+        r->conns[i].ring = r;
+        r->conns[i].slot = i;
+        r->conns[i].fd = INVALID_SOCKET;
+    }
+
+    return true;
+}
+
+// Submits prepared requests, wait => until at least one completion is there
+// or wait_ms passed (UINT32_MAX => no limit)
+static bool ring_enter(uring_t* const r, bool wait, uint32_t wait_ms)
+{
+    __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts = { (int64_t)(wait_ms / 1000), (long long)(wait_ms % 1000) * 1000000 };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+    const bool timed = wait && wait_ms != UINT32_MAX;
+
+    int ret;
+    do
+    {
+        ret = (int)syscall(__NR_io_uring_enter, r->fd, r->sq_pending, wait ? 1 : 0,
+            (wait ? IORING_ENTER_GETEVENTS : 0) | (timed ? IORING_ENTER_EXT_ARG : 0),
+            timed ? &arg : NULL, timed ? sizeof(arg) : 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0 && errno == ETIME)
+        ret = 0; // Nothing submitted and nothing completed within wait_ms
+
+    if (ret < 0)
+    {
+        LIBDAIKIN_ERROR("io_uring_enter error: %d.\n", errno);
+        return false;
+    }
+
+    r->stats.enters++;
+    r->stats.sqes += (uint64_t)ret;
+    r->sq_pending -= (uint32_t)ret;
+    return true;
+}
+
+static struct io_uring_sqe* get_sqe(uring_t* const r)
+{
+    if (r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries &&
+        ring_enter(r, false, 0) == false)
+        return NULL; // No extra error info needed
+
+    const uint32_t idx = r->sq_local_tail & r->sq_mask;
+    struct io_uring_sqe* const sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    r->sq_local_tail++;
+    r->sq_pending++;
+    return sqe;
+}
+
+// Hands buffers (back) to the kernel. A registered buffer ring would spare the requests,
+// but its buffers aren't picked up by every kernel, classic provided buffers are.
+static bool provide_buffers(uring_t* const r, uint16_t bid, uint16_t count)
+{
+    struct io_uring_sqe* const sqe = get_sqe(r);
+    if (sqe == NULL)
+        return false; // No extra error info needed
+
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = count;
+    sqe->addr = (uint64_t)(uintptr_t)(r->buffers + (size_t)bid * DAIKIN_URING_BUFFER_LEN);
+    sqe->len = DAIKIN_URING_BUFFER_LEN;
+    sqe->off = bid;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = user_data(0, UD_BUFFERS);
+    return true;
+}
+
+static uring_t* ring_of_thread()
+{
+    if (t_ring.ring != NULL || t_ring.failed)
+        return t_ring.ring;
+
+    uring_t* const r = new uring_t();
+    r->fd = -1;
+    if (ring_setup(r) == false)
+    {
+        ring_destroy(r);
+        t_ring.failed = true; // Not retried for every open
+        return NULL;
+    }
+
+    // Submitted with the first wait, before the first receive
+    if (provide_buffers(r, 0, DAIKIN_URING_BUFFERS) == false)
+    {
+        ring_destroy(r);
+        t_ring.failed = true;
+        return NULL;
+    }
+
+    t_ring.ring = r;
+    return r;
+}
+
+static bool arm_recv(uring_t* const r, uring_conn_t* const c)
+{
+    struct io_uring_sqe* const sqe = get_sqe(r);
+    if (sqe == NULL)
+        return false; // No extra error info needed
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = user_data(c->slot, UD_RECV);
+    c->recv_armed = true;
+    return true;
+}
+
+static void mark_dirty(uring_t* const r, uring_conn_t* const c)
+{
+    if (c->dirty == false)
+    {
+        c->dirty = true;
+        r->dirty.push_back(c->slot);
+    }
+}
+
+// One send per connection in flight, keeps the order of its writes
+static void prepare_sends(uring_t* const r)
+{
+    size_t keep = 0;
+    for (size_t i = 0; i < r->dirty.size(); i++)
+    {
+        uring_conn_t* const c = &r->conns[r->dirty[i]];
+        if (c->used == false || c->error != 0 || c->tx_used == c->tx_sent)
+        {
+            c->dirty = false;
+            continue;
+        }
+
+        struct io_uring_sqe* sqe;
+        if (c->tx_inflight > 0 || (sqe = get_sqe(r)) == NULL)
+        {
+            r->dirty[keep++] = c->slot; // Next time
+            continue;
+        }
+
+        c->tx_inflight = c->tx_used - c->tx_sent;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = c->fd;
+        sqe->addr = (uint64_t)(uintptr_t)(r->tx + (size_t)c->slot * DAIKIN_URING_TX_LEN + c->tx_sent);
+        sqe->len = c->tx_inflight;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->ioprio = r->tx_fixed ? IORING_RECVSEND_FIXED_BUF : 0;
+        sqe->buf_index = 0;
+        sqe->user_data = user_data(c->slot, UD_SEND);
+        c->dirty = false;
+    }
+
+    r->dirty.resize(keep);
+}
+
+static void complete(uring_t* const r, const struct io_uring_cqe* const cqe)
+{
+    uring_conn_t* const c = &r->conns[(cqe->user_data >> 8) % DAIKIN_URING_MAX_CONNECTIONS];
+
+    switch ((uint8_t)cqe->user_data)
+    {
+    case UD_RECV:
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            const uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (cqe->res > 0 && c->closing == false)
+                c->rx.append(r->buffers + (size_t)bid * DAIKIN_URING_BUFFER_LEN, (size_t)cqe->res);
+            if (provide_buffers(r, bid, 1) == false && c->error == 0)
+                c->error = -ENOBUFS;
+        }
+
+        if (cqe->res == 0)
+            c->eof = true;
+        else if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED && c->error == 0)
+            c->error = cqe->res;
+
+        // Ends after an error, EOF or when the buffers ran out
+        if ((cqe->flags & IORING_CQE_F_MORE) == 0)
+        {
+            c->recv_armed = false;
+            if (c->closing == false && c->eof == false && c->error == 0)
+                arm_recv(r, c);
+        }
+        break;
+
+    case UD_SEND:
+        if (cqe->res == -EINVAL && r->tx_fixed)
+        {
+            // Registered buffers for plain sends need a newer kernel, send again without
+            LIBDAIKIN_INFO("io_uring sends without registered buffers.\n");
+            r->tx_fixed = false;
+            c->tx_inflight = 0;
+            mark_dirty(r, c);
+            break;
+        }
+
+        if (cqe->res <= 0 && c->error == 0)
+            c->error = cqe->res < 0 ? cqe->res : -EPIPE;
+
+        // A short write (full socket buffer) sends the rest next time
+        c->tx_sent += cqe->res > 0 ? (uint32_t)cqe->res : c->tx_inflight;
+        c->tx_inflight = 0;
+        if (c->tx_sent >= c->tx_used)
+            c->tx_sent = c->tx_used = 0;
+        else
+            mark_dirty(r, c);
+        break;
+
+    case UD_BUFFERS:
+        LIBDAIKIN_ERROR("io_uring provide buffers error: %d.\n", -cqe->res); // Only failures complete
+        break;
+
+    default:
+        break; // Cancel
+    }
+}
+
+static void reap(uring_t* const r)
+{
+    uint32_t head = *r->cq_head;
+    const uint32_t tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        complete(r, &r->cqes[head & r->cq_mask]);
+        r->stats.cqes++;
+    }
+
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static bool submit_and_wait(uring_t* const r, uint32_t wait_ms)
+{
+    prepare_sends(r);
+    if (ring_enter(r, true, wait_ms) == false)
+        return false; // No extra error info needed
+
+    reap(r);
+    return true;
+}
+
+// Next wait of a call which started at start_ms, at most DAIKIN_HAL_CANCEL_CHECK ms long.
+// false => timeout, deadline passed or cancelled.
+static bool wait_slice(const daikin_hal_tcp_t* const tcp, uint32_t start_ms, const char* const call, uint32_t* const wait_ms)
+{
+    const uint32_t remaining_ms = daikin_hal_tcp_remaining_ms(tcp);
+    if (remaining_ms == 0)
+    {
+        LIBDAIKIN_ERROR("%s %s.\n", call, DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return false;
+    }
+
+    const uint32_t timeout_ms = DAIKIN_HAL_TIMEOUT_MS(tcp);
+    const uint32_t elapsed_ms = daikin_hal_time_ms() - start_ms;
+    if (timeout_ms > 0 && elapsed_ms >= timeout_ms)
+    {
+        LIBDAIKIN_ERROR("%s timeout after %u ms.\n", call, timeout_ms);
+        return false;
+    }
+
+    *wait_ms = remaining_ms < DAIKIN_HAL_CANCEL_CHECK ? remaining_ms : DAIKIN_HAL_CANCEL_CHECK;
+    if (timeout_ms > 0 && timeout_ms - elapsed_ms < *wait_ms)
+        *wait_ms = timeout_ms - elapsed_ms;
+    return true;
+}
+
+// Non-blocking connect of s, bounded like reads: an unreachable adapter fails after timeout_ms
+// or at the deadline, not after the SYN retries of the kernel (about 2 minutes).
+// Returns 0 or the error.
+static int connect_bounded(const daikin_hal_tcp_t* const tcp, int s, const struct sockaddr_in* const remote)
+{
+    const int flags = fcntl(s, F_GETFL);
+    if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) != 0)
+        return errno;
+
+    int err = connect(s, (const struct sockaddr*)remote, sizeof(*remote)) == 0 ? 0 : errno;
+    const uint32_t start_ms = daikin_hal_time_ms();
+    while (err == EINPROGRESS)
+    {
+        uint32_t wait_ms;
+        if (wait_slice(tcp, start_ms, "connect", &wait_ms) == false)
+            return ETIMEDOUT;
+
+        struct pollfd p = { s, POLLOUT, 0 };
+        const int ret = poll(&p, 1, (int)wait_ms);
+        if (ret < 0 && errno != EINTR)
+            return errno;
+
+        socklen_t err_len = sizeof(err);
+        if (ret > 0 && getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0)
+            return errno;
+    }
+
+    // Blocking again, io_uring would hand out EAGAIN for non-blocking sockets
+    if (err == 0 && fcntl(s, F_SETFL, flags) != 0)
+        return errno;
+
+    return err;
+}
+
+// Until the buffered writes of c are sent
+static bool drain_tx(uring_t* const r, uring_conn_t* const c, const daikin_hal_tcp_t* const tcp)
+{
+    const uint32_t start_ms = daikin_hal_time_ms();
+
+    while ((c->tx_used > 0 && c->error == 0) || c->tx_inflight > 0)
+    {
+        uint32_t wait_ms;
+        if (wait_slice(tcp, start_ms, "send", &wait_ms) == false ||
+            submit_and_wait(r, wait_ms) == false)
+            return false; // No extra error info needed
+    }
+
+    return c->error == 0;
+}
+
+static uring_conn_t* conn_of(const daikin_hal_tcp_t* const tcp)
+{
+    return (uring_conn_t*)tcp->handle;
+}
+
+bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    tcp->handle = NULL;
+    const uint16_t remote_port = DAIKIN_HAL_REMOTE_PORT(tcp);
+
+    uring_t* const r = ring_of_thread();
+    if (r == NULL)
+        return false; // No extra error info needed
+
+    uring_conn_t* c = NULL;
+    for (uint16_t i = 0; i < DAIKIN_URING_MAX_CONNECTIONS && c == NULL; i++)
+    {
+        if (r->conns[i].used == false && r->conns[i].recv_armed == false && r->conns[i].tx_inflight == 0)
+            c = &r->conns[i];
+    }
+
+    if (c == NULL)
+    {
+        LIBDAIKIN_ERROR("All %u connections of the ring are in use.\n", DAIKIN_URING_MAX_CONNECTIONS);
+        return false;
+    }
+
+    int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+    {
+        LIBDAIKIN_ERROR("socket error: %d.\n", errno);
+        return false;
+    }
+
+    // Header and payload go out in one send anyway, small requests shouldn't wait for ACKs
+    int nodelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    struct sockaddr_in remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(remote_port);
+    remote.sin_addr.s_addr = daikin_hal_tcp_IPv4(DAIKIN_HAL_REMOTE_IP(tcp));
+
+    const int err = connect_bounded(tcp, s, &remote);
+    if (err != 0)
+    {
+        LIBDAIKIN_ERROR("Unable to connect to %s:%u. Error: %d\n",
+            DAIKIN_HAL_REMOTE_IP(tcp), remote_port, err);
+        close(s);
+        return false;
+    }
+
+    c->used = true;
+    c->fd = s;
+    c->closing = false;
+    c->eof = false;
+    c->error = 0;
+    c->rx.clear();
+    c->rx_pos = 0;
+    c->tx_used = c->tx_sent = c->tx_inflight = 0;
+
+    // Submitted with the first wait
+    if (arm_recv(r, c) == false)
+    {
+        c->used = false;
+        close(s);
+        return false;
+    }
+
+    tcp->handle = c;
+    return true;
+}
+
+int32_t daikin_hal_tcp_read(
+    const daikin_hal_tcp_t* const tcp,
+    char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    uring_conn_t* const c = conn_of(tcp);
+    if (c == NULL || c->used == false)
+    {
+        LIBDAIKIN_ERROR("Connection is not open.\n");
+        return -1;
+    }
+
+    uring_t* const r = c->ring;
+    reap(r);
+
+    if (c->rx_pos < c->rx.length())
+        r->stats.ready_reads++;
+
+    const uint32_t start_ms = daikin_hal_time_ms();
+    while (c->rx_pos >= c->rx.length())
+    {
+        if (c->error != 0)
+        {
+            LIBDAIKIN_ERROR("recv socket error: %d.\n", -c->error);
+            return -1;
+        }
+
+        if (c->eof)
+            return 0;
+
+        c->rx.clear();
+        c->rx_pos = 0;
+
+        uint32_t wait_ms;
+        if (wait_slice(tcp, start_ms, "recv", &wait_ms) == false ||
+            submit_and_wait(r, wait_ms) == false)
+            return -1; // No extra error info needed
+    }
+
+    const size_t available = c->rx.length() - c->rx_pos;
+    const uint16_t n = (uint16_t)(available < len ? available : len);
+    memcpy(data, &c->rx[c->rx_pos], n);
+    c->rx_pos += n;
+    return (int32_t)n;
+}
+
+int32_t daikin_hal_tcp_write(
+    const daikin_hal_tcp_t* const tcp,
+    const char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    uring_conn_t* const c = conn_of(tcp);
+    if (c == NULL || c->used == false)
+    {
+        LIBDAIKIN_ERROR("Connection is not open.\n");
+        return -1;
+    }
+
+    // Buffered writes would go out with a later wait otherwise
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("send %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
+    uring_t* const r = c->ring;
+    char* const tx = r->tx + (size_t)c->slot * DAIKIN_URING_TX_LEN;
+
+    uint16_t done = 0;
+    while (done < len)
+    {
+        if (c->error != 0)
+        {
+            LIBDAIKIN_ERROR("send socket error: %d.\n", -c->error);
+            return -1;
+        }
+
+        const uint32_t free_len = DAIKIN_URING_TX_LEN - c->tx_used;
+        if (free_len == 0)
+        {
+            if (drain_tx(r, c, tcp) == false && c->error == 0)
+                return -1; // No extra error info needed
+            continue;
+        }
+
+        const uint32_t remaining = (uint32_t)(len - done);
+        const uint16_t n = (uint16_t)(remaining < free_len ? remaining : free_len);
+        memcpy(tx + c->tx_used, data + done, n);
+        c->tx_used += n;
+        done += n;
+        mark_dirty(r, c);
+    }
+
+    return (int32_t)len;
+}
+
+void daikin_hal_tcp_close(
+    daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    uring_conn_t* const c = conn_of(tcp);
+    if (c == NULL || c->used == false)
+        return;
+
+    uring_t* const r = c->ring;
+    drain_tx(r, c, tcp); // E.g. the close frame, gives up at the deadline
+
+    c->closing = true;
+    if (c->recv_armed)
+    {
+        struct io_uring_sqe* const sqe = get_sqe(r);
+        if (sqe != NULL)
+        {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = user_data(c->slot, UD_RECV);
+            sqe->user_data = user_data(c->slot, UD_CANCEL);
+        }
+
+        // The slot is reused only after the last completion of the receive
+        while (c->recv_armed && submit_and_wait(r, UINT32_MAX))
+            ;
+    }
+
+    if (shutdown(c->fd, SHUT_WR) != 0 && errno != ENOTCONN)
+        LIBDAIKIN_ERROR("shutdown socket error: %d.\n", errno);
+    if (close(c->fd) != 0)
+        LIBDAIKIN_ERROR("close error: %d.\n", errno);
+
+    LIBDAIKIN_TRACE("SOCKET '%d' CLOSED.\n", c->fd);
+    c->fd = INVALID_SOCKET;
+    c->used = false;
+    c->rx.clear();
+    tcp->handle = NULL;
+}
+
+bool daikin_hal_uring_flush(void)
+{
+    uring_t* const r = t_ring.ring;
+    if (r == NULL)
+        return true;
+
+    prepare_sends(r);
+    if (r->sq_pending > 0 && ring_enter(r, false, 0) == false)
+        return false; // No extra error info needed
+
+    reap(r);
+    return true;
+}
+
+void daikin_hal_uring_stats(daikin_hal_uring_stats_t* const stats)
+{
+    LIBDAIKIN_ASSERT(stats != NULL);
+
+    if (t_ring.ring != NULL)
+        *stats = t_ring.ring->stats;
+    else
+        memset(stats, 0, sizeof(daikin_hal_uring_stats_t));
+}
+
+uint32_t daikin_hal_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void daikin_hal_sleep_ms(uint32_t ms)
+{
+    // Buffered writes don't wait for the next read
+    daikin_hal_uring_flush();
+
+    struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
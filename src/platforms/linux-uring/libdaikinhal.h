@@ -0,0 +1,58 @@
+#ifndef __LIB_DAIKIN_HAL_URING_H__
+#define __LIB_DAIKIN_HAL_URING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../../include/libdaikinhal.h"
+
+// io_uring HAL for collectors with many connections per thread (Linux 6.0+).
+//
+// Same contract as libdaikinhal.h, except:
+// - every thread has its own ring, a connection is used only by the thread which opened it
+// - writes are buffered in registered memory and submitted together with the next wait
+//   (read, sleep or daikin_hal_uring_flush), a failed write is reported by a later call.
+//   Kernels which don't take registered buffers for sends get the same memory unregistered.
+// - a multishot receive with provided buffers keeps reading every connection,
+//   reads of data which arrived meanwhile need no syscall
+// - the socket isn't exposed, it can't be polled by the caller
+
+#ifndef DAIKIN_URING_MAX_CONNECTIONS
+#   define DAIKIN_URING_MAX_CONNECTIONS (256)  // Per thread
+#endif
+
+#ifndef DAIKIN_URING_TX_LEN
+#   define DAIKIN_URING_TX_LEN          (4096) // Write buffer per connection
+#endif
+
+#ifndef DAIKIN_URING_BUFFERS
+#   define DAIKIN_URING_BUFFERS         (256)  // Receive buffers shared by the connections, power of 2
+#endif
+
+#ifndef DAIKIN_URING_BUFFER_LEN
+#   define DAIKIN_URING_BUFFER_LEN      (2048)
+#endif
+
+typedef struct
+{
+    uint64_t enters;        // io_uring_enter calls
+    uint64_t sqes;          // Submitted requests
+    uint64_t cqes;          // Completions
+    uint64_t ready_reads;   // Reads served without a syscall
+} daikin_hal_uring_stats_t;
+
+// Submits buffered writes of this thread without waiting
+bool daikin_hal_uring_flush(void);
+
+// Counters of this thread's ring
+void daikin_hal_uring_stats(daikin_hal_uring_stats_t* const stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
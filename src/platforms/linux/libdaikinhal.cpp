@@ -0,0 +1,241 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <string.h>
+#include <stdint.h>
+
+#include "libdaikinhal.h"
+#include "../../../src/trace.h"
+
+#define INVALID_SOCKET (-1)
+
+// Handle keeps descriptor + 1, so zero initialized daikin_hal_tcp_t is not a valid socket
+static int socket_of(const daikin_hal_tcp_t* const tcp)
+{
+    return (int)(intptr_t)tcp->handle - 1;
+}
+
+static void* handle_of(int s)
+{
+    return (void*)(intptr_t)(s + 1);
+}
+
+// Waits in slices of DAIKIN_HAL_CANCEL_CHECK until s is ready for events,
+// false => timeout, deadline passed or cancelled
+static bool wait_ready(const daikin_hal_tcp_t* const tcp, short events, const char* const call)
+{
+    const uint32_t timeout_ms = DAIKIN_HAL_TIMEOUT_MS(tcp);
+    const uint32_t start_ms = daikin_hal_time_ms();
+
+    for (;;)
+    {
+        const uint32_t remaining_ms = daikin_hal_tcp_remaining_ms(tcp);
+        if (remaining_ms == 0)
+        {
+            LIBDAIKIN_ERROR("%s %s.\n", call, DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+            return false;
+        }
+
+        const uint32_t elapsed_ms = daikin_hal_time_ms() - start_ms;
+        if (timeout_ms > 0 && elapsed_ms >= timeout_ms)
+        {
+            LIBDAIKIN_ERROR("%s timeout after %u ms.\n", call, timeout_ms);
+            return false;
+        }
+
+        uint32_t wait_ms = remaining_ms < DAIKIN_HAL_CANCEL_CHECK ? remaining_ms : DAIKIN_HAL_CANCEL_CHECK;
+        if (timeout_ms > 0 && timeout_ms - elapsed_ms < wait_ms)
+            wait_ms = timeout_ms - elapsed_ms;
+
+        struct pollfd p = { socket_of(tcp), events, 0 };
+        const int ret = poll(&p, 1, (int)wait_ms);
+        if (ret > 0)
+            return true; // Errors and hang ups are reported by the call itself
+
+        if (ret < 0 && errno != EINTR)
+        {
+            LIBDAIKIN_ERROR("poll error: %d.\n", errno);
+            return false;
+        }
+    }
+}
+
+bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    tcp->handle = handle_of(INVALID_SOCKET);
+    const uint16_t remote_port = DAIKIN_HAL_REMOTE_PORT(tcp);
+
+    // Non-blocking for good, reads and writes poll anyway
+    int s = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+    {
+        LIBDAIKIN_ERROR("socket error: %d.\n", errno);
+        return false;
+    }
+
+    // NO Bind to a specific local network interface, routing table decides
+
+    // Header and payload are written separately, don't wait for delayed ACK
+    int nodelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    struct sockaddr_in remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(remote_port);
+    remote.sin_addr.s_addr = daikin_hal_tcp_IPv4(DAIKIN_HAL_REMOTE_IP(tcp));
+
+    LIBDAIKIN_TRACE("CONNECTING %s:%u.\n", DAIKIN_HAL_REMOTE_IP(tcp), remote_port);
+
+    tcp->handle = handle_of(s);
+
+    // Bounded like reads: an unreachable adapter fails after timeout_ms or at the deadline,
+    // not after the SYN retries of the kernel (about 2 minutes)
+    int err = connect(s, (struct sockaddr*)&remote, sizeof(remote)) == 0 ? 0 : errno;
+    if (err == EINPROGRESS)
+    {
+        socklen_t err_len = sizeof(err);
+        if (wait_ready(tcp, POLLOUT, "connect") == false)
+            err = ETIMEDOUT;
+        else if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0)
+            err = errno;
+    }
+
+    if (err != 0)
+    {
+        LIBDAIKIN_ERROR("Unable to connect to %s:%u. Error: %d\n",
+            DAIKIN_HAL_REMOTE_IP(tcp), remote_port, err);
+        close(s);
+        tcp->handle = handle_of(INVALID_SOCKET);
+        return false;
+    }
+
+    return true;
+}
+
+int32_t daikin_hal_tcp_read(
+    const daikin_hal_tcp_t* const tcp,
+    char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("recv %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
+    // Rest of a frame is usually there already, so poll only when nothing is.
+    // Reads of a hung adapter fail instead of blocking the caller for good.
+    ssize_t ret;
+    for (;;)
+    {
+        ret = recv(socket_of(tcp), data, len, MSG_DONTWAIT);
+        if (ret >= 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+            break;
+
+        if (errno != EINTR && wait_ready(tcp, POLLIN, "recv") == false)
+            return -1; // No extra error info needed
+    }
+
+    if (ret < 0)
+    {
+        LIBDAIKIN_ERROR("recv socket error: %d.\n", errno);
+        return -1;
+    }
+
+    return (int32_t)ret;
+}
+
+int32_t daikin_hal_tcp_write(
+    const daikin_hal_tcp_t* const tcp,
+    const char* const data,
+    uint16_t len)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
+
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("send %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
+    // Usually there is room in the send buffer, so poll only when it is full
+    ssize_t ret;
+    for (;;)
+    {
+        ret = send(socket_of(tcp), data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (ret >= 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+            break;
+
+        if (errno != EINTR && wait_ready(tcp, POLLOUT, "send") == false)
+            return -1; // No extra error info needed
+    }
+
+    if (ret < 0)
+    {
+        LIBDAIKIN_ERROR("send socket error: %d.\n", errno);
+        return -1;
+    }
+
+    return (int32_t)ret;
+}
+
+void daikin_hal_tcp_close(
+    daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    int s = socket_of(tcp);
+    if (s != INVALID_SOCKET) {
+
+        int ret = shutdown(s, SHUT_WR);
+        if (ret != 0 && errno != ENOTCONN)
+        {
+            LIBDAIKIN_ERROR("shutdown socket error: %d.\n", errno);
+        }
+
+        ret = close(s);
+        if (ret != 0)
+        {
+            LIBDAIKIN_ERROR("close error: %d.\n", errno);
+        }
+
+        LIBDAIKIN_TRACE("SOCKET '%d' CLOSED.\n", s);
+        tcp->handle = handle_of(INVALID_SOCKET);
+    }
+}
+
+int daikin_hal_linux_fd(const daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    return socket_of(tcp);
+}
+
+uint32_t daikin_hal_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void daikin_hal_sleep_ms(uint32_t ms)
+{
+    struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
@@ -0,0 +1,17 @@
+#ifndef __LIB_DAIKIN_HAL_LINUX_H__
+#define __LIB_DAIKIN_HAL_LINUX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../../../include/libdaikinhal.h"
+
+// Socket descriptor of the connection (e.g. for poll/epoll), -1 => not open
+int daikin_hal_linux_fd(const daikin_hal_tcp_t* const tcp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
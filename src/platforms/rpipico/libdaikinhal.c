@@ -1,4 +1,5 @@
 #include "socket.h"
+#include "pico/time.h"
 
 #include <string.h>
 
@@ -13,7 +14,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
     LIBDAIKIN_ASSERT(tcp != NULL);
 
     tcp->handle = (void*)((uint32_t)INVALID_SOCKET);
-    const uint16_t remote_port = DAIKIN_REMOTE_PORT;
+    const uint16_t remote_port = DAIKIN_HAL_REMOTE_PORT(tcp);
 
     int8_t ret = socket(TCP_SOCKET_ID, Sn_MR_TCP, 0, 0);
     if (ret != TCP_SOCKET_ID)
@@ -24,7 +25,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
 
     // NO Bind to a specific local network interface
 
-    uint32_t remote_ip = daikin_hal_tcp_IPv4(DAIKIN_REMOTE_IP);
+    uint32_t remote_ip = daikin_hal_tcp_IPv4(DAIKIN_HAL_REMOTE_IP(tcp));
     uint8_t* addr = (uint8_t*)(&remote_ip);
 
     LIBDAIKIN_TRACE("CONNECTING %u.%u.%u.%u:%u.\n",
@@ -33,7 +34,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
     ret = connect(TCP_SOCKET_ID, addr, remote_port);
     if (ret != SOCK_OK)
     {
-        LIBDAIKIN_ERROR("Unable to connect to '%s':%u.\n", DAIKIN_REMOTE_IP, remote_port);
+        LIBDAIKIN_ERROR("Unable to connect to '%s':%u.\n", DAIKIN_HAL_REMOTE_IP(tcp), remote_port);
         close(TCP_SOCKET_ID);
         return false;
     }
@@ -51,6 +52,13 @@ int32_t daikin_hal_tcp_read(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    // Checked before the call only, a blocked one can't be interrupted
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("recv %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
     int32_t ret = recv(TCP_SOCKET_ID, (uint8_t*)data, len);
     if (ret > 0)
         return ret;
@@ -68,6 +76,12 @@ int32_t daikin_hal_tcp_write(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    if (daikin_hal_tcp_remaining_ms(tcp) == 0)
+    {
+        LIBDAIKIN_ERROR("send %s.\n", DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+        return -1;
+    }
+
     int32_t ret = send(TCP_SOCKET_ID, (uint8_t*)data, len);
     if (ret > 0)
         return ret;
@@ -102,3 +116,13 @@ void daikin_hal_tcp_close(
         tcp->handle = (void*)((uint32_t)INVALID_SOCKET);
     }
 }
+
+uint32_t daikin_hal_time_ms(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+void daikin_hal_sleep_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+}
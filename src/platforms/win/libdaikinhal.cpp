@@ -7,12 +7,56 @@
 #include "../../../include/libdaikinhal.h"
 #include "../../../src/trace.h"
 
+// Waits in slices of DAIKIN_HAL_CANCEL_CHECK until the socket is readable (or writable),
+// false => timeout, deadline passed or cancelled
+static bool wait_ready(const daikin_hal_tcp_t* const tcp, bool write, const char* const call)
+{
+    const uint32_t timeout_ms = DAIKIN_HAL_TIMEOUT_MS(tcp);
+    const uint32_t start_ms = daikin_hal_time_ms();
+
+    for (;;)
+    {
+        const uint32_t remaining_ms = daikin_hal_tcp_remaining_ms(tcp);
+        if (remaining_ms == 0)
+        {
+            LIBDAIKIN_ERROR("%s %s.\n", call, DAIKIN_HAL_CANCELLED(tcp) ? "cancelled" : "deadline passed");
+            return false;
+        }
+
+        const uint32_t elapsed_ms = daikin_hal_time_ms() - start_ms;
+        if (timeout_ms > 0 && elapsed_ms >= timeout_ms)
+        {
+            LIBDAIKIN_ERROR("%s timeout after %u ms.\n", call, timeout_ms);
+            return false;
+        }
+
+        uint32_t wait_ms = remaining_ms < DAIKIN_HAL_CANCEL_CHECK ? remaining_ms : DAIKIN_HAL_CANCEL_CHECK;
+        if (timeout_ms > 0 && timeout_ms - elapsed_ms < wait_ms)
+            wait_ms = timeout_ms - elapsed_ms;
+
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET((SOCKET)tcp->handle, &set);
+        struct timeval tv = { (long)(wait_ms / 1000), (long)(wait_ms % 1000) * 1000 };
+
+        const int ret = select(0, write ? NULL : &set, write ? &set : NULL, &set, &tv);
+        if (ret > 0)
+            return true; // Errors are reported by the call itself
+
+        if (ret == SOCKET_ERROR)
+        {
+            LIBDAIKIN_ERROR("select socket error: %d.\n", WSAGetLastError());
+            return false;
+        }
+    }
+}
+
 bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
 
     tcp->handle = (void*)INVALID_SOCKET;
-    const uint16_t remote_port = DAIKIN_REMOTE_PORT;
+    const uint16_t remote_port = DAIKIN_HAL_REMOTE_PORT(tcp);
 
     SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (s == INVALID_SOCKET)
@@ -38,7 +82,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
     struct sockaddr_in remote = { 0 };
     remote.sin_family = AF_INET;
     remote.sin_port = htons(remote_port);
-    remote.sin_addr.s_addr = daikin_hal_tcp_IPv4(DAIKIN_REMOTE_IP);
+    remote.sin_addr.s_addr = daikin_hal_tcp_IPv4(DAIKIN_HAL_REMOTE_IP(tcp));
 
     uint8_t* a = (uint8_t*)(&remote.sin_addr.s_addr);
     LIBDAIKIN_TRACE("CONNECTING %u.%u.%u.%u:%u.\n",
@@ -48,7 +92,7 @@ bool daikin_hal_tcp_open(daikin_hal_tcp_t* const tcp)
     if (ret == SOCKET_ERROR)
     {
         LIBDAIKIN_ERROR("Unable to connect to %s:%u. Error: %d\n",
-            DAIKIN_REMOTE_IP, remote_port, WSAGetLastError());
+            DAIKIN_HAL_REMOTE_IP(tcp), remote_port, WSAGetLastError());
         closesocket(s);
         return false;
     }
@@ -66,6 +110,10 @@ int32_t daikin_hal_tcp_read(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    // Reads of a hung adapter fail instead of blocking the caller for good
+    if (wait_ready(tcp, false, "recv") == false)
+        return -1; // No extra error info needed
+
     int ret = recv((SOCKET)tcp->handle, data, len, 0);
     if (ret == SOCKET_ERROR)
     {
@@ -85,6 +133,9 @@ int32_t daikin_hal_tcp_write(
     LIBDAIKIN_ASSERT(data != NULL);
     LIBDAIKIN_ASSERT(len > 0);
 
+    if (wait_ready(tcp, true, "send") == false)
+        return -1; // No extra error info needed
+
     int ret = send((SOCKET)tcp->handle, data, len, 0);
     if (ret == SOCKET_ERROR)
     {
@@ -119,3 +170,13 @@ void daikin_hal_tcp_close(
         tcp->handle = (void*)INVALID_SOCKET;
     }
 }
+
+uint32_t daikin_hal_time_ms(void)
+{
+    return (uint32_t)GetTickCount();
+}
+
+void daikin_hal_sleep_ms(uint32_t ms)
+{
+    Sleep(ms);
+}
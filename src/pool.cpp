@@ -0,0 +1,292 @@
+#include <string.h>
+#include <string>
+
+#include "../include/libdaikinpool.h"
+
+#include "time_util.h"
+#include "websockets.h"
+#include "trace.h"
+
+static bool is_open(const daikin_pool_slot_t* const s)
+{
+    return s->state != daikin_pool_state_t::PLS_CLOSED;
+}
+
+static uint8_t open_count(const daikin_pool_t* const pool)
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+        n += is_open(&pool->slots[i]) ? 1 : 0;
+    return n;
+}
+
+static bool is_retry_due(const daikin_pool_t* const pool, uint32_t now_ms)
+{
+    return pool->retry_wait == false || daikin_time_is_due(now_ms, pool->retry_ms);
+}
+
+static void close_slot(daikin_pool_slot_t* const s)
+{
+    daikin_close(&s->daikin);
+    s->state = daikin_pool_state_t::PLS_CLOSED;
+}
+
+static bool open_slot(daikin_pool_t* const pool, daikin_pool_slot_t* const s, uint32_t now_ms)
+{
+    // Fresh copy, nothing of the previous session survives
+    s->daikin = pool->proto;
+    s->daikin.is_open = false;
+    s->daikin.tcp.handle = NULL;
+    s->daikin.ws_deflate_state = NULL;
+
+    if (daikin_open(&s->daikin) == false)
+    {
+        daikin_close(&s->daikin);
+        pool->open_failures++;
+        pool->retry_wait = true;
+        pool->retry_ms = now_ms + pool->retry_interval_ms;
+        return false;
+    }
+
+    pool->opens++;
+    pool->retry_wait = false;
+    s->state = daikin_pool_state_t::PLS_IDLE;
+    s->checked_ms = now_ms;
+    return true;
+}
+
+static daikin_pool_slot_t* slot_of(daikin_pool_t* const pool, const daikin_t* const daikin)
+{
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        if (&pool->slots[i].daikin == daikin)
+            return &pool->slots[i];
+    }
+
+    return NULL;
+}
+
+bool daikin_pool_init(
+    daikin_pool_t* const pool,
+    const daikin_t* const proto,
+    uint8_t size,
+    uint32_t check_interval_ms,
+    uint32_t retry_interval_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+    LIBDAIKIN_ASSERT(proto != NULL && proto->is_open == false);
+    LIBDAIKIN_ASSERT(size > 0 && size <= DAIKIN_POOL_MAX);
+
+    if (pool == NULL || proto == NULL || proto->is_open)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument pool or proto.\n");
+        return false;
+    }
+
+    if (size == 0 || size > DAIKIN_POOL_MAX)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument size %u. Size must be between 1 and %u.\n", size, DAIKIN_POOL_MAX);
+        return false;
+    }
+
+    memset(pool, 0, sizeof(daikin_pool_t));
+    pool->proto = *proto;
+    pool->size = size;
+    pool->check_interval_ms = check_interval_ms > 0 ? check_interval_ms : DAIKIN_POOL_CHECK_INTERVAL;
+    pool->retry_interval_ms = retry_interval_ms > 0 ? retry_interval_ms : DAIKIN_POOL_RETRY_INTERVAL;
+    return true;
+}
+
+bool daikin_pool_maintain(daikin_pool_t* const pool, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    if (pool == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument pool.\n");
+        return false;
+    }
+
+    bool ok = true;
+
+    // Idle session trusted for the longest time
+    daikin_pool_slot_t* oldest = NULL;
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        daikin_pool_slot_t* const s = &pool->slots[i];
+        if (s->state == daikin_pool_state_t::PLS_IDLE && (now_ms - s->checked_ms) >= pool->check_interval_ms &&
+            (oldest == NULL || (now_ms - s->checked_ms) > (now_ms - oldest->checked_ms)))
+            oldest = s;
+    }
+
+    if (oldest != NULL)
+    {
+        pool->checks++;
+        if (daikin_ws_ping(&oldest->daikin))
+            oldest->checked_ms = now_ms;
+        else
+        {
+            LIBDAIKIN_INFO("Idle session failed the health check, closing it.\n");
+            pool->check_failures++;
+            close_slot(oldest);
+            ok = false;
+        }
+    }
+
+    if (open_count(pool) < pool->size && is_retry_due(pool, now_ms))
+    {
+        for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+        {
+            if (is_open(&pool->slots[i]) == false)
+            {
+                ok = open_slot(pool, &pool->slots[i], now_ms) && ok;
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+uint32_t daikin_pool_next_delay(const daikin_pool_t* const pool, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    if (pool == NULL)
+        return UINT32_MAX;
+
+    uint32_t delay = UINT32_MAX;
+    if (open_count(pool) < pool->size)
+        delay = is_retry_due(pool, now_ms) ? 0 : pool->retry_ms - now_ms;
+
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        const daikin_pool_slot_t* const s = &pool->slots[i];
+        if (s->state != daikin_pool_state_t::PLS_IDLE)
+            continue;
+
+        const uint32_t age = now_ms - s->checked_ms;
+        const uint32_t d = age >= pool->check_interval_ms ? 0 : pool->check_interval_ms - age;
+        if (d < delay)
+            delay = d;
+    }
+
+    return delay;
+}
+
+daikin_t* daikin_pool_acquire(daikin_pool_t* const pool, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    if (pool == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument pool.\n");
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        daikin_pool_slot_t* const s = &pool->slots[i];
+        if (s->state == daikin_pool_state_t::PLS_IDLE)
+        {
+            s->state = daikin_pool_state_t::PLS_IN_USE;
+            return &s->daikin;
+        }
+    }
+
+    // No standby left, the caller waits on a handshake unless the adapter is failing
+    if (open_count(pool) >= pool->size)
+    {
+        LIBDAIKIN_ERROR("All %u sessions are in use.\n", pool->size);
+        return NULL;
+    }
+
+    if (is_retry_due(pool, now_ms) == false)
+    {
+        LIBDAIKIN_ERROR("Adapter unreachable, next open in %u ms.\n", pool->retry_ms - now_ms);
+        return NULL;
+    }
+
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        daikin_pool_slot_t* const s = &pool->slots[i];
+        if (is_open(s))
+            continue;
+
+        pool->waits++;
+        if (open_slot(pool, s, now_ms) == false)
+            return NULL; // No extra error info needed
+
+        s->state = daikin_pool_state_t::PLS_IN_USE;
+        return &s->daikin;
+    }
+
+    return NULL;
+}
+
+void daikin_pool_release(daikin_pool_t* const pool, daikin_t* const daikin, bool ok, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    daikin_pool_slot_t* const s = pool != NULL && daikin != NULL ? slot_of(pool, daikin) : NULL;
+    if (s == NULL || s->state != daikin_pool_state_t::PLS_IN_USE)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument daikin, not a session in use of the pool.\n");
+        return;
+    }
+
+    if (ok == false)
+    {
+        close_slot(s);
+        return;
+    }
+
+    s->state = daikin_pool_state_t::PLS_IDLE;
+    s->checked_ms = now_ms; // A successful request is as good as a ping
+}
+
+daikin_t* daikin_pool_swap(daikin_pool_t* const pool, daikin_t* const daikin, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    if (pool == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument pool.\n");
+        return NULL;
+    }
+
+    daikin_pool_release(pool, daikin, false, now_ms);
+
+    if (daikin_pool_idle(pool) > 0)
+        pool->swaps++;
+
+    return daikin_pool_acquire(pool, now_ms);
+}
+
+uint8_t daikin_pool_idle(const daikin_pool_t* const pool)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    uint8_t n = 0;
+    for (uint8_t i = 0; pool != NULL && i < DAIKIN_POOL_MAX; i++)
+        n += pool->slots[i].state == daikin_pool_state_t::PLS_IDLE ? 1 : 0;
+    return n;
+}
+
+void daikin_pool_close(daikin_pool_t* const pool)
+{
+    LIBDAIKIN_ASSERT(pool != NULL);
+
+    if (pool == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument pool.\n");
+        return;
+    }
+
+    for (uint8_t i = 0; i < DAIKIN_POOL_MAX; i++)
+    {
+        if (is_open(&pool->slots[i]))
+            close_slot(&pool->slots[i]);
+    }
+}
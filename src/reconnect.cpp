@@ -0,0 +1,199 @@
+#include <string.h>
+
+#include "../include/libdaikinreconnect.h"
+
+#include "time_util.h"
+#include "trace.h"
+
+static bool is_valid_device(const daikin_reconnect_t* const rc, uint16_t device)
+{
+    if (rc == NULL || device >= rc->count)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument device %u.\n", device);
+        return false;
+    }
+
+    return true;
+}
+
+// Pending writes first, then the most overdue
+static bool is_before(const daikin_reconnect_entry_t* const a, const daikin_reconnect_entry_t* const b)
+{
+    if (a->pending_writes != b->pending_writes)
+        return a->pending_writes;
+
+    return (int32_t)(a->due_ms - b->due_ms) < 0;
+}
+
+uint32_t daikin_reconnect_backoff(uint32_t* const random, uint8_t failures, uint32_t base_ms, uint32_t max_ms)
+{
+    LIBDAIKIN_ASSERT(random != NULL);
+
+    uint32_t window = base_ms;
+    for (uint8_t i = 0; i < failures && window < max_ms; i++)
+        window *= 2;
+
+    window = window > max_ms ? max_ms : window;
+    return window > 0 ? daikin_random_next(random) % window : 0;
+}
+
+bool daikin_reconnect_init(
+    daikin_reconnect_t* const rc,
+    daikin_reconnect_entry_t* const entries,
+    uint16_t count,
+    uint16_t max_in_progress,
+    uint32_t base_delay_ms,
+    uint32_t max_delay_ms,
+    uint32_t seed)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+    LIBDAIKIN_ASSERT(entries != NULL && count > 0);
+
+    if (rc == NULL || entries == NULL || count == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument rc or entries.\n");
+        return false;
+    }
+
+    memset(rc, 0, sizeof(daikin_reconnect_t));
+    memset(entries, 0, sizeof(daikin_reconnect_entry_t) * count);
+
+    rc->entries = entries;
+    rc->count = count;
+    rc->max_in_progress = max_in_progress > 0 ? max_in_progress : DAIKIN_RECONNECT_IN_PROGRESS;
+    rc->base_delay_ms = base_delay_ms > 0 ? base_delay_ms : DAIKIN_RECONNECT_BASE_DELAY;
+    rc->max_delay_ms = max_delay_ms > 0 ? max_delay_ms : DAIKIN_RECONNECT_MAX_DELAY;
+    rc->max_delay_ms = rc->max_delay_ms < rc->base_delay_ms ? rc->base_delay_ms : rc->max_delay_ms;
+    rc->random = seed != 0 ? seed : daikin_hal_time_ms() | 1;
+
+    for (uint16_t i = 0; i < count; i++)
+        entries[i].state = daikin_reconnect_state_t::RS_CONNECTED;
+
+    return true;
+}
+
+void daikin_reconnect_lost(daikin_reconnect_t* const rc, uint16_t device, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    if (is_valid_device(rc, device) == false)
+        return; // No extra error info needed
+
+    daikin_reconnect_entry_t* const e = &rc->entries[device];
+    if (e->state == daikin_reconnect_state_t::RS_WAITING)
+        return; // Already scheduled, keeps its backoff
+
+    if (e->state == daikin_reconnect_state_t::RS_CONNECTING)
+        rc->in_progress--;
+
+    // Writes can't wait for the window, the cap still spreads them
+    e->state = daikin_reconnect_state_t::RS_WAITING;
+    e->failures = 0;
+    e->due_ms = now_ms + (e->pending_writes ? 0 :
+        daikin_reconnect_backoff(&rc->random, 0, rc->base_delay_ms, rc->max_delay_ms));
+}
+
+void daikin_reconnect_set_pending_writes(daikin_reconnect_t* const rc, uint16_t device, bool pending)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    if (is_valid_device(rc, device))
+        rc->entries[device].pending_writes = pending;
+}
+
+int32_t daikin_reconnect_next(daikin_reconnect_t* const rc, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    if (rc == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument rc.\n");
+        return -1;
+    }
+
+    int32_t best = -1;
+    for (uint16_t i = 0; i < rc->count; i++)
+    {
+        const daikin_reconnect_entry_t* const e = &rc->entries[i];
+        if (e->state == daikin_reconnect_state_t::RS_WAITING && daikin_time_is_due(now_ms, e->due_ms) &&
+            (best < 0 || is_before(e, &rc->entries[best])))
+            best = i;
+    }
+
+    if (best < 0)
+        return -1;
+
+    if (rc->in_progress >= rc->max_in_progress)
+    {
+        rc->deferred++;
+        return -1;
+    }
+
+    rc->entries[best].state = daikin_reconnect_state_t::RS_CONNECTING;
+    rc->in_progress++;
+    rc->attempts++;
+    return best;
+}
+
+void daikin_reconnect_done(daikin_reconnect_t* const rc, uint16_t device, bool ok, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    if (is_valid_device(rc, device) == false)
+        return; // No extra error info needed
+
+    daikin_reconnect_entry_t* const e = &rc->entries[device];
+    if (e->state != daikin_reconnect_state_t::RS_CONNECTING)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument device %u, it is not connecting.\n", device);
+        return;
+    }
+
+    rc->in_progress--;
+
+    if (ok)
+    {
+        e->state = daikin_reconnect_state_t::RS_CONNECTED;
+        e->failures = 0;
+        return;
+    }
+
+    rc->failures++;
+    if (e->failures < UINT8_MAX)
+        e->failures++;
+
+    e->state = daikin_reconnect_state_t::RS_WAITING;
+    e->due_ms = now_ms + daikin_reconnect_backoff(&rc->random, e->failures, rc->base_delay_ms, rc->max_delay_ms);
+}
+
+uint32_t daikin_reconnect_next_delay(const daikin_reconnect_t* const rc, uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    if (rc == NULL || rc->in_progress >= rc->max_in_progress)
+        return UINT32_MAX; // Next chance is a daikin_reconnect_done
+
+    uint32_t delay = UINT32_MAX;
+    for (uint16_t i = 0; i < rc->count; i++)
+    {
+        const daikin_reconnect_entry_t* const e = &rc->entries[i];
+        if (e->state != daikin_reconnect_state_t::RS_WAITING)
+            continue;
+
+        const uint32_t d = daikin_time_is_due(now_ms, e->due_ms) ? 0 : e->due_ms - now_ms;
+        if (d < delay)
+            delay = d;
+    }
+
+    return delay;
+}
+
+uint16_t daikin_reconnect_waiting(const daikin_reconnect_t* const rc)
+{
+    LIBDAIKIN_ASSERT(rc != NULL);
+
+    uint16_t n = 0;
+    for (uint16_t i = 0; rc != NULL && i < rc->count; i++)
+        n += rc->entries[i].state == daikin_reconnect_state_t::RS_WAITING ? 1 : 0;
+    return n;
+}
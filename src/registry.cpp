@@ -0,0 +1,122 @@
+#include <string.h>
+
+#include "registry.h"
+#include "trace.h"
+
+#define REGISTRY_ENTRY(path, type, writable, min, max) \
+    { path "/la", (uint8_t)(sizeof(path) - 1), type, writable, min, max }
+
+static constexpr registry_entry_t REGISTRY[] =
+{
+    REGISTRY_ENTRY(DAIKIN_PATH_INDOOR_TEMP,        RT_FLOAT,  false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_OUTDOOR_TEMP,       RT_FLOAT,  false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_LEAVING_WATER_TEMP, RT_FLOAT,  false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_TEMP_TARGET,        RT_FLOAT,  true,   16,  30),
+    REGISTRY_ENTRY(DAIKIN_PATH_TEMP_OFFSET,        RT_FLOAT,  true,  -10,  10),
+    REGISTRY_ENTRY(DAIKIN_PATH_POWER_STATE,        RT_STRING, true,    0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_OPERATION_MODE,     RT_STRING, false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_EMERGENCY_STATE,    RT_INT,    false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_ERROR_STATE,        RT_INT,    false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_WARNING_STATE,      RT_INT,    false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_CONSUMPTION,        RT_STRING, false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_TANK_TEMP,          RT_FLOAT,  false,   0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_TANK_TEMP_TARGET,   RT_FLOAT,  true,   20,  75),
+    REGISTRY_ENTRY(DAIKIN_PATH_TANK_POWER_STATE,   RT_STRING, true,    0,   0),
+    REGISTRY_ENTRY(DAIKIN_PATH_TANK_CONSUMPTION,   RT_STRING, false,   0,   0),
+};
+
+static constexpr registry_index_t FIELD_ENTRIES[] =
+{
+    RE_INDOOR_TEMP,         // DF_INDOOR_TEMP
+    RE_OUTDOOR_TEMP,        // DF_OUTDOOR_TEMP
+    RE_LEAVING_WATER_TEMP,  // DF_LEAVING_WATER_TEMP
+    RE_POWER_STATE,         // DF_POWER_STATE
+    RE_EMERGENCY_STATE,     // DF_EMERGENCY_STATE
+    RE_ERROR_STATE,         // DF_ERROR_STATE
+    RE_WARNING_STATE,       // DF_WARNING_STATE
+    RE_NONE,                // DF_TEMP_MODE (derived from target temperature and offset)
+    RE_TEMP_TARGET,         // DF_TEMP_TARGET
+    RE_TEMP_OFFSET,         // DF_TEMP_OFFSET
+};
+
+static constexpr bool registry_is_valid()
+{
+    for (size_t i = 0; i < sizeof(REGISTRY) / sizeof(REGISTRY[0]); i++)
+    {
+        if (REGISTRY[i].path_len == 0 || REGISTRY[i].min > REGISTRY[i].max)
+            return false;
+    }
+    return true;
+}
+
+static constexpr uint32_t registry_compute_hash()
+{
+    // FNV-1a over all paths and types
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(REGISTRY) / sizeof(REGISTRY[0]); i++)
+    {
+        for (const char* p = REGISTRY[i].read_path; *p; ++p)
+            h = (h ^ (uint8_t)*p) * 16777619u;
+        h = (h ^ (uint8_t)REGISTRY[i].type) * 16777619u;
+    }
+    return h;
+}
+
+static constexpr uint32_t REGISTRY_HASH = registry_compute_hash();
+
+static_assert(sizeof(REGISTRY) / sizeof(REGISTRY[0]) == RE_COUNT, "REGISTRY must match registry_index_t");
+static_assert(sizeof(FIELD_ENTRIES) / sizeof(FIELD_ENTRIES[0]) == DF_COUNT, "FIELD_ENTRIES must match daikin_field_t");
+static_assert(registry_is_valid(), "Invalid REGISTRY entry");
+
+const registry_entry_t* registry_get(registry_index_t index)
+{
+    LIBDAIKIN_ASSERT(index < RE_COUNT);
+
+    return &REGISTRY[index];
+}
+
+const registry_entry_t* registry_find(const char* const path, size_t path_len)
+{
+    LIBDAIKIN_ASSERT(path != NULL);
+
+    for (uint8_t i = 0; i < RE_COUNT; i++)
+    {
+        const registry_entry_t* const e = &REGISTRY[i];
+        if (e->path_len == path_len && memcmp(e->read_path, path, path_len) == 0)
+            return e;
+    }
+
+    return NULL;
+}
+
+registry_index_t registry_field_entry(daikin_field_t field)
+{
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+
+    return FIELD_ENTRIES[field];
+}
+
+registry_index_t registry_index_of(const registry_entry_t* const entry)
+{
+    LIBDAIKIN_ASSERT(entry >= REGISTRY && entry < REGISTRY + RE_COUNT);
+
+    return (registry_index_t)(entry - REGISTRY);
+}
+
+uint32_t registry_hash()
+{
+    return REGISTRY_HASH;
+}
+
+daikin_field_t registry_entry_field(registry_index_t index)
+{
+    LIBDAIKIN_ASSERT(index < RE_COUNT);
+
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        if (FIELD_ENTRIES[f] == index)
+            return (daikin_field_t)f;
+    }
+
+    return daikin_field_t::DF_COUNT;
+}
@@ -0,0 +1,70 @@
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../include/libdaikin.h"
+
+typedef enum
+{
+    RT_FLOAT,
+    RT_INT,
+    RT_STRING
+} registry_type_t;
+
+typedef struct
+{
+    const char*     read_path; // Resource path + "/la"
+    uint8_t         path_len;  // Resource path length, read path is 3 bytes longer
+    registry_type_t type;
+    bool            writable;
+    float           min; // Valid range of written numbers
+    float           max;
+} registry_entry_t;
+
+// Order must match the REGISTRY table
+typedef enum
+{
+    RE_INDOOR_TEMP,
+    RE_OUTDOOR_TEMP,
+    RE_LEAVING_WATER_TEMP,
+    RE_TEMP_TARGET,
+    RE_TEMP_OFFSET,
+    RE_POWER_STATE,
+    RE_OPERATION_MODE,
+    RE_EMERGENCY_STATE,
+    RE_ERROR_STATE,
+    RE_WARNING_STATE,
+    RE_CONSUMPTION,
+    RE_TANK_TEMP,
+    RE_TANK_TEMP_TARGET,
+    RE_TANK_POWER_STATE,
+    RE_TANK_CONSUMPTION,
+    RE_COUNT,
+    RE_NONE = RE_COUNT
+} registry_index_t;
+
+static const uint8_t READ_SUFFIX_LEN = 3; // "/la"
+
+// Set points, only the one of the current temperature mode returns an OK rsc code.
+// They are supported regardless of the discovery, which sees just one of them.
+static const uint32_t REGISTRY_MODE_DEPENDENT = (1u << RE_TEMP_TARGET) | (1u << RE_TEMP_OFFSET);
+
+const registry_entry_t* registry_get(registry_index_t index);
+const registry_entry_t* registry_find(const char* const path, size_t path_len); // NULL => unknown path
+registry_index_t        registry_field_entry(daikin_field_t field); // RE_NONE => derived field
+registry_index_t        registry_index_of(const registry_entry_t* const entry);
+daikin_field_t          registry_entry_field(registry_index_t index); // DF_COUNT => not a device info field
+uint32_t                registry_hash(); // Changes when the path catalogue changes
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
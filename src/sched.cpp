@@ -0,0 +1,218 @@
+#include <string.h>
+
+#include "../include/libdaikinsched.h"
+
+#include "fields.h"
+#include "time_util.h"
+#include "trace.h"
+
+static const uint16_t DEFAULT_BUDGET_PER_MIN = 30;
+static const float BUCKET_CAPACITY = (float)DF_COUNT; // Allows one full read at once
+
+static uint8_t field_cost(daikin_field_t field)
+{
+    // Temperature mode reads target temperature and offset
+    return field == daikin_field_t::DF_TEMP_MODE ? 2 : 1;
+}
+
+static void refill(daikin_sched_t* const sched, uint32_t now_ms)
+{
+    const uint32_t elapsed = now_ms - sched->last_refill_ms;
+    sched->last_refill_ms = now_ms;
+
+    sched->tokens += (float)elapsed * sched->config.budget_per_min / 60000.0f;
+    if (sched->tokens > BUCKET_CAPACITY)
+        sched->tokens = BUCKET_CAPACITY;
+}
+
+static void adapt(daikin_sched_field_t* const f, const daikin_sched_field_config_t* const c, double value)
+{
+    if (f->valid)
+    {
+        const double change = value > f->last_value ? value - f->last_value : f->last_value - value;
+
+        if (change >= c->change_threshold)
+            f->interval_ms /= 2; // Signal moves fast, speed up
+        else
+            f->interval_ms += f->interval_ms / 4; // Slow signal, back off
+    }
+
+    if (f->interval_ms < c->min_interval_ms)
+        f->interval_ms = c->min_interval_ms;
+    if (f->interval_ms > c->max_interval_ms)
+        f->interval_ms = c->max_interval_ms;
+
+    f->last_value = value;
+    f->valid = true;
+}
+
+void daikin_sched_default_config(daikin_sched_config_t* const config)
+{
+    LIBDAIKIN_ASSERT(config != NULL);
+
+    if (config == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument config.\n");
+        return;
+    }
+
+    memset(config, 0, sizeof(daikin_sched_config_t));
+    config->budget_per_min = DEFAULT_BUDGET_PER_MIN;
+
+    static const daikin_sched_field_config_t DEFAULTS[DF_COUNT] =
+    {
+        {  5000,  60000, 0.2f }, // DF_INDOOR_TEMP
+        { 30000, 300000, 0.5f }, // DF_OUTDOOR_TEMP
+        {  2000,  60000, 0.5f }, // DF_LEAVING_WATER_TEMP (fast during defrost)
+        { 10000, 120000, 0.5f }, // DF_POWER_STATE
+        { 10000, 300000, 0.5f }, // DF_EMERGENCY_STATE
+        { 10000, 120000, 0.5f }, // DF_ERROR_STATE
+        { 30000, 300000, 0.5f }, // DF_WARNING_STATE
+        {     0,      0, 0.5f }, // DF_TEMP_MODE (updated by target temperature and offset)
+        { 10000, 120000, 0.5f }, // DF_TEMP_TARGET
+        { 10000, 120000, 0.5f }, // DF_TEMP_OFFSET
+    };
+
+    memcpy(config->fields, DEFAULTS, sizeof(DEFAULTS));
+}
+
+void daikin_sched_init(
+    daikin_sched_t* const sched,
+    const daikin_sched_config_t* const config)
+{
+    LIBDAIKIN_ASSERT(sched != NULL);
+
+    if (sched == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument sched.\n");
+        return;
+    }
+
+    memset(sched, 0, sizeof(daikin_sched_t));
+
+    if (config != NULL)
+        sched->config = *config;
+    else
+        daikin_sched_default_config(&sched->config);
+
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+        sched->fields[f].interval_ms = sched->config.fields[f].min_interval_ms;
+
+    sched->tokens = BUCKET_CAPACITY;
+}
+
+bool daikin_sched_poll(
+    daikin_sched_t* const sched,
+    const daikin_t* const daikin,
+    uint32_t now_ms,
+    daikin_device_info_t* const info,
+    uint32_t* const updated_mask)
+{
+    LIBDAIKIN_ASSERT(sched != NULL);
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+    LIBDAIKIN_ASSERT(updated_mask != NULL);
+
+    if (sched == NULL || daikin == NULL || info == NULL || updated_mask == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument sched, daikin, info or updated_mask.\n");
+        return false;
+    }
+
+    *updated_mask = 0;
+
+    if (sched->started == false)
+    {
+        // Everything is due on the first poll
+        for (uint8_t f = 0; f < DF_COUNT; f++)
+            sched->fields[f].next_due_ms = now_ms;
+        sched->last_refill_ms = now_ms;
+        sched->started = true;
+    }
+
+    refill(sched, now_ms);
+
+    while (true)
+    {
+        // Pick the most overdue field
+        int8_t best = -1;
+        uint32_t best_overdue = 0;
+
+        for (uint8_t f = 0; f < DF_COUNT; f++)
+        {
+            const daikin_sched_field_t* const sf = &sched->fields[f];
+
+            if (sched->config.fields[f].max_interval_ms == 0)
+                continue; // Not polled
+            if ((*updated_mask & (1u << f)) != 0 || daikin_time_is_due(now_ms, sf->next_due_ms) == false)
+                continue;
+
+            const uint32_t overdue = now_ms - sf->next_due_ms;
+            if (best < 0 || overdue > best_overdue)
+            {
+                best = (int8_t)f;
+                best_overdue = overdue;
+            }
+        }
+
+        if (best < 0)
+            break; // Nothing due
+
+        const daikin_field_t field = (daikin_field_t)best;
+        const uint8_t cost = field_cost(field);
+        if (sched->tokens < cost)
+            break; // Budget exhausted
+
+        sched->tokens -= cost;
+
+        if (daikin_get_field(daikin, field, info) == false)
+            return false; // No extra error info needed
+
+        daikin_sched_field_t* const sf = &sched->fields[best];
+        adapt(sf, &sched->config.fields[best], daikin_field_get_double(info, field));
+        sf->next_due_ms = now_ms + sf->interval_ms;
+
+        *updated_mask |= (1u << best);
+        if (field == daikin_field_t::DF_TEMP_TARGET || field == daikin_field_t::DF_TEMP_OFFSET)
+            *updated_mask |= (1u << daikin_field_t::DF_TEMP_MODE);
+    }
+
+    return true;
+}
+
+uint32_t daikin_sched_next_delay(
+    const daikin_sched_t* const sched,
+    uint32_t now_ms)
+{
+    LIBDAIKIN_ASSERT(sched != NULL);
+
+    if (sched == NULL || sched->started == false)
+        return 0;
+
+    uint32_t delay = UINT32_MAX;
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        if (sched->config.fields[f].max_interval_ms == 0)
+            continue; // Not polled
+
+        const uint32_t due = sched->fields[f].next_due_ms;
+        const uint32_t d = daikin_time_is_due(now_ms, due) ? 0 : due - now_ms;
+        if (d < delay)
+            delay = d;
+    }
+
+    if (delay == UINT32_MAX || sched->config.budget_per_min == 0)
+        return delay;
+
+    // Time to earn one token
+    const float tokens = sched->tokens +
+        (float)(now_ms - sched->last_refill_ms) * sched->config.budget_per_min / 60000.0f;
+    if (tokens < 1.0f)
+    {
+        const uint32_t wait = (uint32_t)((1.0f - tokens) * 60000.0f / sched->config.budget_per_min) + 1;
+        if (wait > delay)
+            delay = wait;
+    }
+
+    return delay;
+}
@@ -0,0 +1,330 @@
+#include <string.h>
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   define SHM_HAS_POSIX 1
+#endif
+
+#include "../include/libdaikinshm.h"
+
+#include "trace.h"
+
+static const uint32_t REGION_MAGIC = 0x48534B44; // 'DKSH'
+static const uint16_t REGION_VERSION = 1;
+static const uint32_t CACHE_LINE = 64; // Slots don't share cache lines
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define SHM_LOAD(p, order)       __atomic_load_n((p), (order))
+#   define SHM_STORE(p, v, order)   __atomic_store_n((p), (v), (order))
+#   define SHM_RELAXED              __ATOMIC_RELAXED
+#   define SHM_ACQUIRE              __ATOMIC_ACQUIRE
+#   define SHM_RELEASE              __ATOMIC_RELEASE
+#else
+    // Aligned 32 bit volatile accesses with full fences
+#   define SHM_LOAD(p, order)       (std::atomic_thread_fence(std::memory_order_seq_cst), *(volatile uint32_t*)(p))
+#   define SHM_STORE(p, v, order)   do { std::atomic_thread_fence(std::memory_order_seq_cst); *(volatile uint32_t*)(p) = (v); } while (0)
+#   define SHM_RELAXED              0
+#   define SHM_ACQUIRE              0
+#   define SHM_RELEASE              0
+#endif
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t device_count;
+    uint32_t slot_size;
+    uint32_t snapshot_size; // Detects readers built with another daikin_device_info_t
+} shm_region_hdr_t;
+
+typedef struct
+{
+    uint32_t seq; // Selects the stable copy for readers, < 2 => never published
+    uint32_t reserved;
+    daikin_shm_snapshot_t data[2]; // Publisher updates one copy while readers read the other
+} shm_slot_t;
+
+static_assert(sizeof(daikin_shm_snapshot_t) % sizeof(uint32_t) == 0, "Snapshot is copied in 32 bit words");
+
+static const uint32_t HDR_SIZE = (sizeof(shm_region_hdr_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+static const uint32_t SLOT_SIZE = (sizeof(shm_slot_t) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+static const uint32_t SNAPSHOT_WORDS = sizeof(daikin_shm_snapshot_t) / sizeof(uint32_t);
+
+static shm_slot_t* slot_of(const daikin_shm_t* const shm, uint16_t device)
+{
+    return (shm_slot_t*)(shm->mem + HDR_SIZE + (uint32_t)device * SLOT_SIZE);
+}
+
+uint32_t daikin_shm_size(uint16_t device_count)
+{
+    return HDR_SIZE + (uint32_t)device_count * SLOT_SIZE;
+}
+
+bool daikin_shm_init(
+    daikin_shm_t* const shm,
+    uint8_t* const mem,
+    uint32_t mem_len,
+    uint16_t device_count)
+{
+    LIBDAIKIN_ASSERT(shm != NULL);
+    LIBDAIKIN_ASSERT(mem != NULL);
+    LIBDAIKIN_ASSERT(device_count > 0);
+
+    if (shm == NULL || mem == NULL || device_count == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument shm, mem or device_count.\n");
+        return false;
+    }
+
+    if (mem_len < daikin_shm_size(device_count))
+    {
+        LIBDAIKIN_ERROR("Region of %u bytes is too small for %u devices.\n", mem_len, device_count);
+        return false;
+    }
+
+    memset(mem, 0, daikin_shm_size(device_count));
+
+    shm_region_hdr_t* const hdr = (shm_region_hdr_t*)mem;
+    hdr->version = REGION_VERSION;
+    hdr->device_count = device_count;
+    hdr->slot_size = SLOT_SIZE;
+    hdr->snapshot_size = sizeof(daikin_shm_snapshot_t);
+    SHM_STORE(&hdr->magic, REGION_MAGIC, SHM_RELEASE); // Readers attach only to a formatted region
+
+    shm->mem = mem;
+    shm->mem_len = mem_len;
+    shm->device_count = device_count;
+    shm->publisher = true;
+    return true;
+}
+
+bool daikin_shm_publish(
+    daikin_shm_t* const shm,
+    uint16_t device,
+    const daikin_device_info_t* const info,
+    uint32_t updated_mask,
+    uint32_t flags,
+    uint64_t now_ms)
+{
+    LIBDAIKIN_ASSERT(shm != NULL && shm->mem != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (shm == NULL || shm->mem == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument shm or info.\n");
+        return false;
+    }
+
+    if (shm->publisher == false || device >= shm->device_count)
+    {
+        LIBDAIKIN_ERROR("Invalid device %u or not a publisher.\n", device);
+        return false;
+    }
+
+    shm_slot_t* const slot = slot_of(shm, device);
+
+    // Single publisher, own slot can be read without the protocol
+    daikin_shm_snapshot_t next = slot->data[0];
+    next.info = *info;
+    next.flags = flags;
+    next.generation++;
+    next.published_ms = now_ms;
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        if ((updated_mask & (1u << f)) != 0)
+            next.field_ms[f] = now_ms;
+    }
+
+    // Odd seq => readers use copy 1 while copy 0 is written, even => the other way around.
+    // A preempted publisher never blocks readers.
+    const uint32_t seq = slot->seq;
+    for (uint8_t copy = 0; copy < 2; copy++)
+    {
+        SHM_STORE(&slot->seq, seq + 1 + copy, SHM_RELAXED);
+        std::atomic_thread_fence(std::memory_order_release); // New seq is visible before the data changes
+
+        const uint32_t* const src = (const uint32_t*)&next;
+        uint32_t* const dst = (uint32_t*)&slot->data[copy];
+        for (uint32_t i = 0; i < SNAPSHOT_WORDS; i++)
+            SHM_STORE(&dst[i], src[i], SHM_RELAXED);
+
+        std::atomic_thread_fence(std::memory_order_release); // Data is complete before seq moves on
+    }
+
+    return true;
+}
+
+bool daikin_shm_attach(
+    daikin_shm_t* const shm,
+    const uint8_t* const mem,
+    uint32_t mem_len)
+{
+    LIBDAIKIN_ASSERT(shm != NULL);
+    LIBDAIKIN_ASSERT(mem != NULL);
+
+    if (shm == NULL || mem == NULL || mem_len < HDR_SIZE)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument shm, mem or mem_len.\n");
+        return false;
+    }
+
+    const shm_region_hdr_t* const hdr = (const shm_region_hdr_t*)mem;
+    if (SHM_LOAD(&hdr->magic, SHM_ACQUIRE) != REGION_MAGIC ||
+        hdr->version != REGION_VERSION ||
+        hdr->slot_size != SLOT_SIZE ||
+        hdr->snapshot_size != sizeof(daikin_shm_snapshot_t))
+    {
+        LIBDAIKIN_ERROR("Region is not formatted or has a different layout.\n");
+        return false;
+    }
+
+    if (mem_len < daikin_shm_size(hdr->device_count))
+    {
+        LIBDAIKIN_ERROR("Region of %u bytes is too small for %u devices.\n", mem_len, hdr->device_count);
+        return false;
+    }
+
+    shm->mem = (uint8_t*)mem;
+    shm->mem_len = mem_len;
+    shm->device_count = hdr->device_count;
+    shm->publisher = false;
+    return true;
+}
+
+bool daikin_shm_read(
+    const daikin_shm_t* const shm,
+    uint16_t device,
+    daikin_shm_snapshot_t* const snapshot)
+{
+    LIBDAIKIN_ASSERT(shm != NULL && shm->mem != NULL);
+    LIBDAIKIN_ASSERT(snapshot != NULL);
+
+    if (shm == NULL || shm->mem == NULL || snapshot == NULL || device >= shm->device_count)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument shm, device or snapshot.\n");
+        return false;
+    }
+
+    const shm_slot_t* const slot = slot_of(shm, device);
+    uint32_t* const dst = (uint32_t*)snapshot;
+
+    for (uint32_t retry = 0; retry < DAIKIN_SHM_READ_RETRIES; retry++)
+    {
+        const uint32_t seq = SHM_LOAD(&slot->seq, SHM_ACQUIRE);
+        if (seq < 2)
+            return false; // Not published yet, no error
+
+        const uint32_t* const src = (const uint32_t*)&slot->data[seq & 1];
+        for (uint32_t i = 0; i < SNAPSHOT_WORDS; i++)
+            dst[i] = SHM_LOAD(&src[i], SHM_RELAXED);
+
+        std::atomic_thread_fence(std::memory_order_acquire); // Data is read before seq is checked again
+
+        // Publisher started on the copy we read => retry
+        if (SHM_LOAD(&slot->seq, SHM_RELAXED) == seq)
+            return true;
+    }
+
+    LIBDAIKIN_TRACE("Slot %u kept changing during the read.\n", device);
+    return false;
+}
+
+#ifdef SHM_HAS_POSIX
+
+bool daikin_shm_map(
+    const char* const name,
+    bool publisher,
+    uint32_t* const len,
+    uint8_t** const mem)
+{
+    LIBDAIKIN_ASSERT((name != NULL) && (strlen(name) > 0));
+    LIBDAIKIN_ASSERT(len != NULL);
+    LIBDAIKIN_ASSERT(mem != NULL);
+
+    int fd = shm_open(name, publisher ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (fd < 0)
+    {
+        LIBDAIKIN_ERROR("Unable to open shared memory '%s'.\n", name);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        LIBDAIKIN_ERROR("Unable to stat shared memory '%s'.\n", name);
+        close(fd);
+        return false;
+    }
+
+    if (publisher && st.st_size < (off_t)*len && ftruncate(fd, (off_t)*len) != 0)
+    {
+        LIBDAIKIN_ERROR("Unable to size shared memory '%s' to %u bytes.\n", name, *len);
+        close(fd);
+        return false;
+    }
+
+    if (publisher == false && (*len == 0 || (off_t)*len > st.st_size))
+        *len = (uint32_t)st.st_size;
+
+    if (*len == 0)
+    {
+        LIBDAIKIN_ERROR("Shared memory '%s' is empty.\n", name);
+        close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, *len, publisher ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+    {
+        LIBDAIKIN_ERROR("Unable to map shared memory '%s'.\n", name);
+        return false;
+    }
+
+    *mem = (uint8_t*)p;
+    return true;
+}
+
+void daikin_shm_unmap(uint8_t* const mem, uint32_t len)
+{
+    if (mem != NULL)
+        munmap(mem, len);
+}
+
+bool daikin_shm_unlink(const char* const name)
+{
+    LIBDAIKIN_ASSERT((name != NULL) && (strlen(name) > 0));
+
+    return shm_unlink(name) == 0;
+}
+
+#else
+
+bool daikin_shm_map(const char* const name, bool publisher, uint32_t* const len, uint8_t** const mem)
+{
+    (void)name;
+    (void)publisher;
+    (void)len;
+    (void)mem;
+    LIBDAIKIN_ERROR("Shared memory is not supported on this platform.\n");
+    return false;
+}
+
+void daikin_shm_unmap(uint8_t* const mem, uint32_t len)
+{
+    (void)mem;
+    (void)len;
+}
+
+bool daikin_shm_unlink(const char* const name)
+{
+    (void)name;
+    return false;
+}
+
+#endif
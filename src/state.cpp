@@ -0,0 +1,320 @@
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <sys/mman.h>
+#   define STATE_HAS_MMAP 1
+#endif
+
+#include "../include/libdaikinstate.h"
+
+#include "checksum.h"
+#include "map_file.h"
+#include "trace.h"
+
+static const uint32_t REGION_MAGIC = 0x54534B44; // 'DKST'
+static const uint16_t REGION_VERSION = 2; // 2 => capability blob
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t device_count;
+    uint32_t record_size;   // Detects other builds of daikin_state_record_t
+    uint32_t crc;           // Of the fields above
+} state_region_hdr_t;
+
+typedef struct
+{
+    uint32_t crc;           // Of seq and record
+    uint32_t seq;           // Of the save, 0 => never saved
+    daikin_state_record_t record;
+} state_copy_t;
+
+typedef struct
+{
+    state_copy_t copies[2];
+} state_slot_t;
+
+static const uint32_t HDR_SIZE = (sizeof(state_region_hdr_t) + 7) / 8 * 8;
+
+static state_slot_t* slot_of(const daikin_state_t* const state, uint16_t device)
+{
+    return (state_slot_t*)(state->mem + HDR_SIZE + (uint32_t)device * sizeof(state_slot_t));
+}
+
+static uint32_t hdr_crc(const state_region_hdr_t* const hdr)
+{
+    return daikin_crc32(hdr, offsetof(state_region_hdr_t, crc));
+}
+
+static uint32_t copy_crc(const state_copy_t* const copy)
+{
+    return daikin_crc32(&copy->seq, sizeof(state_copy_t) - offsetof(state_copy_t, seq));
+}
+
+static bool is_valid_copy(const state_copy_t* const copy)
+{
+    return copy->seq != 0 && copy->crc == copy_crc(copy);
+}
+
+static bool is_newer(uint32_t seq, uint32_t than)
+{
+    return (int32_t)(seq - than) > 0; // Wrap safe
+}
+
+// Newest valid copy, NULL => none
+static const state_copy_t* newest_copy(const state_slot_t* const slot)
+{
+    const state_copy_t* const a = &slot->copies[0];
+    const state_copy_t* const b = &slot->copies[1];
+    const bool a_valid = is_valid_copy(a);
+    const bool b_valid = is_valid_copy(b);
+
+    if (a_valid && b_valid)
+        return is_newer(b->seq, a->seq) ? b : a;
+
+    return a_valid ? a : (b_valid ? b : NULL);
+}
+
+static bool is_valid_device(const daikin_state_t* const state, uint16_t device)
+{
+    if (state == NULL || state->mem == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument state, not opened.\n");
+        return false;
+    }
+
+    if (device >= state->device_count)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument device %u, region has %u devices.\n", device, state->device_count);
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t daikin_state_size(uint16_t device_count)
+{
+    return HDR_SIZE + (uint32_t)device_count * sizeof(state_slot_t);
+}
+
+bool daikin_state_open(
+    daikin_state_t* const state,
+    uint8_t* const mem,
+    uint32_t mem_len,
+    uint16_t device_count,
+    uint16_t* const restored)
+{
+    LIBDAIKIN_ASSERT(state != NULL);
+    LIBDAIKIN_ASSERT(mem != NULL);
+    LIBDAIKIN_ASSERT(device_count > 0);
+
+    if (state == NULL || mem == NULL || device_count == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument state, mem or device_count.\n");
+        return false;
+    }
+
+    if (mem_len < daikin_state_size(device_count))
+    {
+        LIBDAIKIN_ERROR("Region of %u bytes is too small for %u devices.\n", mem_len, device_count);
+        return false;
+    }
+
+    state->mem = mem;
+    state->mem_len = mem_len;
+    state->device_count = device_count;
+
+    state_region_hdr_t* const hdr = (state_region_hdr_t*)mem;
+    const bool same_layout = hdr->magic == REGION_MAGIC && hdr->version == REGION_VERSION &&
+        hdr->record_size == sizeof(daikin_state_record_t) && hdr->crc == hdr_crc(hdr);
+
+    // Slots of devices the region didn't have start empty
+    const uint16_t kept = same_layout ? (hdr->device_count < device_count ? hdr->device_count : device_count) : 0;
+    memset(mem + daikin_state_size(kept), 0, daikin_state_size(device_count) - daikin_state_size(kept));
+
+    uint16_t valid = 0;
+    for (uint16_t i = 0; i < kept; i++)
+        valid += newest_copy(slot_of(state, i)) != NULL ? 1 : 0;
+
+    if (same_layout)
+    {
+        LIBDAIKIN_INFO("State of %u of %u devices restored.\n", valid, device_count);
+    }
+    else
+    {
+        LIBDAIKIN_INFO("State region formatted for %u devices.\n", device_count);
+    }
+
+    hdr->magic = REGION_MAGIC;
+    hdr->version = REGION_VERSION;
+    hdr->device_count = device_count;
+    hdr->record_size = sizeof(daikin_state_record_t);
+    hdr->crc = hdr_crc(hdr);
+
+    if (restored != NULL)
+        *restored = valid;
+
+    return true;
+}
+
+bool daikin_state_save(
+    daikin_state_t* const state,
+    uint16_t device,
+    const daikin_state_record_t* const record)
+{
+    LIBDAIKIN_ASSERT(state != NULL);
+    LIBDAIKIN_ASSERT(record != NULL);
+
+    if (record == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record.\n");
+        return false;
+    }
+
+    if (is_valid_device(state, device) == false)
+        return false; // No extra error info needed
+
+    state_slot_t* const slot = slot_of(state, device);
+    const state_copy_t* const newest = newest_copy(slot);
+
+    // The newest copy stays intact until the other one is complete
+    state_copy_t* const copy = newest == &slot->copies[0] ? &slot->copies[1] : &slot->copies[0];
+    copy->seq = newest != NULL ? newest->seq + 1 : 1;
+    copy->seq += copy->seq == 0 ? 1 : 0;
+    memcpy(&copy->record, record, sizeof(copy->record));
+    copy->crc = copy_crc(copy);
+    return true;
+}
+
+bool daikin_state_load(
+    const daikin_state_t* const state,
+    uint16_t device,
+    daikin_state_record_t* const record)
+{
+    LIBDAIKIN_ASSERT(state != NULL);
+    LIBDAIKIN_ASSERT(record != NULL);
+
+    if (record == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record.\n");
+        return false;
+    }
+
+    if (is_valid_device(state, device) == false)
+        return false; // No extra error info needed
+
+    const state_copy_t* const newest = newest_copy(slot_of(state, device));
+    if (newest == NULL)
+        return false; // Never saved, not an error
+
+    memcpy(record, &newest->record, sizeof(*record));
+    return true;
+}
+
+static bool is_empty_blob(const uint8_t* const blob, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (blob[i] != 0)
+            return false;
+    }
+
+    return true;
+}
+
+void daikin_state_capture(
+    daikin_state_record_t* const record,
+    const daikin_t* const daikin,
+    const daikin_health_t* const health)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (record == NULL || daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record or daikin.\n");
+        return;
+    }
+
+    memset(record->capabilities, 0, sizeof(record->capabilities));
+    if ((daikin->capabilities & DAIKIN_CAPS_DISCOVERED) != 0)
+        daikin_capabilities_save(daikin, record->capabilities, sizeof(record->capabilities));
+
+    if (health != NULL)
+        record->health = *health;
+}
+
+void daikin_state_apply(
+    const daikin_state_record_t* const record,
+    daikin_t* const daikin,
+    daikin_health_t* const health)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (record == NULL || daikin == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record or daikin.\n");
+        return;
+    }
+
+    // Same checks as a capabilities file, a map of another registry would skip the wrong paths
+    const uint8_t* const blob = record->capabilities;
+    if (is_empty_blob(blob, sizeof(record->capabilities)) ||
+        daikin_capabilities_load(daikin, blob, sizeof(record->capabilities)) == false)
+        daikin->capabilities = 0;
+
+    if (health == NULL)
+        return;
+
+    const daikin_health_config_t config = health->config;
+    *health = record->health;
+    health->config = config;
+    health->probing = false;
+    health->open_until_ms = 0;
+    if (health->state == daikin_health_state_t::HS_OPEN)
+        health->state = daikin_health_state_t::HS_HALF_OPEN;
+}
+
+bool daikin_state_map_file(const char* const path, uint32_t len, uint8_t** const mem)
+{
+    return daikin_map_file(path, len, mem);
+}
+
+void daikin_state_unmap_file(uint8_t* const mem, uint32_t len)
+{
+    daikin_unmap_file(mem, len);
+}
+
+#ifdef STATE_HAS_MMAP
+
+bool daikin_state_sync(const daikin_state_t* const state)
+{
+    LIBDAIKIN_ASSERT(state != NULL && state->mem != NULL);
+
+    if (state == NULL || state->mem == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument state.\n");
+        return false;
+    }
+
+    if (msync(state->mem, daikin_state_size(state->device_count), MS_SYNC) != 0)
+    {
+        LIBDAIKIN_ERROR("msync failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+#else
+
+bool daikin_state_sync(const daikin_state_t* const state)
+{
+    (void)state;
+    return true; // Region is plain memory
+}
+
+#endif
@@ -0,0 +1,19 @@
+#include "time_util.h"
+#include "trace.h"
+
+bool daikin_time_is_due(uint32_t now_ms, uint32_t due_ms)
+{
+    return (int32_t)(now_ms - due_ms) >= 0;
+}
+
+uint32_t daikin_random_next(uint32_t* const state)
+{
+    LIBDAIKIN_ASSERT(state != NULL);
+
+    uint32_t x = *state != 0 ? *state : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
@@ -0,0 +1,21 @@
+#ifndef __TIME_UTIL_H__
+#define __TIME_UTIL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// now_ms reached due_ms, also across the uint32_t wrap (due within 24 days)
+bool     daikin_time_is_due(uint32_t now_ms, uint32_t due_ms);
+
+// xorshift32, state 0 is replaced by a fixed seed
+uint32_t daikin_random_next(uint32_t* const state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,712 @@
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <sys/mman.h>
+#   define TSDB_HAS_MMAP 1
+#endif
+
+#include "../include/libdaikintsdb.h"
+
+#include "fields.h"
+#include "map_file.h"
+#include "trace.h"
+
+static const uint32_t REGION_MAGIC = 0x53544B44; // 'DKTS'
+static const uint32_t SEGMENT_MAGIC = 0x47534B44; // 'DKSG'
+static const uint16_t REGION_VERSION = 1;
+
+static const uint16_t MIN_SEGMENT_SIZE = 256;
+static const uint16_t MAX_SEGMENT_SIZE = 16384; // Keeps column bit positions within uint16_t
+
+static const uint8_t WORST_DOD_BITS = 4 + 32;
+static const uint8_t WORST_XOR_BITS = 1 + 1 + 5 + 5 + 32;
+static const uint8_t NO_WINDOW = 0xFF;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t segment_size;
+    uint32_t segment_count;
+    uint32_t reserved;
+} tsdb_region_hdr_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t t_first;
+    uint32_t t_last;
+    uint16_t count;
+    uint16_t bits[DAIKIN_TSDB_COLUMNS]; // Used bits per column
+} tsdb_segment_hdr_t;
+
+static uint8_t clz32(uint32_t v)
+{
+    LIBDAIKIN_ASSERT(v != 0);
+
+    uint8_t n = 0;
+    while ((v & 0x80000000) == 0)
+    {
+        v <<= 1;
+        n++;
+    }
+    return n;
+}
+
+static uint8_t ctz32(uint32_t v)
+{
+    LIBDAIKIN_ASSERT(v != 0);
+
+    uint8_t n = 0;
+    while ((v & 1) == 0)
+    {
+        v >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static void write_bits(uint8_t* const base, uint32_t* const pos, uint32_t value, uint8_t n)
+{
+    LIBDAIKIN_ASSERT(base != NULL);
+    LIBDAIKIN_ASSERT(pos != NULL);
+    LIBDAIKIN_ASSERT(n > 0 && n <= 32);
+
+    // MSB first, segment memory is zeroed on segment start
+    for (int8_t i = (int8_t)(n - 1); i >= 0; i--)
+    {
+        if ((value >> i) & 1)
+            base[*pos >> 3] |= (uint8_t)(0x80 >> (*pos & 7));
+        (*pos)++;
+    }
+}
+
+static uint32_t read_bits(const uint8_t* const base, uint32_t* const pos, uint8_t n)
+{
+    LIBDAIKIN_ASSERT(base != NULL);
+    LIBDAIKIN_ASSERT(pos != NULL);
+    LIBDAIKIN_ASSERT(n > 0 && n <= 32);
+
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        v = (v << 1) | ((base[*pos >> 3] >> (7 - (*pos & 7))) & 1);
+        (*pos)++;
+    }
+    return v;
+}
+
+static bool column_is_float(uint8_t column)
+{
+    return column > 0 && daikin_field_is_float((daikin_field_t)(column - 1));
+}
+
+static uint8_t column_weight(uint8_t column)
+{
+    if (column == 0)
+        return 2; // Timestamps
+    if (column_is_float(column))
+        return 4;
+    return 1;
+}
+
+static void column_slice(
+    uint16_t segment_size,
+    uint8_t column,
+    uint32_t* const offset,
+    uint32_t* const bits)
+{
+    LIBDAIKIN_ASSERT(column < DAIKIN_TSDB_COLUMNS);
+
+    uint32_t total_weight = 0, weight_before = 0;
+    for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+    {
+        if (c == column)
+            weight_before = total_weight;
+        total_weight += column_weight(c);
+    }
+
+    const uint32_t unit = (segment_size - (uint32_t)sizeof(tsdb_segment_hdr_t)) / total_weight;
+    *offset = (uint32_t)sizeof(tsdb_segment_hdr_t) + weight_before * unit;
+    *bits = column_weight(column) * unit * 8;
+}
+
+static tsdb_segment_hdr_t* segment_at(const daikin_tsdb_t* const tsdb, uint32_t index)
+{
+    LIBDAIKIN_ASSERT(index < tsdb->segment_count);
+
+    return (tsdb_segment_hdr_t*)(tsdb->mem + sizeof(tsdb_region_hdr_t) + index * tsdb->segment_size);
+}
+
+static void column_reset(daikin_tsdb_column_t* const col)
+{
+    memset(col, 0, sizeof(daikin_tsdb_column_t));
+    col->leading = NO_WINDOW;
+}
+
+static void encode_dod(uint8_t* const base, uint32_t* const pos, daikin_tsdb_column_t* const col, uint32_t v)
+{
+    const uint32_t delta = v - col->prev;
+    const int32_t dod = (int32_t)(delta - (uint32_t)col->prev_delta);
+
+    if (dod == 0)
+        write_bits(base, pos, 0, 1);
+    else if (dod >= -63 && dod <= 64)
+    {
+        write_bits(base, pos, 0b10, 2);
+        write_bits(base, pos, (uint32_t)dod & 0x7F, 7);
+    }
+    else if (dod >= -255 && dod <= 256)
+    {
+        write_bits(base, pos, 0b110, 3);
+        write_bits(base, pos, (uint32_t)dod & 0x1FF, 9);
+    }
+    else if (dod >= -2047 && dod <= 2048)
+    {
+        write_bits(base, pos, 0b1110, 4);
+        write_bits(base, pos, (uint32_t)dod & 0xFFF, 12);
+    }
+    else
+    {
+        write_bits(base, pos, 0b1111, 4);
+        write_bits(base, pos, (uint32_t)dod, 32);
+    }
+
+    col->prev = v;
+    col->prev_delta = (int32_t)delta;
+}
+
+static uint32_t decode_dod(const uint8_t* const base, uint32_t* const pos, daikin_tsdb_column_t* const col)
+{
+    static const uint8_t DOD_BITS[] = { 0, 7, 9, 12, 32 };
+
+    uint8_t ones = 0;
+    while (ones < 4 && read_bits(base, pos, 1) == 1)
+        ones++;
+
+    uint32_t dod = 0;
+    const uint8_t n = DOD_BITS[ones];
+    if (n > 0)
+    {
+        dod = read_bits(base, pos, n);
+        if (n < 32 && dod > (1u << (n - 1)))
+            dod -= (1u << n); // Sign extend
+    }
+
+    const uint32_t delta = (uint32_t)col->prev_delta + dod;
+    col->prev += delta;
+    col->prev_delta = (int32_t)delta;
+    return col->prev;
+}
+
+static void encode_xor(uint8_t* const base, uint32_t* const pos, daikin_tsdb_column_t* const col, uint32_t v)
+{
+    const uint32_t x = v ^ col->prev;
+    col->prev = v;
+
+    if (x == 0)
+    {
+        write_bits(base, pos, 0, 1);
+        return;
+    }
+
+    write_bits(base, pos, 1, 1);
+
+    uint8_t leading = clz32(x);
+    const uint8_t trailing = ctz32(x);
+    if (leading > 31)
+        leading = 31;
+
+    if (col->leading != NO_WINDOW && leading >= col->leading && trailing >= col->trailing)
+    {
+        // Meaningful bits fit into the previous window
+        write_bits(base, pos, 0, 1);
+        write_bits(base, pos, x >> col->trailing, (uint8_t)(32 - col->leading - col->trailing));
+        return;
+    }
+
+    const uint8_t len = (uint8_t)(32 - leading - trailing);
+    write_bits(base, pos, 1, 1);
+    write_bits(base, pos, leading, 5);
+    write_bits(base, pos, (uint32_t)(len - 1), 5);
+    write_bits(base, pos, x >> trailing, len);
+
+    col->leading = leading;
+    col->trailing = trailing;
+}
+
+static uint32_t decode_xor(const uint8_t* const base, uint32_t* const pos, daikin_tsdb_column_t* const col)
+{
+    if (read_bits(base, pos, 1) == 0)
+        return col->prev;
+
+    if (read_bits(base, pos, 1) == 1)
+    {
+        col->leading = (uint8_t)read_bits(base, pos, 5);
+        const uint8_t len = (uint8_t)(read_bits(base, pos, 5) + 1);
+        col->trailing = (uint8_t)(32 - col->leading - len);
+    }
+
+    const uint8_t len = (uint8_t)(32 - col->leading - col->trailing);
+    col->prev ^= read_bits(base, pos, len) << col->trailing;
+    return col->prev;
+}
+
+static void encode_value(
+    uint8_t* const seg,
+    tsdb_segment_hdr_t* const hdr,
+    daikin_tsdb_t* const tsdb,
+    uint8_t column,
+    uint32_t v)
+{
+    uint32_t offset, bits;
+    column_slice(tsdb->segment_size, column, &offset, &bits);
+
+    uint32_t pos = hdr->bits[column];
+    daikin_tsdb_column_t* const col = &tsdb->columns[column];
+
+    if (hdr->count == 0)
+    {
+        // First sample in the segment is stored raw
+        write_bits(seg + offset, &pos, v, 32);
+        col->prev = v;
+    }
+    else if (column_is_float(column))
+        encode_xor(seg + offset, &pos, col, v);
+    else
+        encode_dod(seg + offset, &pos, col, v);
+
+    LIBDAIKIN_ASSERT(pos <= bits);
+    hdr->bits[column] = (uint16_t)pos;
+}
+
+static uint32_t decode_value(
+    const uint8_t* const seg,
+    uint16_t segment_size,
+    uint8_t column,
+    uint16_t index,
+    uint32_t* const pos,
+    daikin_tsdb_column_t* const col)
+{
+    uint32_t offset, bits;
+    column_slice(segment_size, column, &offset, &bits);
+
+    if (index == 0)
+    {
+        column_reset(col);
+        col->prev = read_bits(seg + offset, pos, 32);
+        return col->prev;
+    }
+
+    if (column_is_float(column))
+        return decode_xor(seg + offset, pos, col);
+
+    return decode_dod(seg + offset, pos, col);
+}
+
+static uint8_t worst_bits(uint8_t column)
+{
+    return column_is_float(column) ? WORST_XOR_BITS : WORST_DOD_BITS;
+}
+
+static bool segment_fits(const daikin_tsdb_t* const tsdb, const tsdb_segment_hdr_t* const hdr)
+{
+    if (hdr->count == 0xFFFF)
+        return false;
+
+    for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+    {
+        uint32_t offset, bits;
+        column_slice(tsdb->segment_size, c, &offset, &bits);
+
+        if (hdr->bits[c] + worst_bits(c) > bits)
+            return false;
+    }
+
+    return true;
+}
+
+static void segment_start(daikin_tsdb_t* const tsdb, uint32_t index, uint32_t seq)
+{
+    tsdb_segment_hdr_t* const hdr = segment_at(tsdb, index);
+    memset(hdr, 0, tsdb->segment_size);
+    hdr->seq = seq;
+    hdr->magic = SEGMENT_MAGIC;
+
+    for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+        column_reset(&tsdb->columns[c]);
+
+    tsdb->active = index;
+}
+
+// Decodes up to count samples of all columns, returns the number which end within the used bits
+static uint16_t segment_replay(daikin_tsdb_t* const tsdb, uint16_t count, uint32_t* const pos, uint32_t* const t_first)
+{
+    const tsdb_segment_hdr_t* const hdr = segment_at(tsdb, tsdb->active);
+    const uint8_t* const seg = (const uint8_t*)hdr;
+
+    for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+    {
+        pos[c] = 0;
+        column_reset(&tsdb->columns[c]);
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+        {
+            uint32_t offset, bits;
+            column_slice(tsdb->segment_size, c, &offset, &bits);
+
+            // Appends leave room for the worst case, so this bounds reads of a corrupted segment too
+            if (pos[c] + worst_bits(c) > bits)
+                return i;
+
+            const uint32_t v = decode_value(seg, tsdb->segment_size, c, i, &pos[c], &tsdb->columns[c]);
+            if (pos[c] > hdr->bits[c])
+                return i; // Zeroed memory decodes too, bits ends the data
+
+            if (c == 0 && i == 0)
+                *t_first = v;
+        }
+    }
+
+    return count;
+}
+
+static void segment_recover(daikin_tsdb_t* const tsdb)
+{
+    // Replay the active segment to restore encoder state. A crash within an append leaves bits of
+    // a sample which isn't counted (or a broken tail), they are cleared and the segment ends before.
+    tsdb_segment_hdr_t* const hdr = segment_at(tsdb, tsdb->active);
+    uint8_t* const seg = (uint8_t*)hdr;
+    uint32_t pos[DAIKIN_TSDB_COLUMNS];
+    uint32_t t_first = 0;
+    bool torn = false;
+
+    uint16_t count = segment_replay(tsdb, hdr->count, pos, &t_first);
+    if (count < hdr->count)
+    {
+        LIBDAIKIN_INFO("Segment %u is cut to %u of %u samples.\n", tsdb->active, count, hdr->count);
+        count = segment_replay(tsdb, count, pos, &t_first);
+    }
+
+    for (uint8_t c = 0; c < DAIKIN_TSDB_COLUMNS; c++)
+    {
+        uint32_t offset, bits;
+        column_slice(tsdb->segment_size, c, &offset, &bits);
+
+        torn |= pos[c] != hdr->bits[c];
+
+        // Appends OR bits into zeroed memory
+        uint8_t* const base = seg + offset;
+        const uint32_t next = (pos[c] + 7) / 8;
+        if ((pos[c] & 7) != 0)
+            base[pos[c] >> 3] &= (uint8_t)~(0xFF >> (pos[c] & 7));
+        memset(base + next, 0, bits / 8 - next);
+
+        hdr->bits[c] = (uint16_t)pos[c];
+    }
+
+    if (torn)
+        LIBDAIKIN_INFO("Segment %u had bits of an incomplete append, cleared.\n", tsdb->active);
+
+    hdr->count = count;
+    hdr->t_first = count > 0 ? t_first : 0;
+    hdr->t_last = count > 0 ? tsdb->columns[0].prev : 0;
+}
+
+bool daikin_tsdb_open(
+    daikin_tsdb_t* const tsdb,
+    uint8_t* const mem,
+    uint32_t mem_len,
+    uint16_t segment_size)
+{
+    LIBDAIKIN_ASSERT(tsdb != NULL);
+    LIBDAIKIN_ASSERT(mem != NULL);
+
+    if (tsdb == NULL || mem == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument tsdb or mem.\n");
+        return false;
+    }
+
+    if (segment_size == 0)
+        segment_size = DAIKIN_TSDB_SEGMENT_SIZE;
+
+    if ((segment_size % 4) != 0 || segment_size < MIN_SEGMENT_SIZE || segment_size > MAX_SEGMENT_SIZE)
+    {
+        LIBDAIKIN_ERROR("Invalid segment size: %u.\n", segment_size);
+        return false;
+    }
+
+    if (mem_len < sizeof(tsdb_region_hdr_t) + segment_size)
+    {
+        LIBDAIKIN_ERROR("Region too small: %u bytes.\n", mem_len);
+        return false;
+    }
+
+    memset(tsdb, 0, sizeof(daikin_tsdb_t));
+    tsdb->mem = mem;
+    tsdb->mem_len = mem_len;
+    tsdb->segment_size = segment_size;
+    tsdb->segment_count = (mem_len - (uint32_t)sizeof(tsdb_region_hdr_t)) / segment_size;
+
+    tsdb_region_hdr_t* const region = (tsdb_region_hdr_t*)mem;
+    if (
+        region->magic == REGION_MAGIC &&
+        region->version == REGION_VERSION &&
+        region->segment_size == segment_size &&
+        region->segment_count == tsdb->segment_count)
+    {
+        // Find the newest segment
+        uint32_t max_seq = 0;
+        for (uint32_t i = 0; i < tsdb->segment_count; i++)
+        {
+            const tsdb_segment_hdr_t* const hdr = segment_at(tsdb, i);
+            if (hdr->magic == SEGMENT_MAGIC && hdr->seq > max_seq)
+            {
+                max_seq = hdr->seq;
+                tsdb->active = i;
+            }
+        }
+
+        if (max_seq > 0)
+        {
+            segment_recover(tsdb); // Sealed segments are kept as they are
+            return true;
+        }
+
+        LIBDAIKIN_INFO("Telemetry store is not valid. Formatting.\n");
+    }
+
+    memset(region, 0, sizeof(tsdb_region_hdr_t));
+    for (uint32_t i = 0; i < tsdb->segment_count; i++)
+        segment_at(tsdb, i)->magic = 0;
+
+    region->version = REGION_VERSION;
+    region->segment_size = segment_size;
+    region->segment_count = tsdb->segment_count;
+    region->magic = REGION_MAGIC;
+
+    segment_start(tsdb, 0, 1);
+    return true;
+}
+
+bool daikin_tsdb_append(
+    daikin_tsdb_t* const tsdb,
+    uint32_t t,
+    const daikin_device_info_t* const info)
+{
+    LIBDAIKIN_ASSERT(tsdb != NULL && tsdb->mem != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (tsdb == NULL || tsdb->mem == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument tsdb or info.\n");
+        return false;
+    }
+
+    tsdb_segment_hdr_t* hdr = segment_at(tsdb, tsdb->active);
+    if (hdr->count > 0 && t < hdr->t_last)
+    {
+        LIBDAIKIN_ERROR("Timestamp %u is older than the last one %u.\n", t, hdr->t_last);
+        return false;
+    }
+
+    if (segment_fits(tsdb, hdr) == false)
+    {
+        const uint32_t seq = hdr->seq + 1;
+        segment_start(tsdb, (tsdb->active + 1) % tsdb->segment_count, seq);
+        hdr = segment_at(tsdb, tsdb->active);
+    }
+
+    uint8_t* const seg = (uint8_t*)hdr;
+    if (hdr->count == 0)
+        hdr->t_first = t;
+
+    encode_value(seg, hdr, tsdb, 0, t);
+
+    for (uint8_t f = 0; f < DF_COUNT; f++)
+    {
+        const daikin_field_t field = (daikin_field_t)f;
+        uint32_t v;
+
+        if (daikin_field_is_float(field))
+        {
+            const float temp = daikin_field_get_float(info, field);
+            memcpy(&v, &temp, sizeof(v));
+        }
+        else
+            v = (uint32_t)daikin_field_get_int32(info, field);
+
+        encode_value(seg, hdr, tsdb, (uint8_t)(f + 1), v);
+    }
+
+    hdr->t_last = t;
+    hdr->count++; // Publish the sample last
+    return true;
+}
+
+bool daikin_tsdb_query(
+    const daikin_tsdb_t* const tsdb,
+    daikin_field_t field,
+    uint32_t t_from,
+    uint32_t t_to,
+    daikin_tsdb_sample_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(tsdb != NULL && tsdb->mem != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    if (tsdb == NULL || tsdb->mem == NULL || field >= daikin_field_t::DF_COUNT || cb == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument tsdb, field or cb.\n");
+        return false;
+    }
+
+    const uint8_t column = (uint8_t)(field + 1);
+    const bool is_float = daikin_field_is_float(field);
+
+    // Oldest segment follows the active one in the ring
+    for (uint32_t i = 1; i <= tsdb->segment_count; i++)
+    {
+        const uint32_t index = (tsdb->active + i) % tsdb->segment_count;
+        const tsdb_segment_hdr_t* const hdr = segment_at(tsdb, index);
+
+        if (hdr->magic != SEGMENT_MAGIC || hdr->count == 0)
+            continue;
+        if (hdr->t_last < t_from || hdr->t_first > t_to)
+            continue;
+
+        const uint8_t* const seg = (const uint8_t*)hdr;
+        daikin_tsdb_column_t ts_col, v_col;
+        uint32_t ts_pos = 0, v_pos = 0;
+
+        for (uint16_t s = 0; s < hdr->count; s++)
+        {
+            const uint32_t t = decode_value(seg, tsdb->segment_size, 0, s, &ts_pos, &ts_col);
+            const uint32_t v = decode_value(seg, tsdb->segment_size, column, s, &v_pos, &v_col);
+
+            if (t > t_to)
+                return true;
+            if (t < t_from)
+                continue;
+
+            double value;
+            if (is_float)
+            {
+                float temp;
+                memcpy(&temp, &v, sizeof(temp));
+                value = (double)temp;
+            }
+            else
+                value = (double)(int32_t)v;
+
+            if (cb(ctx, t, value) == false)
+                return true;
+        }
+    }
+
+    return true;
+}
+
+typedef struct
+{
+    uint32_t t_from;
+    uint32_t bucket_len;
+    daikin_tsdb_bucket_t* out;
+    uint32_t max_buckets;
+    uint32_t used;
+} tsdb_downsample_ctx_t;
+
+static bool downsample_cb(void* ctx, uint32_t t, double value)
+{
+    tsdb_downsample_ctx_t* const d = (tsdb_downsample_ctx_t*)ctx;
+
+    const uint32_t index = (t - d->t_from) / d->bucket_len;
+    if (index >= d->max_buckets)
+        return false;
+
+    while (d->used <= index)
+    {
+        daikin_tsdb_bucket_t* const b = &d->out[d->used];
+        memset(b, 0, sizeof(daikin_tsdb_bucket_t));
+        b->t_start = d->t_from + d->used * d->bucket_len;
+        d->used++;
+    }
+
+    daikin_tsdb_bucket_t* const b = &d->out[index];
+    const float v = (float)value;
+
+    if (b->count == 0 || v < b->min)
+        b->min = v;
+    if (b->count == 0 || v > b->max)
+        b->max = v;
+
+    b->count++;
+    b->avg += (v - b->avg) / (float)b->count; // Running mean
+    return true;
+}
+
+uint32_t daikin_tsdb_downsample(
+    const daikin_tsdb_t* const tsdb,
+    daikin_field_t field,
+    uint32_t t_from,
+    uint32_t t_to,
+    uint32_t bucket_len,
+    daikin_tsdb_bucket_t* const out,
+    uint32_t max_buckets)
+{
+    LIBDAIKIN_ASSERT(bucket_len > 0);
+    LIBDAIKIN_ASSERT(out != NULL);
+
+    if (bucket_len == 0 || out == NULL || max_buckets == 0)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument bucket_len, out or max_buckets.\n");
+        return 0;
+    }
+
+    tsdb_downsample_ctx_t ctx = { t_from, bucket_len, out, max_buckets, 0 };
+    if (daikin_tsdb_query(tsdb, field, t_from, t_to, downsample_cb, &ctx) == false)
+        return 0; // No extra error info needed
+
+    return ctx.used;
+}
+
+bool daikin_tsdb_map_file(const char* const path, uint32_t len, uint8_t** const mem)
+{
+    return daikin_map_file(path, len, mem);
+}
+
+void daikin_tsdb_unmap_file(uint8_t* const mem, uint32_t len)
+{
+    daikin_unmap_file(mem, len);
+}
+
+#ifdef TSDB_HAS_MMAP
+
+bool daikin_tsdb_sync(const daikin_tsdb_t* const tsdb)
+{
+    LIBDAIKIN_ASSERT(tsdb != NULL && tsdb->mem != NULL);
+
+    if (msync(tsdb->mem, tsdb->mem_len, MS_SYNC) != 0)
+    {
+        LIBDAIKIN_ERROR("msync failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+#else
+
+bool daikin_tsdb_sync(const daikin_tsdb_t* const tsdb)
+{
+    (void)tsdb;
+    return true; // Region is plain memory
+}
+
+#endif
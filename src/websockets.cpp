@@ -4,6 +4,7 @@
 
 #include "websockets.h"
 #include "websockets_frame.h"
+#include "limiter.h"
 #include "trace.h"
 
 #include "../include/libdaikinhal.h"
@@ -25,6 +26,8 @@ static const char WS_RESPONSE_LINE3[] =
 "upgrade: websocket";
 static const char WS_RESPONSE_LINE4[] =
 "sec-websocket-accept:";
+static const char WS_RESPONSE_EXTENSIONS[] =
+"sec-websocket-extensions:";
 
 static char* str_to_lower(
     char* const s)
@@ -275,19 +278,26 @@ static int32_t sha1_digest(
     return 0;
 }
 
-static std::string ws_create_key()
+static uint32_t ws_max_message_len(const daikin_t* const daikin)
 {
-    srand((unsigned)clock());
+    return daikin->max_message_len > 0 ? daikin->max_message_len : DAIKIN_WS_MAX_MESSAGE;
+}
 
+static ws_deflate_t* ws_deflate_of(const daikin_t* const daikin)
+{
+    return (ws_deflate_t*)daikin->ws_deflate_state;
+}
+
+static std::string ws_create_key()
+{
     char buf[16];
     const int16_t len = sizeof(buf);
-    for (int16_t i = 0; i < len; i++)
-        buf[i] = (char)(rand() % 256);
+    ws_random_fill(buf, len);
 
     return base64_encode_to_string(buf, len);
 }
 
-static std::string ws_create_expected_hash(
+std::string ws_create_accept_hash(
     const std::string& key)
 {
     LIBDAIKIN_ASSERT(key.size() > 0);
@@ -301,21 +311,35 @@ static std::string ws_create_expected_hash(
         return "";
     }
 
-    std::string expected_hash_base64 =
-        base64_encode_to_string(digest, sizeof(digest));
+    return base64_encode_to_string(digest, sizeof(digest));
+}
+
+static std::string ws_create_expected_hash(
+    const std::string& key)
+{
+    LIBDAIKIN_ASSERT(key.size() > 0);
+
+    std::string expected_hash_base64 = ws_create_accept_hash(key);
+    if (expected_hash_base64.length() == 0)
+        return ""; // No extra error info needed
+
     str_to_lower(&expected_hash_base64[0]);
     return expected_hash_base64;
 }
 
-static std::string ws_create_handshake_request(const std::string& key)
+static std::string ws_create_handshake_request(
+    const daikin_hal_tcp_t* const tcp,
+    const std::string& key,
+    const std::string& extensions)
 {
+    LIBDAIKIN_ASSERT(tcp != NULL);
     LIBDAIKIN_ASSERT(key.size() > 0);
 
     std::string req = std::string("GET /mca HTTP/1.1\r\n");
     req += "Host: ";
-    req += DAIKIN_REMOTE_IP;
+    req += DAIKIN_HAL_REMOTE_IP(tcp);
     req += ":";
-    req += std::to_string(DAIKIN_REMOTE_PORT);
+    req += std::to_string(DAIKIN_HAL_REMOTE_PORT(tcp));
     req += "\r\n";
     req += "Upgrade: websocket\r\n";
     req += "Connection: Upgrade\r\n";
@@ -323,6 +347,12 @@ static std::string ws_create_handshake_request(const std::string& key)
     req += key;
     req += "\r\n";
     req += "Sec-WebSocket-Version: 13\r\n";
+    if (extensions.length() > 0)
+    {
+        req += "Sec-WebSocket-Extensions: ";
+        req += extensions;
+        req += "\r\n";
+    }
     req += "\r\n";
 
     LIBDAIKIN_TRACE("WS REQUEST:\n%s", req.c_str());
@@ -331,21 +361,28 @@ static std::string ws_create_handshake_request(const std::string& key)
 
 static bool ws_handshake_validate_response(
     std::string& response,
-    const std::string& expected_hash_base64)
+    const std::string& expected_hash_base64,
+    ws_deflate_params_t* const deflate_params,
+    bool* const deflate)
 {
     LIBDAIKIN_ASSERT(response.length() > 0);
     LIBDAIKIN_ASSERT(expected_hash_base64.length() > 0);
+    LIBDAIKIN_ASSERT(deflate_params != NULL);
+    LIBDAIKIN_ASSERT(deflate != NULL);
+
+    *deflate = false;
 
     LIBDAIKIN_TRACE("WS RESPONSE:\n%s", response.c_str());
 
     int successCount = 0;
     const int MIN_SUCCESS_COUNT = 4;
     const size_t line4_prefix_len = strlen(WS_RESPONSE_LINE4);
+    const size_t extensions_prefix_len = strlen(WS_RESPONSE_EXTENSIONS);
 
-    // scan each line \r\n in response
+    // scan each line \r\n in response, extensions may follow the required lines
     char* e, *h;
     char* line = &response[0];
-    while (((e = strstr(line, "\r\n")) != NULL) && (successCount < MIN_SUCCESS_COUNT))
+    while ((e = strstr(line, "\r\n")) != NULL)
     {
         *e = 0; ++e; // \r
         *e = 0; ++e; // \n
@@ -368,6 +405,16 @@ static bool ws_handshake_validate_response(
             if (hashEqual)
                 successCount++;
         }
+        else if (strncmp(line, WS_RESPONSE_EXTENSIONS, extensions_prefix_len) == 0)
+        {
+            // Server may only accept what we offered
+            if (ws_deflate_parse(line + extensions_prefix_len, deflate_params) == false)
+            {
+                LIBDAIKIN_ERROR("Unsupported WS extension: '%s'.\n", line + extensions_prefix_len);
+                return false;
+            }
+            *deflate = true;
+        }
 
         line = e;
     }
@@ -394,7 +441,7 @@ bool daikin_ws_open(daikin_t* const daikin)
     std::string key =
         ws_create_key();
     std::string request =
-        ws_create_handshake_request(key);
+        ws_create_handshake_request(&daikin->tcp, key, daikin->ws_deflate ? ws_deflate_offer() : "");
 
     int32_t ret = daikin_hal_tcp_write(&daikin->tcp, &request[0], (uint16_t)request.length());
     if (ret < 1)
@@ -403,7 +450,7 @@ bool daikin_ws_open(daikin_t* const daikin)
         return false;
     }
 
-    char data[256];
+    char data[512]; // Room for the extension header
     uint16_t len = sizeof(data);
 
     ret = daikin_hal_tcp_read(&daikin->tcp, data, len);
@@ -428,12 +475,31 @@ bool daikin_ws_open(daikin_t* const daikin)
 
     std::string response = std::string(data, len);
     std::string expected_hash_base64 = ws_create_expected_hash(key);
-    if (ws_handshake_validate_response(response, expected_hash_base64) == false)
+    ws_deflate_params_t deflate_params;
+    bool deflate = false;
+    if (ws_handshake_validate_response(response, expected_hash_base64, &deflate_params, &deflate) == false)
     {
         LIBDAIKIN_ERROR("ws_handshake_validate_response failed.\n");
         return false;
     }
 
+    if (deflate)
+    {
+        // Inflate window is allocated for what the server may use
+        if (daikin->ws_deflate == false || deflate_params.server_max_window_bits > DAIKIN_WS_DEFLATE_WINDOW_BITS)
+        {
+            LIBDAIKIN_ERROR("Server accepted permessage-deflate with unexpected parameters.\n");
+            return false;
+        }
+
+        daikin->ws_deflate_state = ws_deflate_create(&deflate_params, true);
+        if (daikin->ws_deflate_state == NULL)
+            return false; // No extra error info needed
+
+        LIBDAIKIN_INFO("permessage-deflate negotiated, server window %u bits.\n",
+            deflate_params.server_max_window_bits);
+    }
+
     daikin->is_open = true;
     return true;
 }
@@ -449,13 +515,26 @@ bool daikin_ws_request(
 
     LIBDAIKIN_TRACE("WS TEXT FRAME REQUEST: %s\n", request.c_str());
 
-    if (ws_write_text_frame(&daikin->tcp, request) == false)
+    daikin_limiter_t* const limiter = daikin->limiter;
+    if (limiter != NULL && limiter_acquire(limiter, &daikin->tcp) == false)
+        return false; // No extra error info needed
+
+    if (ws_write_text_frame(&daikin->tcp, request, ws_deflate_of(daikin)) == false)
     {
+        if (limiter != NULL)
+            limiter_release(limiter);
         LIBDAIKIN_ERROR("ws_write_text_frame failed.\n");
         return false;
     }
 
-    if (ws_wait_for_text_frame(&daikin->tcp, response) == false)
+    const uint32_t sent_ms = limiter != NULL ? limiter_sent(limiter) : 0;
+
+    const bool ok = ws_wait_for_text_frame(&daikin->tcp, response, ws_max_message_len(daikin), ws_deflate_of(daikin));
+
+    if (limiter != NULL)
+        limiter_completed(limiter, sent_ms, ok);
+
+    if (ok == false)
     {
         LIBDAIKIN_ERROR("ws_wait_for_text_frame failed.\n");
         return false;
@@ -465,6 +544,111 @@ bool daikin_ws_request(
     return true;
 }
 
+bool daikin_ws_request_stream(
+    const daikin_t* const daikin,
+    const std::string& request,
+    daikin_chunk_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(request.length() > 0);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    LIBDAIKIN_TRACE("WS TEXT FRAME REQUEST (STREAM): %s\n", request.c_str());
+
+    daikin_limiter_t* const limiter = daikin->limiter;
+    if (limiter != NULL && limiter_acquire(limiter, &daikin->tcp) == false)
+        return false; // No extra error info needed
+
+    if (ws_write_text_frame(&daikin->tcp, request, ws_deflate_of(daikin)) == false)
+    {
+        if (limiter != NULL)
+            limiter_release(limiter);
+        LIBDAIKIN_ERROR("ws_write_text_frame failed.\n");
+        return false;
+    }
+
+    const uint32_t sent_ms = limiter != NULL ? limiter_sent(limiter) : 0;
+
+    const bool ok = ws_wait_for_text_stream(&daikin->tcp, cb, ctx, ws_deflate_of(daikin));
+
+    if (limiter != NULL)
+        limiter_completed(limiter, sent_ms, ok);
+
+    if (ok == false)
+    {
+        LIBDAIKIN_ERROR("ws_wait_for_text_stream failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_ws_receive_stream(
+    const daikin_t* const daikin,
+    daikin_chunk_cb cb,
+    void* ctx)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(cb != NULL);
+
+    if (ws_wait_for_text_stream(&daikin->tcp, cb, ctx, ws_deflate_of(daikin)) == false)
+    {
+        LIBDAIKIN_ERROR("ws_wait_for_text_stream failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_ws_send(
+    const daikin_t* const daikin,
+    const std::string& request)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+    LIBDAIKIN_ASSERT(request.length() > 0);
+
+    LIBDAIKIN_TRACE("WS TEXT FRAME SEND: %s\n", request.c_str());
+
+    if (ws_write_text_frame(&daikin->tcp, request, ws_deflate_of(daikin)) == false)
+    {
+        LIBDAIKIN_ERROR("ws_write_text_frame failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool daikin_ws_receive(
+    const daikin_t* const daikin,
+    std::string& response)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (ws_wait_for_text_frame(&daikin->tcp, response, ws_max_message_len(daikin), ws_deflate_of(daikin)) == false)
+    {
+        LIBDAIKIN_ERROR("ws_wait_for_text_frame failed.\n");
+        return false;
+    }
+
+    LIBDAIKIN_TRACE("WS TEXT FRAME RECEIVE: %s\n", response.c_str());
+    return true;
+}
+
+bool daikin_ws_ping(
+    const daikin_t* const daikin)
+{
+    LIBDAIKIN_ASSERT(daikin != NULL);
+
+    if (ws_ping(&daikin->tcp) == false)
+    {
+        LIBDAIKIN_ERROR("ws_ping failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
 void daikin_ws_close(
     daikin_t* const daikin)
 {
@@ -477,5 +661,8 @@ void daikin_ws_close(
         daikin->is_open = false;
     }
 
+    ws_deflate_destroy((ws_deflate_t*)daikin->ws_deflate_state);
+    daikin->ws_deflate_state = NULL;
+
     daikin_hal_tcp_close(&daikin->tcp);
 }
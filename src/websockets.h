@@ -12,8 +12,16 @@ extern "C" {
 
 bool daikin_ws_open(daikin_t* const daikin);
 bool daikin_ws_request(const daikin_t* const daikin, const std::string& request, std::string& response);
+bool daikin_ws_request_stream(const daikin_t* const daikin, const std::string& request, daikin_chunk_cb cb, void* ctx);
+bool daikin_ws_receive_stream(const daikin_t* const daikin, daikin_chunk_cb cb, void* ctx);
+bool daikin_ws_send(const daikin_t* const daikin, const std::string& request);
+bool daikin_ws_receive(const daikin_t* const daikin, std::string& response);
+bool daikin_ws_ping(const daikin_t* const daikin);
 void daikin_ws_close(daikin_t* const daikin);
 
+// Sec-WebSocket-Accept value for the key (server side, e.g. tools/mock-adapter)
+std::string ws_create_accept_hash(const std::string& key);
+
 #ifdef __cplusplus
 }
 #endif
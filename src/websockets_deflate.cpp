@@ -0,0 +1,315 @@
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "websockets_deflate.h"
+#include "trace.h"
+
+#include "../include/libdaikin.h"
+
+static const uint8_t MIN_WINDOW_BITS = 9; // zlib doesn't support 8 for raw deflate
+static const uint8_t MAX_WINDOW_BITS = 15;
+
+static const char EXTENSION_NAME[] = "permessage-deflate";
+
+bool ws_deflate_parse(const char* value, ws_deflate_params_t* const params)
+{
+    LIBDAIKIN_ASSERT(value != NULL);
+    LIBDAIKIN_ASSERT(params != NULL);
+
+    params->client_no_context_takeover = false;
+    params->server_no_context_takeover = false;
+    params->client_max_window_bits = MAX_WINDOW_BITS;
+    params->server_max_window_bits = MAX_WINDOW_BITS;
+
+    while (*value == ' ')
+        ++value;
+
+    const size_t name_len = sizeof(EXTENSION_NAME) - 1;
+    if (strncmp(value, EXTENSION_NAME, name_len) != 0 ||
+        (value[name_len] != 0 && value[name_len] != ';' && value[name_len] != ' ' && value[name_len] != ','))
+        return false; // Other extension
+
+    // Parameters of the first offer only, "; key[=value]" up to ',' or the end
+    const char* p = value + name_len;
+    while (*p != 0 && *p != ',')
+    {
+        if (*p == ';' || *p == ' ')
+        {
+            ++p;
+            continue;
+        }
+
+        const char* const key = p;
+        while (*p != 0 && *p != '=' && *p != ';' && *p != ',' && *p != ' ')
+            ++p;
+        const std::string name(key, p - key);
+
+        long bits = -1;
+        if (*p == '=')
+        {
+            ++p;
+            if (*p == '"')
+                ++p;
+            bits = strtol(p, (char**)&p, 10);
+            if (*p == '"')
+                ++p;
+        }
+
+        if (name == "client_no_context_takeover")
+            params->client_no_context_takeover = true;
+        else if (name == "server_no_context_takeover")
+            params->server_no_context_takeover = true;
+        else if (name == "client_max_window_bits" || name == "server_max_window_bits")
+        {
+            if (bits == -1 && name[0] == 'c')
+                continue; // Offer without a value => any size
+
+            if (bits < MIN_WINDOW_BITS || bits > MAX_WINDOW_BITS)
+            {
+                LIBDAIKIN_ERROR("Unsupported %s: %ld.\n", name.c_str(), bits);
+                return false;
+            }
+
+            if (name[0] == 'c')
+                params->client_max_window_bits = (uint8_t)bits;
+            else
+                params->server_max_window_bits = (uint8_t)bits;
+        }
+        else
+        {
+            LIBDAIKIN_ERROR("Unknown permessage-deflate parameter '%s'.\n", name.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string ws_deflate_accept(const ws_deflate_params_t* const params)
+{
+    LIBDAIKIN_ASSERT(params != NULL);
+
+    std::string value = EXTENSION_NAME;
+    value += "; server_max_window_bits=" + std::to_string(params->server_max_window_bits);
+    value += "; client_max_window_bits=" + std::to_string(params->client_max_window_bits);
+    if (params->server_no_context_takeover)
+        value += "; server_no_context_takeover";
+    if (params->client_no_context_takeover)
+        value += "; client_no_context_takeover";
+    return value;
+}
+
+#ifdef DAIKIN_WS_DEFLATE
+
+#include <zlib.h>
+
+static const uint16_t ZLIB_CHUNK_LEN = 256; // Stack buffer of the inflate and deflate output
+
+// Every compressed message ends with an empty stored block, which is not sent
+static const char MESSAGE_TAIL[] = { 0x00, 0x00, (char)0xFF, (char)0xFF };
+
+struct ws_deflate_s
+{
+    z_stream deflate;
+    z_stream inflate;
+    bool deflate_reset;
+    bool inflate_reset;
+};
+
+std::string ws_deflate_offer()
+{
+    // Both windows are limited, memory stays bounded in both directions
+    std::string value = EXTENSION_NAME;
+    value += "; client_max_window_bits=" + std::to_string(DAIKIN_WS_DEFLATE_WINDOW_BITS);
+    value += "; server_max_window_bits=" + std::to_string(DAIKIN_WS_DEFLATE_WINDOW_BITS);
+    return value;
+}
+
+ws_deflate_t* ws_deflate_create(const ws_deflate_params_t* const params, bool client)
+{
+    LIBDAIKIN_ASSERT(params != NULL);
+
+    ws_deflate_t* const d = (ws_deflate_t*)calloc(1, sizeof(ws_deflate_t));
+    if (d == NULL)
+    {
+        LIBDAIKIN_ERROR("Out of memory for permessage-deflate.\n");
+        return NULL;
+    }
+
+    const uint8_t client_bits = params->client_max_window_bits < DAIKIN_WS_DEFLATE_WINDOW_BITS ?
+        params->client_max_window_bits : DAIKIN_WS_DEFLATE_WINDOW_BITS;
+
+    // Compressor may use a smaller window than allowed, inflater needs the peer's one
+    const uint8_t deflate_bits = client ? client_bits : params->server_max_window_bits;
+    const uint8_t inflate_bits = client ? params->server_max_window_bits : params->client_max_window_bits;
+    d->deflate_reset = client ? params->client_no_context_takeover : params->server_no_context_takeover;
+    d->inflate_reset = client ? params->server_no_context_takeover : params->client_no_context_takeover;
+
+    // Negative window bits => raw deflate without zlib header
+    if (deflateInit2(&d->deflate, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -(int)deflate_bits,
+        DAIKIN_WS_DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        LIBDAIKIN_ERROR("deflateInit2 failed.\n");
+        free(d);
+        return NULL;
+    }
+
+    if (inflateInit2(&d->inflate, -(int)inflate_bits) != Z_OK)
+    {
+        LIBDAIKIN_ERROR("inflateInit2 failed.\n");
+        deflateEnd(&d->deflate);
+        free(d);
+        return NULL;
+    }
+
+    return d;
+}
+
+void ws_deflate_destroy(ws_deflate_t* const deflate)
+{
+    if (deflate == NULL)
+        return;
+
+    deflateEnd(&deflate->deflate);
+    inflateEnd(&deflate->inflate);
+    free(deflate);
+}
+
+bool ws_deflate_compress(ws_deflate_t* const deflate, const char* const data, uint32_t len, std::string& out)
+{
+    LIBDAIKIN_ASSERT(deflate != NULL);
+    LIBDAIKIN_ASSERT(data != NULL || len == 0);
+
+    z_stream* const z = &deflate->deflate;
+    char chunk[ZLIB_CHUNK_LEN];
+
+    out.clear();
+    z->next_in = (Bytef*)data;
+    z->avail_in = len;
+
+    do
+    {
+        z->next_out = (Bytef*)chunk;
+        z->avail_out = sizeof(chunk);
+        if (::deflate(z, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+        {
+            LIBDAIKIN_ERROR("deflate failed.\n");
+            return false;
+        }
+
+        out.append(chunk, sizeof(chunk) - z->avail_out);
+    } while (z->avail_out == 0);
+
+    if (out.length() < sizeof(MESSAGE_TAIL) ||
+        memcmp(&out[out.length() - sizeof(MESSAGE_TAIL)], MESSAGE_TAIL, sizeof(MESSAGE_TAIL)) != 0)
+    {
+        LIBDAIKIN_ERROR("Unexpected end of the deflate output.\n");
+        return false;
+    }
+
+    out.resize(out.length() - sizeof(MESSAGE_TAIL));
+
+    if (deflate->deflate_reset)
+        deflateReset(z);
+
+    return true;
+}
+
+static bool inflate_input(ws_deflate_t* const deflate, const char* const data, uint32_t len,
+    ws_inflate_sink_t sink, void* ctx)
+{
+    z_stream* const z = &deflate->inflate;
+    char chunk[ZLIB_CHUNK_LEN];
+
+    z->next_in = (Bytef*)data;
+    z->avail_in = len;
+
+    do
+    {
+        z->next_out = (Bytef*)chunk;
+        z->avail_out = sizeof(chunk);
+
+        const int ret = inflate(z, Z_SYNC_FLUSH);
+        if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)
+        {
+            LIBDAIKIN_ERROR("inflate failed: %d.\n", ret);
+            return false;
+        }
+
+        const uint32_t produced = sizeof(chunk) - z->avail_out;
+        if (produced > 0 && sink(ctx, chunk, produced) == false)
+            return false; // No extra error info needed
+
+        if (ret == Z_STREAM_END)
+            inflateReset(z); // Final block sent by the peer, the rest starts a new stream
+        else if (ret == Z_BUF_ERROR)
+            break; // Needs more input
+    } while (z->avail_in > 0 || z->avail_out == 0);
+
+    return true;
+}
+
+bool ws_deflate_inflate(ws_deflate_t* const deflate, const char* const data, uint32_t len, bool last,
+    ws_inflate_sink_t sink, void* ctx)
+{
+    LIBDAIKIN_ASSERT(deflate != NULL);
+    LIBDAIKIN_ASSERT(sink != NULL);
+
+    if (len > 0 && inflate_input(deflate, data, len, sink, ctx) == false)
+        return false; // No extra error info needed
+
+    if (last == false)
+        return true;
+
+    if (inflate_input(deflate, MESSAGE_TAIL, sizeof(MESSAGE_TAIL), sink, ctx) == false)
+        return false; // No extra error info needed
+
+    if (deflate->inflate_reset)
+        inflateReset(&deflate->inflate);
+
+    return true;
+}
+
+#else
+
+std::string ws_deflate_offer()
+{
+    return "";
+}
+
+ws_deflate_t* ws_deflate_create(const ws_deflate_params_t* const params, bool client)
+{
+    (void)params;
+    (void)client;
+    LIBDAIKIN_ERROR("permessage-deflate is not built in (DAIKIN_WS_DEFLATE).\n");
+    return NULL;
+}
+
+void ws_deflate_destroy(ws_deflate_t* const deflate)
+{
+    (void)deflate;
+}
+
+bool ws_deflate_compress(ws_deflate_t* const deflate, const char* const data, uint32_t len, std::string& out)
+{
+    (void)deflate;
+    (void)data;
+    (void)len;
+    (void)out;
+    return false;
+}
+
+bool ws_deflate_inflate(ws_deflate_t* const deflate, const char* const data, uint32_t len, bool last,
+    ws_inflate_sink_t sink, void* ctx)
+{
+    (void)deflate;
+    (void)data;
+    (void)len;
+    (void)last;
+    (void)sink;
+    (void)ctx;
+    return false;
+}
+
+#endif
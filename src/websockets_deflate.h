@@ -0,0 +1,52 @@
+#ifndef __WEBSOCKETS_DEFLATE_H__
+#define __WEBSOCKETS_DEFLATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string>
+
+// permessage-deflate (RFC 7692), built with DAIKIN_WS_DEFLATE (zlib).
+// Without it the offer is empty and every function fails, the connection stays uncompressed.
+
+typedef struct
+{
+    bool    client_no_context_takeover; // Client compressor is reset after every message
+    bool    server_no_context_takeover;
+    uint8_t client_max_window_bits;     // LZ77 window of the client compressor (9-15)
+    uint8_t server_max_window_bits;
+} ws_deflate_params_t;
+
+typedef struct ws_deflate_s ws_deflate_t;
+
+// Output of ws_deflate_inflate, false => abort
+typedef bool (*ws_inflate_sink_t)(void* ctx, const char* data, uint32_t len);
+
+// Value of the Sec-WebSocket-Extensions request header, "" when not built in
+std::string ws_deflate_offer();
+
+// Parses the (lower case) Sec-WebSocket-Extensions value, false => not permessage-deflate or invalid
+bool ws_deflate_parse(const char* value, ws_deflate_params_t* const params);
+
+// Response value of a server accepting params
+std::string ws_deflate_accept(const ws_deflate_params_t* const params);
+
+// client => compresses with the client parameters and inflates with the server ones, server => the other way around
+ws_deflate_t* ws_deflate_create(const ws_deflate_params_t* const params, bool client);
+void ws_deflate_destroy(ws_deflate_t* const deflate);
+
+// Whole message, out is the payload of a frame with RSV1 set
+bool ws_deflate_compress(ws_deflate_t* const deflate, const char* const data, uint32_t len, std::string& out);
+
+// Payload of the message in pieces, last => end of the message
+bool ws_deflate_inflate(ws_deflate_t* const deflate, const char* const data, uint32_t len, bool last,
+    ws_inflate_sink_t sink, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,15 +6,20 @@
 #include <vector>
 
 #include "websockets_frame.h"
+#include "time_util.h"
 #include "trace.h"
 
 static const uint8_t FIN_MASK           = 0b10000000;
+static const uint8_t RSV1_MASK          = 0b01000000; // Compressed message (permessage-deflate)
+static const uint8_t RSV23_MASK         = 0b00110000;
 static const uint8_t OPCODE_MASK        = 0b00001111;
 static const uint8_t MASK_MASK          = 0b10000000;
 static const uint8_t PAYLOADLEN_MASK    = 0b01111111;
 
 static const uint8_t CONTROL_FRAME_MASK = 0b00001000;
 
+static const uint16_t WS_CHUNK_LEN      = 256; // Stack buffer of streamed payloads
+
 // https://developer.ibm.com/articles/au-endianc/
 static const uint16_t BIGENDIAN_TEST = 1;
 #define IS_HOST_BIGENDIAN() ( (*(char*)&BIGENDIAN_TEST) == 0 )
@@ -31,6 +36,7 @@ typedef enum
 
 typedef struct {
     bool        fin;
+    bool        rsv1;
     ws_opcode_t opcode;
     bool        mask;
     uint64_t    payload_len;
@@ -122,6 +128,40 @@ static uint64_t network_to_host_uint64(uint64_t v)
     return *((uint32_t*)data);
 }
 
+uint32_t daikin_hal_tcp_remaining_ms(const daikin_hal_tcp_t* const tcp)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    if (DAIKIN_HAL_CANCELLED(tcp))
+        return 0;
+
+    if (tcp->deadline_ms == 0)
+        return UINT32_MAX;
+
+    const int32_t remaining = (int32_t)(tcp->deadline_ms - daikin_hal_time_ms()); // Wrap safe
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+void ws_random_fill(char* const buf, uint16_t len)
+{
+    LIBDAIKIN_ASSERT(buf != NULL);
+
+#ifdef DAIKIN_FLEET
+    // Sessions run on many threads, rand() would be one lock for all of them (xorshift32)
+    static thread_local uint32_t state = 0;
+    if (state == 0)
+        state = ((uint32_t)clock() ^ (uint32_t)(uintptr_t)&state ^ daikin_hal_time_ms()) | 1;
+
+    for (uint16_t i = 0; i < len; i++)
+        buf[i] = (char)(daikin_random_next(&state) >> 24);
+#else
+    srand((unsigned)clock());
+
+    for (uint16_t i = 0; i < len; i++)
+        buf[i] = (char)(rand() % 256);
+#endif
+}
+
 static bool ws_is_control_frame(ws_opcode_t opcode)
 {
     return (((uint8_t)opcode) & CONTROL_FRAME_MASK) == CONTROL_FRAME_MASK;
@@ -134,10 +174,7 @@ static void ws_set_masking_key(
     LIBDAIKIN_ASSERT(masking_key != NULL);
     LIBDAIKIN_ASSERT(masking_key_len == 4);
 
-    srand((unsigned)clock());
-
-    for (uint8_t i = 0; i < masking_key_len; i++)
-        masking_key[i] = (char)(rand() % 256);
+    ws_random_fill(masking_key, masking_key_len);
 }
 
 static void ws_mask_payload(
@@ -159,13 +196,16 @@ static uint8_t ws_set_client_header(
     char* const header,
     uint8_t hdr_max_len,
     ws_opcode_t opcode,
-    uint16_t payload_len)
+    uint16_t payload_len,
+    bool compressed)
 {
     LIBDAIKIN_ASSERT(header != NULL);
     LIBDAIKIN_ASSERT(hdr_max_len == 8);
     LIBDAIKIN_ASSERT(
         (opcode == ws_opcode_t::WS_OPC_TEXT_FRAME) ||
-        (opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME)); // Currently supported only those
+        (opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME) ||
+        (opcode == ws_opcode_t::WS_OPC_PING_FRAME) ||
+        (opcode == ws_opcode_t::WS_OPC_PONG_FRAME)); // Currently supported only those
     //LIBDAIKIN_ASSERT(payload_len > 0); // Request can have empty body
 
     // We do not support payload_len > 0xFFFF
@@ -179,7 +219,7 @@ static uint8_t ws_set_client_header(
     }
 
     const bool fin = true; // Currently supported only true
-    header[0] = (char)((fin ? FIN_MASK : 0) | (((char)opcode) & OPCODE_MASK));
+    header[0] = (char)((fin ? FIN_MASK : 0) | (compressed ? RSV1_MASK : 0) | (((char)opcode) & OPCODE_MASK));
     header[1] = (char)(MASK_MASK | (hdr_payload_len & PAYLOADLEN_MASK)); // Client always masks, server never
 
     if (hdr_payload_len <= 125)
@@ -196,20 +236,27 @@ static uint8_t ws_set_client_header(
     return 2 + 2 + 4; // Medium version of the hdr
 }
 
-static bool ws_read_payload_len(
+static bool ws_read_exact(
     const daikin_hal_tcp_t* const tcp,
-    char* payload_len,
-    uint16_t payload_len_len)
+    char* const data,
+    uint16_t len)
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
-    LIBDAIKIN_ASSERT(payload_len != NULL);
-    LIBDAIKIN_ASSERT(payload_len_len > 0);
+    LIBDAIKIN_ASSERT(data != NULL);
+    LIBDAIKIN_ASSERT(len > 0);
 
-    int32_t ret = daikin_hal_tcp_read(tcp, payload_len, payload_len_len);
-    if (ret < ((int32_t)payload_len_len))
+    // Large frames arrive in several TCP segments
+    uint16_t done = 0;
+    while (done < len)
     {
-        LIBDAIKIN_ERROR("daikin_hal_tcp_read (payload_len) failed: %d.\n", ret);
-        return false;
+        int32_t ret = daikin_hal_tcp_read(tcp, data + done, (uint16_t)(len - done));
+        if (ret < 1)
+        {
+            LIBDAIKIN_ERROR("daikin_hal_tcp_read failed: %d.\n", ret);
+            return false;
+        }
+
+        done = (uint16_t)(done + ret);
     }
 
     return true;
@@ -219,12 +266,15 @@ static bool ws_write_frame(
     const daikin_hal_tcp_t* const tcp,
     ws_opcode_t opcode,
     char* const payload, // We are modifying payload via masking
-    uint16_t payload_len)
+    uint16_t payload_len,
+    bool compressed = false)
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
     LIBDAIKIN_ASSERT(
         (opcode == ws_opcode_t::WS_OPC_TEXT_FRAME) ||
-        (opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME)); // Currently supported only those
+        (opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME) ||
+        (opcode == ws_opcode_t::WS_OPC_PING_FRAME) ||
+        (opcode == ws_opcode_t::WS_OPC_PONG_FRAME)); // Currently supported only those
     LIBDAIKIN_ASSERT(payload != NULL);
     //LIBDAIKIN_ASSERT(payload_len > 0); // Request can have empty body
 
@@ -233,7 +283,7 @@ static bool ws_write_frame(
     const uint8_t masking_key_len = 4;
 
     ws_set_masking_key(&hdr[4], hdr_max_len - masking_key_len);
-    uint8_t hdr_len = ws_set_client_header(hdr, hdr_max_len, opcode, payload_len);
+    uint8_t hdr_len = ws_set_client_header(hdr, hdr_max_len, opcode, payload_len, compressed);
 
     ws_mask_payload(payload, payload_len, &hdr[hdr_len - masking_key_len], masking_key_len);
 
@@ -257,13 +307,9 @@ static bool ws_write_frame(
     return true;
 }
 
-static bool ws_read_parse_frame(
+static bool ws_read_frame_header(
     const daikin_hal_tcp_t* const tcp,
-    ws_min_frame_t* const frame,
-    bool expect_fin,
-    ws_opcode_t expect_opcode,
-    std::vector<char> &payload
-)
+    ws_min_frame_t* const frame)
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
     LIBDAIKIN_ASSERT(frame != NULL);
@@ -271,86 +317,312 @@ static bool ws_read_parse_frame(
     memset(frame, 0, sizeof(ws_min_frame_t));
 
     char hdr[2];
-    const uint8_t hdr_min_len = sizeof(hdr);
-
-    int32_t ret = daikin_hal_tcp_read(tcp, hdr, hdr_min_len);
-    if (ret < ((int32_t)hdr_min_len))
+    if (ws_read_exact(tcp, hdr, sizeof(hdr)) == false)
     {
-        LIBDAIKIN_ERROR("Unexpected WS Frame len (header): %d.\n", ret);
+        LIBDAIKIN_ERROR("Unexpected WS Frame len (header).\n");
         return false;
     }
 
     frame->fin = (hdr[0] & FIN_MASK) == FIN_MASK;
+    frame->rsv1 = (hdr[0] & RSV1_MASK) == RSV1_MASK;
     frame->opcode = (ws_opcode_t)(hdr[0] & OPCODE_MASK);
     frame->mask = (hdr[1] & MASK_MASK) == MASK_MASK;
     uint8_t temp_len = (uint8_t)(hdr[1] & PAYLOADLEN_MASK);
 
-    if ((!frame->fin) && expect_fin)
-    {
-        LIBDAIKIN_ERROR("Expected FIN in the WS Frame.\n");
-        return false;
-    }
-
     if (frame->mask)
     {
         LIBDAIKIN_ERROR("Unexpected MASK flag from the server in the WS Frame.\n");
         return false;
     }
 
-    if (frame->opcode != expect_opcode)
+    if (ws_is_control_frame(frame->opcode) && frame->fin == false)
     {
-        LIBDAIKIN_ERROR("Unexpected OPCODE flag: %d from the server in the WS Frame.\n",
-            (int32_t) frame->opcode);
+        LIBDAIKIN_ERROR("Control frame must have FIN flag.\n");
         return false;
     }
 
-    if (ws_is_control_frame(frame->opcode) && frame->fin == false)
+    if ((hdr[0] & RSV23_MASK) != 0 || (frame->rsv1 && ws_is_control_frame(frame->opcode)))
     {
-        LIBDAIKIN_ERROR("Control frame must have FIN flag.\n");
+        LIBDAIKIN_ERROR("Unexpected RSV flags in the WS Frame.\n");
         return false;
     }
 
     if (temp_len <= 125)
         frame->payload_len = temp_len;
+    else if (temp_len == 126)
+    {
+        uint16_t ext_payload_len;
+        if (ws_read_exact(tcp, (char*)&ext_payload_len, sizeof(ext_payload_len)) == false)
+            return false; // No extra error info needed
+        frame->payload_len = network_to_host_uint16(ext_payload_len);
+    }
     else
     {
-        if (temp_len == 126)
+        uint64_t ext_payload_len;
+        if (ws_read_exact(tcp, (char*)&ext_payload_len, sizeof(ext_payload_len)) == false)
+            return false; // No extra error info needed
+        frame->payload_len = network_to_host_uint64(ext_payload_len);
+    }
+
+    if (ws_is_control_frame(frame->opcode) && frame->payload_len > 125)
+    {
+        LIBDAIKIN_ERROR("Control frame max payload length (125) exceeded. Total length: %u.\n",
+            (uint32_t)frame->payload_len);
+        return false;
+    }
+
+    return true;
+}
+
+static bool ws_read_payload(
+    const daikin_hal_tcp_t* const tcp,
+    uint64_t len,
+    bool fin,
+    std::string* const out,
+    ws_chunk_sink_t sink,
+    void* const ctx)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    if (out != NULL)
+    {
+        // Straight into the response, the caller checked the bound
+        size_t offset = out->size();
+        out->resize(offset + (size_t)len);
+        while (len > 0)
         {
-            char ext_payload_len[2];
-            if (ws_read_payload_len(tcp, ext_payload_len, sizeof(ext_payload_len)) == false)
+            const uint16_t n = (uint16_t)(len > 0xFFFF ? 0xFFFF : len);
+            if (ws_read_exact(tcp, &(*out)[offset], n) == false)
                 return false; // No extra error info needed
-            frame->payload_len =
-                network_to_host_uint16(*((uint16_t*)ext_payload_len));
+            offset += n;
+            len -= n;
         }
-        else
+
+        return true;
+    }
+
+    // Streamed (sink) or drained (no sink) through a small buffer
+    char chunk[WS_CHUNK_LEN];
+    if (len == 0 && fin && sink != NULL)
+        return sink(ctx, "", 0, true);
+
+    while (len > 0)
+    {
+        const uint16_t n = (uint16_t)(len > sizeof(chunk) ? sizeof(chunk) : len);
+        if (ws_read_exact(tcp, chunk, n) == false)
+            return false; // No extra error info needed
+        len -= n;
+
+        if (sink != NULL && sink(ctx, chunk, n, fin && len == 0) == false)
         {
-            char ext_payload_len_cont[8];
-            if (ws_read_payload_len(tcp, ext_payload_len_cont, sizeof(ext_payload_len_cont)) == false)
-                return false; // No extra error info needed
-            frame->payload_len =
-                network_to_host_uint64(*((uint64_t*)ext_payload_len_cont));
+            LIBDAIKIN_ERROR("Message chunk rejected by the consumer.\n");
+            return false;
         }
     }
 
-    if (ws_is_control_frame(frame->opcode) && frame->payload_len > 125)
+    return true;
+}
+
+typedef struct
+{
+    std::string* out;
+    ws_chunk_sink_t sink;
+    void* ctx;
+    uint32_t max_len;
+    uint64_t total;
+    bool too_long;
+} ws_inflate_ctx_t;
+
+static bool ws_inflated(void* ctx, const char* data, uint32_t len)
+{
+    ws_inflate_ctx_t* const ic = (ws_inflate_ctx_t*)ctx;
+
+    // Inflating goes on after the limit, the shared window must stay in sync
+    ic->total += len;
+    if (ic->max_len > 0 && ic->total > ic->max_len)
     {
-        LIBDAIKIN_ERROR("Control frame max payload length (125) exceeded. Total length: %u.\n",
-            (uint16_t)frame->payload_len);
+        if (ic->too_long == false)
+            LIBDAIKIN_ERROR("Message exceeds the limit of %u bytes.\n", ic->max_len);
+        ic->too_long = true;
+    }
+
+    if (ic->too_long)
+        return true;
+
+    if (ic->out != NULL)
+    {
+        ic->out->append(data, len);
+        return true;
+    }
+
+    if (ic->sink(ic->ctx, data, len, false) == false)
+    {
+        LIBDAIKIN_ERROR("Message chunk rejected by the consumer.\n");
         return false;
     }
 
-    payload.resize(frame->payload_len);
-    if (frame->payload_len > 0)
+    return true;
+}
+
+static bool ws_read_compressed_payload(
+    const daikin_hal_tcp_t* const tcp,
+    uint64_t len,
+    bool fin,
+    ws_deflate_t* const deflate,
+    ws_inflate_ctx_t* const ic)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(deflate != NULL);
+
+    char chunk[WS_CHUNK_LEN];
+    do
+    {
+        const uint16_t n = (uint16_t)(len > sizeof(chunk) ? sizeof(chunk) : len);
+        if (n > 0 && ws_read_exact(tcp, chunk, n) == false)
+            return false; // No extra error info needed
+        len -= n;
+
+        if (ws_deflate_inflate(deflate, chunk, n, fin && len == 0, ws_inflated, ic) == false)
+            return false; // No extra error info needed
+    } while (len > 0);
+
+    // Inflated output has no natural last chunk
+    if (fin && ic->sink != NULL && ic->too_long == false)
+        return ic->sink(ic->ctx, chunk, 0, true);
+
+    return true;
+}
+
+// Reads frames until a complete message with the expected opcode arrives.
+// Continuation frames are reassembled (out) or streamed (sink), pings answered,
+// data frames are skipped while waiting for a close frame and fail while waiting for a pong.
+static bool ws_read_message(
+    const daikin_hal_tcp_t* const tcp,
+    ws_opcode_t expect_opcode,
+    uint32_t max_len,
+    std::string* const out,
+    ws_chunk_sink_t sink,
+    void* const ctx,
+    ws_deflate_t* const deflate)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(
+        (expect_opcode == ws_opcode_t::WS_OPC_TEXT_FRAME) ||
+        (expect_opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME) ||
+        (expect_opcode == ws_opcode_t::WS_OPC_PONG_FRAME));
+
+    bool in_message = false, skip = false, too_long = false, compressed = false;
+    uint64_t total = 0;
+    ws_inflate_ctx_t ic = { out, sink, ctx, max_len, 0, false };
+
+    if (out != NULL)
+        out->clear();
+
+    while (true)
     {
-        ret = daikin_hal_tcp_read(tcp, &payload[0], (uint16_t)payload.size());
-        if (ret < (int32_t)payload.size())
+        ws_min_frame_t frame;
+        if (ws_read_frame_header(tcp, &frame) == false)
+            return false; // No extra error info needed
+
+        if (ws_is_control_frame(frame.opcode))
         {
-            LIBDAIKIN_ERROR("daikin_hal_tcp_read (payload) failed: %d.\n", ret);
+            // Can arrive between fragments of a message
+            std::string payload;
+            if (frame.payload_len > 0 && ws_read_payload(tcp, frame.payload_len, true, &payload, NULL, NULL) == false)
+                return false; // No extra error info needed
+
+            if (frame.opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME)
+            {
+                if (expect_opcode != ws_opcode_t::WS_OPC_CLOSE_FRAME)
+                {
+                    LIBDAIKIN_ERROR("Connection closed by the server.\n");
+                    return false;
+                }
+
+                if (out != NULL)
+                    *out = payload;
+                return true;
+            }
+
+            if (frame.opcode == ws_opcode_t::WS_OPC_PONG_FRAME && expect_opcode == ws_opcode_t::WS_OPC_PONG_FRAME)
+            {
+                if (out != NULL)
+                    *out = payload;
+                return true;
+            }
+
+            if (frame.opcode == ws_opcode_t::WS_OPC_PING_FRAME &&
+                ws_write_frame(tcp, ws_opcode_t::WS_OPC_PONG_FRAME, &payload[0], (uint16_t)payload.size()) == false)
+                return false; // No extra error info needed
+
+            continue; // Pong or unknown control frame
+        }
+
+        if (in_message == (frame.opcode != ws_opcode_t::WS_OPC_CONT_FRAME))
+        {
+            LIBDAIKIN_ERROR("Unexpected OPCODE flag: %d from the server in the WS Frame.\n",
+                (int32_t)frame.opcode);
             return false;
         }
-    }
 
-    return true;
+        if (in_message == false)
+        {
+            skip = expect_opcode == ws_opcode_t::WS_OPC_CLOSE_FRAME;
+            if (skip == false && frame.opcode != expect_opcode)
+            {
+                LIBDAIKIN_ERROR("Unexpected OPCODE flag: %d from the server in the WS Frame.\n",
+                    (int32_t)frame.opcode);
+                return false;
+            }
+
+            if (frame.rsv1 && deflate == NULL)
+            {
+                LIBDAIKIN_ERROR("Compressed message without permessage-deflate.\n");
+                return false;
+            }
+
+            in_message = true;
+            compressed = frame.rsv1;
+            total = 0;
+        }
+        else if (frame.rsv1)
+        {
+            LIBDAIKIN_ERROR("RSV1 flag on a continuation frame.\n");
+            return false;
+        }
+
+        if (compressed && skip == false)
+        {
+            // Limit applies to the inflated size
+            if (ws_read_compressed_payload(tcp, frame.payload_len, frame.fin, deflate, &ic) == false)
+                return false; // No extra error info needed
+
+            if (frame.fin)
+                return ic.too_long == false;
+            continue;
+        }
+
+        total += frame.payload_len;
+        if (skip == false && max_len > 0 && total > max_len)
+        {
+            // Rest of the message is drained, the connection stays usable
+            LIBDAIKIN_ERROR("Message exceeds the limit of %u bytes.\n", max_len);
+            too_long = skip = true;
+        }
+
+        if (ws_read_payload(tcp, frame.payload_len, frame.fin,
+            skip ? NULL : out, skip ? NULL : sink, ctx) == false)
+            return false; // No extra error info needed
+
+        if (frame.fin)
+        {
+            if (too_long)
+                return false;
+            if (skip == false)
+                return true;
+            in_message = false;
+        }
+    }
 }
 
 bool ws_write_close_frame(
@@ -387,11 +659,10 @@ bool ws_wait_for_close_frame(
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
 
-    ws_min_frame_t f;
-    std::vector<char> payload = std::vector<char>();
-    if (ws_read_parse_frame(tcp, &f, true, ws_opcode_t::WS_OPC_CLOSE_FRAME, payload) == false)
+    std::string payload;
+    if (ws_read_message(tcp, ws_opcode_t::WS_OPC_CLOSE_FRAME, 0, &payload, NULL, NULL, NULL) == false)
     {
-        LIBDAIKIN_ERROR("ws_read_parse_frame failed.\n");
+        LIBDAIKIN_ERROR("ws_read_message failed.\n");
         return false;
     }
 
@@ -404,7 +675,34 @@ bool ws_wait_for_close_frame(
     if (payload.size() > 2) // At least three bytes for reason (previous two are for status code)
     {
         LIBDAIKIN_TRACE("CLOSE FRAME - REASON: '%s'.\n",
-            std::string(&payload[2], payload.size() - 2).c_str());
+            payload.substr(2).c_str());
+    }
+
+    return true;
+}
+
+bool ws_ping(
+    const daikin_hal_tcp_t* const tcp
+)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+
+    static const char PING_PAYLOAD[] = "libdaikin";
+
+    std::string payload = PING_PAYLOAD;
+    if (ws_write_frame(tcp, ws_opcode_t::WS_OPC_PING_FRAME, &payload[0], (uint16_t)payload.size()) == false)
+        return false; // No extra error info needed
+
+    if (ws_read_message(tcp, ws_opcode_t::WS_OPC_PONG_FRAME, 0, &payload, NULL, NULL, NULL) == false)
+    {
+        LIBDAIKIN_ERROR("ws_read_message failed.\n");
+        return false;
+    }
+
+    if (payload != PING_PAYLOAD)
+    {
+        LIBDAIKIN_ERROR("Pong payload doesn't match the ping.\n");
+        return false;
     }
 
     return true;
@@ -412,32 +710,57 @@ bool ws_wait_for_close_frame(
 
 bool ws_write_text_frame(
     const daikin_hal_tcp_t* const tcp,
-    const std::string& request
+    const std::string& request,
+    ws_deflate_t* const deflate
 )
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
     LIBDAIKIN_ASSERT(request.length() > 0);
 
     // Create copy, because we need to modify original data (masking data)
-    std::string data = request;
-    return ws_write_frame(tcp, ws_opcode_t::WS_OPC_TEXT_FRAME, &data[0], (uint16_t)data.length());
+    std::string data;
+    if (deflate == NULL)
+        data = request;
+    else if (ws_deflate_compress(deflate, request.data(), (uint32_t)request.length(), data) == false)
+        return false; // No extra error info needed
+
+    return ws_write_frame(tcp, ws_opcode_t::WS_OPC_TEXT_FRAME, &data[0], (uint16_t)data.length(), deflate != NULL);
 }
 
 bool ws_wait_for_text_frame(
     const daikin_hal_tcp_t* const tcp,
-    std::string& response
+    std::string& response,
+    uint32_t max_len,
+    ws_deflate_t* const deflate
 )
 {
     LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(max_len > 0);
 
-    ws_min_frame_t f;
-    std::vector<char> payload = std::vector<char>();
-    if (ws_read_parse_frame(tcp, &f, true, ws_opcode_t::WS_OPC_TEXT_FRAME, payload) == false)
+    if (ws_read_message(tcp, ws_opcode_t::WS_OPC_TEXT_FRAME, max_len, &response, NULL, NULL, deflate) == false)
+    {
+        LIBDAIKIN_ERROR("ws_read_message failed.\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool ws_wait_for_text_stream(
+    const daikin_hal_tcp_t* const tcp,
+    ws_chunk_sink_t sink,
+    void* const ctx,
+    ws_deflate_t* const deflate
+)
+{
+    LIBDAIKIN_ASSERT(tcp != NULL);
+    LIBDAIKIN_ASSERT(sink != NULL);
+
+    if (ws_read_message(tcp, ws_opcode_t::WS_OPC_TEXT_FRAME, 0, NULL, sink, ctx, deflate) == false)
     {
-        LIBDAIKIN_ERROR("ws_read_parse_frame failed.\n");
+        LIBDAIKIN_ERROR("ws_read_message failed.\n");
         return false;
     }
 
-    response = std::string(&payload[0], payload.size());
     return true;
 }
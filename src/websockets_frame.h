@@ -10,13 +10,29 @@ extern "C" {
 #include <string>
 
 #include "../include/libdaikinhal.h"
+#include "websockets_deflate.h"
 
 const uint16_t WS_SC_NORMAL_CLOSURE = 1000;
 
+// Masking keys, handshake keys and request ids, not for cryptography
+void ws_random_fill(char* const buf, uint16_t len);
+
 bool ws_write_close_frame(const daikin_hal_tcp_t* const tcp, uint16_t status_code, const char* const reason);
 bool ws_wait_for_close_frame(const daikin_hal_tcp_t* const tcp);
-bool ws_write_text_frame(const daikin_hal_tcp_t* const tcp, const std::string& text);
-bool ws_wait_for_text_frame(const daikin_hal_tcp_t* const tcp, std::string& response);
+// Round trip of a ping, the session must be idle (no response or notification pending)
+bool ws_ping(const daikin_hal_tcp_t* const tcp);
+// deflate != NULL => messages are compressed (permessage-deflate negotiated)
+bool ws_write_text_frame(const daikin_hal_tcp_t* const tcp, const std::string& text, ws_deflate_t* const deflate);
+// Reassembles fragmented messages up to max_len bytes
+bool ws_wait_for_text_frame(const daikin_hal_tcp_t* const tcp, std::string& response, uint32_t max_len,
+    ws_deflate_t* const deflate);
+
+// Payload chunks in order, last is set on the final one. false => abort
+typedef bool (*ws_chunk_sink_t)(void* ctx, const char* data, uint32_t len, bool last);
+
+// Streams the next text message without holding it, any length
+bool ws_wait_for_text_stream(const daikin_hal_tcp_t* const tcp, ws_chunk_sink_t sink, void* const ctx,
+    ws_deflate_t* const deflate);
 
 #ifdef __cplusplus
 }
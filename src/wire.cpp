@@ -0,0 +1,364 @@
+#include <string.h>
+
+#include "../include/libdaikinwire.h"
+
+#include "byte_order.h"
+#include "trace.h"
+
+static const uint8_t BATCH_MAGIC[] = { 'D', 'K', 'W', 'B' };
+
+// Both record kinds start with device and time
+static const uint8_t RECORD_DEVICE = 0;
+static const uint8_t RECORD_TIME = 4;
+
+// Info record layout
+static const uint8_t INFO_FIELDS = 2;
+static const uint8_t INFO_OFFSETS[DF_COUNT] =
+{
+    8,  // DF_INDOOR_TEMP         f32
+    12, // DF_OUTDOOR_TEMP        f32
+    16, // DF_LEAVING_WATER_TEMP  f32
+    32, // DF_POWER_STATE         u8
+    20, // DF_EMERGENCY_STATE     i32
+    24, // DF_ERROR_STATE         i32
+    28, // DF_WARNING_STATE       i32
+    33, // DF_TEMP_MODE           u8
+    34, // DF_TEMP_TARGET         u8
+    35, // DF_TEMP_OFFSET         i8
+};
+
+// Change record layout
+static const uint8_t CHANGE_FIELD = 2;
+static const uint8_t CHANGE_FLAGS = 3;
+static const uint8_t CHANGE_OLD = 8;
+static const uint8_t CHANGE_NEW = 16;
+static const uint8_t CHANGE_FLAG_INITIAL = 0x01;
+
+static void put_float(uint8_t* const p, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    daikin_put_le32(p, bits);
+}
+
+static float get_float(const uint8_t* const p)
+{
+    const uint32_t bits = daikin_get_le32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void put_double(uint8_t* const p, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    daikin_put_le64(p, bits);
+}
+
+static double get_double(const uint8_t* const p)
+{
+    const uint64_t bits = daikin_get_le64(p);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static uint8_t* next_record(daikin_wire_writer_t* const writer, daikin_wire_kind_t kind, uint16_t record_len)
+{
+    if (writer->kind != kind)
+    {
+        LIBDAIKIN_ERROR("Batch is of kind %d, not %d.\n", writer->kind, kind);
+        return NULL;
+    }
+
+    if (writer->count == UINT16_MAX || writer->len - writer->used < record_len)
+        return NULL; // Full, not an error
+
+    uint8_t* const record = writer->buf + writer->used;
+    writer->used += record_len;
+    writer->count++;
+    return record;
+}
+
+bool daikin_wire_begin(
+    daikin_wire_writer_t* const writer,
+    uint8_t* const buf,
+    uint32_t len,
+    daikin_wire_kind_t kind)
+{
+    LIBDAIKIN_ASSERT(writer != NULL);
+    LIBDAIKIN_ASSERT(buf != NULL);
+
+    if (writer == NULL || buf == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument writer or buf.\n");
+        return false;
+    }
+
+    if (kind != daikin_wire_kind_t::WK_INFO && kind != daikin_wire_kind_t::WK_CHANGE)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument kind: %d.\n", kind);
+        return false;
+    }
+
+    if (len < DAIKIN_WIRE_HEADER_LEN)
+    {
+        LIBDAIKIN_ERROR("Buffer too small: %u. Required: %u.\n", len, DAIKIN_WIRE_HEADER_LEN);
+        return false;
+    }
+
+    writer->buf = buf;
+    writer->len = len;
+    writer->used = DAIKIN_WIRE_HEADER_LEN;
+    writer->count = 0;
+    writer->kind = kind;
+    return true;
+}
+
+bool daikin_wire_add_info(
+    daikin_wire_writer_t* const writer,
+    uint16_t device,
+    uint32_t t,
+    const daikin_device_info_t* const info,
+    uint16_t fields)
+{
+    LIBDAIKIN_ASSERT(writer != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (writer == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument writer or info.\n");
+        return false;
+    }
+
+    uint8_t* const p = next_record(writer, daikin_wire_kind_t::WK_INFO, DAIKIN_WIRE_INFO_LEN);
+    if (p == NULL)
+        return false; // No extra error info needed
+
+    daikin_put_le16(p + RECORD_DEVICE, device);
+    daikin_put_le16(p + INFO_FIELDS, (uint16_t)(fields & ((1u << DF_COUNT) - 1)));
+    daikin_put_le32(p + RECORD_TIME, t);
+    put_float(p + INFO_OFFSETS[DF_INDOOR_TEMP], info->indoor_temp);
+    put_float(p + INFO_OFFSETS[DF_OUTDOOR_TEMP], info->outdoor_temp);
+    put_float(p + INFO_OFFSETS[DF_LEAVING_WATER_TEMP], info->leaving_water_temp);
+    daikin_put_le32(p + INFO_OFFSETS[DF_EMERGENCY_STATE], (uint32_t)info->emergency_state);
+    daikin_put_le32(p + INFO_OFFSETS[DF_ERROR_STATE], (uint32_t)info->error_state);
+    daikin_put_le32(p + INFO_OFFSETS[DF_WARNING_STATE], (uint32_t)info->warning_state);
+    p[INFO_OFFSETS[DF_POWER_STATE]] = (uint8_t)info->power_state;
+    p[INFO_OFFSETS[DF_TEMP_MODE]] = (uint8_t)info->temp_mode;
+    p[INFO_OFFSETS[DF_TEMP_TARGET]] = info->temp_target;
+    p[INFO_OFFSETS[DF_TEMP_OFFSET]] = (uint8_t)info->temp_offset;
+    return true;
+}
+
+bool daikin_wire_add_change(
+    daikin_wire_writer_t* const writer,
+    uint16_t device,
+    uint32_t t,
+    const daikin_delta_event_t* const event)
+{
+    LIBDAIKIN_ASSERT(writer != NULL);
+    LIBDAIKIN_ASSERT(event != NULL);
+
+    if (writer == NULL || event == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument writer or event.\n");
+        return false;
+    }
+
+    uint8_t* const p = next_record(writer, daikin_wire_kind_t::WK_CHANGE, DAIKIN_WIRE_CHANGE_LEN);
+    if (p == NULL)
+        return false; // No extra error info needed
+
+    daikin_put_le16(p + RECORD_DEVICE, device);
+    p[CHANGE_FIELD] = (uint8_t)event->field;
+    p[CHANGE_FLAGS] = event->initial ? CHANGE_FLAG_INITIAL : 0;
+    daikin_put_le32(p + RECORD_TIME, t);
+    put_double(p + CHANGE_OLD, event->old_value);
+    put_double(p + CHANGE_NEW, event->new_value);
+    return true;
+}
+
+uint32_t daikin_wire_end(daikin_wire_writer_t* const writer)
+{
+    LIBDAIKIN_ASSERT(writer != NULL);
+
+    if (writer == NULL || writer->buf == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument writer.\n");
+        return 0;
+    }
+
+    uint8_t* const p = writer->buf;
+    memcpy(p, BATCH_MAGIC, sizeof(BATCH_MAGIC));
+    p[4] = DAIKIN_WIRE_VERSION;
+    p[5] = (uint8_t)writer->kind;
+    daikin_put_le16(p + 6, writer->count);
+    daikin_put_le16(p + 8, writer->kind == daikin_wire_kind_t::WK_INFO ? DAIKIN_WIRE_INFO_LEN : DAIKIN_WIRE_CHANGE_LEN);
+    daikin_put_le16(p + 10, 0);
+    return writer->used;
+}
+
+bool daikin_wire_read(
+    daikin_wire_reader_t* const reader,
+    const uint8_t* const data,
+    uint32_t len)
+{
+    LIBDAIKIN_ASSERT(reader != NULL);
+    LIBDAIKIN_ASSERT(data != NULL);
+
+    if (reader == NULL || data == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument reader or data.\n");
+        return false;
+    }
+
+    if (len < DAIKIN_WIRE_HEADER_LEN || memcmp(data, BATCH_MAGIC, sizeof(BATCH_MAGIC)) != 0)
+    {
+        LIBDAIKIN_ERROR("Not a batch.\n");
+        return false;
+    }
+
+    if (data[4] < 1 || data[4] > DAIKIN_WIRE_VERSION)
+    {
+        LIBDAIKIN_ERROR("Unsupported batch version: %u.\n", data[4]);
+        return false;
+    }
+
+    const daikin_wire_kind_t kind = (daikin_wire_kind_t)data[5];
+    const uint16_t count = daikin_get_le16(data + 6);
+    const uint16_t record_len = daikin_get_le16(data + 8);
+
+    // Longer records are read by their known part
+    const uint16_t min_len =
+        kind == daikin_wire_kind_t::WK_INFO ? DAIKIN_WIRE_INFO_LEN :
+        kind == daikin_wire_kind_t::WK_CHANGE ? DAIKIN_WIRE_CHANGE_LEN : 0;
+    if (min_len == 0 || record_len < min_len)
+    {
+        LIBDAIKIN_ERROR("Invalid batch kind %u or record length %u.\n", data[5], record_len);
+        return false;
+    }
+
+    if (len < DAIKIN_WIRE_BATCH_LEN(count, record_len))
+    {
+        LIBDAIKIN_ERROR("Batch truncated: %u. Required: %u.\n", len, DAIKIN_WIRE_BATCH_LEN(count, record_len));
+        return false;
+    }
+
+    reader->data = data;
+    reader->count = count;
+    reader->record_len = record_len;
+    reader->kind = kind;
+    return true;
+}
+
+const uint8_t* daikin_wire_record(const daikin_wire_reader_t* const reader, uint16_t index)
+{
+    LIBDAIKIN_ASSERT(reader != NULL);
+
+    if (reader == NULL || index >= reader->count)
+        return NULL;
+
+    return reader->data + DAIKIN_WIRE_HEADER_LEN + (uint32_t)index * reader->record_len;
+}
+
+uint16_t daikin_wire_device(const uint8_t* const record)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+
+    return daikin_get_le16(record + RECORD_DEVICE);
+}
+
+uint32_t daikin_wire_time(const uint8_t* const record)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+
+    return daikin_get_le32(record + RECORD_TIME);
+}
+
+uint16_t daikin_wire_info_fields(const uint8_t* const record)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+
+    return daikin_get_le16(record + INFO_FIELDS);
+}
+
+bool daikin_wire_info_value(
+    const uint8_t* const record,
+    daikin_field_t field,
+    double* const v)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+    LIBDAIKIN_ASSERT(field < daikin_field_t::DF_COUNT);
+    LIBDAIKIN_ASSERT(v != NULL);
+
+    if (field >= daikin_field_t::DF_COUNT || (daikin_get_le16(record + INFO_FIELDS) & (1u << field)) == 0)
+        return false;
+
+    const uint8_t* const p = record + INFO_OFFSETS[field];
+    switch (field)
+    {
+    case daikin_field_t::DF_INDOOR_TEMP:
+    case daikin_field_t::DF_OUTDOOR_TEMP:
+    case daikin_field_t::DF_LEAVING_WATER_TEMP: *v = (double)get_float(p); break;
+    case daikin_field_t::DF_EMERGENCY_STATE:
+    case daikin_field_t::DF_ERROR_STATE:
+    case daikin_field_t::DF_WARNING_STATE:      *v = (double)(int32_t)daikin_get_le32(p); break;
+    case daikin_field_t::DF_TEMP_OFFSET:        *v = (double)(int8_t)*p; break;
+    default:                                    *v = (double)*p; break;
+    }
+
+    return true;
+}
+
+void daikin_wire_info_decode(
+    const uint8_t* const record,
+    daikin_device_info_t* const info)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+    LIBDAIKIN_ASSERT(info != NULL);
+
+    if (record == NULL || info == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record or info.\n");
+        return;
+    }
+
+    info->indoor_temp = get_float(record + INFO_OFFSETS[DF_INDOOR_TEMP]);
+    info->outdoor_temp = get_float(record + INFO_OFFSETS[DF_OUTDOOR_TEMP]);
+    info->leaving_water_temp = get_float(record + INFO_OFFSETS[DF_LEAVING_WATER_TEMP]);
+    info->emergency_state = (int32_t)daikin_get_le32(record + INFO_OFFSETS[DF_EMERGENCY_STATE]);
+    info->error_state = (int32_t)daikin_get_le32(record + INFO_OFFSETS[DF_ERROR_STATE]);
+    info->warning_state = (int32_t)daikin_get_le32(record + INFO_OFFSETS[DF_WARNING_STATE]);
+    info->power_state = (daikin_power_state_t)record[INFO_OFFSETS[DF_POWER_STATE]];
+    info->temp_mode = (daikin_temperature_mode_t)record[INFO_OFFSETS[DF_TEMP_MODE]];
+    info->temp_target = record[INFO_OFFSETS[DF_TEMP_TARGET]];
+    info->temp_offset = (int8_t)record[INFO_OFFSETS[DF_TEMP_OFFSET]];
+}
+
+bool daikin_wire_change_decode(
+    const uint8_t* const record,
+    daikin_delta_event_t* const event)
+{
+    LIBDAIKIN_ASSERT(record != NULL);
+    LIBDAIKIN_ASSERT(event != NULL);
+
+    if (record == NULL || event == NULL)
+    {
+        LIBDAIKIN_ERROR("Invalid input argument record or event.\n");
+        return false;
+    }
+
+    if (record[CHANGE_FIELD] >= DF_COUNT)
+    {
+        LIBDAIKIN_ERROR("Invalid change of field %u.\n", record[CHANGE_FIELD]);
+        return false;
+    }
+
+    event->field = (daikin_field_t)record[CHANGE_FIELD];
+    event->initial = (record[CHANGE_FLAGS] & CHANGE_FLAG_INITIAL) != 0;
+    event->old_value = get_double(record + CHANGE_OLD);
+    event->new_value = get_double(record + CHANGE_NEW);
+    return true;
+}
@@ -0,0 +1,138 @@
+// daikin_get_device_info_partial against an in-process adapter without the leaving water
+// temperature: after daikin_discover the field is skipped, its bit in fields stays clear
+// and the bits of all fields which were read are set.
+//
+// Usage: daikin-test-device-info
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <thread>
+
+#include "../../include/libdaikin.h"
+#include "../../include/libdaikinm2m.h"
+#include "../../tools/common/ws_server.h"
+
+static const std::map<std::string, std::string> VALUES =
+{
+    { DAIKIN_PATH_INDOOR_TEMP,      "21.5" },
+    { DAIKIN_PATH_OUTDOOR_TEMP,     "4.0" },
+    { DAIKIN_PATH_TEMP_TARGET,      "22" },
+    { DAIKIN_PATH_POWER_STATE,      "\"on\"" },
+    { DAIKIN_PATH_EMERGENCY_STATE,  "0" },
+    { DAIKIN_PATH_ERROR_STATE,      "0" },
+    { DAIKIN_PATH_WARNING_STATE,    "0" },
+};
+
+static uint32_t g_requests = 0;
+
+static bool on_text(void* ctx, const std::string& payload)
+{
+    const ws_server_conn_t* const conn = (const ws_server_conn_t*)ctx;
+
+    daikin_m2m_t req;
+    if (daikin_m2m_decode(payload.data(), (uint32_t)payload.length(), &req) == false)
+        return false;
+
+    g_requests++;
+
+    // to is /[0]/<path>/la, the response comes from there
+    const std::string to = req.to;
+    const char prefix[] = "/[0]/";
+    const char la[] = "/la";
+    std::string path = to.substr(sizeof(prefix) - 1);
+    path.resize(path.length() - (sizeof(la) - 1));
+
+    auto it = VALUES.find(path);
+    std::string rsp = "{\"m2m:rsp\":{\"rsc\":";
+    rsp += it != VALUES.end() ? "2000" : (path == DAIKIN_PATH_TEMP_OFFSET ? "4000" : "4004");
+    rsp += ",\"rqi\":\"" + std::string(req.rqi) + "\",\"to\":\"" + req.fr + "\",\"fr\":\"" + to + "\"";
+    if (it != VALUES.end())
+        rsp += ",\"pc\":{\"m2m:cin\":{\"con\":" + it->second + ",\"cnf\":\"text/plain:0\"}}";
+    rsp += "}}";
+
+    return ws_server_send_text(conn, rsp);
+}
+
+static void serve(int ls)
+{
+    ws_server_conn_t conn;
+    conn.fd = accept(ls, NULL, NULL);
+    conn.upgraded = false;
+    conn.deflate = NULL;
+    if (conn.fd < 0)
+        return;
+
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(conn.fd, buf, sizeof(buf), 0)) > 0)
+    {
+        if (ws_server_on_data(&conn, buf, (size_t)n, on_text, &conn) == false)
+            break;
+    }
+
+    ws_server_close(&conn);
+}
+
+static bool check(bool ok, const char* const what)
+{
+    if (ok == false)
+        fprintf(stderr, "FAILED: %s\n", what);
+    return ok;
+}
+
+int main()
+{
+    const int ls = ws_server_listen_tcp("127.0.0.1", 0);
+    if (ls < 0)
+        return 2;
+
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    getsockname(ls, (struct sockaddr*)&addr, &addr_len);
+
+    std::thread adapter(serve, ls);
+
+    daikin_t daikin;
+    memset(&daikin, 0, sizeof(daikin));
+    daikin.tcp.remote_ip = "127.0.0.1";
+    daikin.tcp.remote_port = ntohs(addr.sin_port);
+
+    daikin_device_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.leaving_water_temp = -99;
+
+    uint32_t fields = 0;
+    bool ok =
+        check(daikin_open(&daikin), "open") &&
+        check(daikin_discover(&daikin), "discover") &&
+        check(daikin_is_supported(&daikin, DAIKIN_PATH_LEAVING_WATER_TEMP) == false, "leaving water temperature missing");
+
+    const uint32_t requests = g_requests;
+    ok = ok &&
+        check(daikin_get_device_info_partial(&daikin, &info, &fields), "partial read") &&
+        check((fields & (1u << DF_LEAVING_WATER_TEMP)) == 0, "no bit for the missing field") &&
+        check(info.leaving_water_temp == -99, "missing field left as is") &&
+        check(g_requests - requests == 8, "no round trip for the missing field") &&
+        check((fields & (1u << DF_INDOOR_TEMP)) != 0 && info.indoor_temp == 21.5f, "indoor temperature") &&
+        check((fields & (1u << DF_OUTDOOR_TEMP)) != 0 && info.outdoor_temp == 4.0f, "outdoor temperature") &&
+        check((fields & (1u << DF_TEMP_MODE)) != 0 && info.temp_mode == TM_TARGET, "temperature mode") &&
+        check((fields & (1u << DF_TEMP_TARGET)) != 0 && info.temp_target == 22, "target temperature") &&
+        check((fields & (1u << DF_POWER_STATE)) != 0 && info.power_state == PS_ON, "power state") &&
+        check((fields & (1u << DF_WARNING_STATE)) != 0, "warning state");
+
+    ok = check(daikin_get_field(&daikin, DF_LEAVING_WATER_TEMP, &info), "skipped field read") && ok;
+
+    daikin_close(&daikin);
+    adapter.join();
+    close(ls);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
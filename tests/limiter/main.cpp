@@ -0,0 +1,151 @@
+// In-flight cap of a shared limiter: with max_in_flight requests in flight the next acquire
+// is refused at its deadline or waits until a slot is given back. Threads sharing the limiter
+// never have more than max_in_flight requests in flight together.
+//
+// Usage: daikin-test-limiter
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../../include/libdaikinhal.h"
+#include "../../src/limiter.h"
+
+static const uint8_t MAX_IN_FLIGHT = 3;
+static const uint32_t THREADS = 8;
+static const uint32_t ROUNDS = 2000;
+
+static bool check(bool ok, const char* const what)
+{
+    if (ok == false)
+        fprintf(stderr, "FAILED: %s\n", what);
+    return ok;
+}
+
+static daikin_limiter_stats_t stats_of(daikin_limiter_t* const limiter)
+{
+    daikin_limiter_stats_t stats;
+    daikin_limiter_get_stats(limiter, &stats);
+    return stats;
+}
+
+static bool test_refused_and_waiting()
+{
+    daikin_limiter_t limiter;
+    daikin_limits_t limits = { 0.0f, 1, MAX_IN_FLIGHT, 0 }; // Unlimited rate, only the cap
+    daikin_limiter_init(&limiter, &limits);
+
+    daikin_hal_tcp_t tcp;
+    memset(&tcp, 0, sizeof(tcp));
+
+    // N requests in flight
+    bool ok = true;
+    uint32_t sent_ms[MAX_IN_FLIGHT];
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++)
+    {
+        ok = check(limiter_acquire(&limiter, &tcp), "acquire within the cap") && ok;
+        sent_ms[i] = limiter_sent(&limiter);
+    }
+
+    ok = check(stats_of(&limiter).in_flight == MAX_IN_FLIGHT, "in flight at the cap") && ok;
+
+    // N+1 with a deadline is refused
+    tcp.deadline_ms = daikin_hal_time_ms() + 30;
+    ok = check(limiter_acquire(&limiter, &tcp) == false, "acquire over the cap refused") && ok;
+    ok = check(stats_of(&limiter).window_full == 1, "window_full counted") && ok;
+    ok = check(stats_of(&limiter).in_flight == MAX_IN_FLIGHT, "refused acquire takes no slot") && ok;
+
+    // N+1 without a deadline waits for a completion
+    tcp.deadline_ms = 0;
+    std::atomic<bool> acquired(false);
+    std::thread waiter([&]()
+    {
+        acquired = limiter_acquire(&limiter, &tcp);
+    });
+
+    daikin_hal_sleep_ms(50);
+    ok = check(acquired == false, "acquire over the cap waits") && ok;
+    ok = check(stats_of(&limiter).waiting == 1, "waiting counted") && ok;
+
+    limiter_completed(&limiter, sent_ms[0], true);
+    waiter.join();
+    ok = check(acquired, "waiting acquire gets the freed slot") && ok;
+    ok = check(stats_of(&limiter).in_flight == MAX_IN_FLIGHT, "freed slot taken again") && ok;
+    ok = check(stats_of(&limiter).window_full == 2, "window_full counted for the waiter") && ok;
+
+    // Requests which were not sent give their slot back
+    limiter_release(&limiter);
+    ok = check(stats_of(&limiter).in_flight == MAX_IN_FLIGHT - 1, "release frees the slot") && ok;
+
+    limiter_completed(&limiter, sent_ms[1], true);
+    limiter_completed(&limiter, sent_ms[2], true);
+    ok = check(stats_of(&limiter).in_flight == 0, "all slots free") && ok;
+    ok = check(stats_of(&limiter).waiting == 0, "nobody waiting") && ok;
+    return ok;
+}
+
+static bool test_shared()
+{
+    daikin_limiter_t limiter;
+    daikin_limits_t limits = { 0.0f, 1, MAX_IN_FLIGHT, 0 };
+    daikin_limiter_init(&limiter, &limits);
+
+    std::atomic<uint32_t> in_flight(0);
+    std::atomic<uint32_t> max_in_flight(0);
+    std::atomic<uint32_t> failures(0);
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREADS; t++)
+    {
+        threads.emplace_back([&]()
+        {
+            daikin_hal_tcp_t tcp;
+            memset(&tcp, 0, sizeof(tcp));
+
+            for (uint32_t i = 0; i < ROUNDS; i++)
+            {
+                if (limiter_acquire(&limiter, &tcp) == false)
+                {
+                    failures++;
+                    continue;
+                }
+
+                const uint32_t sent_ms = limiter_sent(&limiter);
+                const uint32_t now = ++in_flight;
+                uint32_t seen = max_in_flight;
+                while (now > seen && max_in_flight.compare_exchange_weak(seen, now) == false)
+                {
+                }
+
+                std::this_thread::yield();
+                in_flight--;
+                limiter_completed(&limiter, sent_ms, true);
+            }
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    const daikin_limiter_stats_t stats = stats_of(&limiter);
+    bool ok = true;
+    ok = check(failures == 0, "no acquire failed without a deadline") && ok;
+    ok = check(max_in_flight <= MAX_IN_FLIGHT, "shared cap held") && ok;
+    ok = check(stats.requests == THREADS * ROUNDS, "all requests counted") && ok;
+    ok = check(stats.in_flight == 0 && stats.waiting == 0, "all slots free") && ok;
+    ok = check(stats.max_queue_depth <= THREADS, "queue depth bounded by the callers") && ok;
+    return ok;
+}
+
+int main()
+{
+    bool ok = test_refused_and_waiting();
+    ok = test_shared() && ok;
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Fleet runtime (libdaikinfleet.h) scaling with the number of workers.
+//
+// Polls --devices sessions spread over --adapters mock adapters (consecutive ports from
+// --adapter, e.g. one daikin-mock-adapter per core, each accepts 64 sessions) with 1, 2, 4, ...
+// up to --workers workers. Every run opens all sessions first (handshake storm), then counts
+// polls for --seconds. Reports polls per second, speedup over one worker and steals.
+//
+// Usage: daikin-bench-fleet [--adapter 127.0.0.1[:8080]] [--adapters 1] [--devices 64]
+//        [--workers <cores>] [--seconds 2] [--pin 0|1]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../../include/libdaikinfleet.h"
+
+static const uint32_t WARMUP_TIMEOUT_MS = 10000;
+
+static bool split_address(const char* const arg, std::string& ip, uint16_t& port)
+{
+    const char* const colon = strchr(arg, ':');
+    ip = colon != NULL ? std::string(arg, colon - arg) : std::string(arg);
+    if (colon != NULL)
+        port = (uint16_t)atoi(colon + 1);
+    return ip.length() > 0 && port > 0;
+}
+
+static double run(const std::vector<daikin_t>& devices, uint16_t workers, uint32_t seconds, bool pin,
+    daikin_fleet_stats_t* const stats)
+{
+    daikin_fleet_config_t config = {};
+    config.workers = workers;
+    config.pin = pin;
+    config.fields = 1u << DF_INDOOR_TEMP;
+
+    daikin_fleet_t fleet = {};
+    if (daikin_fleet_start(&fleet, &config, &devices[0], (uint32_t)devices.size()) == false)
+        return 0.0;
+
+    // Every session polled once => handshakes are done
+    const uint32_t start_ms = daikin_hal_time_ms();
+    daikin_fleet_stats_t before;
+    do
+    {
+        daikin_hal_sleep_ms(10);
+        daikin_fleet_stats(&fleet, UINT16_MAX, &before);
+    } while (before.polls < devices.size() && daikin_hal_time_ms() - start_ms < WARMUP_TIMEOUT_MS);
+
+    const uint32_t measure_ms = daikin_hal_time_ms();
+    daikin_hal_sleep_ms(seconds * 1000);
+    daikin_fleet_stats(&fleet, UINT16_MAX, stats);
+    const uint32_t elapsed_ms = daikin_hal_time_ms() - measure_ms;
+
+    daikin_fleet_stop(&fleet);
+
+    const uint64_t polls = stats->polls - before.polls;
+    stats->failures -= before.failures;
+    return elapsed_ms > 0 ? polls * 1000.0 / elapsed_ms : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string adapter_ip = "127.0.0.1";
+    uint16_t adapter_port = 8080;
+    uint32_t adapters = 1, device_count = 64, seconds = 2;
+    uint16_t max_workers = (uint16_t)std::thread::hardware_concurrency();
+    bool pin = false;
+    bool usage = (argc % 2) == 0;
+
+    for (int i = 1; usage == false && i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--adapter") == 0)
+            usage = split_address(argv[i + 1], adapter_ip, adapter_port) == false;
+        else if (strcmp(argv[i], "--adapters") == 0)
+            adapters = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--devices") == 0)
+            device_count = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--workers") == 0)
+            max_workers = (uint16_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--pin") == 0)
+            pin = atoi(argv[i + 1]) != 0;
+        else
+            usage = true;
+    }
+
+    if (usage || adapters == 0 || device_count == 0 || max_workers == 0)
+    {
+        fprintf(stderr, "Usage: %s [--adapter ip[:port]] [--adapters 1] [--devices 64] [--workers <cores>] [--seconds 2] [--pin 0|1]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<daikin_t> devices(device_count);
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        memset(&devices[i], 0, sizeof(daikin_t));
+        devices[i].tcp.remote_ip = adapter_ip.c_str();
+        devices[i].tcp.remote_port = (uint16_t)(adapter_port + i % adapters);
+    }
+
+    // 1, 2, 4, ... and max_workers
+    std::vector<uint16_t> runs;
+    for (uint16_t workers = 1; workers < max_workers; workers *= 2)
+        runs.push_back(workers);
+    runs.push_back(max_workers);
+
+    double base = 0.0;
+    bool failed = false;
+    for (size_t r = 0; r < runs.size(); r++)
+    {
+        const uint16_t workers = runs[r];
+        daikin_fleet_stats_t stats;
+        const double qps = run(devices, workers, seconds, pin, &stats);
+        base = workers == 1 ? qps : base;
+        failed = failed || qps == 0.0 || stats.failures > 0;
+
+        printf("workers: %-3u devices: %u  polls/s: %-9.0f speedup: %.2fx  steals: %llu  failures: %llu\n",
+            workers, device_count, qps, base > 0 ? qps / base : 0.0,
+            (unsigned long long)stats.steals, (unsigned long long)stats.failures);
+    }
+
+    return failed ? 1 : 0;
+}
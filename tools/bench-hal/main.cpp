@@ -0,0 +1,165 @@
+// Poll throughput and CPU cost of a HAL backend with many connections per thread.
+//
+// Built twice: daikin-bench-hal-socket (blocking socket HAL) and daikin-bench-hal-uring
+// (io_uring HAL). Opens --connections sessions to the adapter (e.g. daikin-mock-adapter on
+// loopback) and polls the indoor temperature of each one --rounds times.
+// sync waits for every response before the next request (daikin_get_field),
+// pipelined sends the requests of all sessions first, then reads the responses.
+// Reports polls per second and CPU time per poll.
+//
+// Usage: daikin-bench-hal-socket|daikin-bench-hal-uring [--adapter 127.0.0.1[:8080]] [--connections 32]
+//        [--rounds 200] [--mode sync|pipelined]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../../src/websockets.h"
+
+#ifdef DAIKIN_BENCH_URING
+#   include "../../src/platforms/linux-uring/libdaikinhal.h"
+#else
+#   include "../../src/platforms/linux/libdaikinhal.h"
+#endif
+
+static const char POLL_PATH[] = "/[0]/MNAE/1/Sensor/IndoorTemperature/la";
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t cpu_us()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ull +
+        (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static bool split_address(const char* const arg, std::string& ip, uint16_t& port)
+{
+    const char* const colon = strchr(arg, ':');
+    ip = colon != NULL ? std::string(arg, colon - arg) : std::string(arg);
+    if (colon != NULL)
+        port = (uint16_t)atoi(colon + 1);
+    return ip.length() > 0 && port > 0;
+}
+
+static uint32_t round_sync(std::vector<daikin_t>& sessions)
+{
+    uint32_t failed = 0;
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        daikin_device_info_t info = {};
+        failed += daikin_get_field(&sessions[i], DF_INDOOR_TEMP, &info) ? 0 : 1;
+    }
+
+    return failed;
+}
+
+static uint32_t round_pipelined(std::vector<daikin_t>& sessions, uint32_t round)
+{
+    uint32_t failed = 0;
+    std::vector<bool> sent(sessions.size());
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        std::string req = "{\"m2m:rqp\":{\"fr\":\"/bench\",\"rqi\":\"";
+        req += std::to_string(round);
+        req += "\",\"op\":2,\"to\":\"";
+        req += POLL_PATH;
+        req += "\"}}";
+        sent[i] = daikin_ws_send(&sessions[i], req);
+        failed += sent[i] ? 0 : 1;
+    }
+
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        std::string rsp;
+        if (sent[i] && (daikin_ws_receive(&sessions[i], rsp) == false || rsp.find("\"rsc\":2000") == std::string::npos))
+            failed++;
+    }
+
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    std::string adapter_ip = "127.0.0.1";
+    uint16_t adapter_port = 8080;
+    uint32_t connections = 32, rounds = 200;
+    bool pipelined = false;
+    bool usage = (argc % 2) == 0;
+
+    for (int i = 1; usage == false && i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--adapter") == 0)
+            usage = split_address(argv[i + 1], adapter_ip, adapter_port) == false;
+        else if (strcmp(argv[i], "--connections") == 0)
+            connections = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rounds") == 0)
+            rounds = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--mode") == 0 && strcmp(argv[i + 1], "sync") == 0)
+            pipelined = false;
+        else if (strcmp(argv[i], "--mode") == 0 && strcmp(argv[i + 1], "pipelined") == 0)
+            pipelined = true;
+        else
+            usage = true;
+    }
+
+    if (usage || connections == 0)
+    {
+        fprintf(stderr, "Usage: %s [--adapter ip[:port]] [--connections 32] [--rounds 200] [--mode sync|pipelined]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<daikin_t> sessions(connections);
+    for (uint32_t i = 0; i < connections; i++)
+    {
+        memset(&sessions[i], 0, sizeof(daikin_t));
+        sessions[i].tcp.remote_ip = adapter_ip.c_str();
+        sessions[i].tcp.remote_port = adapter_port;
+        if (daikin_open(&sessions[i]) == false)
+        {
+            fprintf(stderr, "daikin_open of session %u failed.\n", i);
+            for (uint32_t j = 0; j <= i; j++)
+                daikin_close(&sessions[j]);
+            return 1;
+        }
+    }
+
+    uint32_t failed = 0;
+    const uint64_t start = now_us();
+    const uint64_t start_cpu = cpu_us();
+    for (uint32_t r = 0; r < rounds; r++)
+        failed += pipelined ? round_pipelined(sessions, r) : round_sync(sessions);
+
+    const uint64_t elapsed = now_us() - start;
+    const uint64_t cpu = cpu_us() - start_cpu;
+    const uint64_t polls = (uint64_t)rounds * connections;
+
+    printf("%-9s connections: %u  polls: %llu  failed: %u  polls/s: %.0f  cpu/poll: %.2f us\n",
+        pipelined ? "pipelined" : "sync", connections, (unsigned long long)polls, failed,
+        elapsed > 0 ? polls * 1e6 / elapsed : 0.0, polls > 0 ? (double)cpu / polls : 0.0);
+
+#ifdef DAIKIN_BENCH_URING
+    daikin_hal_uring_stats_t stats;
+    daikin_hal_uring_stats(&stats);
+    printf("io_uring  enters: %llu  sqes: %llu  cqes: %llu  ready reads: %llu  polls/enter: %.2f\n",
+        (unsigned long long)stats.enters, (unsigned long long)stats.sqes, (unsigned long long)stats.cqes,
+        (unsigned long long)stats.ready_reads, stats.enters > 0 ? (double)polls / stats.enters : 0.0);
+#endif
+
+    for (uint32_t i = 0; i < connections; i++)
+        daikin_close(&sessions[i]);
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+// Reader throughput of the shared-memory snapshot (libdaikinshm.h) under writer contention.
+//
+// Runs the readers alone, then against a publisher writing back to back
+// (or at --writer-hz). Reports reads per second, failed reads and torn copies
+// (which must stay 0).
+//
+// Usage: daikin-bench-shm [--readers 4] [--seconds 2] [--devices 4] [--writer-hz 0]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../../include/libdaikinshm.h"
+
+static const char SHM_NAME[] = "/daikin-bench-shm";
+
+typedef struct
+{
+    uint64_t reads;
+    uint64_t failed;
+    uint64_t torn;
+} reader_result_t;
+
+static std::atomic<bool> g_run(false);
+static std::atomic<bool> g_stop(false);
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fill(daikin_device_info_t* const info, uint32_t n)
+{
+    // Every field carries n, a torn copy mixes generations
+    info->indoor_temp = (float)n;
+    info->outdoor_temp = (float)n;
+    info->leaving_water_temp = (float)n;
+    info->emergency_state = (int32_t)n;
+    info->error_state = (int32_t)n;
+    info->warning_state = (int32_t)n;
+}
+
+static bool is_consistent(const daikin_shm_snapshot_t* const s)
+{
+    const int32_t n = s->info.error_state;
+    return s->info.emergency_state == n && s->info.warning_state == n &&
+        s->info.indoor_temp == (float)n && s->info.leaving_water_temp == (float)n &&
+        s->field_ms[DF_INDOOR_TEMP] == s->published_ms;
+}
+
+static void reader(const daikin_shm_t* const shm, reader_result_t* const result)
+{
+    daikin_shm_snapshot_t s;
+    reader_result_t r = { 0, 0, 0 };
+    uint16_t device = 0;
+
+    while (g_run.load(std::memory_order_relaxed) == false)
+        ;
+
+    while (g_stop.load(std::memory_order_relaxed) == false)
+    {
+        if (daikin_shm_read(shm, device, &s) == false)
+            r.failed++;
+        else if (is_consistent(&s) == false)
+            r.torn++;
+
+        r.reads++;
+        device = (uint16_t)((device + 1) % shm->device_count);
+    }
+
+    *result = r;
+}
+
+static void writer(daikin_shm_t* const shm, uint32_t hz, uint64_t* const writes)
+{
+    daikin_device_info_t info = {};
+    uint32_t n = 1;
+    const uint64_t period = hz > 0 ? 1000000000ull / hz : 0;
+    uint64_t next = now_ns();
+
+    while (g_stop.load(std::memory_order_relaxed) == false)
+    {
+        fill(&info, n);
+        daikin_shm_publish(shm, (uint16_t)(n % shm->device_count), &info, (1u << DF_COUNT) - 1,
+            DAIKIN_SHM_F_CONNECTED, n);
+        n++;
+
+        if (period > 0)
+        {
+            next += period;
+            while (now_ns() < next && g_stop.load(std::memory_order_relaxed) == false)
+                ;
+        }
+    }
+
+    *writes = n - 1;
+}
+
+static void run(daikin_shm_t* const publisher, const daikin_shm_t* const shm,
+    uint32_t readers, uint32_t seconds, bool with_writer, uint32_t writer_hz)
+{
+    std::vector<std::thread> threads;
+    std::vector<reader_result_t> results(readers);
+    uint64_t writes = 0;
+
+    g_run = false;
+    g_stop = false;
+
+    for (uint32_t i = 0; i < readers; i++)
+        threads.push_back(std::thread(reader, shm, &results[i]));
+    if (with_writer)
+        threads.push_back(std::thread(writer, publisher, writer_hz, &writes));
+
+    const uint64_t start = now_ns();
+    g_run = true;
+    sleep(seconds);
+    g_stop = true;
+
+    for (std::thread& t : threads)
+        t.join();
+
+    const double elapsed = (double)(now_ns() - start) / 1e9;
+    reader_result_t total = { 0, 0, 0 };
+    for (const reader_result_t& r : results)
+    {
+        total.reads += r.reads;
+        total.failed += r.failed;
+        total.torn += r.torn;
+    }
+
+    printf("%-14s readers: %u  reads/s: %12.0f  per reader: %12.0f  ns/read: %6.1f  failed: %llu  torn: %llu",
+        with_writer ? "with writer" : "readers only", readers, total.reads / elapsed,
+        total.reads / elapsed / readers, elapsed * 1e9 * readers / (double)(total.reads ? total.reads : 1),
+        (unsigned long long)total.failed, (unsigned long long)total.torn);
+    if (with_writer)
+        printf("  writes/s: %.0f", writes / elapsed);
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t readers = 4, seconds = 2, writer_hz = 0;
+    uint16_t devices = 4;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--readers") == 0)
+            readers = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--devices") == 0)
+            devices = (uint16_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--writer-hz") == 0)
+            writer_hz = (uint32_t)atoi(argv[i + 1]);
+    }
+
+    if (readers == 0 || seconds == 0 || devices == 0 || (argc % 2) == 0)
+    {
+        fprintf(stderr, "Usage: %s [--readers 4] [--seconds 2] [--devices 4] [--writer-hz 0]\n", argv[0]);
+        return 1;
+    }
+
+    // Publisher and readers use separate mappings, like separate processes
+    uint32_t len = daikin_shm_size(devices), reader_len = 0;
+    uint8_t* mem;
+    uint8_t* reader_mem;
+    daikin_shm_t publisher, shm;
+
+    if (daikin_shm_map(SHM_NAME, true, &len, &mem) == false ||
+        daikin_shm_init(&publisher, mem, len, devices) == false ||
+        daikin_shm_map(SHM_NAME, false, &reader_len, &reader_mem) == false ||
+        daikin_shm_attach(&shm, reader_mem, reader_len) == false)
+    {
+        fprintf(stderr, "Shared memory setup failed.\n");
+        daikin_shm_unlink(SHM_NAME);
+        return 2;
+    }
+
+    daikin_device_info_t info = {};
+    for (uint16_t d = 0; d < devices; d++)
+    {
+        fill(&info, 0);
+        daikin_shm_publish(&publisher, d, &info, (1u << DF_COUNT) - 1, DAIKIN_SHM_F_CONNECTED, 0);
+    }
+
+    printf("snapshot: %zu bytes, devices: %u, cpus: %ld\n",
+        sizeof(daikin_shm_snapshot_t), devices, sysconf(_SC_NPROCESSORS_ONLN));
+
+    run(&publisher, &shm, readers, seconds, false, 0);
+    run(&publisher, &shm, readers, seconds, true, writer_hz);
+
+    daikin_shm_unmap(reader_mem, reader_len);
+    daikin_shm_unmap(mem, len);
+    daikin_shm_unlink(SHM_NAME);
+    return 0;
+}
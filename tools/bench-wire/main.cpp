@@ -0,0 +1,265 @@
+// Encode and decode cost of device snapshots: hand-rolled JSON (snprintf, parsed with
+// libdaikinjson.h) against the binary batches of libdaikinwire.h, plus the NDJSON and
+// CSV export (libdaikinexport.h).
+//
+// Every pass encodes --devices snapshots into one message and decodes it again, the decoded
+// values are compared with the encoded ones. Reports ns per device and bytes per device.
+//
+// Usage: daikin-bench-wire [--devices 1000] [--rounds 2000]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "../../include/libdaikinexport.h"
+#include "../../include/libdaikinjson.h"
+#include "../../include/libdaikinwire.h"
+
+static const uint16_t ALL_FIELDS = (1u << DF_COUNT) - 1;
+
+typedef struct
+{
+    std::vector<daikin_device_info_t>* out;
+    daikin_device_info_t info;
+    int8_t key; // Field of the next value, -1 => none
+} json_decode_t;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fill(std::vector<daikin_device_info_t>& devices)
+{
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        daikin_device_info_t* const info = &devices[i];
+        memset(info, 0, sizeof(*info));
+        info->indoor_temp = 18.0f + (float)(i % 80) * 0.25f;
+        info->outdoor_temp = -5.5f + (float)(i % 31) * 0.5f;
+        info->leaving_water_temp = 30.0f + (float)(i % 17) * 0.5f;
+        info->power_state = (i & 1) ? daikin_power_state_t::PS_ON : daikin_power_state_t::PS_STANDBY;
+        info->error_state = (int32_t)(i % 3);
+        info->temp_mode = daikin_temperature_mode_t::TM_TARGET;
+        info->temp_target = (uint8_t)(20 + i % 6);
+        info->temp_offset = (int8_t)(i % 5) - 2;
+    }
+}
+
+static bool is_equal(const daikin_device_info_t* const a, const daikin_device_info_t* const b)
+{
+    return a->indoor_temp == b->indoor_temp && a->outdoor_temp == b->outdoor_temp &&
+        a->leaving_water_temp == b->leaving_water_temp && a->power_state == b->power_state &&
+        a->emergency_state == b->emergency_state && a->error_state == b->error_state &&
+        a->warning_state == b->warning_state && a->temp_mode == b->temp_mode &&
+        a->temp_target == b->temp_target && a->temp_offset == b->temp_offset;
+}
+
+// What the gateways do today: one object per device in an array
+static void json_encode(const std::vector<daikin_device_info_t>& devices, std::string& out)
+{
+    char line[512];
+    out = "[";
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        const daikin_device_info_t* const d = &devices[i];
+        const int len = snprintf(line, sizeof(line),
+            "%s{\"device\":%u,\"t\":%u,\"indoor_temp\":%.2f,\"outdoor_temp\":%.2f,\"leaving_water_temp\":%.2f,"
+            "\"power_state\":%d,\"emergency_state\":%d,\"error_state\":%d,\"warning_state\":%d,"
+            "\"temp_mode\":%d,\"temp_target\":%u,\"temp_offset\":%d}",
+            i > 0 ? "," : "", (unsigned)i, 1700000000u, d->indoor_temp, d->outdoor_temp, d->leaving_water_temp,
+            (int)d->power_state, d->emergency_state, d->error_state, d->warning_state,
+            (int)d->temp_mode, d->temp_target, d->temp_offset);
+        out.append(line, (size_t)len);
+    }
+    out += "]";
+}
+
+static bool json_cb(daikin_json_t* json, daikin_json_event_t event, const char* text, uint16_t len)
+{
+    static const char* const NAMES[DF_COUNT] =
+    {
+        "indoor_temp", "outdoor_temp", "leaving_water_temp", "power_state", "emergency_state",
+        "error_state", "warning_state", "temp_mode", "temp_target", "temp_offset",
+    };
+
+    json_decode_t* const d = (json_decode_t*)json->ctx;
+    (void)len;
+
+    switch (event)
+    {
+    case daikin_json_event_t::JE_OBJECT_START:
+        memset(&d->info, 0, sizeof(d->info));
+        break;
+    case daikin_json_event_t::JE_OBJECT_END:
+        d->out->push_back(d->info);
+        break;
+    case daikin_json_event_t::JE_KEY:
+        d->key = -1;
+        for (int8_t f = 0; f < DF_COUNT && d->key < 0; f++)
+            d->key = strcmp(text, NAMES[f]) == 0 ? f : -1;
+        break;
+    case daikin_json_event_t::JE_NUMBER:
+        if (d->key >= 0)
+        {
+            const double v = strtod(text, NULL);
+            switch ((daikin_field_t)d->key)
+            {
+            case daikin_field_t::DF_INDOOR_TEMP:        d->info.indoor_temp = (float)v; break;
+            case daikin_field_t::DF_OUTDOOR_TEMP:       d->info.outdoor_temp = (float)v; break;
+            case daikin_field_t::DF_LEAVING_WATER_TEMP: d->info.leaving_water_temp = (float)v; break;
+            case daikin_field_t::DF_POWER_STATE:        d->info.power_state = (daikin_power_state_t)(int)v; break;
+            case daikin_field_t::DF_EMERGENCY_STATE:    d->info.emergency_state = (int32_t)v; break;
+            case daikin_field_t::DF_ERROR_STATE:        d->info.error_state = (int32_t)v; break;
+            case daikin_field_t::DF_WARNING_STATE:      d->info.warning_state = (int32_t)v; break;
+            case daikin_field_t::DF_TEMP_MODE:          d->info.temp_mode = (daikin_temperature_mode_t)(int)v; break;
+            case daikin_field_t::DF_TEMP_TARGET:        d->info.temp_target = (uint8_t)v; break;
+            default:                                    d->info.temp_offset = (int8_t)v; break;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+static bool discard_cb(void* ctx, const char* data, uint32_t len)
+{
+    (void)data;
+    *(uint64_t*)ctx += len;
+    return true;
+}
+
+static void report(const char* const name, uint64_t ns, uint32_t rounds, uint32_t devices, size_t bytes, uint32_t mismatches)
+{
+    printf("%-16s ns/device: %8.1f  bytes/device: %6.1f  mismatches: %u\n",
+        name, (double)ns / rounds / devices, (double)bytes / devices, mismatches);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t devices_count = 1000;
+    uint32_t rounds = 2000;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--devices") == 0)
+            devices_count = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rounds") == 0)
+            rounds = (uint32_t)atoi(argv[i + 1]);
+    }
+
+    if (argc % 2 == 0 || devices_count == 0 || devices_count > UINT16_MAX || rounds == 0)
+    {
+        fprintf(stderr, "Usage: %s [--devices 1000] [--rounds 2000]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<daikin_device_info_t> devices(devices_count);
+    std::vector<daikin_device_info_t> decoded;
+    decoded.reserve(devices_count);
+    fill(devices);
+
+    // JSON
+    std::string json;
+    uint64_t encode_ns = 0, decode_ns = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        uint64_t t0 = now_ns();
+        json_encode(devices, json);
+        uint64_t t1 = now_ns();
+
+        json_decode_t d = { &decoded, {}, -1 };
+        daikin_json_t parser;
+        decoded.clear();
+        daikin_json_init(&parser, json_cb, &d);
+        daikin_json_feed(&parser, json.data(), (uint32_t)json.length());
+        daikin_json_finish(&parser);
+        uint64_t t2 = now_ns();
+
+        encode_ns += t1 - t0;
+        decode_ns += t2 - t1;
+        for (uint32_t i = 0; r == 0 && i < devices_count; i++)
+            mismatches += i < decoded.size() && is_equal(&devices[i], &decoded[i]) ? 0 : 1;
+    }
+    report("json encode", encode_ns, rounds, devices_count, json.length(), mismatches);
+    report("json decode", decode_ns, rounds, devices_count, json.length(), mismatches);
+
+    // Binary batch
+    std::vector<uint8_t> buf(DAIKIN_WIRE_BATCH_LEN(devices_count, DAIKIN_WIRE_INFO_LEN));
+    uint32_t batch_len = 0;
+    uint64_t read_ns = 0;
+    double sum = 0;
+    encode_ns = decode_ns = 0;
+    mismatches = 0;
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        uint64_t t0 = now_ns();
+        daikin_wire_writer_t writer;
+        daikin_wire_begin(&writer, buf.data(), (uint32_t)buf.size(), daikin_wire_kind_t::WK_INFO);
+        for (uint32_t i = 0; i < devices_count; i++)
+            daikin_wire_add_info(&writer, (uint16_t)i, 1700000000u, &devices[i], ALL_FIELDS);
+        batch_len = daikin_wire_end(&writer);
+        uint64_t t1 = now_ns();
+
+        daikin_wire_reader_t reader;
+        decoded.clear();
+        daikin_wire_read(&reader, buf.data(), batch_len);
+        for (uint16_t i = 0; i < reader.count; i++)
+        {
+            daikin_device_info_t info;
+            daikin_wire_info_decode(daikin_wire_record(&reader, i), &info);
+            decoded.push_back(info);
+        }
+        uint64_t t2 = now_ns();
+
+        // In place, e.g. an aggregate over one field
+        for (uint16_t i = 0; i < reader.count; i++)
+        {
+            double v;
+            if (daikin_wire_info_value(daikin_wire_record(&reader, i), daikin_field_t::DF_INDOOR_TEMP, &v))
+                sum += v;
+        }
+        uint64_t t3 = now_ns();
+
+        encode_ns += t1 - t0;
+        decode_ns += t2 - t1;
+        read_ns += t3 - t2;
+        for (uint32_t i = 0; r == 0 && i < devices_count; i++)
+            mismatches += i < decoded.size() && is_equal(&devices[i], &decoded[i]) ? 0 : 1;
+    }
+    report("wire encode", encode_ns, rounds, devices_count, batch_len, mismatches);
+    report("wire decode", decode_ns, rounds, devices_count, batch_len, mismatches);
+    report("wire read field", read_ns, rounds, devices_count, batch_len, mismatches);
+
+    // Export of the batch
+    daikin_wire_reader_t reader;
+    daikin_wire_read(&reader, buf.data(), batch_len);
+    const daikin_export_format_t FORMATS[] = { daikin_export_format_t::EF_NDJSON, daikin_export_format_t::EF_CSV };
+    for (daikin_export_format_t format : FORMATS)
+    {
+        uint64_t bytes = 0;
+        const uint64_t t0 = now_ns();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            daikin_export_t e;
+            daikin_export_init(&e, format, discard_cb, &bytes);
+            daikin_export_batch(&e, &reader);
+            daikin_export_flush(&e);
+        }
+        report(format == daikin_export_format_t::EF_CSV ? "export csv" : "export ndjson",
+            now_ns() - t0, rounds, devices_count, (size_t)(bytes / rounds), 0);
+    }
+
+    printf("checksum: %.1f\n", sum); // Keeps the in place reads
+    return 0;
+}
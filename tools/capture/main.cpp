@@ -0,0 +1,165 @@
+// Records polls of an adapter to a capture file and replays them offline (capture HAL).
+//
+// record polls the adapter --polls times every --interval ms (daikin_get_device_info)
+// and writes the wire traffic with timestamps. replay runs the same polls against
+// the capture, at the recorded speed or faster (--speed, 0 => no delays), --loops times,
+// and reports the poll times. Use the same --polls and DAIKIN_DEVICE_INFO_FIELDS for both.
+//
+// Usage: daikin-capture record <file> [--adapter 169.254.126.102[:80]] [--polls 10] [--interval 1000]
+//        daikin-capture replay <file> [--polls 10] [--speed 1] [--loops 1]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "../../include/libdaikin.h"
+#include "../../src/platforms/capture/libdaikinhal.h"
+
+typedef struct
+{
+    uint32_t polls;
+    uint32_t failed;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint64_t total_us;
+} poll_stats_t;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static bool split_address(const char* const arg, std::string& ip, uint16_t& port)
+{
+    const char* const colon = strchr(arg, ':');
+    ip = colon != NULL ? std::string(arg, colon - arg) : std::string(arg);
+    if (colon != NULL)
+        port = (uint16_t)atoi(colon + 1);
+    return ip.length() > 0 && port > 0;
+}
+
+static void run_polls(daikin_t* const daikin, uint32_t polls, uint32_t interval_ms, poll_stats_t* const stats)
+{
+    if (daikin_open(daikin) == false)
+    {
+        fprintf(stderr, "daikin_open failed.\n");
+        stats->failed += polls;
+        daikin_close(daikin);
+        return;
+    }
+
+    for (uint32_t i = 0; i < polls; i++)
+    {
+        if (i > 0 && interval_ms > 0)
+            daikin_hal_sleep_ms(interval_ms);
+
+        daikin_device_info_t info = {};
+        const uint64_t start = now_us();
+        const bool ok = daikin_get_device_info(daikin, &info);
+        const uint64_t elapsed = now_us() - start;
+
+        stats->polls++;
+        if (ok == false)
+        {
+            stats->failed++;
+            continue;
+        }
+
+        stats->total_us += elapsed;
+        stats->min_us = stats->min_us == 0 || elapsed < stats->min_us ? elapsed : stats->min_us;
+        stats->max_us = elapsed > stats->max_us ? elapsed : stats->max_us;
+    }
+
+    daikin_close(daikin);
+}
+
+static void print_stats(const char* const what, const poll_stats_t* const stats, uint64_t elapsed_us)
+{
+    const uint32_t ok = stats->polls - stats->failed;
+    printf("%-8s polls: %u  failed: %u  min: %.3f ms  avg: %.3f ms  max: %.3f ms  polls/s: %.1f\n",
+        what, stats->polls, stats->failed,
+        stats->min_us / 1000.0, ok > 0 ? stats->total_us / 1000.0 / ok : 0.0, stats->max_us / 1000.0,
+        elapsed_us > 0 ? stats->polls * 1e6 / elapsed_us : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+    const bool record = argc >= 3 && strcmp(argv[1], "record") == 0;
+    const bool replay = argc >= 3 && strcmp(argv[1], "replay") == 0;
+    std::string adapter_ip;
+    uint16_t adapter_port = 80;
+    uint32_t polls = 10, interval_ms = 1000, loops = 1;
+    float speed = 1.0f;
+    bool usage = (record || replay) == false || (argc % 2) == 0;
+
+    for (int i = 3; usage == false && i + 1 < argc; i += 2)
+    {
+        if (record && strcmp(argv[i], "--adapter") == 0)
+            usage = split_address(argv[i + 1], adapter_ip, adapter_port) == false;
+        else if (record && strcmp(argv[i], "--interval") == 0)
+            interval_ms = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--polls") == 0)
+            polls = (uint32_t)atoi(argv[i + 1]);
+        else if (replay && strcmp(argv[i], "--speed") == 0)
+            speed = (float)atof(argv[i + 1]);
+        else if (replay && strcmp(argv[i], "--loops") == 0)
+            loops = (uint32_t)atoi(argv[i + 1]);
+        else
+            usage = true;
+    }
+
+    if (usage)
+    {
+        fprintf(stderr, "Usage: %s record <file> [--adapter ip[:port]] [--polls 10] [--interval 1000]\n", argv[0]);
+        fprintf(stderr, "       %s replay <file> [--polls 10] [--speed 1] [--loops 1]\n", argv[0]);
+        return 1;
+    }
+
+    daikin_t daikin = {};
+    if (adapter_ip.length() > 0)
+    {
+        daikin.tcp.remote_ip = adapter_ip.c_str();
+        daikin.tcp.remote_port = adapter_port;
+    }
+
+    if (record)
+    {
+        if (daikin_hal_capture_record(argv[2]) == false)
+            return 1;
+
+        poll_stats_t stats = {};
+        const uint64_t start = now_us();
+        run_polls(&daikin, polls, interval_ms, &stats);
+        print_stats("record", &stats, now_us() - start);
+
+        daikin_hal_capture_stop();
+        return stats.failed > 0 ? 1 : 0;
+    }
+
+    // Every loop replays the capture from the start
+    poll_stats_t total = {};
+    const uint64_t start = now_us();
+    for (uint32_t loop = 0; loop < loops; loop++)
+    {
+        if (daikin_hal_capture_replay(argv[2], speed) == false)
+            return 1;
+
+        poll_stats_t stats = {};
+        run_polls(&daikin, polls, 0, &stats);
+
+        total.polls += stats.polls;
+        total.failed += stats.failed;
+        total.total_us += stats.total_us;
+        total.min_us = total.min_us == 0 || (stats.min_us > 0 && stats.min_us < total.min_us) ? stats.min_us : total.min_us;
+        total.max_us = stats.max_us > total.max_us ? stats.max_us : total.max_us;
+    }
+
+    print_stats("replay", &total, now_us() - start);
+    daikin_hal_capture_stop();
+    return total.failed > 0 ? 1 : 0;
+}
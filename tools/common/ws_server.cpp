@@ -0,0 +1,314 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ws_server.h"
+
+#include "../../src/websockets.h"
+#include "../../src/websockets_deflate.h"
+
+static const size_t MAX_FRAME_LEN = 0xFFFF;
+
+static const uint8_t OPC_CONT_FRAME = 0x0;
+static const uint8_t OPC_TEXT_FRAME = 0x1;
+static const uint8_t OPC_CLOSE_FRAME = 0x8;
+static const uint8_t OPC_PING_FRAME = 0x9;
+static const uint8_t OPC_PONG_FRAME = 0xA;
+
+static const uint8_t RSV1_MASK = 0x40;
+
+static bool g_deflate = false;
+
+static bool write_frame(int fd, uint8_t opcode, const std::string& payload, bool fin = true, bool compressed = false)
+{
+    // Server frames are never masked
+    std::string frame;
+    frame.reserve(10 + payload.length());
+    frame += (char)((fin ? 0x80 : 0) | (compressed ? RSV1_MASK : 0) | opcode);
+
+    const uint64_t len = payload.length();
+    if (len <= 125)
+        frame += (char)len;
+    else if (len <= 0xFFFF)
+    {
+        frame += (char)126;
+        frame += (char)(len >> 8);
+        frame += (char)(len & 0xFF);
+    }
+    else
+    {
+        frame += (char)127;
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame += (char)((len >> shift) & 0xFF);
+    }
+
+    frame += payload;
+    return ws_server_write_all(fd, frame.data(), frame.length());
+}
+
+static bool handle_handshake(ws_server_conn_t* const conn)
+{
+    const size_t end = conn->rx.find("\r\n\r\n");
+    if (end == std::string::npos)
+        return conn->rx.length() < 4096; // Need more data
+
+    const std::string req = conn->rx.substr(0, end);
+    conn->rx.erase(0, end + 4);
+
+    const char token[] = "Sec-WebSocket-Key:";
+    size_t b = req.find(token);
+    if (b == std::string::npos)
+    {
+        fprintf(stderr, "Missing Sec-WebSocket-Key.\n");
+        return false;
+    }
+
+    b += sizeof(token) - 1;
+    while (b < req.length() && req[b] == ' ')
+        b++;
+    const size_t e = req.find("\r\n", b);
+    const std::string key = req.substr(b, e == std::string::npos ? std::string::npos : e - b);
+
+    std::string rsp =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " + ws_create_accept_hash(key) + "\r\n";
+
+    const char extensions[] = "Sec-WebSocket-Extensions:";
+    b = req.find(extensions);
+    if (g_deflate && b != std::string::npos)
+    {
+        b += sizeof(extensions) - 1;
+        const size_t e = req.find("\r\n", b);
+        const std::string offer = req.substr(b, e == std::string::npos ? std::string::npos : e - b);
+
+        // Unsupported offers are declined, the connection stays uncompressed
+        ws_deflate_params_t params;
+        if (ws_deflate_parse(offer.c_str(), &params) &&
+            (conn->deflate = ws_deflate_create(&params, false)) != NULL)
+            rsp += "Sec-WebSocket-Extensions: " + ws_deflate_accept(&params) + "\r\n";
+    }
+
+    rsp += "\r\n";
+
+    conn->upgraded = true;
+    return ws_server_write_all(conn->fd, rsp.data(), rsp.length());
+}
+
+static bool append_inflated(void* ctx, const char* data, uint32_t len)
+{
+    ((std::string*)ctx)->append(data, len);
+    return true;
+}
+
+static bool handle_frames(ws_server_conn_t* const conn, ws_server_text_cb cb, void* ctx)
+{
+    while (conn->rx.length() >= 2)
+    {
+        const uint8_t* const p = (const uint8_t*)conn->rx.data();
+        const uint8_t opcode = p[0] & 0x0F;
+        size_t len = p[1] & 0x7F;
+        size_t hdr_len = 2;
+
+        if (len == 126)
+        {
+            if (conn->rx.length() < 4)
+                return true; // Need more data
+            len = ((size_t)p[2] << 8) | p[3];
+            hdr_len = 4;
+        }
+        else if (len == 127)
+        {
+            fprintf(stderr, "Frames over 64 KiB are not supported.\n");
+            return false;
+        }
+
+        const bool masked = (p[1] & 0x80) != 0;
+        const size_t mask_len = masked ? 4 : 0;
+        if (conn->rx.length() < hdr_len + mask_len + len)
+            return true; // Need more data
+
+        std::string payload = conn->rx.substr(hdr_len + mask_len, len);
+        for (size_t i = 0; masked && i < len; i++)
+            payload[i] = (char)(payload[i] ^ p[hdr_len + i % 4]);
+        const bool compressed = (p[0] & RSV1_MASK) != 0;
+        conn->rx.erase(0, hdr_len + mask_len + len);
+
+        if (compressed)
+        {
+            std::string inflated;
+            if (conn->deflate == NULL ||
+                ws_deflate_inflate((ws_deflate_t*)conn->deflate, payload.data(), (uint32_t)payload.length(), true,
+                    append_inflated, &inflated) == false)
+            {
+                fprintf(stderr, "Invalid compressed frame from %d.\n", conn->fd);
+                return false;
+            }
+            payload.swap(inflated);
+        }
+
+        if (opcode == OPC_CLOSE_FRAME)
+        {
+            write_frame(conn->fd, OPC_CLOSE_FRAME, payload.substr(0, 2));
+            return false;
+        }
+
+        if (opcode == OPC_PING_FRAME && write_frame(conn->fd, OPC_PONG_FRAME, payload) == false)
+            return false;
+
+        if (opcode == OPC_TEXT_FRAME && cb(ctx, payload) == false)
+            return false;
+    }
+
+    return true;
+}
+
+bool ws_server_on_data(
+    ws_server_conn_t* const conn,
+    const char* const data,
+    size_t len,
+    ws_server_text_cb cb,
+    void* ctx)
+{
+    conn->rx.append(data, len);
+    if (conn->rx.length() > MAX_FRAME_LEN + 8)
+    {
+        fprintf(stderr, "Receive buffer of %d exceeded.\n", conn->fd);
+        return false;
+    }
+
+    if (conn->upgraded == false && handle_handshake(conn) == false)
+        return false;
+
+    return conn->upgraded == false || handle_frames(conn, cb, ctx);
+}
+
+void ws_server_enable_deflate(bool enable)
+{
+    g_deflate = enable;
+}
+
+bool ws_server_send_text(const ws_server_conn_t* const conn, const std::string& payload)
+{
+    return ws_server_send_text_fragmented(conn, payload, 0);
+}
+
+bool ws_server_send_text_fragmented(const ws_server_conn_t* const conn, const std::string& payload, size_t fragment_len)
+{
+    // Whole message is compressed, fragments carry pieces of the compressed data
+    std::string data;
+    const bool compressed = conn->deflate != NULL;
+    if (compressed == false)
+        data = payload;
+    else if (ws_deflate_compress((ws_deflate_t*)conn->deflate, payload.data(), (uint32_t)payload.length(), data) == false)
+        return false;
+
+    if (fragment_len == 0 || data.length() <= fragment_len)
+        return write_frame(conn->fd, OPC_TEXT_FRAME, data, true, compressed);
+
+    // Continuation frames with a ping in between, like a busy server would send
+    for (size_t offset = 0; offset < data.length(); offset += fragment_len)
+    {
+        const bool first = offset == 0, fin = offset + fragment_len >= data.length();
+        if (write_frame(conn->fd, first ? OPC_TEXT_FRAME : OPC_CONT_FRAME, data.substr(offset, fragment_len), fin,
+            first && compressed) == false)
+            return false;
+        if (first && write_frame(conn->fd, OPC_PING_FRAME, "mock") == false)
+            return false;
+    }
+
+    return true;
+}
+
+void ws_server_close(ws_server_conn_t* const conn)
+{
+    close(conn->fd);
+    ws_deflate_destroy((ws_deflate_t*)conn->deflate);
+    conn->deflate = NULL;
+}
+
+bool ws_server_write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        const ssize_t ret = send(fd, data, len, MSG_NOSIGNAL);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+
+        data += ret;
+        len -= (size_t)ret;
+    }
+
+    return true;
+}
+
+int ws_server_listen_tcp(const char* const ip, uint16_t port)
+{
+    const int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0)
+        return -1;
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = inet_addr(ip);
+
+    if (bind(s, (struct sockaddr*)&local, sizeof(local)) != 0 || listen(s, 64) != 0)
+    {
+        fprintf(stderr, "Unable to listen on %s:%u. Error: %d\n", ip, port, errno);
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+int ws_server_listen_unix(const char* const path)
+{
+    const int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0)
+        return -1;
+
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(local.sun_path))
+    {
+        fprintf(stderr, "Unix socket path '%s' is too long.\n", path);
+        close(s);
+        return -1;
+    }
+
+    strcpy(local.sun_path, path);
+    unlink(path); // Stale socket of the previous run
+
+    if (bind(s, (struct sockaddr*)&local, sizeof(local)) != 0 || listen(s, 64) != 0)
+    {
+        fprintf(stderr, "Unable to listen on '%s'. Error: %d\n", path, errno);
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+uint32_t ws_server_now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,44 @@
+#ifndef __WS_SERVER_H__
+#define __WS_SERVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <string>
+
+// Minimal WebSocket server side used by the host tools (mock adapter, gateway, ...).
+// Receives only unfragmented text and close frames up to 64 KiB, like the adapter.
+// Sends frames of any length (64-bit length form over 64 KiB).
+
+typedef struct
+{
+    int fd;
+    bool upgraded;
+    std::string rx;
+    void* deflate; // permessage-deflate state when negotiated, freed by ws_server_close
+} ws_server_conn_t;
+
+// Accept permessage-deflate offers of clients (DAIKIN_WS_DEFLATE builds)
+void ws_server_enable_deflate(bool enable);
+
+// Called for every complete text frame. Return false to close the connection.
+typedef bool (*ws_server_text_cb)(void* ctx, const std::string& payload);
+
+// Feeds received bytes (handshake first, frames after). false => close the connection.
+bool ws_server_on_data(ws_server_conn_t* const conn, const char* const data, size_t len,
+    ws_server_text_cb cb, void* ctx);
+
+bool ws_server_send_text(const ws_server_conn_t* const conn, const std::string& payload);
+// Splits messages over fragment_len bytes into continuation frames (0 => never)
+bool ws_server_send_text_fragmented(const ws_server_conn_t* const conn, const std::string& payload, size_t fragment_len);
+void ws_server_close(ws_server_conn_t* const conn);
+bool ws_server_write_all(int fd, const char* data, size_t len);
+
+// Listening sockets, -1 => error
+int ws_server_listen_tcp(const char* const ip, uint16_t port);
+int ws_server_listen_unix(const char* const path);
+
+uint32_t ws_server_now_ms(); // Monotonic
+
+#endif
@@ -0,0 +1,683 @@
+// Local gateway sharing one adapter session between many clients.
+//
+// The adapter accepts only a few WebSocket sessions. The gateway holds a single
+// upstream session and serves local clients which speak the same protocol
+// (any libdaikin client pointed at the gateway with DAIKIN_REMOTE_IP/PORT
+// or daikin_hal_tcp_t.remote_ip/remote_port works unchanged):
+// - reads are served from a shared snapshot while it is younger than --max-age,
+//   identical reads waiting for the adapter are coalesced into one request
+// - writes and other requests are serialized in arrival order
+// - subscriptions are shared, notifications are fanned out to subscribed clients
+// - --deflate 1 compresses both sides with permessage-deflate (DAIKIN_WS_DEFLATE builds)
+//
+// Usage: daikin-gateway --adapter 169.254.126.102[:80] [--listen 127.0.0.1:8081]
+//                       [--unix /run/daikin-gateway.sock] [--max-age 1000] [--deflate 0]
+// SIGUSR1 prints statistics.
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../../include/libdaikinjson.h"
+#include "../../include/libdaikinm2m.h"
+#include "../../src/websockets.h"
+#include "../../src/platforms/linux/libdaikinhal.h"
+#include "../common/ws_server.h"
+
+static const uint32_t RECONNECT_DELAY_MS = 5000;
+static const int32_t RSC_OK = 2000;
+static const int32_t RSC_CREATED = 2001;
+static const int32_t RSC_DELETED = 2002;
+static const int32_t RSC_NOT_FOUND = 4004;
+static const int32_t RSC_CONFLICT = 4105;
+static const int32_t RSC_UNAVAILABLE = 5103; // Target not reachable
+
+typedef struct
+{
+    ws_server_conn_t conn;
+    std::set<std::string> subscriptions; // Container paths
+} gw_client_t;
+
+typedef struct
+{
+    uint32_t client;
+    std::string rqi;
+    std::string fr;
+} gw_waiter_t;
+
+typedef enum
+{
+    JOB_READ,       // Read of path, answered to all waiters of the path
+    JOB_FORWARD,    // Request of one client, serialized
+    JOB_UNSUBSCRIBE // Last local subscriber of the container is gone
+} gw_job_type_t;
+
+typedef struct
+{
+    gw_job_type_t type;
+    std::string path; // Without "/[0]/"
+    gw_waiter_t waiter;
+    int32_t op;
+    int32_t ty;
+    std::string request;
+} gw_job_t;
+
+typedef struct
+{
+    int32_t rsc;
+    std::string pc; // Primitive content, can be empty
+    uint32_t t_ms;
+} gw_snapshot_entry_t;
+
+typedef struct
+{
+    uint32_t client_requests;
+    uint32_t upstream_requests;
+    uint32_t snapshot_hits;
+    uint32_t coalesced;
+    uint32_t notifications;
+    uint32_t reconnects;
+} gw_stats_t;
+
+static daikin_t g_daikin = {};
+static uint32_t g_next_connect_ms = 0;
+static uint32_t g_max_age_ms = 1000;
+
+static std::map<uint32_t, gw_client_t> g_clients;
+static uint32_t g_next_client = 1;
+
+static std::deque<gw_job_t> g_jobs;
+static std::map<std::string, std::vector<gw_waiter_t>> g_pending_reads;
+static std::map<std::string, gw_snapshot_entry_t> g_snapshot;
+static std::map<std::string, uint32_t> g_upstream_subscriptions; // Container => local subscribers
+
+static uint32_t g_rqi = 1;
+static gw_stats_t g_stats = {};
+static volatile sig_atomic_t g_stop = 0;
+static volatile sig_atomic_t g_print_stats = 0;
+
+static const char prefix[] = "/[0]/";
+static const size_t prefix_len = sizeof(prefix) - 1;
+
+// Key paths of objects which are passed on unchanged
+static const char* const PC_PATH[] = { "m2m:rsp", "pc" };
+static const char* const REP_PATH[] = { "m2m:rqp", "pc", "m2m:sgn", "nev", "rep" };
+
+typedef struct
+{
+    const char* const* path;        // Keys from the top level object
+    size_t path_len;
+    std::vector<std::string> keys;  // Key of the current value per depth
+    uint32_t begin;
+    uint32_t end;                   // 0 => not found
+} gw_object_span_t;
+
+static bool on_span_event(daikin_json_t* json, daikin_json_event_t event, const char* text, uint16_t len)
+{
+    gw_object_span_t* const span = (gw_object_span_t*)json->ctx;
+    const size_t depth = json->depth; // Already updated for container events
+
+    if (event == JE_KEY || event == JE_ARRAY_START)
+    {
+        // Values of arrays have no key
+        span->keys.resize(depth);
+        span->keys[depth - 1] = event == JE_KEY ? std::string(text, len) : std::string();
+    }
+    else if (event == JE_OBJECT_START && span->begin == 0 && depth == span->path_len + 1)
+    {
+        bool match = span->keys.size() >= span->path_len;
+        for (size_t i = 0; match && i < span->path_len; i++)
+            match = span->keys[i] == span->path[i];
+        span->begin = match ? json->offset : 0;
+    }
+    else if (event == JE_OBJECT_END && span->begin != 0 && span->end == 0 && depth == span->path_len)
+        span->end = json->offset + 1;
+
+    return true;
+}
+
+// JSON text of the object at the key path, empty => none
+static std::string json_object(const std::string& s, const char* const* path, size_t path_len)
+{
+    gw_object_span_t span = { path, path_len, std::vector<std::string>(), 0, 0 };
+    daikin_json_t json;
+    daikin_json_init(&json, on_span_event, &span);
+
+    if (daikin_json_feed(&json, s.data(), (uint32_t)s.length()) == false || span.end == 0)
+        return "";
+
+    return s.substr(span.begin, span.end - span.begin);
+}
+
+static bool decode(const std::string& s, daikin_m2m_t& msg)
+{
+    return daikin_m2m_decode(s.data(), (uint32_t)s.length(), &msg);
+}
+
+static std::string response_json(int32_t rsc, const gw_waiter_t& w, const std::string& path, const std::string& pc)
+{
+    std::string rsp;
+    rsp.reserve(96 + path.length() + pc.length());
+    rsp += "{\"m2m:rsp\":{\"rsc\":";
+    rsp += std::to_string(rsc);
+    rsp += ",\"rqi\":\"";
+    rsp += w.rqi;
+    rsp += "\",\"to\":\"";
+    rsp += w.fr;
+    rsp += "\",\"fr\":\"";
+    rsp += prefix;
+    rsp += path;
+    rsp += "\"";
+    if (pc.length() > 0)
+    {
+        rsp += ",\"pc\":";
+        rsp += pc;
+    }
+    rsp += "}}";
+    return rsp;
+}
+
+static void reply(const gw_waiter_t& w, const std::string& rsp)
+{
+    auto it = g_clients.find(w.client);
+    if (it == g_clients.end())
+        return; // Client is gone
+
+    if (ws_server_send_text(&it->second.conn, rsp) == false)
+        fprintf(stderr, "Response to client %u failed.\n", w.client);
+}
+
+static bool is_snapshot_fresh(const std::string& path, uint32_t now)
+{
+    auto it = g_snapshot.find(path);
+    return it != g_snapshot.end() && (now - it->second.t_ms) < g_max_age_ms;
+}
+
+static void upstream_disconnect()
+{
+    // Connection is broken, don't wait for the close handshake
+    g_daikin.is_open = false;
+    daikin_close(&g_daikin);
+    g_next_connect_ms = ws_server_now_ms() + RECONNECT_DELAY_MS;
+}
+
+static bool upstream_connect()
+{
+    if (g_daikin.is_open)
+        return true;
+
+    if ((int32_t)(ws_server_now_ms() - g_next_connect_ms) < 0)
+        return false; // Wait before the next attempt
+
+    if (daikin_open(&g_daikin) == false)
+    {
+        fprintf(stderr, "Connecting to the adapter %s:%u failed.\n", g_daikin.tcp.remote_ip, g_daikin.tcp.remote_port);
+        upstream_disconnect();
+        return false;
+    }
+
+    g_stats.reconnects++;
+
+    // Subscriptions don't survive the session
+    for (auto& s : g_upstream_subscriptions)
+    {
+        gw_job_t job = { JOB_FORWARD, s.first, { 0, "", "" }, 1, 23, "" };
+        g_jobs.push_front(job);
+    }
+
+    return true;
+}
+
+static void handle_upstream_notification(const std::string& frame, const daikin_m2m_t& msg)
+{
+    g_stats.notifications++;
+
+    std::string ack = "{\"m2m:rsp\":{\"rsc\":2000,\"rqi\":\"";
+    ack += msg.rqi;
+    ack += "\",\"to\":\"";
+    ack += msg.fr;
+    ack += "\",\"fr\":\"libdaikin\"}}";
+    daikin_ws_send(&g_daikin, ack);
+
+    // Subscription resource is /[0]/<container>/<subscription name>
+    const std::string sur = msg.sur;
+    const size_t slash = sur.rfind('/');
+    if (sur.compare(0, prefix_len, prefix) != 0 || slash == std::string::npos || slash <= prefix_len)
+        return;
+
+    const std::string container = sur.substr(prefix_len, slash - prefix_len);
+
+    // Notified content instance is the new latest value
+    const std::string cin = json_object(frame, REP_PATH, sizeof(REP_PATH) / sizeof(REP_PATH[0]));
+    if (cin.length() > 0)
+        g_snapshot[container + "/la"] = { RSC_OK, cin, ws_server_now_ms() };
+
+    for (auto& c : g_clients)
+    {
+        if (c.second.subscriptions.count(container) != 0)
+            ws_server_send_text(&c.second.conn, frame);
+    }
+}
+
+static bool upstream_request(const std::string& request, std::string& response, daikin_m2m_t& msg)
+{
+    if (upstream_connect() == false)
+        return false;
+
+    g_stats.upstream_requests++;
+
+    if (daikin_ws_send(&g_daikin, request) == false)
+    {
+        upstream_disconnect();
+        return false;
+    }
+
+    while (true)
+    {
+        if (daikin_ws_receive(&g_daikin, response) == false)
+        {
+            upstream_disconnect();
+            return false;
+        }
+
+        decode(response, msg);
+        if (msg.kind != daikin_m2m_kind_t::MK_REQUEST)
+            return true;
+
+        handle_upstream_notification(response, msg);
+    }
+}
+
+static std::string upstream_request_json(int32_t op, const std::string& path, const char* const extra)
+{
+    std::string req = "{\"m2m:rqp\":{\"fr\":\"libdaikin\",\"rqi\":\"";
+    req += std::to_string(g_rqi++);
+    req += "\",\"op\":";
+    req += std::to_string(op);
+    req += ",\"to\":\"";
+    req += prefix;
+    req += path;
+    req += "\"";
+    req += extra;
+    req += "}}";
+    return req;
+}
+
+static void run_read(const gw_job_t& job)
+{
+    std::string response;
+    daikin_m2m_t msg;
+    int32_t rsc = RSC_UNAVAILABLE;
+    std::string pc;
+
+    if (upstream_request(upstream_request_json(2, job.path, ""), response, msg))
+    {
+        rsc = msg.rsc;
+        pc = json_object(response, PC_PATH, sizeof(PC_PATH) / sizeof(PC_PATH[0]));
+        g_snapshot[job.path] = { rsc, pc, ws_server_now_ms() };
+    }
+
+    auto it = g_pending_reads.find(job.path);
+    if (it == g_pending_reads.end())
+        return;
+
+    const std::vector<gw_waiter_t> waiters = it->second;
+    g_pending_reads.erase(it);
+
+    for (const gw_waiter_t& w : waiters)
+        reply(w, response_json(rsc, w, job.path, pc));
+}
+
+static void run_forward(const gw_job_t& job)
+{
+    auto client = g_clients.find(job.waiter.client);
+    const bool is_subscribe = job.op == 1 && job.ty == 23;
+    const bool is_unsubscribe = job.op == 4;
+
+    if (job.waiter.client != 0 && client == g_clients.end())
+        return; // Client is gone
+
+    if (is_subscribe)
+    {
+        const bool upstream = g_upstream_subscriptions.count(job.path) != 0;
+
+        if (job.waiter.client == 0)
+        {
+            // Renewal after reconnect
+            std::string response;
+            daikin_m2m_t msg;
+            upstream_request(upstream_request_json(1, job.path,
+                ",\"ty\":23,\"pc\":{\"m2m:sub\":{\"rn\":\"libdaikin\",\"enc\":{\"net\":[3]},\"nu\":[\"libdaikin\"],\"nct\":1}}"), response, msg);
+            return;
+        }
+
+        if (client->second.subscriptions.count(job.path) != 0)
+        {
+            reply(job.waiter, response_json(RSC_CONFLICT, job.waiter, job.path, ""));
+            return;
+        }
+
+        if (upstream)
+        {
+            // Shared, no need to ask the adapter again
+            g_upstream_subscriptions[job.path]++;
+            client->second.subscriptions.insert(job.path);
+            reply(job.waiter, response_json(RSC_CREATED, job.waiter, job.path, ""));
+            return;
+        }
+    }
+
+    if (is_unsubscribe)
+    {
+        const size_t slash = job.path.rfind('/');
+        const std::string container = slash == std::string::npos ? "" : job.path.substr(0, slash);
+
+        if (client->second.subscriptions.erase(container) == 0)
+        {
+            reply(job.waiter, response_json(RSC_NOT_FOUND, job.waiter, job.path, ""));
+            return;
+        }
+
+        if (--g_upstream_subscriptions[container] > 0)
+        {
+            reply(job.waiter, response_json(RSC_DELETED, job.waiter, job.path, ""));
+            return;
+        }
+
+        g_upstream_subscriptions.erase(container);
+    }
+
+    std::string response;
+    daikin_m2m_t msg;
+    if (upstream_request(job.request, response, msg) == false)
+    {
+        reply(job.waiter, response_json(RSC_UNAVAILABLE, job.waiter, job.path, ""));
+        return;
+    }
+
+    const int32_t rsc = msg.rsc;
+    if (is_subscribe && (rsc == RSC_OK || rsc == RSC_CREATED || rsc == RSC_CONFLICT))
+    {
+        g_upstream_subscriptions[job.path]++;
+        client->second.subscriptions.insert(job.path);
+    }
+
+    // Written value changes the latest instance
+    if (job.op == 1 && job.ty == 4)
+        g_snapshot.erase(job.path + "/la");
+
+    reply(job.waiter, response);
+}
+
+static void run_unsubscribe(const gw_job_t& job)
+{
+    if (g_upstream_subscriptions.count(job.path) != 0)
+        return; // Somebody subscribed again meanwhile
+
+    std::string response;
+    daikin_m2m_t msg;
+    upstream_request(upstream_request_json(4, job.path + "/libdaikin", ""), response, msg);
+}
+
+static void run_job()
+{
+    const gw_job_t job = g_jobs.front();
+    g_jobs.pop_front();
+
+    if (job.type == JOB_READ)
+        run_read(job);
+    else if (job.type == JOB_FORWARD)
+        run_forward(job);
+    else
+        run_unsubscribe(job);
+}
+
+static bool on_text(void* ctx, const std::string& payload)
+{
+    const uint32_t id = (uint32_t)(uintptr_t)ctx;
+
+    daikin_m2m_t msg;
+    const bool decoded = decode(payload, msg);
+
+    // Acknowledge of a notification, the gateway acknowledged it already
+    if (decoded && msg.kind == daikin_m2m_kind_t::MK_RESPONSE)
+        return true;
+
+    g_stats.client_requests++;
+
+    const std::string to = msg.to;
+    gw_job_t job = { JOB_FORWARD, "", { id, msg.rqi, msg.fr }, msg.op, msg.ty, payload };
+
+    // rqi, to and fr must be complete to answer and forward the request
+    if (decoded == false || msg.truncated || to.compare(0, prefix_len, prefix) != 0)
+    {
+        reply(job.waiter, response_json(4000, job.waiter, to, ""));
+        return true;
+    }
+
+    job.path = to.substr(prefix_len);
+
+    if (job.op == 2)
+    {
+        const uint32_t now = ws_server_now_ms();
+        if (is_snapshot_fresh(job.path, now))
+        {
+            g_stats.snapshot_hits++;
+            const gw_snapshot_entry_t& e = g_snapshot[job.path];
+            reply(job.waiter, response_json(e.rsc, job.waiter, job.path, e.pc));
+            return true;
+        }
+
+        std::vector<gw_waiter_t>& waiters = g_pending_reads[job.path];
+        if (waiters.size() > 0)
+            g_stats.coalesced++;
+        else
+        {
+            job.type = JOB_READ;
+            g_jobs.push_back(job);
+        }
+
+        waiters.push_back(job.waiter);
+        return true;
+    }
+
+    g_jobs.push_back(job);
+    return true;
+}
+
+static void drop_client(uint32_t id)
+{
+    auto it = g_clients.find(id);
+    ws_server_close(&it->second.conn);
+
+    for (const std::string& container : it->second.subscriptions)
+    {
+        if (--g_upstream_subscriptions[container] == 0)
+        {
+            g_upstream_subscriptions.erase(container);
+            gw_job_t job = { JOB_UNSUBSCRIBE, container, { 0, "", "" }, 4, 0, "" };
+            g_jobs.push_back(job);
+        }
+    }
+
+    g_clients.erase(it);
+}
+
+static void print_stats()
+{
+    printf("clients: %zu, client requests: %u, upstream requests: %u, snapshot hits: %u, coalesced: %u, "
+        "notifications: %u, connects: %u, subscriptions: %zu\n",
+        g_clients.size(), g_stats.client_requests, g_stats.upstream_requests, g_stats.snapshot_hits,
+        g_stats.coalesced, g_stats.notifications, g_stats.reconnects, g_upstream_subscriptions.size());
+    fflush(stdout);
+}
+
+static void on_signal(int sig)
+{
+    if (sig == SIGUSR1)
+        g_print_stats = 1;
+    else
+        g_stop = 1;
+}
+
+static bool split_address(const char* const s, std::string& ip, uint16_t& port)
+{
+    const char* const colon = strchr(s, ':');
+    ip = colon != NULL ? std::string(s, colon - s) : std::string(s);
+    if (colon != NULL)
+        port = (uint16_t)atoi(colon + 1);
+
+    return ip.length() > 0 && port > 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::string adapter_ip, listen_ip = "127.0.0.1";
+    uint16_t adapter_port = 80, listen_port = 8081;
+    const char* unix_path = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--adapter") == 0 && split_address(argv[i + 1], adapter_ip, adapter_port))
+            continue;
+        if (strcmp(argv[i], "--listen") == 0 && split_address(argv[i + 1], listen_ip, listen_port))
+            continue;
+        if (strcmp(argv[i], "--unix") == 0)
+            unix_path = argv[i + 1];
+        else if (strcmp(argv[i], "--max-age") == 0)
+            g_max_age_ms = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--deflate") == 0)
+        {
+            g_daikin.ws_deflate = atoi(argv[i + 1]) != 0;
+            ws_server_enable_deflate(g_daikin.ws_deflate);
+        }
+        else
+            adapter_ip.clear();
+    }
+
+    if (adapter_ip.length() == 0 || (argc % 2) == 0)
+    {
+        fprintf(stderr, "Usage: %s --adapter ip[:port] [--listen 127.0.0.1:8081] [--unix path] [--max-age 1000] [--deflate 0]\n", argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGUSR1, on_signal);
+
+    g_daikin.tcp.remote_ip = adapter_ip.c_str();
+    g_daikin.tcp.remote_port = adapter_port;
+    g_next_connect_ms = ws_server_now_ms();
+    upstream_connect();
+
+    std::vector<int> listeners;
+    listeners.push_back(ws_server_listen_tcp(listen_ip.c_str(), listen_port));
+    if (unix_path != NULL)
+        listeners.push_back(ws_server_listen_unix(unix_path));
+
+    for (int ls : listeners)
+    {
+        if (ls < 0)
+            return 2;
+    }
+
+    printf("Gateway for %s:%u listening on %s:%u%s%s.\n", adapter_ip.c_str(), adapter_port,
+        listen_ip.c_str(), listen_port, unix_path != NULL ? " and " : "", unix_path != NULL ? unix_path : "");
+    fflush(stdout);
+
+    while (g_stop == 0)
+    {
+        if (g_print_stats)
+        {
+            g_print_stats = 0;
+            print_stats();
+        }
+
+        std::vector<struct pollfd> fds;
+        std::vector<uint32_t> ids;
+
+        for (int ls : listeners)
+            fds.push_back({ ls, POLLIN, 0 });
+
+        const int upstream_fd = g_daikin.is_open ? daikin_hal_linux_fd(&g_daikin.tcp) : -1;
+        fds.push_back({ upstream_fd, POLLIN, 0 }); // Negative fd is ignored by poll
+
+        for (auto& c : g_clients)
+        {
+            fds.push_back({ c.second.conn.fd, POLLIN, 0 });
+            ids.push_back(c.first);
+        }
+
+        // Jobs run one per iteration, requests arriving meanwhile can be coalesced
+        const int timeout = g_jobs.size() > 0 ? 0 : (g_daikin.is_open ? -1 : (int)RECONNECT_DELAY_MS);
+        const int ret = poll(&fds[0], fds.size(), timeout);
+        if (ret < 0 && errno != EINTR)
+            break;
+
+        const size_t first_client = listeners.size() + 1;
+        for (size_t i = first_client; ret > 0 && i < fds.size(); i++)
+        {
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+                continue;
+
+            const uint32_t id = ids[i - first_client];
+            char buf[4096];
+            const ssize_t n = recv(fds[i].fd, buf, sizeof(buf), 0);
+
+            if (n <= 0 || ws_server_on_data(&g_clients[id].conn, buf, (size_t)n, on_text, (void*)(uintptr_t)id) == false)
+                drop_client(id);
+        }
+
+        // Notification while no request is running
+        if (ret > 0 && upstream_fd >= 0 && (fds[listeners.size()].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+        {
+            std::string frame;
+            daikin_m2m_t msg;
+            if (daikin_ws_receive(&g_daikin, frame) == false)
+                upstream_disconnect();
+            else if (decode(frame, msg) && msg.kind == daikin_m2m_kind_t::MK_REQUEST)
+                handle_upstream_notification(frame, msg);
+        }
+
+        for (size_t i = 0; ret > 0 && i < listeners.size(); i++)
+        {
+            if ((fds[i].revents & POLLIN) == 0)
+                continue;
+
+            const int s = accept(listeners[i], NULL, NULL);
+            if (s >= 0)
+                g_clients[g_next_client++] = { { s, false, std::string(), NULL }, std::set<std::string>() };
+        }
+
+        if (g_jobs.size() > 0)
+            run_job();
+        else if (g_daikin.is_open == false)
+            upstream_connect();
+    }
+
+    print_stats();
+    daikin_close(&g_daikin);
+
+    for (auto& c : g_clients)
+        ws_server_close(&c.second.conn);
+    for (int ls : listeners)
+        close(ls);
+    if (unix_path != NULL)
+        unlink(unix_path);
+
+    return 0;
+}
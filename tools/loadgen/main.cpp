@@ -0,0 +1,408 @@
+// Load generator and soak test: how many adapters one gateway drives and how latency degrades.
+//
+// Opens --sessions sessions spread over --adapters adapters (consecutive ports from --adapter,
+// e.g. several daikin-mock-adapter instances, each accepts 64 sessions) and --threads threads.
+// Every session keeps --depth requests in flight: they are sent back to back, then the responses
+// are read in order. --writes percent of the requests write the power state, the others read
+// the indoor temperature. Failed sessions are closed and reopened (counted as reconnects),
+// a request gets --timeout ms.
+//
+// Every --interval seconds and at the end: requests per second, latency p50/p99/p999 (send to
+// response), errors, reconnects, open sessions and resident memory. Run for hours as soak test.
+//
+//   for p in 8080 8081 8082 8083; do daikin-mock-adapter --port $p & done
+//   daikin-loadgen --adapters 4 --sessions 256 --threads 4 --depth 4 --seconds 3600
+//
+// Usage: daikin-loadgen [--adapter 127.0.0.1[:8080]] [--adapters 1] [--sessions 32] [--threads 1]
+//        [--depth 1] [--writes 0] [--seconds 10] [--interval 10] [--timeout 5000]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../../src/time_util.h"
+#include "../../src/websockets.h"
+
+static const uint32_t MOCK_MAX_SESSIONS = 64;
+static const uint32_t REOPEN_DELAY_MS = 100; // After a failed open
+static const uint8_t HISTOGRAM_SUB_BITS = 4; // 16 buckets per power of 2, about 6% resolution
+static const uint32_t HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS;
+
+static const char READ_PATH[] = "/[0]/MNAE/1/Sensor/IndoorTemperature/la";
+static const char WRITE_PATH[] = "/[0]/" DAIKIN_PATH_POWER_STATE;
+
+// Latencies in us, log-linear buckets
+typedef struct
+{
+    std::vector<uint64_t> buckets;
+    uint64_t count;
+    uint64_t max;
+} histogram_t;
+
+typedef struct
+{
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t reconnects;
+    uint64_t failed_opens;
+} counters_t;
+
+typedef struct
+{
+    daikin_t daikin;
+    std::string ip;
+    bool ever_open;
+    uint32_t retry_ms;
+} session_t;
+
+typedef struct
+{
+    uint32_t depth;
+    uint32_t writes;
+    uint32_t timeout_ms;
+} load_config_t;
+
+static std::atomic<bool> g_stop(false);
+static std::atomic<uint32_t> g_open(0);
+static std::mutex g_lock; // Interval totals below
+static histogram_t g_histogram;
+static counters_t g_counters;
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static bool split_address(const char* const arg, std::string& ip, uint16_t& port)
+{
+    const char* const colon = strchr(arg, ':');
+    ip = colon != NULL ? std::string(arg, colon - arg) : std::string(arg);
+    if (colon != NULL)
+        port = (uint16_t)atoi(colon + 1);
+    return ip.length() > 0 && port > 0;
+}
+
+static uint64_t rss_bytes()
+{
+    unsigned long size = 0, resident = 0;
+    FILE* const f = fopen("/proc/self/statm", "r");
+    if (f != NULL)
+    {
+        if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+static void histogram_reset(histogram_t* const h)
+{
+    h->buckets.assign(HISTOGRAM_BUCKETS, 0);
+    h->count = 0;
+    h->max = 0;
+}
+
+static uint32_t bucket_of(uint64_t v)
+{
+    if (v < (1u << HISTOGRAM_SUB_BITS))
+        return (uint32_t)v;
+
+    const uint32_t msb = 63 - (uint32_t)__builtin_clzll(v);
+    const uint32_t shift = msb - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) << HISTOGRAM_SUB_BITS) + (uint32_t)((v >> shift) & ((1u << HISTOGRAM_SUB_BITS) - 1));
+}
+
+// Upper bound of the bucket
+static uint64_t value_of(uint32_t bucket)
+{
+    if (bucket < (1u << HISTOGRAM_SUB_BITS))
+        return bucket;
+
+    const uint32_t shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    const uint64_t sub = (bucket & ((1u << HISTOGRAM_SUB_BITS) - 1)) | (1u << HISTOGRAM_SUB_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+static void histogram_add(histogram_t* const h, uint64_t v)
+{
+    h->buckets[bucket_of(v)]++;
+    h->count++;
+    h->max = v > h->max ? v : h->max;
+}
+
+static void histogram_merge(histogram_t* const to, const histogram_t* const from)
+{
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        to->buckets[i] += from->buckets[i];
+    to->count += from->count;
+    to->max = from->max > to->max ? from->max : to->max;
+}
+
+static uint64_t percentile(const histogram_t* const h, double p)
+{
+    if (h->count == 0)
+        return 0;
+
+    const uint64_t rank = (uint64_t)(p * (double)h->count + 0.5);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen >= rank && seen > 0)
+            return value_of(i) < h->max ? value_of(i) : h->max;
+    }
+
+    return h->max;
+}
+
+static std::string request_json(bool write, uint32_t id)
+{
+    std::string req = "{\"m2m:rqp\":{\"fr\":\"/loadgen\",\"rqi\":\"";
+    req += std::to_string(id);
+    req += write ? "\",\"op\":1,\"to\":\"" : "\",\"op\":2,\"to\":\"";
+    req += write ? WRITE_PATH : READ_PATH;
+    req += write ? "\",\"ty\":4,\"pc\":{\"m2m:cin\":{\"con\":\"on\",\"cnf\":\"text/plain:0\"}}}}" : "\"}}";
+    return req;
+}
+
+static bool is_success(const std::string& rsp)
+{
+    // 2000 retrieved, 2001 created
+    return rsp.find("\"rsc\":2000") != std::string::npos || rsp.find("\"rsc\":2001") != std::string::npos;
+}
+
+static void drop(session_t* const s, counters_t* const c)
+{
+    // Broken anyway, no close handshake
+    daikin_set_deadline(&s->daikin, daikin_hal_time_ms());
+    daikin_close(&s->daikin);
+    daikin_set_deadline(&s->daikin, 0);
+    g_open--;
+    c->errors++;
+}
+
+// One batch of depth requests, false => the session failed
+static bool run_batch(session_t* const s, const load_config_t* const config, uint32_t* const random,
+    histogram_t* const h, counters_t* const c)
+{
+    std::vector<uint64_t> sent(config->depth);
+    std::string rsp;
+
+    for (uint32_t i = 0; i < config->depth; i++)
+    {
+        const bool write = daikin_random_next(random) % 100 < config->writes;
+        sent[i] = now_us();
+        if (daikin_ws_send(&s->daikin, request_json(write, daikin_random_next(random))) == false)
+            return false;
+    }
+
+    for (uint32_t i = 0; i < config->depth; i++)
+    {
+        if (daikin_ws_receive(&s->daikin, rsp) == false || is_success(rsp) == false)
+            return false;
+
+        histogram_add(h, now_us() - sent[i]);
+        c->requests++;
+    }
+
+    return true;
+}
+
+static void worker(std::vector<session_t*> sessions, load_config_t config, uint32_t seed)
+{
+    histogram_t h;
+    histogram_reset(&h);
+    counters_t c = { 0, 0, 0, 0 };
+    uint32_t random = seed | 1;
+
+    while (g_stop.load(std::memory_order_relaxed) == false)
+    {
+        const uint32_t now_ms = daikin_hal_time_ms();
+        bool idle = true;
+
+        for (session_t* const s : sessions)
+        {
+            if (s->daikin.is_open == false)
+            {
+                if ((int32_t)(now_ms - s->retry_ms) < 0)
+                    continue;
+
+                if (daikin_open(&s->daikin) == false)
+                {
+                    daikin_close(&s->daikin);
+                    s->retry_ms = now_ms + REOPEN_DELAY_MS;
+                    c.failed_opens++;
+                    continue;
+                }
+
+                c.reconnects += s->ever_open ? 1 : 0;
+                s->ever_open = true;
+                g_open++;
+            }
+
+            idle = false;
+            if (run_batch(s, &config, &random, &h, &c) == false)
+                drop(s, &c);
+        }
+
+        // Hand over the round, the main thread reports intervals
+        {
+            std::lock_guard<std::mutex> lock(g_lock);
+            histogram_merge(&g_histogram, &h);
+            g_counters.requests += c.requests;
+            g_counters.errors += c.errors;
+            g_counters.reconnects += c.reconnects;
+            g_counters.failed_opens += c.failed_opens;
+        }
+
+        histogram_reset(&h);
+        c = { 0, 0, 0, 0 };
+
+        if (idle)
+            daikin_hal_sleep_ms(REOPEN_DELAY_MS / 10);
+    }
+
+    for (session_t* const s : sessions)
+    {
+        if (s->daikin.is_open)
+            g_open--;
+        daikin_close(&s->daikin);
+    }
+}
+
+static void report(const char* const label, double seconds, const histogram_t* const h, const counters_t* const c)
+{
+    printf("%-8s req/s: %9.0f  p50: %7.2f ms  p99: %7.2f ms  p999: %7.2f ms  max: %7.2f ms  "
+        "errors: %llu  reconnects: %llu  failed opens: %llu  open: %u  rss: %.1f MB\n",
+        label, (double)c->requests / seconds,
+        percentile(h, 0.5) / 1000.0, percentile(h, 0.99) / 1000.0, percentile(h, 0.999) / 1000.0, h->max / 1000.0,
+        (unsigned long long)c->errors, (unsigned long long)c->reconnects, (unsigned long long)c->failed_opens,
+        g_open.load(), (double)rss_bytes() / (1024.0 * 1024.0));
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    std::string adapter_ip = "127.0.0.1";
+    uint16_t adapter_port = 8080;
+    uint32_t adapters = 1, sessions_count = 32, threads = 1, seconds = 10, interval = 10;
+    load_config_t config = { 1, 0, 5000 };
+    bool usage = (argc % 2) == 0;
+
+    for (int i = 1; usage == false && i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--adapter") == 0)
+            usage = split_address(argv[i + 1], adapter_ip, adapter_port) == false;
+        else if (strcmp(argv[i], "--adapters") == 0)
+            adapters = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--sessions") == 0)
+            sessions_count = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--depth") == 0)
+            config.depth = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--writes") == 0)
+            config.writes = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seconds") == 0)
+            seconds = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--interval") == 0)
+            interval = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--timeout") == 0)
+            config.timeout_ms = (uint32_t)atoi(argv[i + 1]);
+        else
+            usage = true;
+    }
+
+    if (usage || adapters == 0 || sessions_count == 0 || threads == 0 || config.depth == 0 ||
+        config.writes > 100 || seconds == 0 || interval == 0)
+    {
+        fprintf(stderr, "Usage: %s [--adapter 127.0.0.1[:8080]] [--adapters 1] [--sessions 32] [--threads 1]\n"
+            "       [--depth 1] [--writes 0] [--seconds 10] [--interval 10] [--timeout 5000]\n", argv[0]);
+        return 1;
+    }
+
+    if ((sessions_count + adapters - 1) / adapters > MOCK_MAX_SESSIONS)
+        fprintf(stderr, "Warning: more than %u sessions per adapter, a mock adapter refuses them.\n", MOCK_MAX_SESSIONS);
+
+    std::vector<session_t> sessions(sessions_count);
+    std::vector<std::vector<session_t*>> per_thread(threads);
+    for (uint32_t i = 0; i < sessions_count; i++)
+    {
+        session_t* const s = &sessions[i];
+        memset(&s->daikin, 0, sizeof(s->daikin));
+        s->ip = adapter_ip;
+        s->daikin.tcp.remote_ip = s->ip.c_str();
+        s->daikin.tcp.remote_port = (uint16_t)(adapter_port + i % adapters);
+        s->daikin.tcp.timeout_ms = config.timeout_ms;
+        s->ever_open = false;
+        s->retry_ms = 0;
+        per_thread[i % threads].push_back(s);
+    }
+
+    printf("sessions: %u  adapters: %u  threads: %u  depth: %u  writes: %u%%\n",
+        sessions_count, adapters, threads, config.depth, config.writes);
+
+    histogram_reset(&g_histogram);
+    histogram_t total;
+    histogram_reset(&total);
+    counters_t total_counters = { 0, 0, 0, 0 };
+
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads; t++)
+        workers.push_back(std::thread(worker, per_thread[t], config, 0x9E3779B9u * (t + 1)));
+
+    const uint64_t start = now_us();
+    uint64_t interval_start = start;
+    while (now_us() - start < (uint64_t)seconds * 1000000ull)
+    {
+        const uint64_t end = start + (uint64_t)seconds * 1000000ull;
+        const uint64_t next = interval_start + (uint64_t)interval * 1000000ull;
+        const uint64_t until = next < end ? next : end;
+        while (now_us() < until)
+            daikin_hal_sleep_ms(10);
+
+        histogram_t h;
+        counters_t c;
+        {
+            std::lock_guard<std::mutex> lock(g_lock);
+            h = g_histogram;
+            c = g_counters;
+            histogram_reset(&g_histogram);
+            g_counters = { 0, 0, 0, 0 };
+        }
+
+        const uint64_t now = now_us();
+        if (until == next)
+            report("interval", (double)(now - interval_start) / 1e6, &h, &c);
+
+        histogram_merge(&total, &h);
+        total_counters.requests += c.requests;
+        total_counters.errors += c.errors;
+        total_counters.reconnects += c.reconnects;
+        total_counters.failed_opens += c.failed_opens;
+        interval_start = now;
+    }
+
+    g_stop = true;
+    for (std::thread& t : workers)
+        t.join();
+
+    // Requests finished while stopping count too
+    histogram_merge(&total, &g_histogram);
+    total_counters.requests += g_counters.requests;
+    total_counters.errors += g_counters.errors;
+    report("total", (double)(now_us() - start) / 1e6, &total, &total_counters);
+    return 0;
+}
@@ -0,0 +1,387 @@
+// Mock of the Daikin LAN adapter (BRP069A61/62) for development without a heat pump.
+//
+// Speaks the same WebSocket/oneM2M subset as the adapter:
+// - op 2 (retrieve) of "<path>/la"
+// - op 1 (create) of a content instance (ty 4) or a subscription (ty 23)
+// - op 4 (delete) of a subscription
+// Sensor values drift every --notify-interval ms and subscribers get notifications.
+//
+// --fragment splits messages into continuation frames with a ping in between.
+// --deflate 1 accepts permessage-deflate offers (DAIKIN_WS_DEFLATE builds).
+//
+// Usage: daikin-mock-adapter [--port 8080] [--notify-interval 5000] [--mode target|offset] [--fragment 0]
+//                            [--deflate 0]
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../include/libdaikin.h"
+#include "../common/ws_server.h"
+
+static const size_t MAX_CLIENTS = 64;
+
+typedef struct
+{
+    std::string con; // JSON representation of the value
+    bool writable;
+    bool available;
+} mock_value_t;
+
+typedef struct
+{
+    ws_server_conn_t conn;
+    std::set<std::string> subscriptions; // Container paths
+} mock_client_t;
+
+static std::map<std::string, mock_value_t> g_values;
+static std::vector<mock_client_t> g_clients;
+static uint32_t g_rqi = 1;
+static volatile sig_atomic_t g_stop = 0;
+static size_t g_fragment_len = 0; // 0 => unfragmented
+
+static std::string timestamp()
+{
+    // Adapter format: 20240101T120000Z
+    char buf[20];
+    const time_t t = time(NULL);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, sizeof(buf), "%Y%m%dT%H%M%SZ", &tm);
+    return buf;
+}
+
+static void set_value(const char* const path, const char* const con, bool writable)
+{
+    g_values[path] = { con, writable, true };
+}
+
+static void init_values(bool target_mode)
+{
+    set_value(DAIKIN_PATH_INDOOR_TEMP, "21.5", false);
+    set_value(DAIKIN_PATH_OUTDOOR_TEMP, "4.0", false);
+    set_value(DAIKIN_PATH_LEAVING_WATER_TEMP, "35.0", false);
+    set_value(DAIKIN_PATH_TEMP_TARGET, "22", true);
+    set_value(DAIKIN_PATH_TEMP_OFFSET, "0", true);
+    set_value(DAIKIN_PATH_POWER_STATE, "\"on\"", true);
+    set_value(DAIKIN_PATH_OPERATION_MODE, "\"heating\"", true);
+    set_value(DAIKIN_PATH_EMERGENCY_STATE, "0", false);
+    set_value(DAIKIN_PATH_ERROR_STATE, "0", false);
+    set_value(DAIKIN_PATH_WARNING_STATE, "0", false);
+    set_value(DAIKIN_PATH_CONSUMPTION, "{\"Electrical\":{\"Heating\":{\"D\":[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]}}}", false);
+
+    // Only one set point is used, depending on the temperature mode
+    g_values[DAIKIN_PATH_TEMP_TARGET].available = target_mode;
+    g_values[DAIKIN_PATH_TEMP_OFFSET].available = !target_mode;
+}
+
+static std::string json_string(const std::string& s, const char* const key)
+{
+    const std::string token = std::string("\"") + key + "\":\"";
+    size_t b = s.find(token);
+    if (b == std::string::npos)
+        return "";
+
+    b += token.length();
+    const size_t e = s.find('"', b);
+    return e == std::string::npos ? "" : s.substr(b, e - b);
+}
+
+static int32_t json_int(const std::string& s, const char* const key)
+{
+    const std::string token = std::string("\"") + key + "\":";
+    const size_t b = s.find(token);
+    if (b == std::string::npos)
+        return -1;
+
+    return (int32_t)strtol(s.c_str() + b + token.length(), NULL, 10);
+}
+
+static std::string json_con(const std::string& s)
+{
+    const char token[] = "\"con\":";
+    size_t b = s.find(token);
+    if (b == std::string::npos)
+        return "";
+
+    b += sizeof(token) - 1;
+    size_t e = b;
+    if (s[e] == '"')
+        e = s.find('"', e + 1) + 1;
+    else
+    {
+        while (e < s.length() && s[e] != ',' && s[e] != '}')
+            e++;
+    }
+
+    return s.substr(b, e - b);
+}
+
+static std::string cin_json(const mock_value_t& v)
+{
+    const std::string ts = timestamp();
+    return "{\"m2m:cin\":{\"con\":" + v.con + ",\"cnf\":\"text/plain:0\",\"ty\":4,\"ct\":\"" +
+        ts + "\",\"lt\":\"" + ts + "\"}}";
+}
+
+static std::string response_json(int32_t rsc, const std::string& rqi, const std::string& fr,
+    const std::string& to, const std::string& pc)
+{
+    std::string rsp = "{\"m2m:rsp\":{\"rsc\":" + std::to_string(rsc) + ",\"rqi\":\"" + rqi +
+        "\",\"to\":\"" + fr + "\",\"fr\":\"" + to + "\"";
+    if (pc.length() > 0)
+        rsp += ",\"pc\":" + pc;
+    return rsp + "}}";
+}
+
+static void notify(const std::string& path)
+{
+    const mock_value_t& v = g_values[path];
+    if (v.available == false)
+        return;
+
+    for (mock_client_t& c : g_clients)
+    {
+        if (c.subscriptions.count(path) == 0)
+            continue;
+
+        const std::string sur = "/[0]/" + path + "/libdaikin";
+        const std::string rqp = "{\"m2m:rqp\":{\"op\":5,\"to\":\"libdaikin\",\"fr\":\"/[0]/MNAE\",\"rqi\":\"" +
+            std::to_string(g_rqi++) + "\",\"pc\":{\"m2m:sgn\":{\"nev\":{\"rep\":" + cin_json(v) +
+            ",\"net\":3},\"sur\":\"" + sur + "\"}}}}";
+
+        if (ws_server_send_text_fragmented(&c.conn, rqp, g_fragment_len) == false)
+            fprintf(stderr, "Notification to %d failed.\n", c.conn.fd);
+    }
+}
+
+static std::string handle_request(mock_client_t& c, const std::string& req)
+{
+    const std::string rqi = json_string(req, "rqi");
+    const std::string fr = json_string(req, "fr");
+    const std::string to = json_string(req, "to");
+    const int32_t op = json_int(req, "op");
+
+    const char prefix[] = "/[0]/";
+    if (to.compare(0, sizeof(prefix) - 1, prefix) != 0)
+        return response_json(4000, rqi, fr, to, "");
+
+    std::string path = to.substr(sizeof(prefix) - 1);
+
+    if (op == 2)
+    {
+        const char la[] = "/la";
+        if (path.length() > sizeof(la) - 1 && path.compare(path.length() - (sizeof(la) - 1), sizeof(la) - 1, la) == 0)
+            path.resize(path.length() - (sizeof(la) - 1));
+
+        auto it = g_values.find(path);
+        if (it == g_values.end())
+            return response_json(4004, rqi, fr, to, "");
+        if (it->second.available == false)
+            return response_json(4000, rqi, fr, to, "");
+
+        return response_json(2000, rqi, fr, to, cin_json(it->second));
+    }
+
+    if (op == 1 && json_int(req, "ty") == 23)
+    {
+        if (g_values.count(path) == 0)
+            return response_json(4004, rqi, fr, to, "");
+        if (c.subscriptions.insert(path).second == false)
+            return response_json(4105, rqi, fr, to, "");
+
+        return response_json(2001, rqi, fr, to, "");
+    }
+
+    if (op == 1 && json_int(req, "ty") == 4)
+    {
+        auto it = g_values.find(path);
+        if (it == g_values.end())
+            return response_json(4004, rqi, fr, to, "");
+        if (it->second.writable == false || it->second.available == false)
+            return response_json(4005, rqi, fr, to, "");
+
+        const std::string con = json_con(req);
+        if (con.length() == 0)
+            return response_json(4000, rqi, fr, to, "");
+
+        const bool changed = it->second.con != con;
+        it->second.con = con;
+
+        // Response goes first, notifications of the change follow
+        ws_server_send_text_fragmented(&c.conn, response_json(2001, rqi, fr, to, ""), g_fragment_len);
+        if (changed)
+            notify(path);
+        return "";
+    }
+
+    if (op == 4)
+    {
+        const std::string suffix = "/libdaikin";
+        if (path.length() <= suffix.length() ||
+            path.compare(path.length() - suffix.length(), suffix.length(), suffix) != 0)
+            return response_json(4004, rqi, fr, to, "");
+
+        path.resize(path.length() - suffix.length());
+        if (c.subscriptions.erase(path) == 0)
+            return response_json(4004, rqi, fr, to, "");
+
+        return response_json(2002, rqi, fr, to, "");
+    }
+
+    return response_json(4000, rqi, fr, to, "");
+}
+
+static void drift()
+{
+    // Random walk of the sensors, notifications for every change
+    const char* const sensors[] = { DAIKIN_PATH_INDOOR_TEMP, DAIKIN_PATH_OUTDOOR_TEMP, DAIKIN_PATH_LEAVING_WATER_TEMP };
+
+    for (const char* const path : sensors)
+    {
+        mock_value_t& v = g_values[path];
+        const double step = ((rand() % 5) - 2) * 0.5;
+        if (step == 0)
+            continue;
+
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%.1f", strtod(v.con.c_str(), NULL) + step);
+        v.con = buf;
+        notify(path);
+    }
+}
+
+static bool on_text(void* ctx, const std::string& payload)
+{
+    mock_client_t& c = *(mock_client_t*)ctx;
+
+    // Acknowledge of our notification
+    if (payload.compare(0, 10, "{\"m2m:rsp\"") == 0)
+        return true;
+
+    const std::string rsp = handle_request(c, payload);
+    return rsp.length() == 0 || ws_server_send_text_fragmented(&c.conn, rsp, g_fragment_len);
+}
+
+static void on_signal(int)
+{
+    g_stop = 1;
+}
+
+int main(int argc, char** argv)
+{
+    uint16_t port = 8080;
+    uint32_t notify_interval = 5000;
+    bool target_mode = false;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--port") == 0)
+            port = (uint16_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--notify-interval") == 0)
+            notify_interval = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--mode") == 0)
+            target_mode = strcmp(argv[i + 1], "target") == 0;
+        else if (strcmp(argv[i], "--fragment") == 0)
+            g_fragment_len = (size_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--deflate") == 0)
+            ws_server_enable_deflate(atoi(argv[i + 1]) != 0);
+        else
+        {
+            fprintf(stderr, "Usage: %s [--port 8080] [--notify-interval 5000] [--mode target|offset] [--fragment 0] [--deflate 0]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    init_values(target_mode);
+
+    const int ls = ws_server_listen_tcp("0.0.0.0", port);
+    if (ls < 0)
+        return 2;
+
+    printf("Mock adapter listening on port %u.\n", port);
+    fflush(stdout);
+
+    uint32_t next_drift = ws_server_now_ms() + notify_interval;
+
+    while (g_stop == 0)
+    {
+        std::vector<struct pollfd> fds;
+        fds.push_back({ ls, POLLIN, 0 });
+        for (const mock_client_t& c : g_clients)
+            fds.push_back({ c.conn.fd, POLLIN, 0 });
+
+        int timeout = -1;
+        if (notify_interval > 0)
+        {
+            const int32_t left = (int32_t)(next_drift - ws_server_now_ms());
+            timeout = left > 0 ? left : 0;
+        }
+
+        int ret = poll(&fds[0], fds.size(), timeout);
+        if (ret < 0 && errno != EINTR)
+            break;
+
+        if (notify_interval > 0 && (int32_t)(ws_server_now_ms() - next_drift) >= 0)
+        {
+            drift();
+            next_drift = ws_server_now_ms() + notify_interval;
+        }
+
+        if (ret <= 0)
+            continue;
+
+        // Clients first, accepting changes g_clients
+        for (size_t i = fds.size() - 1; i > 0; i--)
+        {
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+                continue;
+
+            mock_client_t& c = g_clients[i - 1];
+            char buf[4096];
+            const ssize_t n = recv(c.conn.fd, buf, sizeof(buf), 0);
+
+            if (n <= 0 || ws_server_on_data(&c.conn, buf, (size_t)n, on_text, &c) == false)
+            {
+                ws_server_close(&c.conn);
+                g_clients.erase(g_clients.begin() + (i - 1));
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int s = accept(ls, NULL, NULL);
+            if (s >= 0 && g_clients.size() < MAX_CLIENTS)
+            {
+                // Pipelined responses go out as they're ready, not held back by Nagle
+                const int one = 1;
+                setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                g_clients.push_back({ { s, false, std::string(), NULL }, std::set<std::string>() });
+            }
+            else if (s >= 0)
+                close(s);
+        }
+    }
+
+    for (mock_client_t& c : g_clients)
+        ws_server_close(&c.conn);
+    close(ls);
+    return 0;
+}